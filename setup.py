@@ -102,6 +102,18 @@ else:
         'src/libbiosiglite/biosig4c++/physicalunits.c'
     ]
 
+# OpenMP for the parallel file decoders and analysis functions;
+# Apple's clang doesn't support it
+if os.name == "nt":
+    openmp_compile_args = ['/openmp']
+    openmp_link_args = []
+elif sys.platform == "darwin":
+    openmp_compile_args = []
+    openmp_link_args = []
+else:
+    openmp_compile_args = ['-fopenmp']
+    openmp_link_args = ['-fopenmp']
+
 fftw3_libraries = ['fftw3']
 if 'libraries' in system_info.get_info('fftw3').keys():
     fftw3_libraries = system_info.get_info('fftw3')['libraries']
@@ -166,9 +178,9 @@ stfio_module = Extension(
     define_macros=np_define_macros + biosig_define_macros +
     win_define_macros,
     extra_compile_args=np_extra_compile_args + hdf5_extra_compile_args +
-    win_compile_args,
+    win_compile_args + openmp_compile_args,
     extra_link_args=np_extra_link_args + hdf5_extra_link_args +
-    win_link_args,
+    win_link_args + openmp_link_args,
     include_dirs=win_include_dirs,
     sources=[
         'src/libstfio/abf/abflib.cpp',
@@ -197,6 +209,9 @@ stfio_module = Extension(
         'src/libstfio/axg/stringUtils.cpp',
         'src/libstfio/biosig/biosiglib.cpp',
         'src/libstfio/cfs/cfs.c',
+        'src/libstfio/ascii/asciilib.cpp',
+        'src/libstfio/ascii/textparser.cpp',
+        'src/libstfio/cache/cachelib.cpp',
         'src/libstfio/cfs/cfslib.cpp',
         'src/libstfio/channel.cpp',
         'src/libstfio/hdf5/hdf5lib.cpp',
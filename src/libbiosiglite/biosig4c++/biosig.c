@@ -12525,7 +12525,8 @@ size_t sread_raw(size_t start, size_t length, HDRTYPE* hdr, char flag, void *buf
 
 		// read data
 		count = ifread(tmpptr, hdr->AS.bpb, nelem, hdr);
-		if (buf != NULL) {
+		if (buf == NULL) {
+			// the records are now cached in hdr->AS.rawdata
 			hdr->AS.flag_collapsed_rawdata = 0;	// is rawdata not collapsed
 			hdr->AS.first = start;
 			hdr->AS.length= count;
@@ -12561,6 +12562,128 @@ int cachingWholeFile(HDRTYPE* hdr) {
 /****************************************************************************/
 /**	SREAD : segment-based                                              **/
 /****************************************************************************/
+/*
+ *	Conversion kernels for sread: each converts the samples of one channel
+ *	in NREC consecutive data records with a single loop per type and byte
+ *	order, with overflow detection and calibration (unless ucal) applied in
+ *	the same pass.
+ *	  src, srec, sstep: first sample, record size and sample distance in bytes
+ *	  dst, drec, dstep: first value, record size and value distance in elements
+ *	Returns 0 if there is no kernel for GDFTYP.
+ */
+static inline float bswap_f32p(const uint8_t *p) {
+	union {uint32_t i32; float f32;} u;
+	u.i32 = bswap_32(*(const uint32_t*)p);
+	return u.f32;
+}
+
+static inline double bswap_f64p(const uint8_t *p) {
+	union {uint64_t i64; double f64;} u;
+	u.i64 = bswap_64(*(const uint64_t*)p);
+	return u.f64;
+}
+
+#define SREAD_KERNEL(LOAD) \
+	for (k4 = 0; k4 < nrec; k4++) { \
+		const uint8_t *s = src + k4*srec; \
+		biosig_data_type *d = dst + k4*drec; \
+		if (ovf) { \
+			for (k5 = 0; k5 < spr; k5++) { \
+				biosig_data_type v = (biosig_data_type)(LOAD); \
+				if ((v <= DigMin) || (v >= DigMax)) v = NAN; \
+				d[k5*dstep] = ucal ? v : v*Cal + Off; \
+			} \
+		} \
+		else if (ucal) { \
+			for (k5 = 0; k5 < spr; k5++) \
+				d[k5*dstep] = (biosig_data_type)(LOAD); \
+		} \
+		else { \
+			for (k5 = 0; k5 < spr; k5++) \
+				d[k5*dstep] = (biosig_data_type)(LOAD)*Cal + Off; \
+		} \
+	}
+
+#define SREAD_SAMPLE(TYPE) (*(const TYPE*)(s + k5*sstep))
+
+static int sread_convert(biosig_data_type *dst, size_t drec, size_t dstep,
+		const uint8_t *src, size_t srec, size_t sstep, size_t nrec, size_t spr,
+		uint16_t GDFTYP, char SWAP, char ovf, char ucal,
+		double DigMin, double DigMax, double Cal, double Off) {
+
+	size_t k4, k5;
+	switch (GDFTYP) {
+	case 1:
+		SREAD_KERNEL(SREAD_SAMPLE(int8_t));
+		break;
+	case 2:
+		SREAD_KERNEL(SREAD_SAMPLE(uint8_t));
+		break;
+	case 3:
+		if (SWAP) {
+			SREAD_KERNEL((int16_t)bswap_16(SREAD_SAMPLE(uint16_t)));
+		} else {
+			SREAD_KERNEL(SREAD_SAMPLE(int16_t));
+		}
+		break;
+	case 4:
+		if (SWAP) {
+			SREAD_KERNEL((uint16_t)bswap_16(SREAD_SAMPLE(uint16_t)));
+		} else {
+			SREAD_KERNEL(SREAD_SAMPLE(uint16_t));
+		}
+		break;
+	case 5:
+		if (SWAP) {
+			SREAD_KERNEL((int32_t)bswap_32(SREAD_SAMPLE(uint32_t)));
+		} else {
+			SREAD_KERNEL(SREAD_SAMPLE(int32_t));
+		}
+		break;
+	case 6:
+		if (SWAP) {
+			SREAD_KERNEL((uint32_t)bswap_32(SREAD_SAMPLE(uint32_t)));
+		} else {
+			SREAD_KERNEL(SREAD_SAMPLE(uint32_t));
+		}
+		break;
+	case 7:
+		if (SWAP) {
+			SREAD_KERNEL((int64_t)bswap_64(SREAD_SAMPLE(uint64_t)));
+		} else {
+			SREAD_KERNEL(SREAD_SAMPLE(int64_t));
+		}
+		break;
+	case 8:
+		if (SWAP) {
+			SREAD_KERNEL((uint64_t)bswap_64(SREAD_SAMPLE(uint64_t)));
+		} else {
+			SREAD_KERNEL(SREAD_SAMPLE(uint64_t));
+		}
+		break;
+	case 16:
+		if (SWAP) {
+			SREAD_KERNEL(bswap_f32p(s + k5*sstep));
+		} else {
+			SREAD_KERNEL(SREAD_SAMPLE(float));
+		}
+		break;
+	case 17:
+		if (SWAP) {
+			SREAD_KERNEL(bswap_f64p(s + k5*sstep));
+		} else {
+			SREAD_KERNEL(SREAD_SAMPLE(double));
+		}
+		break;
+	default:
+		return 0;
+	}
+	return 1;
+}
+
+#undef SREAD_SAMPLE
+#undef SREAD_KERNEL
+
 size_t sread(biosig_data_type* data, size_t start, size_t length, HDRTYPE* hdr) {
 /*
  *	Reads LENGTH blocks with HDR.AS.bpb BYTES each
@@ -12696,8 +12819,18 @@ size_t sread(biosig_data_type* data, size_t start, size_t length, HDRTYPE* hdr)
 
 		union {int16_t i16; uint16_t u16; uint32_t i32; float f32; uint64_t i64; double f64;} u;
 
+		// common data types are converted by a specialized kernel,
+		// the sample-by-sample loop below handles everything else
+		char CONVERTED = (DIV == 1) && (VERBOSE_LEVEL <= 8) && (hdr->TYPE != FEF) &&
+			sread_convert(hdr->FLAG.ROW_BASED_CHANNELS ? data1 + k2 : data1 + k2*count*hdr->SPR,
+				hdr->FLAG.ROW_BASED_CHANNELS ? hdr->SPR*NS : hdr->SPR,
+				hdr->FLAG.ROW_BASED_CHANNELS ? NS : 1,
+				hdr->AS.rawdata + toffset*hdr->AS.bpb + CHptr->bi, hdr->AS.bpb, stride*SZ >> 3,
+				count, CHptr->SPR, GDFTYP, SWAP, hdr->FLAG.OVERFLOWDETECTION, hdr->FLAG.UCAL,
+				CHptr->DigMin, CHptr->DigMax, CHptr->Cal, CHptr->Off);
+
 		// TODO:  MIT data types
-		for (k4 = 0; k4 < count; k4++)
+		for (k4 = 0; !CONVERTED && k4 < count; k4++)
 		{  	uint8_t *ptr1;
 
 #ifndef  ONLYGDF
@@ -34,6 +34,57 @@ std::string ABF1Error(const std::string& fName, int nError);
 
 }
 
+namespace {
+
+// Channel names and units are padded with blanks in the file header.
+std::string trimABFString(const char* str) {
+    std::string trimmed(str);
+    if (trimmed.find("  ") < trimmed.size()) {
+        trimmed.erase(trimmed.begin()+trimmed.find("  "), trimmed.end());
+    }
+    return trimmed;
+}
+
+void setABF2Attributes(const ABF2FileHeader* pFH, Recording& ReturnData) {
+    ReturnData.SetXScale((double)(pFH->fADCSequenceInterval/1000.0));
+    
+    std::string comment("Created with ");
+    comment += std::string( pFH->sCreatorInfo );
+    ReturnData.SetComment(comment);
+
+    ldiv_t year=ldiv(pFH->uFileStartDate,(ABFLONG)10000);
+    ldiv_t month=ldiv(year.rem,(ABFLONG)100);
+
+    ldiv_t hours=ldiv(pFH->uFileStartTimeMS/1000,(ABFLONG)3600);
+    ldiv_t minutes=ldiv(hours.rem,(ABFLONG)60);
+
+    // Recording::SetDateTime expects the year to be passed as the number of years since 1900, and the month
+    // as 0 = Jan ... 11 = Dec
+    ReturnData.SetDateTime(year.quot-1900, month.quot-1, month.rem, hours.quot, minutes.quot, minutes.rem);
+}
+
+void setABF1Attributes(ABFFileHeader& FH, Recording& ReturnData) {
+    // Apparently, the sample interval has to be multiplied by
+    // the number of channels for multiplexed data. Thanks to
+    // Dominique Engel for noticing.
+    ReturnData.SetXScale((double)(FH.fADCSampleInterval/1000.0)*(double)FH.nADCNumChannels);
+    std::string comment("Created with ");
+    FH.sCreatorInfo[ABF_CREATORINFOLEN-1]=0;  // make sure string is 0-terminated
+    FH._sFileComment[ABF_OLDFILECOMMENTLEN-1]=0;  // make sure string is 0-terminated
+    comment += std::string( FH.sCreatorInfo );
+    ReturnData.SetComment(comment);
+
+    ldiv_t year=ldiv(FH.lFileStartDate,(ABFLONG)10000);
+    ldiv_t month=ldiv(year.rem,(ABFLONG)100);
+
+    ldiv_t hours=ldiv(FH.lFileStartTime,(ABFLONG)3600);
+    ldiv_t minutes=ldiv(hours.rem,(ABFLONG)60);
+
+    ReturnData.SetDateTime(year.quot, month.quot, month.rem, hours.quot, minutes.quot, minutes.rem);
+}
+
+}
+
 std::string stfio::ABF1Error(const std::string& fName, int nError) {
     UINT uMaxLen=320;
     std::vector<char> errorMsg(uMaxLen);
@@ -43,7 +94,8 @@ std::string stfio::ABF1Error(const std::string& fName, int nError) {
     return std::string( &errorMsg[0] );
 }
 
-void stfio::importABFFile(const std::string &fName, Recording &ReturnData, ProgressInfo& progDlg) {
+void stfio::importABFFile(const std::string &fName, Recording &ReturnData, ProgressInfo& progDlg,
+                          const stfio::ImportFilter& filter) {
     ABF2_FileInfo fileInfo;
 
     // Open file:
@@ -100,14 +152,15 @@ void stfio::importABFFile(const std::string &fName, Recording &ReturnData, Progr
 #endif
     
     if (CABF2ProtocolReader::CanOpen( (void*)&fileInfo, sizeof(fileInfo) )) {
-        importABF2File( std::string(fName.c_str()), ReturnData, progDlg );
+        importABF2File( std::string(fName.c_str()), ReturnData, progDlg, filter );
     } else {
-        importABF1File( std::string(fName.c_str()), ReturnData, progDlg );
+        importABF1File( std::string(fName.c_str()), ReturnData, progDlg, filter );
     }
 }
 
 
-void stfio::importABF2File(const std::string &fName, Recording &ReturnData, ProgressInfo& progDlg) {
+void stfio::importABF2File(const std::string &fName, Recording &ReturnData, ProgressInfo& progDlg,
+                           const stfio::ImportFilter& filter) {
 
     CABF2ProtocolReader abf2;
     std::wstring wfName;
@@ -167,8 +220,18 @@ void stfio::importABF2File(const std::string &fName, Recording &ReturnData, Prog
         }
         finalSections = 1;
     }
-    for (int nChannel=0; nChannel < numberChannels; ++nChannel) {
-        int progbar = (int)(((double)nChannel/(double)numberChannels)*100.0);
+    std::vector<int> channels;
+    try {
+        channels = filter.SelectChannels(numberChannels);
+    }
+    catch (...) {
+        ABF_Close(hFile,&nError);
+        throw;
+    }
+    int numberSelected = (int)channels.size();
+    for (int nSelected=0; nSelected < numberSelected; ++nSelected) {
+        int nChannel = channels[nSelected];
+        int progbar = (int)(((double)nSelected/(double)numberSelected)*100.0);
         progDlg.Update(progbar, "Memory allocation");
         ABFLONG grandsize = pFH->lNumSamplesPerEpisode / numberChannels;
         std::ostringstream label;
@@ -196,14 +259,29 @@ void stfio::importABF2File(const std::string &fName, Recording &ReturnData, Prog
                 finalSections=numberSections;
             }
         }
+        int firstEpisode = 1, lastEpisode = numberSections;
+        int firstSweep = 0, endSweep = 0;
+        if (gapfree) {
+            // a gapfree file is a single sweep that is read in chunks
+            filter.SelectSweeps(1, firstSweep, endSweep);
+            if (endSweep == firstSweep) {
+                lastEpisode = 0;
+                finalSections = 0;
+            }
+        } else {
+            filter.SelectSweeps((int)numberSections, firstSweep, endSweep);
+            firstEpisode = firstSweep+1;
+            lastEpisode = endSweep;
+            finalSections = endSweep-firstSweep;
+        }
         Channel TempChannel(finalSections, grandsize);
         Section TempSectionGrand(grandsize, label.str());
-        for (int nEpisode=1; nEpisode<=numberSections;++nEpisode) {
+        for (int nEpisode=firstEpisode; nEpisode<=lastEpisode;++nEpisode) {
             int progbar =
                 // Channel contribution:
-                (int)(((double)nChannel/(double)numberChannels)*100.0+
+                (int)(((double)nSelected/(double)numberSelected)*100.0+
                       // Section contribution:
-                      (double)(nEpisode-1)/(double)numberSections*(100.0/numberChannels));
+                      (double)(nEpisode-1)/(double)numberSections*(100.0/numberSelected));
             std::ostringstream progStr;
             progStr << "Reading channel #" << nChannel + 1 << " of " << numberChannels
                     << ", Section #" << nEpisode << " of " << numberSections;
@@ -258,7 +336,7 @@ void stfio::importABF2File(const std::string &fName, Recording &ReturnData, Prog
                     Section TempSectionT(TempSection.size(),label.str());
                     std::copy(TempSection.begin(),TempSection.end(),&TempSectionT[0]);
                     try {
-                        TempChannel.InsertSection(TempSectionT,nEpisode-1);
+                        TempChannel.InsertSection(TempSectionT,nEpisode-firstEpisode);
                     }
                     catch (...) {
                         ABF_Close(hFile,&nError);
@@ -279,7 +357,7 @@ void stfio::importABF2File(const std::string &fName, Recording &ReturnData, Prog
                 TempChannel.resize(TempChannel.size()-1);
             }
         }
-        if (gapfree) {
+        if (gapfree && finalSections > 0) {
             try {
                 TempChannel.InsertSection(TempSectionGrand,0);
             }
@@ -289,10 +367,10 @@ void stfio::importABF2File(const std::string &fName, Recording &ReturnData, Prog
             }
         }
         try {
-            if ((int)ReturnData.size()<numberChannels) {
-                ReturnData.resize(numberChannels);
+            if ((int)ReturnData.size()<numberSelected) {
+                ReturnData.resize(numberSelected);
             }
-            ReturnData.InsertChannel(TempChannel,nChannel);
+            ReturnData.InsertChannel(TempChannel,nSelected);
         }
         catch (...) {
             ReturnData.resize(0);
@@ -300,20 +378,11 @@ void stfio::importABF2File(const std::string &fName, Recording &ReturnData, Prog
             throw;
         }
         
-        progbar = (int)(((double)(nChannel+1)/(double)numberChannels)*100.0);
+        progbar = (int)(((double)(nSelected+1)/(double)numberSelected)*100.0);
         progDlg.Update(progbar, "Completing channel reading\n");
 
-        std::string channel_name( pFH->sADCChannelName[pFH->nADCSamplingSeq[nChannel]] );
-        if (channel_name.find("  ")<channel_name.size()) {
-            channel_name.erase(channel_name.begin()+channel_name.find("  "),channel_name.end());
-        }
-        ReturnData[nChannel].SetChannelName(channel_name);
-
-        std::string channel_units( pFH->sADCUnits[pFH->nADCSamplingSeq[nChannel]] );
-        if (channel_units.find("  ") < channel_units.size()) {
-            channel_units.erase(channel_units.begin() + channel_units.find("  "),channel_units.end());
-        }
-        ReturnData[nChannel].SetYUnits(channel_units);
+        ReturnData[nSelected].SetChannelName(trimABFString(pFH->sADCChannelName[pFH->nADCSamplingSeq[nChannel]]));
+        ReturnData[nSelected].SetYUnits(trimABFString(pFH->sADCUnits[pFH->nADCSamplingSeq[nChannel]]));
     }
 
     if (!ABF_Close(hFile,&nError)) {
@@ -323,26 +392,13 @@ void stfio::importABF2File(const std::string &fName, Recording &ReturnData, Prog
         throw std::runtime_error(errorMsg);
     }
     
-    ReturnData.SetXScale((double)(pFH->fADCSequenceInterval/1000.0));
-    
-    std::string comment("Created with ");
-    comment += std::string( pFH->sCreatorInfo );
-    ReturnData.SetComment(comment);
-
-    ldiv_t year=ldiv(pFH->uFileStartDate,(ABFLONG)10000);
-    ldiv_t month=ldiv(year.rem,(ABFLONG)100);
-
-    ldiv_t hours=ldiv(pFH->uFileStartTimeMS/1000,(ABFLONG)3600);
-    ldiv_t minutes=ldiv(hours.rem,(ABFLONG)60);
-
-    // Recording::SetDateTime expects the year to be passed as the number of years since 1900, and the month
-    // as 0 = Jan ... 11 = Dec
-    ReturnData.SetDateTime(year.quot-1900, month.quot-1, month.rem, hours.quot, minutes.quot, minutes.rem);
+    setABF2Attributes(pFH, ReturnData);
 
     abf2.Close();
 }
 
-void stfio::importABF1File(const std::string &fName, Recording &ReturnData, ProgressInfo& progDlg) {
+void stfio::importABF1File(const std::string &fName, Recording &ReturnData, ProgressInfo& progDlg,
+                           const stfio::ImportFilter& filter) {
     
     int hFile = 0;
     ABFFileHeader FH;
@@ -387,13 +443,25 @@ void stfio::importABF1File(const std::string &fName, Recording &ReturnData, Prog
         throw std::runtime_error("Error while calling stfio::importABFFile():\n"
             "lActualEpisodes>dwMaxEpi");
     }
-    for (int nChannel=0;nChannel<numberChannels;++nChannel) {
-        Channel TempChannel(numberSections);
-        for (DWORD dwEpisode=1;dwEpisode<=(DWORD)numberSections;++dwEpisode) {
+    std::vector<int> channels;
+    try {
+        channels = filter.SelectChannels(numberChannels);
+    }
+    catch (...) {
+        ABF_Close(hFile,&nError);
+        throw;
+    }
+    int numberSelected = (int)channels.size();
+    int firstSweep = 0, endSweep = 0;
+    filter.SelectSweeps((int)numberSections, firstSweep, endSweep);
+    for (int nSelected=0;nSelected<numberSelected;++nSelected) {
+        int nChannel = channels[nSelected];
+        Channel TempChannel(endSweep-firstSweep);
+        for (DWORD dwEpisode=firstSweep+1;dwEpisode<=(DWORD)endSweep;++dwEpisode) {
             int progbar = // Channel contribution:
-                (int)(((double)nChannel/(double)numberChannels)*100.0+
+                (int)(((double)nSelected/(double)numberSelected)*100.0+
                       // Section contribution:
-                      (double)(dwEpisode-1)/(double)numberSections*(100.0/numberChannels));
+                      (double)(dwEpisode-1)/(double)numberSections*(100.0/numberSelected));
             std::ostringstream progStr;
             progStr << "Reading channel #" << nChannel + 1 << " of " << numberChannels
                     << ", Section #" << dwEpisode << " of " << numberSections;
@@ -432,7 +500,7 @@ void stfio::importABF1File(const std::string &fName, Recording &ReturnData, Prog
             Section TempSectionT(TempSection.size(),label.str());
             std::copy(TempSection.begin(),TempSection.end(),&TempSectionT[0]);
             try {
-                TempChannel.InsertSection(TempSectionT,dwEpisode-1);
+                TempChannel.InsertSection(TempSectionT,dwEpisode-firstSweep-1);
             }
             catch (...) {
                 ABF_Close(hFile,&nError);
@@ -440,10 +508,10 @@ void stfio::importABF1File(const std::string &fName, Recording &ReturnData, Prog
             }
         }
         try {
-            if ((int)ReturnData.size()<numberChannels) {
-                ReturnData.resize(numberChannels);
+            if ((int)ReturnData.size()<numberSelected) {
+                ReturnData.resize(numberSelected);
             }
-            ReturnData.InsertChannel(TempChannel,nChannel);
+            ReturnData.InsertChannel(TempChannel,nSelected);
         }
         catch (...) {
             ReturnData.resize(0);
@@ -451,17 +519,8 @@ void stfio::importABF1File(const std::string &fName, Recording &ReturnData, Prog
             throw;
         }
 
-        std::string channel_name( FH.sADCChannelName[FH.nADCSamplingSeq[nChannel]] );
-        if (channel_name.find("  ")<channel_name.size()) {
-            channel_name.erase(channel_name.begin()+channel_name.find("  "),channel_name.end());
-        }
-        ReturnData[nChannel].SetChannelName(channel_name);
-
-        std::string channel_units( FH.sADCUnits[FH.nADCSamplingSeq[nChannel]] );
-        if (channel_units.find("  ") < channel_units.size()) {
-            channel_units.erase(channel_units.begin() + channel_units.find("  "),channel_units.end());
-        }
-        ReturnData[nChannel].SetYUnits(channel_units);
+        ReturnData[nSelected].SetChannelName(trimABFString(FH.sADCChannelName[FH.nADCSamplingSeq[nChannel]]));
+        ReturnData[nSelected].SetYUnits(trimABFString(FH.sADCUnits[FH.nADCSamplingSeq[nChannel]]));
     }
 
     if (!ABF_Close(hFile,&nError)) {
@@ -470,24 +529,266 @@ void stfio::importABF1File(const std::string &fName, Recording &ReturnData, Prog
         ReturnData.resize(0);
         throw std::runtime_error(errorMsg);
     }
-    // Apparently, the sample interval has to be multiplied by
-    // the number of channels for multiplexed data. Thanks to
-    // Dominique Engel for noticing.
-    ReturnData.SetXScale((double)(FH.fADCSampleInterval/1000.0)*(double)numberChannels);
-    std::string comment("Created with ");
-    FH.sCreatorInfo[ABF_CREATORINFOLEN-1]=0;  // make sure string is 0-terminated
-    FH._sFileComment[ABF_OLDFILECOMMENTLEN-1]=0;  // make sure string is 0-terminated
-    comment += std::string( FH.sCreatorInfo );
-    ReturnData.SetComment(comment);
+    setABF1Attributes(FH, ReturnData);
+}
 
-    ldiv_t year=ldiv(FH.lFileStartDate,(ABFLONG)10000);
-    ldiv_t month=ldiv(year.rem,(ABFLONG)100);
+namespace {
 
-    ldiv_t hours=ldiv(FH.lFileStartTime,(ABFLONG)3600);
-    ldiv_t minutes=ldiv(hours.rem,(ABFLONG)60);
+// Keeps an ABF2 file open and reads episodes when they are requested.
+class ABF2LazyFile : public stfio::LazyFile {
+  public:
+    ABF2LazyFile(const std::string& fName);
+    ~ABF2LazyFile();
 
-    ReturnData.SetDateTime(year.quot, month.quot, month.rem, hours.quot, minutes.quot, minutes.rem);
+    void ReadSection(std::size_t n_c, std::size_t n_s, Section& ReturnSection);
+
+  private:
+    void ReadEpisode(int nChannel, DWORD dwEpisode, Vector_float& TempSection);
+
+    std::string fName;
+    CABF2ProtocolReader abf2;
+    const ABF2FileHeader* pFH;
+    int hFile;
+    // Gapfree files are returned as a single section per channel
+    bool gapfree;
+    ABFLONG numberSections;
+    ABFLONG grandsize;
+};
+
+ABF2LazyFile::ABF2LazyFile(const std::string& fName_)
+    : fName(fName_), pFH(NULL), hFile(0), gapfree(false), numberSections(0), grandsize(0)
+{
+#if !defined(_MSC_VER)
+    if (!abf2.Open( fName.c_str() )) {
+#else
+    std::wstring wfName;
+    wfName.resize(fName.size());
+    std::copy(fName.begin(), fName.end(), wfName.begin());
+    if (!abf2.Open( &wfName[0] )) {
+#endif
+        std::string errorMsg("Exception while calling openLazyABFFile():\nCouldn't open file");
+        throw std::runtime_error(errorMsg);
+    }
+    int nError = 0;
+    if (!abf2.Read( &nError )) {
+        abf2.Close();
+        std::string errorMsg("Exception while calling openLazyABFFile():\nCouldn't read file");
+        throw std::runtime_error(errorMsg);
+    }
+
+    pFH = abf2.GetFileHeader();
+    hFile = abf2.GetFileNumber();
+    int numberChannels = pFH->nADCNumChannels;
+    numberSections = pFH->lActualEpisodes;
+    ABFLONG finalSections = numberSections;
+    gapfree = (pFH->nOperationMode == ABF2_GAPFREEFILE);
+    if (gapfree) {
+        UINT uMaxSamples = pFH->lNumSamplesPerEpisode / numberChannels;
+        DWORD dwMaxEpi;
+        if (!ABF2_SetChunkSize(hFile,abf2.GetFileHeaderW(),&uMaxSamples,&dwMaxEpi,&nError)) {
+            std::ostringstream errorMsg;
+            errorMsg << "Exception while calling ABF2_SetChunkSize() "
+                     << "\n" << stfio::ABF1Error(fName, nError);
+            abf2.Close();
+            throw std::runtime_error(errorMsg.str());
+        }
+        grandsize = pFH->lActualAcqLength / numberChannels;
+        if (grandsize <= 0 || grandsize >= (ABFLONG)Vector_double().max_size()) {
+            // too large for a single section; segment as in importABF2File()
+            gapfree = false;
+        } else {
+            finalSections = 1;
+        }
+    }
+
+    header.resize(numberChannels);
+    for (int nChannel=0; nChannel < numberChannels; ++nChannel) {
+        Channel TempChannel(finalSections);
+        for (ABFLONG n_s=0; n_s < finalSections; ++n_s) {
+            std::ostringstream label;
+            if (gapfree) {
+                label << fName << ", gapfree section";
+            } else {
+                label << fName << ", Section # " << n_s+1;
+            }
+            TempChannel[n_s].SetSectionDescription(label.str());
+        }
+        TempChannel.SetChannelName(trimABFString(pFH->sADCChannelName[pFH->nADCSamplingSeq[nChannel]]));
+        TempChannel.SetYUnits(trimABFString(pFH->sADCUnits[pFH->nADCSamplingSeq[nChannel]]));
+        header.InsertChannel(TempChannel, nChannel);
+    }
+    setABF2Attributes(pFH, header);
+}
+
+ABF2LazyFile::~ABF2LazyFile() {
+    abf2.Close();
+}
+
+void ABF2LazyFile::ReadEpisode(int nChannel, DWORD dwEpisode, Vector_float& TempSection) {
+    int nError = 0;
+    unsigned int uNumSamplesW = 0;
+    if (!ABF2_ReadChannel(hFile, pFH, pFH->nADCSamplingSeq[nChannel], dwEpisode, TempSection,
+                          &uNumSamplesW, &nError))
+    {
+        std::string errorMsg("Exception while calling ABF2_ReadChannel():\n");
+        errorMsg += stfio::ABF1Error(fName, nError);
+        throw std::runtime_error(errorMsg);
+    }
+    if (!gapfree && uNumSamplesW != TempSection.size()) {
+        throw std::runtime_error("Exception while calling ABF2_ReadChannel()");
+    }
+}
 
+void ABF2LazyFile::ReadSection(std::size_t n_c, std::size_t n_s, Section& ReturnSection) {
+    CheckRange(n_c, n_s);
+    ReturnSection = header[n_c][n_s];
+    int numberChannels = pFH->nADCNumChannels;
+    if (gapfree) {
+        ABFLONG chunksize = pFH->lNumSamplesPerEpisode / numberChannels;
+        ReturnSection.get_w().resize(grandsize);
+        for (ABFLONG nEpisode=1; nEpisode<=numberSections; ++nEpisode) {
+            UINT uNumSamples = chunksize;
+            if (nEpisode == numberSections) {
+                uNumSamples = grandsize - (nEpisode-1) * chunksize;
+            }
+            if (uNumSamples == 0) {
+                continue;
+            }
+            Vector_float TempSection(uNumSamples, 0.0);
+            ReadEpisode((int)n_c, nEpisode, TempSection);
+            if ((nEpisode-1) * chunksize + TempSection.size() <= ReturnSection.size()) {
+                std::copy(TempSection.begin(), TempSection.end(),
+                          &ReturnSection[(nEpisode-1) * chunksize]);
+            }
+        }
+    } else {
+        UINT uNumSamples = 0;
+        int nError = 0;
+        if (!ABF2_GetNumSamples(hFile, pFH, n_s+1, &uNumSamples, &nError)) {
+            std::ostringstream errorMsg;
+            errorMsg << "Exception while calling ABF2_GetNumSamples() "
+                     << "for episode # "
+                     << n_s+1 << "\n"
+                     << stfio::ABF1Error(fName, nError);
+            throw std::runtime_error(errorMsg.str());
+        }
+        if (uNumSamples > 0) {
+            Vector_float TempSection(uNumSamples, 0.0);
+            ReadEpisode((int)n_c, n_s+1, TempSection);
+            ReturnSection.get_w().assign(TempSection.begin(), TempSection.end());
+        }
+    }
+}
+
+// Keeps an ABF1 file open and reads episodes when they are requested.
+class ABF1LazyFile : public stfio::LazyFile {
+  public:
+    ABF1LazyFile(const std::string& fName);
+    ~ABF1LazyFile();
+
+    void ReadSection(std::size_t n_c, std::size_t n_s, Section& ReturnSection);
+
+  private:
+    std::string fName;
+    int hFile;
+    ABFFileHeader FH;
+};
+
+ABF1LazyFile::ABF1LazyFile(const std::string& fName_)
+    : fName(fName_), hFile(0)
+{
+    UINT uMaxSamples = 0;
+    DWORD dwMaxEpi = 0;
+    int nError = 0;
+
+#if !defined(_MSC_VER)
+    if (!ABF_ReadOpen(fName.c_str(), &hFile, ABF_DATAFILE, &FH,
+                      &uMaxSamples, &dwMaxEpi, &nError))
+#else
+    std::wstring wfName;
+    for(std::string::size_type i=0; i<fName.size(); ++i) {
+        wfName += wchar_t(fName[i]);
+    }
+    if (!ABF_ReadOpen(wfName.c_str(), &hFile, ABF_DATAFILE, &FH,
+                      &uMaxSamples, &dwMaxEpi, &nError))
+#endif
+    {
+        std::string errorMsg("Exception while calling ABF_ReadOpen():\n");
+        errorMsg+=stfio::ABF1Error(fName,nError);
+        ABF_Close(hFile,&nError);
+        throw std::runtime_error(errorMsg);
+    }
+    int numberChannels=FH.nADCNumChannels;
+    ABFLONG numberSections=FH.lActualEpisodes;
+    if ((DWORD)numberSections>dwMaxEpi) {
+        ABF_Close(hFile,&nError);
+        throw std::runtime_error("Error while calling stfio::openLazyABFFile():\n"
+            "lActualEpisodes>dwMaxEpi");
+    }
+    header.resize(numberChannels);
+    for (int nChannel=0; nChannel < numberChannels; ++nChannel) {
+        Channel TempChannel(numberSections);
+        for (ABFLONG n_s=0; n_s < numberSections; ++n_s) {
+            std::ostringstream label;
+            label << fName << ", Section # " << n_s+1;
+            TempChannel[n_s].SetSectionDescription(label.str());
+        }
+        TempChannel.SetChannelName(trimABFString(FH.sADCChannelName[FH.nADCSamplingSeq[nChannel]]));
+        TempChannel.SetYUnits(trimABFString(FH.sADCUnits[FH.nADCSamplingSeq[nChannel]]));
+        header.InsertChannel(TempChannel, nChannel);
+    }
+    setABF1Attributes(FH, header);
+}
+
+ABF1LazyFile::~ABF1LazyFile() {
+    int nError = 0;
+    ABF_Close(hFile, &nError);
+}
+
+void ABF1LazyFile::ReadSection(std::size_t n_c, std::size_t n_s, Section& ReturnSection) {
+    CheckRange(n_c, n_s);
+    DWORD dwEpisode = n_s+1;
+    int nError = 0;
+    unsigned int uNumSamples=0;
+    if (!ABF_GetNumSamples(hFile,&FH,dwEpisode,&uNumSamples,&nError)) {
+        std::string errorMsg( "Exception while calling ABF_GetNumSamples():\n" );
+        errorMsg += stfio::ABF1Error(fName, nError);
+        throw std::runtime_error(errorMsg);
+    }
+    Vector_float TempSection(uNumSamples, 0.0);
+    unsigned int uNumSamplesW=0;
+    if (!ABF_ReadChannel(hFile, &FH, FH.nADCSamplingSeq[n_c], dwEpisode, TempSection,
+                         &uNumSamplesW, &nError))
+    {
+        std::string errorMsg("Exception while calling ABF_ReadChannel():\n");
+        errorMsg += stfio::ABF1Error(fName, nError);
+        throw std::runtime_error(errorMsg);
+    }
+    if (uNumSamples!=uNumSamplesW) {
+        throw std::runtime_error("Exception while calling ABF_ReadChannel()");
+    }
+    ReturnSection = header[n_c][n_s];
+    ReturnSection.get_w().assign(TempSection.begin(), TempSection.end());
+}
+
+}
+
+stfio::LazyFile* stfio::openLazyABFFile(const std::string& fName) {
+    ABF2_FileInfo fileInfo;
+    FILE* fh = fopen( fName.c_str(), "rb" );
+    if (!fh) {
+        throw std::runtime_error("Exception while calling openLazyABFFile():\nCouldn't open file");
+    }
+    std::size_t res = fread( &fileInfo, sizeof( fileInfo ), 1, fh );
+    fclose(fh);
+    if (res != 1) {
+        throw std::runtime_error("Exception while calling openLazyABFFile():\nCouldn't read file");
+    }
+    if (CABF2ProtocolReader::CanOpen( (void*)&fileInfo, sizeof(fileInfo) )) {
+        return new ABF2LazyFile(fName);
+    } else {
+        return new ABF1LazyFile(fName);
+    }
 }
 #if defined(_WINDOWS) && !defined(__MINGW32__)
 #pragma optimize ("", on)
@@ -31,24 +31,37 @@ namespace stfio {
  *  \param ReturnData On entry, an empty Recording object. On exit,
  *         the data stored in \e fName.
  *  \param progress True if the progress dialog should be updated.
+ *  \param filter The channels and sweeps to be read.
  */
-void importABFFile(const std::string& fName, Recording& ReturnData, ProgressInfo& progDlg);
+void importABFFile(const std::string& fName, Recording& ReturnData, ProgressInfo& progDlg,
+                   const ImportFilter& filter = ImportFilter());
  
  //! Open an ABF1 file and store its contents to a Recording object.
 /*! \param fName The full path to the file to be opened.
  *  \param ReturnData On entry, an empty Recording object. On exit,
  *         the data stored in \e fName.
  *  \param progress True if the progress dialog should be updated.
+ *  \param filter The channels and sweeps to be read.
  */
-void importABF1File(const std::string& fName, Recording& ReturnData, ProgressInfo& progDlg);
+void importABF1File(const std::string& fName, Recording& ReturnData, ProgressInfo& progDlg,
+                    const ImportFilter& filter = ImportFilter());
  
  //! Open an ABF2 file and store its contents to a Recording object.
 /*! \param fName The full path to the file to be opened.
  *  \param ReturnData On entry, an empty Recording object. On exit,
  *         the data stored in \e fName.
  *  \param progress True if the progress dialog should be updated.
+ *  \param filter The channels and sweeps to be read.
  */
-void importABF2File(const std::string& fName, Recording& ReturnData, ProgressInfo& progDlg);
+void importABF2File(const std::string& fName, Recording& ReturnData, ProgressInfo& progDlg,
+                    const ImportFilter& filter = ImportFilter());
+
+//! Open an ABF1 or ABF2 file for on-demand reading of its sections.
+/*! Gapfree files are returned as a single section per channel, as in importABF2File().
+ *  \param fName The full path to the file to be opened.
+ *  \return A new LazyFile that has to be deleted by the caller.
+ */
+LazyFile* openLazyABFFile(const std::string& fName);
 
 }
 
@@ -20,9 +20,13 @@
 #include "filedesc.hpp"             // File descriptors for ABF files.
 #include "./../Common/ArrayPtr.hpp"   // Smart array pointer template class.
 #include "./../Common/FileReadCache.hpp"
+#include "../../../stfio.h"         // stfio::Mutex
+
+#include <vector>
 
 //
-// Set the maximum number of files that can be open simultaneously.
+// Set the number of file descriptors that are allocated initially. The table
+// grows as needed, so that this only limits the memory that is reserved.
 // This can be overridden from the compiler command line.
 //
 #ifndef ABF_MAXFILES
@@ -42,7 +46,11 @@
 
 //------------------------------------ Shared Variables -----------------------------------------
 */
-static CFileDescriptor *g_FileData[ABF_MAXFILES];
+// Open files, indexed by file handle. The table is shared by all threads
+// and may only be accessed while g_FileDataMutex is locked; each
+// descriptor is only used by the thread that has opened the file.
+static std::vector<CFileDescriptor *> g_FileData(ABF_MAXFILES, (CFileDescriptor *)NULL);
+static stfio::Mutex g_FileDataMutex;
 
 HINSTANCE g_hInstance = NULL;
 
@@ -76,17 +84,6 @@ BOOL GetNewFileDescriptor(CFileDescriptor **ppFI, int *pnFile, int *pnError)
 {
     //   WPTRASSERT(ppFI);
     //   WPTRASSERT(pnFile);
-    int nFile;
-   
-    // Find an empty slot.
-    for (nFile=0; nFile < ABF_MAXFILES; nFile++)
-        if (g_FileData[nFile] == NULL)
-            break;
-   
-    // Return an error if no space left.   
-    if (nFile == ABF_MAXFILES)
-        return ErrorReturn(pnError, ABF_TOOMANYFILESOPEN);
-
     // Allocate a new descriptor.
     CFileDescriptor *pFI = new CFileDescriptor;
     if (pFI == NULL)
@@ -97,6 +94,16 @@ BOOL GetNewFileDescriptor(CFileDescriptor **ppFI, int *pnFile, int *pnError)
         delete pFI;
         return ErrorReturn(pnError, ABF_BADTEMPFILE);
     }
+
+    stfio::MutexLocker lock(g_FileDataMutex);
+
+    // Find an empty slot, or add one if all slots are in use.
+    int nFile;
+    for (nFile=0; nFile < (int)g_FileData.size(); nFile++)
+        if (g_FileData[nFile] == NULL)
+            break;
+    if (nFile == (int)g_FileData.size())
+        g_FileData.push_back(NULL);
       
     *ppFI = g_FileData[nFile] = pFI;
     *pnFile = nFile;
@@ -111,12 +118,17 @@ BOOL GetFileDescriptor(CFileDescriptor **ppFI, int nFile, int *pnError)
 {
     //   WPTRASSERT(ppFI);
 
-    // Check that index is within range.
-    if ((nFile < 0) || (nFile >= ABF_MAXFILES))
-        return ErrorReturn(pnError, ABF_EBADFILEINDEX);
+    CFileDescriptor *pFI = NULL;
+    {
+        stfio::MutexLocker lock(g_FileDataMutex);
 
-    // Get a pointer to the descriptor.
-    CFileDescriptor *pFI = g_FileData[nFile];
+        // Check that index is within range.
+        if ((nFile < 0) || (nFile >= (int)g_FileData.size()))
+            return ErrorReturn(pnError, ABF_EBADFILEINDEX);
+
+        // Get a pointer to the descriptor.
+        pFI = g_FileData[nFile];
+    }
     if (pFI == NULL)
         return ErrorReturn(pnError, ABF_EBADFILEINDEX);
 
@@ -131,8 +143,15 @@ BOOL GetFileDescriptor(CFileDescriptor **ppFI, int nFile, int *pnError)
 //
 void ReleaseFileDescriptor(int nFile)
 {
-    delete g_FileData[nFile];
-    g_FileData[nFile] = NULL;
+    CFileDescriptor *pFI = NULL;
+    {
+        stfio::MutexLocker lock(g_FileDataMutex);
+        if ((nFile < 0) || (nFile >= (int)g_FileData.size()))
+            return;
+        pFI = g_FileData[nFile];
+        g_FileData[nFile] = NULL;
+    }
+    delete pFI;
 }
 
 //===============================================================================================
@@ -324,9 +343,8 @@ BOOL ABF_Initialize()
          // Save the DLL instance handle.
          g_hInstance = hDLL;
     */
-    for (int i=0; i<ABF_MAXFILES; i++)
-        g_FileData[i] = NULL;
-      
+    // Descriptors of files that are still open are kept; the table is
+    // initialized statically.
 #if (ABF_MAXFILES > 15)      
     //   UINT uAvailableFiles = SetHandleCount(ABF_MAXFILES);  uAvailableFiles = uAvailableFiles;
 #endif
@@ -343,7 +361,7 @@ BOOL ABF_Initialize()
 //
 void ABF_Cleanup(void)
 {
-    for (int i=0; i<ABF_MAXFILES; i++)
+    for (int i=0; i<(int)g_FileData.size(); i++)
     {
         if (g_FileData[i])
         {
@@ -1125,7 +1143,7 @@ static BOOL _SetChunkSize( CFileDescriptor *pFI, ABFFileHeader *pFH,
             // Calculate file offsets and expand out any episodes longer than
             // uMaxChunkSize to span multiple Synch entries.
    
-            Synch SynchItem;
+            Synch SynchItem = { 0 };
             pFI->GetSynchEntry(i, &SynchItem);
 
             // if there are no missing samples, add this length to the previous entry.
@@ -1266,7 +1284,7 @@ static BOOL ABF2_SetChunkSize( CFileDescriptor *pFI, ABF2FileHeader *pFH,
             // Calculate file offsets and expand out any episodes longer than
             // uMaxChunkSize to span multiple Synch entries.
    
-            Synch SynchItem;
+            Synch SynchItem = { 0 };
             pFI->GetSynchEntry(i, &SynchItem);
 
             // if there are no missing samples, add this length to the previous entry.
@@ -1412,7 +1430,7 @@ static BOOL _SetOverlap(CFileDescriptor *pFI, const ABFFileHeader *pFH, BOOL bAl
         // Loop through the rest of the entries.
         for (UINT i=2; i<=uSynchCount; i++)
         {
-            Synch SynchItem;
+            Synch SynchItem = { 0 };
             pFI->GetSynchEntry(i, &SynchItem);
 
             if ((SynchItem.dwStart != ABF_AVERAGESWEEPSTART) &&
@@ -1741,7 +1759,7 @@ BOOL WINAPI ABF_MultiplexRead(int nFile, const ABFFileHeader *pFH, DWORD dwEpiso
 
     // If a synch array is not present, create a synch entry for this chunk,
     // otherwise, read it from the synch array.
-    Synch SynchEntry;
+    Synch SynchEntry = { 0 };
     if (!GetSynchEntry( pFH, pFI, dwEpisode, &SynchEntry ))
         return ErrorReturn(pnError, ABF_EEPISODERANGE);
       
@@ -1800,7 +1818,7 @@ BOOL WINAPI ABF2_MultiplexRead(int nFile, const ABF2FileHeader *pFH, DWORD dwEpi
 
     // If a synch array is not present, create a synch entry for this chunk,
     // otherwise, read it from the synch array.
-    Synch SynchEntry;
+    Synch SynchEntry = { 0 };
     if (!ABF2_GetSynchEntry( pFH, pFI, dwEpisode, &SynchEntry ))
         return ErrorReturn(pnError, ABF_EEPISODERANGE);
       
@@ -2882,9 +2900,8 @@ BOOL WINAPI ABF_ReadTags(int nFile, const ABFFileHeader *pFH, DWORD dwFirstTag,
     return TRUE;
 }
 
-static char *GetTagComment(ABFTag *pTag)
+static char *GetTagComment(ABFTag *pTag, char *szRval)
 {
-    static char szRval[ABF_TAGCOMMENTLEN+1];
     char *ps = pTag->sComment;
     UINT i=0;
     for (i=0; i<ABF_TAGCOMMENTLEN; i++)
@@ -2896,7 +2913,7 @@ static char *GetTagComment(ABFTag *pTag)
         szRval[ABF_TAGCOMMENTLEN-i] = '\0';
     }
     else
-        LoadString(g_hInstance, IDS_NONE, szRval, sizeof(szRval));
+        LoadString(g_hInstance, IDS_NONE, szRval, ABF_TAGCOMMENTLEN+1);
     return szRval;
 }
 
@@ -2930,7 +2947,8 @@ BOOL WINAPI ABF_FormatTag(int nFile, const ABFFileHeader *pFH, ABFLONG lTagNumbe
     char szTagTime[32];
     ABFU_FormatDouble(dTimeInMS/1E3, 10, szTagTime, sizeof(szTagTime));
    
-    char *ps = GetTagComment(&Tag);
+    char szComment[ABF_TAGCOMMENTLEN+1];
+    char *ps = GetTagComment(&Tag, szComment);
 
     if (bEpisodic)
     {
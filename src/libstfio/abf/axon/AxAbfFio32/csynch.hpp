@@ -15,10 +15,12 @@
 #include "../Common/axodefn.h"
 #include "../Common/axodebug.h"
 
+#include <vector>
+
 //-----------------------------------------------------------------------------------------------
 // Local constants:
 
-#define SYNCH_BUFFER_SIZE  100         // buffer 100 synch entries at a time.
+#define SYNCH_BUFFER_SIZE  100         // initial number of synch entries read from the data file.
 
 // Synch structure definition.
 struct Synch
@@ -30,6 +32,9 @@ struct Synch
 
 //-----------------------------------------------------------------------------------------------
 // CSynch class definition
+// The synch array used to be virtualized through a temporary file, 100 entries at a time.
+// At 12 bytes per entry it is now simply held in memory, so that event-detected files with
+// many episodes don't need a temporary file and a cache reload every 100 episodes.
 
 class CSynch
 {
@@ -37,19 +42,9 @@ public:
    enum eMODE { eWRITEMODE, eREADMODE };
 
 private:    // Member variables.
-#if defined(_WINDOWS) && !defined(__MINGW32__)
-   char   m_szFileName[_MAX_PATH];            // Filename for array virtualization
-#endif
-
-   FILEHANDLE  m_hfSynchFile;                      // Handle to temporary file.
-   eMODE  m_eMode;                            // Mode flag for buffering algorithm.
-
-   UINT   m_uSynchCount;                     // Total count of entries in the synch array
-   UINT   m_uCacheCount;                      // Count of entries in the cache
-   UINT   m_uCacheStart;                     // Number of first entry in the cache.
-
-   Synch  m_SynchBuffer[SYNCH_BUFFER_SIZE];   // Buffer for caching synch entries.
-   Synch  m_LastEntry;                        // Last entry written (write only).
+   eMODE  m_eMode;                            // Mode flag (entries may only be put in write mode).
+   std::vector<Synch> m_Entries;              // All entries of the synch array.
+   Synch  m_LastEntry;                        // Last entry written.
 
 private:    // Declare but don't define copy constructor to prevent use of default
    CSynch(const CSynch &CS);
@@ -57,15 +52,7 @@ private:    // Declare but don't define copy constructor to prevent use of defau
 
 private:    // Private member functions.
    void _Initialize();
-   BOOL _Flush();
-/*   BOOL _PackBuffer(UINT uAcquiredSamples, UINT &uEntries, UINT uSampleSize);
-//   BOOL _Read(LPVOID lpBuf, DWORD dwBytesToRead);
-*/   
-   BOOL Read(LPVOID lpBuf, DWORD dwFilePos, DWORD dwEntriesToRead);
-   BOOL _GetReadMode( UINT uFirstEntry, Synch *pSynch, UINT uEntries );
-   BOOL _GetWriteMode( UINT uFirstEntry, Synch *pSynch, UINT uEntries );
-   BOOL _IsFileOpen();
-   
+
 public:     // Public member functions
    CSynch();
    ~CSynch();
@@ -75,18 +62,10 @@ public:     // Public member functions
    void  CloseFile();
 
    void  SetMode(eMODE eMode);
-   
+
    BOOL  Put( UINT uStart, UINT uLength, UINT uOffset=0 );
-/*   void  UpdateLength( DWORD dwLength );
-   void  IncreaseLastLength( DWORD dwIncrease );
-   BOOL  GetLastEntry(Synch *pSynch);
-   
-*/   BOOL  Get( UINT uFirstEntry, Synch *pSynch, UINT uEntries );
-/*   BOOL  Update( UINT uEntry, const Synch *pSynch );
-*/   UINT  GetCount() const;
-/*   
-   BOOL  Write( HANDLE hDataFile, UINT uAcquiredSamples, UINT *puSynchCount, UINT uSampleSize );
-*/
+   BOOL  Get( UINT uFirstEntry, Synch *pSynch, UINT uEntries );
+   UINT  GetCount() const;
 };
 
 
@@ -97,71 +76,23 @@ public:     // Public member functions
 inline UINT CSynch::GetCount() const
 {
 //   MEMBERASSERT();
-   return m_uSynchCount;
-}
-
-//===============================================================================================
-// PROCEDURE: Read
-// PURPOSE:   Reads a block and returns FALSE on ERROR.
-//
-inline BOOL CSynch::Read(LPVOID lpBuf, DWORD dwFirstEntry, DWORD dwEntriesToRead)
-{
-//   MEMBERASSERT();
-
-   DWORD dwBytesToRead= dwEntriesToRead * sizeof(Synch);
-//   ARRAYASSERT(LPSTR(lpBuf), dwBytesToRead);
-
-   // Save the current file position and seek to the desired position.
-   DWORD dwCurrentPos = c_SetFilePointer( m_hfSynchFile, 0, NULL, FILE_CURRENT );
-
-   if (dwCurrentPos == INVALID_SEEK_VALUE)
-      return FALSE;
-
-   c_SetFilePointer( m_hfSynchFile, dwFirstEntry * sizeof(Synch), NULL, FILE_BEGIN );
-
-   DWORD dwBytesRead = 0;
-   BOOL bOK = c_ReadFile(m_hfSynchFile, lpBuf, dwBytesToRead, &dwBytesRead, NULL);
-
-   // Restore the original file.
-   c_SetFilePointer( m_hfSynchFile, dwCurrentPos, NULL, FILE_BEGIN );
-
-   // Debug error messages.
-   if( !bOK )
-   {
-       TRACE( (char*)"CSynch::Read - ReadFile failed");// with the following error:\n" );
-//      SHOW_SYSTEM_ERROR( GetLastError() );
-   }
-
-   if( dwBytesRead != dwBytesToRead ) {
-//      TRACE2( "CSynch::Read - error reading from file:  dwBytesToRead %d, dwBytesRead %d.\n",
-//               dwBytesToRead, dwBytesRead );
-   }
-   return (bOK && (dwBytesRead==dwBytesToRead));
+   return UINT(m_Entries.size());
 }
 
 //===============================================================================================
 // PROCEDURE: Get
-// PURPOSE:   Retrieves synch entries from the virtualized array.
+// PURPOSE:   Retrieves synch entries from the synch array.
 //
 inline BOOL CSynch::Get( UINT uFirstEntry, Synch *pSynch, UINT uEntries )
 {
 //   MEMBERASSERT();
 //   ASSERT(uEntries > 0);
 //   ARRAYASSERT(pSynch, uEntries);
-//   ASSERT(uFirstEntry+uEntries <= m_uSynchCount);
-   if (m_eMode == eREADMODE)
-      return _GetReadMode( uFirstEntry, pSynch, uEntries );
-   else
-      return _GetWriteMode( uFirstEntry, pSynch, uEntries );
-}
-
-//===============================================================================================
-// PROCEDURE: _IsFileOpen
-// PURPOSE:   Returns TRUE if the temp file was opened ok.
-//
-inline BOOL CSynch::_IsFileOpen()
-{
-   return (m_hfSynchFile != FILE_NULL);
+   if (uFirstEntry >= GetCount() || uEntries > GetCount() - uFirstEntry)
+      return FALSE;
+   for (UINT i=0; i<uEntries; i++)
+      pSynch[i] = m_Entries[uFirstEntry+i];
+   return TRUE;
 }
 
 #endif      // INC_CSYNCH_HPP
@@ -83,6 +83,11 @@ BOOL CFileDescriptor::Open(LPCTSTR szFileName, BOOL bReadOnly)
    }
    m_uFlags = bReadOnly ? FI_READONLY : FI_WRITEONLY;
 
+   // Serve header, synch array and data reads of read-only files from a memory
+   // mapping where possible. If the file can't be mapped, reads use the file handle.
+   if (bReadOnly)
+      m_File.Map();
+
 #if defined(_MSC_VER)
    wcsncpy(m_szFileName, szFileName, _MAX_PATH-1);
    m_szFileName[_MAX_PATH-1] = '\0';
@@ -202,7 +207,7 @@ UINT CFileDescriptor::EpisodeStart(UINT uEpisode)
 {
    //MEMBERASSERT();
    ASSERT(uEpisode > 0);
-   Synch SynchEntry;
+   Synch SynchEntry = { 0 };
    m_VSynch.Get(uEpisode-1, &SynchEntry, 1);
    return SynchEntry.dwStart;
 }
@@ -215,7 +220,7 @@ void CFileDescriptor::SetEpisodeStart(UINT uEpisode, UINT uSynchTime)
 {
    //MEMBERASSERT();
    ASSERT(uEpisode > 0);
-   Synch SynchEntry;
+   Synch SynchEntry = { 0 };
    VERIFY(m_VSynch.Get(uEpisode-1, &SynchEntry, 1));
    SynchEntry.dwStart = uSynchTime;
    VERIFY(m_VSynch.Update(uEpisode-1, &SynchEntry));
@@ -229,7 +234,7 @@ UINT CFileDescriptor::EpisodeLength(UINT uEpisode)
 {
    //MEMBERASSERT();
    ASSERT(uEpisode > 0);
-   Synch SynchEntry;
+   Synch SynchEntry = { 0 };
    m_VSynch.Get(uEpisode-1, &SynchEntry, 1);
    return SynchEntry.dwLength;
 }
@@ -370,7 +375,7 @@ UINT CFileDescriptor::FileOffset( UINT uEpisode)
 {
    //MEMBERASSERT();
    ASSERT(uEpisode > 0);
-   Synch SynchEntry;
+   Synch SynchEntry = { 0 };
    m_VSynch.Get(uEpisode-1, &SynchEntry, 1);
    return SynchEntry.dwFileOffset;
 }
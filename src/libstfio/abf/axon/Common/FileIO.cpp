@@ -28,6 +28,11 @@
 #include "wincpp.hpp"
 #include "FileIO.hpp"
 
+#if !defined(_WIN32)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
 //===============================================================================================
 // FUNCTION: Constructor
 // PURPOSE:  Initialize the object
@@ -38,6 +43,9 @@ CFileIO::CFileIO()
    m_hFileHandle   = NULL;
    m_szFileName[0] = '\0';
    m_dwLastError   = 0;
+   m_pbMapped      = NULL;
+   m_llMappedSize  = 0;
+   m_llPosition    = 0;
 }
 
 //===============================================================================================
@@ -50,6 +58,9 @@ CFileIO::CFileIO(FILEHANDLE hFile)
    m_hFileHandle   = hFile;
    m_szFileName[0] = '\0';
    m_dwLastError   = 0;
+   m_pbMapped      = NULL;
+   m_llMappedSize  = 0;
+   m_llPosition    = 0;
 }
 
 #if !defined(_MSC_VER)
@@ -59,6 +70,9 @@ CFileIO::CFileIO(HANDLE hFile)
     m_hFileHandle   = (FILEHANDLE)hFile;
    m_szFileName[0] = '\0';
    m_dwLastError   = 0;
+   m_pbMapped      = NULL;
+   m_llMappedSize  = 0;
+   m_llPosition    = 0;
 }
 #endif
 
@@ -138,6 +152,9 @@ void CFileIO::SetFileHandle(FILEHANDLE hFile)
    m_hFileHandle   = hFile;
    m_szFileName[0] = '\0';
    m_dwLastError   = 0;
+   m_pbMapped      = NULL;
+   m_llMappedSize  = 0;
+   m_llPosition    = 0;
 }
 
 /*
@@ -182,6 +199,22 @@ BOOL CFileIO::Read(LPVOID lpBuf, DWORD dwBytesToRead, DWORD *pdwBytesRead)
    ASSERT(m_hFileHandle != FILE_NULL);
 
    DWORD dwBytesRead = 0;
+   if (m_pbMapped != NULL)
+   {
+      if (m_llPosition < m_llMappedSize)
+      {
+         dwBytesRead = dwBytesToRead;
+         if (LONGLONG(dwBytesRead) > m_llMappedSize - m_llPosition)
+            dwBytesRead = DWORD(m_llMappedSize - m_llPosition);
+         memcpy(lpBuf, m_pbMapped + m_llPosition, dwBytesRead);
+         m_llPosition += dwBytesRead;
+      }
+      if (pdwBytesRead)
+         *pdwBytesRead = dwBytesRead;
+      if (dwBytesRead!=dwBytesToRead)
+         return SetLastError(ERROR_HANDLE_EOF);
+      return TRUE;
+   }
 #if defined(_MSC_VER)
    BOOL bRval = ::ReadFile(m_hFileHandle, lpBuf, dwBytesToRead, &dwBytesRead, NULL);
 #else
@@ -204,6 +237,7 @@ BOOL CFileIO::Read(LPVOID lpBuf, DWORD dwBytesToRead, DWORD *pdwBytesRead)
 BOOL CFileIO::Close()
 {
    //MEMBERASSERT();
+   Unmap();
    if (m_hFileHandle != NULL)
    {
 #if defined(_MSC_VER)
@@ -219,6 +253,55 @@ BOOL CFileIO::Close()
    m_szFileName[0] = '\0';
    return TRUE;
 }
+
+//===============================================================================================
+// FUNCTION: Map
+// PURPOSE:  Maps the whole file read-only into memory. Subsequent Seek() and Read() calls
+//           are served from the mapping, so that many small reads don't each cost a system
+//           call. Returns FALSE if the file can't be mapped; reads then go through the
+//           file handle as before. Only available on POSIX systems.
+// NOTES:    The file pointer of the underlying handle is not moved by mapped reads.
+//
+BOOL CFileIO::Map()
+{
+   //MEMBERASSERT();
+   ASSERT(m_hFileHandle != FILE_NULL);
+   if (m_pbMapped != NULL)
+      return TRUE;
+#if !defined(_WIN32)
+   int fd = fileno(m_hFileHandle);
+   struct stat st;
+   if (fstat(fd, &st) != 0 || st.st_size <= 0 || off_t(size_t(st.st_size)) != st.st_size)
+      return FALSE;
+   void *pvView = mmap(NULL, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+   if (pvView == MAP_FAILED)
+      return FALSE;
+   posix_madvise(pvView, size_t(st.st_size), POSIX_MADV_SEQUENTIAL);
+   m_pbMapped     = (BYTE *)pvView;
+   m_llMappedSize = st.st_size;
+   m_llPosition   = ftell(m_hFileHandle);
+   return TRUE;
+#else
+   return FALSE;
+#endif
+}
+
+//===============================================================================================
+// FUNCTION: Unmap
+// PURPOSE:  Releases the memory mapped view of the file, if any.
+//
+void CFileIO::Unmap()
+{
+   //MEMBERASSERT();
+   if (m_pbMapped == NULL)
+      return;
+#if !defined(_WIN32)
+   munmap(m_pbMapped, size_t(m_llMappedSize));
+#endif
+   m_pbMapped     = NULL;
+   m_llMappedSize = 0;
+   m_llPosition   = 0;
+}
       
 
 //===============================================================================================
@@ -228,6 +311,7 @@ BOOL CFileIO::Close()
 FILEHANDLE CFileIO::Release()
 {
    //MEMBERASSERT();
+   Unmap();
    FILEHANDLE hRval    = m_hFileHandle;
    m_hFileHandle   = NULL;
    m_szFileName[0] = '\0';
@@ -261,6 +345,20 @@ BOOL CFileIO::SeekFailure(DWORD dwOffset)
 //
 BOOL CFileIO::Seek(LONGLONG lOffset, UINT uFlag, LONGLONG *plNewOffset)
 {
+   if (m_pbMapped != NULL)
+   {
+      LONGLONG llBase = 0;
+      if (uFlag == FILE_CURRENT)
+         llBase = m_llPosition;
+      else if (uFlag == FILE_END)
+         llBase = m_llMappedSize;
+      if (llBase + lOffset < 0)
+         return FALSE;
+      m_llPosition = llBase + lOffset;
+      if (plNewOffset)
+         *plNewOffset = m_llPosition;
+      return TRUE;
+   }
 #if !defined(_MSC_VER)
 	/*MEMBERASSERT();*/
     short    origin = 0;
@@ -306,6 +404,8 @@ LONGLONG CFileIO::GetFileSize()
 {
    /*MEMBERASSERT();*/
    ASSERT(m_hFileHandle != FILE_NULL);
+   if (m_pbMapped != NULL)
+      return m_llMappedSize;
 #if !defined(_MSC_VER)
     return c_GetFileSize(m_hFileHandle,NULL);
 #else
@@ -25,6 +25,9 @@ class CFileIO
     TCHAR         m_szFileName[_MAX_PATH]; // The complete filename of the file
     FILEHANDLE       m_hFileHandle;           // The DOS file handle for data file
     DWORD        m_dwLastError;           // Error number for last error.
+    BYTE        *m_pbMapped;              // Read-only view of the file, NULL if not mapped.
+    LONGLONG     m_llMappedSize;          // Size of the mapped view in bytes.
+    LONGLONG     m_llPosition;            // File pointer while the file is mapped.
 
   private:    // Prevent default copy constructor and operator=()
     CFileIO(const CFileIO &FI);
@@ -45,6 +48,9 @@ class CFileIO
     BOOL  CreateEx(LPCTSTR szFileName, DWORD dwDesiredAccess, DWORD dwShareMode,
                    DWORD dwCreationDisposition, DWORD dwFlagsAndAttributes);
     BOOL  Close();
+    BOOL  Map();
+    void  Unmap();
+    BOOL  IsMapped() const;
     /*   BOOL  IsOpen() const;
 
          BOOL  Write(const void *pvBuffer, DWORD dwSizeInBytes, DWORD *pdwBytesWritten=NULL);
@@ -96,6 +102,15 @@ inline FILEHANDLE CFileIO::GetFileHandle() const
     //   MEMBERASSERT();
     return m_hFileHandle;
 }
+
+//===============================================================================================
+// FUNCTION: IsMapped
+// PURPOSE:  Returns TRUE if reads are served from a memory mapped view of the file.
+//
+inline BOOL CFileIO::IsMapped() const
+{
+    return (m_pbMapped != NULL);
+}
 #if 0
 
 //===============================================================================================
@@ -17,6 +17,9 @@
 	#define min(a,b)   (((a) < (b)) ? (a) : (b))
 #endif
 
+// The cache doubles in size on sequential reads, up to this many bytes.
+#define READCACHE_MAX_BYTES (1024 * 1024)
+
 //===============================================================================================
 // PROCEDURE: CFileReadCache
 // PURPOSE:   Constructor. 
@@ -30,6 +33,7 @@ CFileReadCache::CFileReadCache()
    m_uItemCount   = 0;                    // Number of items available
    m_llFileOffset = 0;                    // Start offset in the file.
    m_uCacheSize   = 0;
+   m_uMaxCacheSize = 0;
    m_uCacheStart  = 0;
    m_uCacheCount  = 0;
    m_pItemCache.reset((BYTE*)0);
@@ -62,6 +66,7 @@ BOOL CFileReadCache::Initialize(UINT uItemSize, UINT uCacheSize, FILEHANDLE hFil
    m_llFileOffset = llOffset;
    m_File.SetFileHandle(hFile);
    m_uCacheSize   = uCacheSize;
+   m_uMaxCacheSize = max(uCacheSize, min(uItems, READCACHE_MAX_BYTES / uItemSize));
    m_uCacheStart  = 0;
    m_uCacheCount  = 0;
    m_pItemCache.reset(new BYTE[uItemSize * uCacheSize]);
@@ -126,6 +131,8 @@ void *CFileReadCache::Get( UINT uEntry )
 //===============================================================================================
 // PROCEDURE: LoadCache
 // PURPOSE:   If an entry is not in the cache, the cache is reloaded from disk.
+//            A miss right after the cached block is taken as a sequential scan: the
+//            cache grows so that long arrays are read in few, large blocks.
 //
 BOOL CFileReadCache::LoadCache(UINT uEntry)
 {
@@ -135,12 +142,23 @@ BOOL CFileReadCache::LoadCache(UINT uEntry)
    if ((uEntry >= m_uCacheStart) && (uEntry < m_uCacheStart+m_uCacheCount))
       return TRUE;
 
-   // Set the cache at the start of the cache size block that includes the requested item
-   m_uCacheStart = uEntry - (uEntry % m_uCacheSize);
+   BOOL bSequential = (m_uCacheCount > 0) && (uEntry == m_uCacheStart+m_uCacheCount);
+   if (bSequential && m_uCacheSize < m_uMaxCacheSize)
+   {
+      m_uCacheSize = min(2 * m_uCacheSize, m_uMaxCacheSize);
+      m_pItemCache.reset(new BYTE[m_uItemSize * m_uCacheSize]);
+   }
+
+   // Continue a sequential scan at the requested item, otherwise set the cache
+   // at the start of the cache size block that includes the requested item
+   if (bSequential)
+      m_uCacheStart = uEntry;
+   else
+      m_uCacheStart = uEntry - (uEntry % m_uCacheSize);
    m_uCacheCount = min(m_uItemCount-m_uCacheStart, m_uCacheSize);
 
    // seek to the start point.
-   if (!m_File.Seek(m_uCacheStart * m_uItemSize + m_llFileOffset, FILE_BEGIN))
+   if (!m_File.Seek(LONGLONG(m_uCacheStart) * m_uItemSize + m_llFileOffset, FILE_BEGIN))
       return FALSE;
 
    // Read the items from the file.
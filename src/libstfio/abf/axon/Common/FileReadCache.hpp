@@ -25,6 +25,7 @@ private:
    UINT     m_uItemCount;      // Number of items available in the file
    LONGLONG m_llFileOffset;    // Start offset in the file.
    UINT     m_uCacheSize;
+   UINT     m_uMaxCacheSize;   // Limit for the cache size when it grows on sequential reads.
    UINT     m_uCacheStart;
    UINT     m_uCacheCount;
    boost::shared_array<BYTE>    m_pItemCache;
@@ -12,7 +12,12 @@
 // along with this program; if not, write to the Free Software
 // Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+
 #include "./asciilib.h"
+#include "./textparser.h"
 
 #if 0
 wxString stf::NextWord( wxString& str ) {
@@ -39,148 +44,166 @@ wxString stf::NextWord( wxString& str ) {
 }
 #endif
 
-void stf::importASCIIFile( const wxString& fName, int hLinesToSkip, int nColumns,
-        bool firstIsTime, bool toSection, Recording& ReturnRec, bool progress )
-{
-    wxProgressDialog progDlg( wxT("Importing text file"), wxT("Starting..."), 100,
-            NULL, wxPD_SMOOTH | wxPD_AUTO_HIDE | wxPD_APP_MODAL | wxPD_CAN_SKIP );
+namespace {
+
+// Lines are parsed in blocks so that progress can be reported
+const int LINES_PER_BLOCK = 65536;
+
+bool isBlank(const stfio::TextLine& line) {
+    for (const char* pos = line.begin; pos != line.end; ++pos) {
+        if (*pos != ' ' && *pos != '\t') return false;
+    }
+    return true;
+}
+
+// Reads the next whitespace-separated number; missing numbers are read as 0
+const char* readWord(const char* pos, const char* lineEnd, double& value) {
+    while (pos != lineEnd && (*pos == ' ' || *pos == '\t' || *pos == ',')) {
+        ++pos;
+    }
+    const char* first = pos;
+    while (pos != lineEnd && *pos != ' ' && *pos != '\t' && *pos != ',') {
+        ++pos;
+    }
+    value = stfio::parseDouble(first, pos);
+    return pos;
+}
+
+std::string noPath(const std::string& fName) {
+    std::string::size_type sep = fName.find_last_of("/\\");
+    return (sep == std::string::npos) ? fName : fName.substr(sep+1);
+}
+
+}
 
-    //Open ASCII file and copy its contents to ReturnData:
+void stfio::importASCIIFile( const std::string& fName, int hLinesToSkip, int nColumns,
+        bool firstIsTime, bool toSection, Recording& ReturnRec, ProgressInfo& progDlg )
+{
+    int nData = nColumns-int(firstIsTime);
+    if (nData <= 0) {
+        ReturnRec.resize(0);
+        throw std::runtime_error("Empty text file; aborting file import.");
+    }
 
-    wxFileInputStream fStream( fName );
-    wxTextInputStream tStream( fStream );
+    // Read the whole file at once:
+    TextFile file(fName);
+    TextLine line;
 
     // Read header:
-    wxString header;
+    std::string header;
     for(int n_h=0; n_h<hLinesToSkip; n_h++) {
-        if ( fStream.Eof() ) {
+        if ( !file.ReadLine(line) ) {
             ReturnRec.resize(0);
             throw std::runtime_error("Unexpected end of file; aborting file import.");
         }
-        header << tStream.ReadLine() << wxT("\n");
+        header.append(line.begin, line.end);
+        header += "\n";
     }
 
-    double time[2];
-    // Read data:
-    // use vectors temporarily to push back values:
-    std::vector<Vector_double > tempVec(nColumns-int(firstIsTime));
-    std::vector<Vector_double >::iterator it_vd;
-    // Reserve memory right here to speed up file reading a little:
-    for ( it_vd = tempVec.begin(); it_vd != tempVec.end(); ++it_vd ) {
-        // it_vd->reserve( 32768 );
-    }
-    int n_time=0;
-    int nline = 0;
-    bool skip = false;
-    for (;;) {
-        if (fStream.Eof())
-            break;
-        nline++;
-        if ( std::div(nline, 100).rem == 0 ) {
-            if ( skip ) {
-                ReturnRec.resize(0);
-                throw std::runtime_error("File import aborted by user.");
-            }
-            if (progress) {
-                wxString progMsg( wxT("Reading line #") );
-                progMsg << nline;
-                progDlg.Pulse( progMsg, &skip );
-            }
-        }
-        // calculate sampling rate from first two time values:
-        if (firstIsTime) {
-            double tempTime = tStream.ReadDouble();
-            if (n_time<2) {
-                time[n_time++]=tempTime;
-            }
-        }
-
-        if (fStream.Eof())
-            break;
-        for (int n_col=0;n_col<nColumns-int(firstIsTime);++n_col) {
-            tempVec[n_col].push_back( tStream.ReadDouble() );
+    // Every non-blank line contains one row, so that the number of
+    // rows is known before any number is parsed.
+    std::vector<TextLine> lines;
+    while (file.ReadLine(line)) {
+        if (!isBlank(line)) {
+            lines.push_back(line);
         }
     }
-    if ( tempVec.empty() ) {
+    int nRows = (int)lines.size();
+    if (nRows == 0) {
         ReturnRec.resize(0);
         throw std::runtime_error("Empty text file; aborting file import.");
     }
-    // insert vectors:
+
+    // Construct sections in place:
     int n_sec=0, n_ch=0;
     if (toSection) {
-        n_sec=nColumns-int(firstIsTime);
+        n_sec=nData;
         n_ch=1;
     } else {
         n_sec=1;
-        n_ch=nColumns-int(firstIsTime);
+        n_ch=nData;
     }
     ReturnRec.resize(n_ch);
-    std::vector<Channel> TempChannel(n_ch,Channel(n_sec));
-    for (int n_insert=0;n_insert<nColumns-int(firstIsTime);++n_insert) {
-        Section TempSection(tempVec[n_insert].size());
-        std::copy(tempVec[n_insert].begin(),tempVec[n_insert].end(),&TempSection[0]);
-        try {
-            if (toSection) {
-                std::ostringstream label;
-                label << stf::noPath(fName) << ", Section # " << n_insert+1;
-                TempSection.SetSectionDescription(label.str());
-                TempChannel[0].InsertSection(TempSection,n_insert);
-            } else {
-                std::ostringstream label;
-                label << fName << ", Section # 1";
-                TempSection.SetSectionDescription(label.str());
-                TempChannel[n_insert].InsertSection(TempSection,0);
-            }
+    std::vector<double*> columns(nData);
+    for (int n_col=0; n_col<nData; ++n_col) {
+        std::ostringstream label;
+        Section* sec = NULL;
+        if (toSection) {
+            if (n_col == 0) ReturnRec[0].resize(n_sec);
+            label << noPath(fName) << ", Section # " << n_col+1;
+            sec = &ReturnRec[0][n_col];
+        } else {
+            ReturnRec[n_col].resize(n_sec);
+            label << fName << ", Section # 1";
+            sec = &ReturnRec[n_col][0];
         }
-        catch (...) {throw;}
+        sec->SetSectionDescription(label.str());
+        sec->get_w().resize(nRows);
+        columns[n_col] = &(*sec)[0];
     }
-    for (std::size_t n_ch=0;n_ch<TempChannel.size();++n_ch) {
-        try {
-            ReturnRec.InsertChannel(TempChannel[n_ch],n_ch);
+
+    std::vector<double> time(nRows > 1 && firstIsTime ? 2 : 0);
+    for (int n_block=0; n_block < nRows; n_block += LINES_PER_BLOCK) {
+        int blockEnd = std::min(n_block+LINES_PER_BLOCK, nRows);
+        std::ostringstream progStr;
+        progStr << "Reading line #" << n_block+1 << " of " << nRows;
+        bool skip = false;
+        progDlg.Update((int)(100.0*n_block/nRows), progStr.str(), &skip);
+        if (skip) {
+            ReturnRec.resize(0);
+            throw std::runtime_error("File import aborted by user.");
+        }
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+        for (int n_l=n_block; n_l < blockEnd; ++n_l) {
+            const char* pos = lines[n_l].begin;
+            double value = 0;
+            if (firstIsTime) {
+                pos = readWord(pos, lines[n_l].end, value);
+                // calculate sampling rate from first two time values:
+                if (n_l < (int)time.size()) {
+                    time[n_l] = value;
+                }
+            }
+            for (int n_col=0; n_col<nData; ++n_col) {
+                pos = readWord(pos, lines[n_l].end, value);
+                columns[n_col][n_l] = value;
+            }
         }
-        catch (...) {throw;}
     }
 
     if (firstIsTime) {
-        if (time[1]-time[0] <= 0) {
+        if (time.size() < 2 || time[1]-time[0] <= 0) {
             ReturnRec.resize(0);
             throw std::runtime_error("Negative sampling interval\n"
                     "Check number of columns");
         }
         ReturnRec.SetXScale(time[1]-time[0]);
     }
-#if (wxCHECK_VERSION(2, 9, 0) || defined(MODULE_ONLY))
-    ReturnRec.SetFileDescription( header.ToStdString() );
-#else
-    ReturnRec.SetFileDescription(std::string(header.mb_str()));
-#endif    
+    ReturnRec.SetFileDescription(header);
 }
 
-bool stf::exportASCIIFile(const wxString& fName, const Section& Export) {
-    wxString out( stf::sectionToString(Export) );
-    ofstreamMan ASCIIfile( fName );
-    ASCIIfile.myStream.Write( out );
-    return true;
+bool stfio::exportASCIIFile(const std::string& fName, const Section& Export) {
+    std::ofstream ASCIIfile(fName.c_str());
+    if (!ASCIIfile) {
+        return false;
+    }
+    ASCIIfile << (int)Export.size() << "\n";
+    for (int n=0;n<(int)Export.size();++n) {
+        ASCIIfile << Export.GetXScale()*n << "\t" << Export[n] << "\n";
+    }
+    return ASCIIfile.good();
 }
 
-bool stf::exportASCIIFile(const wxString& fName, const Channel& Export) {
-    wxProgressDialog progDlg( wxT("Exporting channel"), wxT("Starting..."), 100,
-            NULL, wxPD_SMOOTH | wxPD_AUTO_HIDE | wxPD_APP_MODAL );
-
+bool stfio::exportASCIIFile(const std::string& fName, const Channel& Export) {
     for (std::size_t n_s=0;n_s<Export.size();++n_s) {
         // create new filename:
-        wxString newFName;
-        newFName << fName << wxT("_") << (int)n_s << wxT(".txt");
-        wxString progStr;
-        progStr << wxT("Writing section #") << (int)n_s + 1 << wxT(" of ") << (int)Export.size()
-        << wxT("\nto file: ") << newFName;
-        progDlg.Update(
-                // Section contribution:
-                (int)((double)n_s/(double)Export.size()*100.0),
-                progStr
-        );
-        ofstreamMan ASCIIfile( newFName );
-        ASCIIfile.myStream.Write( stf::sectionToString(Export[n_s]) );
+        std::ostringstream newFName;
+        newFName << fName << "_" << (int)n_s << ".txt";
+        if (!exportASCIIFile(newFName.str(), Export[n_s])) {
+            return false;
+        }
     }
     return true;
 }
@@ -27,7 +27,10 @@
 namespace stfio {
 
 //! Open an ASCII file and store its contents to a Recording object.
-/*! \param fName Full path to the file to be read.
+/*! Each non-blank line after the header contains one row of numbers,
+ *  separated by spaces, tabs or commas; missing numbers are read as 0.
+ *  Numbers are parsed independently of the current locale.
+ *  \param fName Full path to the file to be read.
  *  \param hLinesToSkip Header lines to skip.
  *  \param nColumns Number of columns.
  *  \param firstIsTime true if the first column contains time values, false otherwise.
@@ -35,7 +38,7 @@ namespace stfio {
  *         false if they should be put into different channels.
  *  \param ReturnRec On entry, an empty Recording object. On exit,
  *         the data stored in \e fName.
- *  \param progress True if the progress dialog should be updated.
+ *  \param progDlg Progress indicator.
  */
 void importASCIIFile(const std::string& fName,
         int hLinesToSkip,
@@ -0,0 +1,214 @@
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <clocale>
+#include <stdexcept>
+
+#include <locale.h>
+#ifdef __APPLE__
+#include <xlocale.h>
+#endif
+
+#if __cplusplus > 199711L
+#include <cstdint>
+#else
+#include <boost/cstdint.hpp>
+#endif
+
+#include "./textparser.h"
+
+namespace {
+
+// Powers of ten that can be represented exactly as doubles
+const double exactPowers[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// Largest integer up to which all integers can be represented exactly
+const uint64_t maxExactMantissa = (uint64_t)1 << 53;
+
+inline bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+// The C locale for strtod(). strtod() itself uses the decimal separator
+// of the current locale, and querying that with localeconv() isn't
+// thread-safe. Created during static initialisation, before any parser
+// threads are started.
+#ifdef _WIN32
+typedef _locale_t c_locale_t;
+c_locale_t createCLocale() { return _create_locale(LC_NUMERIC, "C"); }
+inline double strtodC(const char* str, c_locale_t loc) { return _strtod_l(str, NULL, loc); }
+#else
+typedef locale_t c_locale_t;
+c_locale_t createCLocale() { return newlocale(LC_NUMERIC_MASK, "C", (locale_t)0); }
+inline double strtodC(const char* str, c_locale_t loc) { return strtod_l(str, NULL, loc); }
+#endif
+
+const c_locale_t cLocale = createCLocale();
+
+// Numbers that can't be converted exactly by parseDouble()
+double parseDoubleLocale(const char* first, const char* last) {
+    char buf[64];
+    std::string longNumber;
+    const char* number = buf;
+    std::size_t len = last - first;
+    if (len < sizeof(buf)) {
+        memcpy(buf, first, len);
+        buf[len] = '\0';
+    } else {
+        longNumber.assign(first, last);
+        number = longNumber.c_str();
+    }
+    if (cLocale == (c_locale_t)0) {
+        return strtod(number, NULL);
+    }
+    return strtodC(number, cLocale);
+}
+
+}
+
+stfio::TextFile::TextFile(const std::string& fName) : buffer(), pos(0) {
+    FILE* fp = fopen(fName.c_str(), "rb");
+    if (fp == NULL) {
+        throw std::runtime_error(std::string("Couldn't open ") + fName);
+    }
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    if (size > 0) {
+        buffer.resize(size);
+        if (fread(&buffer[0], 1, size, fp) != (std::size_t)size) {
+            fclose(fp);
+            throw std::runtime_error(std::string("Error while reading ") + fName);
+        }
+    }
+    fclose(fp);
+}
+
+bool stfio::TextFile::ReadLine(TextLine& line) {
+    if (pos >= buffer.size()) {
+        return false;
+    }
+    const char* begin = &buffer[0];
+    std::size_t lineEnd = pos;
+    while (lineEnd < buffer.size() && begin[lineEnd] != '\n' && begin[lineEnd] != '\r') {
+        ++lineEnd;
+    }
+    line = TextLine(begin+pos, begin+lineEnd);
+    pos = lineEnd;
+    if (pos < buffer.size() && begin[pos] == '\r') {
+        ++pos;
+    }
+    if (pos < buffer.size() && begin[pos] == '\n') {
+        ++pos;
+    }
+    return true;
+}
+
+void stfio::TextFile::ReadLines(std::vector<TextLine>& lines) {
+    TextLine line;
+    while (ReadLine(line) && !line.empty()) {
+        lines.push_back(line);
+    }
+}
+
+double stfio::parseDouble(const char* first, const char* last) {
+    const char* p = first;
+    bool negative = false;
+    if (p != last && (*p == '+' || *p == '-')) {
+        negative = (*p == '-');
+        ++p;
+    }
+
+    // Decimal mantissa and exponent
+    uint64_t mantissa = 0;
+    int nDigits = 0, exponent = 0;
+    bool hasDigits = false;
+    for (; p != last && isDigit(*p); ++p) {
+        hasDigits = true;
+        if (mantissa == 0 && *p == '0') continue;
+        if (++nDigits > 19) return parseDoubleLocale(first, last);
+        mantissa = mantissa*10 + (*p-'0');
+    }
+    if (p != last && *p == '.') {
+        for (++p; p != last && isDigit(*p); ++p) {
+            hasDigits = true;
+            --exponent;
+            if (mantissa == 0 && *p == '0') continue;
+            if (++nDigits > 19) return parseDoubleLocale(first, last);
+            mantissa = mantissa*10 + (*p-'0');
+        }
+    }
+    if (!hasDigits) {
+        // empty fields, nan, inf, hexadecimal numbers, ...
+        return (first == last) ? 0.0 : parseDoubleLocale(first, last);
+    }
+    if (p != last && (*p == 'e' || *p == 'E')) {
+        const char* e = p+1;
+        bool negativeExp = false;
+        if (e != last && (*e == '+' || *e == '-')) {
+            negativeExp = (*e == '-');
+            ++e;
+        }
+        if (e == last || !isDigit(*e)) {
+            return parseDoubleLocale(first, last);
+        }
+        int exp10 = 0;
+        for (; e != last && isDigit(*e); ++e) {
+            if (exp10 > 10000) return parseDoubleLocale(first, last);
+            exp10 = exp10*10 + (*e-'0');
+        }
+        exponent += negativeExp ? -exp10 : exp10;
+        p = e;
+    }
+    if (p != last) {
+        return parseDoubleLocale(first, last);
+    }
+
+    // Both the mantissa and the power of ten are exact, so that a single
+    // multiplication or division is correctly rounded.
+    if (mantissa > maxExactMantissa || exponent < -22 || exponent > 22) {
+        return parseDoubleLocale(first, last);
+    }
+    double value = (double)mantissa;
+    if (exponent < 0) {
+        value /= exactPowers[-exponent];
+    } else {
+        value *= exactPowers[exponent];
+    }
+    return negative ? -value : value;
+}
+
+const char* stfio::readField(const char* pos, const char* lineEnd, double& value) {
+    while (pos != lineEnd && *pos == ' ') {
+        ++pos;
+    }
+    const char* first = pos;
+    while (pos != lineEnd && *pos != ' ' && *pos != '\t' && *pos != ',') {
+        ++pos;
+    }
+    value = parseDouble(first, pos);
+    while (pos != lineEnd && *pos == ' ') {
+        ++pos;
+    }
+    if (pos != lineEnd && (*pos == '\t' || *pos == ',')) {
+        ++pos;
+    }
+    return pos;
+}
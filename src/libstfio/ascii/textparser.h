@@ -0,0 +1,94 @@
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+/*! \file textparser.h
+ *  \brief Fast parsing of numeric text files.
+ *
+ *  Text files are read into memory with a single read and split into
+ *  lines, which can then be parsed independently of each other (e.g.
+ *  from several threads). Numbers are always parsed with '.' as the
+ *  decimal separator, regardless of the current locale.
+ */
+
+#ifndef _TEXTPARSER_H
+#define _TEXTPARSER_H
+
+#include <string>
+#include <vector>
+
+namespace stfio {
+
+//! A line of text, without line terminators.
+struct TextLine {
+    TextLine() : begin(NULL), end(NULL) {}
+    TextLine(const char* b, const char* e) : begin(b), end(e) {}
+
+    //! true if the line contains no characters.
+    bool empty() const { return begin == end; }
+
+    const char* begin; /*!< First character of the line. */
+    const char* end;   /*!< One past the last character of the line. */
+};
+
+//! A text file that is held in memory.
+class TextFile {
+  public:
+    //! Reads a complete file into memory.
+    /*! Throws std::runtime_error if the file can't be read.
+     *  \param fName Full path to the file to be read.
+     */
+    explicit TextFile(const std::string& fName);
+
+    //! Reads the next line.
+    /*! Lines may be terminated by "\n", "\r\n" or "\r".
+     *  \param line On exit, the next line of the file.
+     *  \return false if the end of the file has been reached.
+     */
+    bool ReadLine(TextLine& line);
+
+    //! Reads all remaining lines up to the first empty line or the end of the file.
+    /*! \param lines On exit, the lines that have been read.
+     */
+    void ReadLines(std::vector<TextLine>& lines);
+
+  private:
+    std::vector<char> buffer;
+    std::size_t pos;
+};
+
+//! Parses a number in the C locale.
+/*! Behaves like strtod() on the characters from \e first to \e last in
+ *  the C locale: trailing characters that aren't part of a number are
+ *  ignored, and 0 is returned if no number can be parsed. Plain decimal
+ *  numbers are converted without any library calls.
+ *  \param first The first character of the number.
+ *  \param last One past the last character of the number.
+ *  \return The parsed number.
+ */
+double parseDouble(const char* first, const char* last);
+
+//! Reads the next field of a tab-, comma- or space-delimited line.
+/*! Leading and trailing spaces as well as a single delimiter after the
+ *  field are skipped, so that empty fields between two delimiters are
+ *  read as 0, as in the Axon Text File library.
+ *  \param pos The current position in the line.
+ *  \param lineEnd The end of the line.
+ *  \param value On exit, the value of the field.
+ *  \return The position of the next field.
+ */
+const char* readField(const char* pos, const char* lineEnd, double& value);
+
+}
+
+#endif
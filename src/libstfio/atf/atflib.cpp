@@ -14,8 +14,10 @@
 
 #include <iostream>
 #include <sstream>
+#include <algorithm>
 
 #include "./atflib.h"
+#include "../ascii/textparser.h"
 #include "../recording.h"
 
 namespace stfio {
@@ -30,6 +32,19 @@ std::string stfio::ATFError(const std::string& fName, int nError) {
 }
 
 bool stfio::exportATFFile(const std::string& fName, const Recording& WData) {
+    SectionReader source(WData);
+    return exportATFFile(fName, source);
+}
+
+bool stfio::exportATFFile(const std::string& fName, SectionReader& source) {
+    const Recording& WData = source.GetHeader();
+    // Sections are written as columns, so that all sections of the
+    // exported channel are needed at once.
+    std::vector<Section> sections(WData[0].size());
+    for (std::size_t n_s=0; n_s < sections.size(); ++n_s) {
+        sections[n_s] = source.Read(0, n_s);
+    }
+
     int nColumns=1+(int)WData[0].size() /*time + number of sections*/, nFileNum;
     int nError;
 
@@ -63,11 +78,11 @@ bool stfio::exportATFFile(const std::string& fName, const Recording& WData) {
         }
     }
     // Write data line by line:
-    std::size_t max_size=WData[0][0].size();
+    std::size_t max_size=sections[0].size();
     // check for equal section sizes:
-    for (int n_s=1;n_s<(int)WData[0].size();++n_s) {
-        if (WData[0][n_s].size() > max_size) {
-            max_size=WData[0][n_s].size();
+    for (int n_s=1;n_s<(int)sections.size();++n_s) {
+        if (sections[n_s].size() > max_size) {
+            max_size=sections[n_s].size();
         }
     }
     for (int n_l=0;n_l < (int)max_size; ++n_l) {
@@ -81,8 +96,8 @@ bool stfio::exportATFFile(const std::string& fName, const Recording& WData) {
                     throw std::runtime_error(errorMsg);
                 }
             } else {
-                double toWrite = (n_l < (int)WData[0][n_c-1].size()) ?
-                        (double)WData[0][n_c-1][n_l] :
+                double toWrite = (n_l < (int)sections[n_c-1].size()) ?
+                        (double)sections[n_c-1][n_l] :
                 0.0;
                         if (!ATF_WriteDataRecord1(nFileNum,toWrite,&nError)) {
                             std::string errorMsg("Exception while calling ATF_WriteDataRecord1():\n");
@@ -105,115 +120,200 @@ bool stfio::exportATFFile(const std::string& fName, const Recording& WData) {
     return true;
 }
 
+namespace {
+
+// Lines are parsed in blocks so that progress can be reported
+const int LINES_PER_BLOCK = 65536;
+
+std::string stripSpaces(const char* begin, const char* end) {
+    while (begin != end && (*begin == ' ' || *begin == '\t')) ++begin;
+    while (end != begin && (*(end-1) == ' ' || *(end-1) == '\t')) --end;
+    return std::string(begin, end);
+}
+
+// Splits a line of (optionally quoted) column headings into fields
+std::vector<std::string> readHeadings(const stfio::TextLine& line, int nColumns) {
+    std::vector<std::string> headings;
+    const char* pos = line.begin;
+    while ((int)headings.size() < nColumns && pos != line.end) {
+        while (pos != line.end && (*pos == '\t' || *pos == ',')) ++pos;
+        if (pos == line.end) break;
+        const char* first = pos;
+        if (*pos == '"') {
+            first = ++pos;
+            while (pos != line.end && *pos != '"') ++pos;
+            headings.push_back(stripSpaces(first, pos));
+            if (pos != line.end) ++pos;
+        } else {
+            while (pos != line.end && *pos != '\t' && *pos != ',') ++pos;
+            headings.push_back(stripSpaces(first, pos));
+        }
+    }
+    if ((int)headings.size() < nColumns) {
+        throw std::runtime_error("Error while opening ATF file:\nMissing column headings");
+    }
+    return headings;
+}
+
+// Splits a heading of the form "Title (units)"
+void splitHeading(const std::string& heading, std::string& title, std::string& units) {
+    std::string::size_type open = heading.find('(');
+    if (open == std::string::npos) {
+        title = heading;
+        units = "";
+        return;
+    }
+    std::string::size_type close = heading.find(')', open);
+    if (close == std::string::npos) {
+        close = heading.size();
+    }
+    title = stripSpaces(heading.data(), heading.data()+open);
+    units = stripSpaces(heading.data()+open+1, heading.data()+close);
+}
+
+// Reads the first two numbers from a header line
+void readHeaderNumbers(const stfio::TextLine& line, double& first, double& second) {
+    const char* pos = stfio::readField(line.begin, line.end, first);
+    stfio::readField(pos, line.end, second);
+}
+
+}
+
 void stfio::importATFFile(const std::string &fName, Recording &ReturnData, ProgressInfo& progDlg) {
-    int nColumns, nFileNum;
-    int nError;
-    const int nMaxText=64;
+    // Read the complete file at once, and parse all columns in a single pass
+    // instead of going through the ATF library column by column.
+    TextFile file(fName);
+    TextLine line;
 
-    if (!ATF_OpenFile(fName.c_str(),ATF_READONLY,&nColumns,&nFileNum,&nError)) {
-        std::string errorMsg("Exception while calling ATF_OpenFile():\n");
-        errorMsg+=ATFError(fName,nError);
-        throw std::runtime_error(errorMsg);
+    // File id and version
+    if (!file.ReadLine(line) || line.end-line.begin < 3) {
+        throw std::runtime_error("Error while opening ATF file:\nFile appears to be empty");
+    }
+    std::string fileId(line.begin, line.begin+3);
+    const char* pos = line.begin+3;
+    while (pos != line.end && (*pos == ' ' || *pos == '\t' || *pos == ',')) ++pos;
+    double version = 0;
+    readField(pos, line.end, version);
+    if (fileId == "ATF") {
+        if (version > ATF_CURRENTVERSION || version == 0.0) {
+            throw std::runtime_error("Error while opening ATF file:\nUnsupported ATF version");
+        }
+    } else if (fileId == "PAF") {
+        if (version != 5.0) {
+            throw std::runtime_error("Error while opening ATF file:\nUnsupported PAF version");
+        }
+        version = 0.0;
+    } else {
+        throw std::runtime_error("Error while opening ATF file:\nNot an ATF file");
+    }
+
+    // Number of optional header records and of data columns
+    double nHeadersD = 0, nColumnsD = 0;
+    if (!file.ReadLine(line)) {
+        throw std::runtime_error("Error while opening ATF file:\nMissing header");
+    }
+    if (version == 0.0) {
+        double dummy = 0;
+        readHeaderNumbers(line, nHeadersD, dummy);
+        if (!file.ReadLine(line)) {
+            throw std::runtime_error("Error while opening ATF file:\nMissing header");
+        }
+        readHeaderNumbers(line, nColumnsD, dummy);
+    } else {
+        readHeaderNumbers(line, nHeadersD, nColumnsD);
     }
+    int nHeaders = nHeadersD > 0 ? (int)nHeadersD : 0;
+    int nColumns = nColumnsD > 0 ? (int)nColumnsD : 0;
     // Assume that the first column is time:
     if (nColumns==0) {
         std::string errorMsg("Error while opening ATF file:\nFile appears to be empty");
         throw std::runtime_error(errorMsg);
     }
-    long sectionSize;
-    if (!ATF_CountDataLines(nFileNum,&sectionSize,&nError)) {
-        std::string errorMsg("Exception while calling ATF_CountDataLines():\n");
-        errorMsg+=ATFError(fName,nError);
-        throw std::runtime_error(errorMsg);
+    for (int n_h=0; n_h < nHeaders; ++n_h) {
+        if (!file.ReadLine(line)) {
+            throw std::runtime_error("Error while opening ATF file:\nMissing header records");
+        }
     }
 
-    // If first column contains time values, determine sampling interval:
-    std::vector<char> titleVec(nMaxText);
-    if (!ATF_GetColumnTitle(nFileNum,0,&titleVec[0],nMaxText,&nError)) {
-        std::string errorMsg("Exception while calling ATF_GetColumnTitle():\n");
-        errorMsg+=ATFError(fName,nError);
-        throw std::runtime_error(errorMsg);
+    // Column titles and units
+    std::vector<std::string> titles(nColumns), units(nColumns);
+    if (!file.ReadLine(line)) {
+        throw std::runtime_error("Error while opening ATF file:\nMissing column headings");
     }
-    std::string titleString(titleVec.begin(),titleVec.end());
+    if (version == 0.0) {
+        titles = readHeadings(line, nColumns);
+        if (!file.ReadLine(line)) {
+            throw std::runtime_error("Error while opening ATF file:\nMissing column units");
+        }
+        units = readHeadings(line, nColumns);
+    } else {
+        std::vector<std::string> headings = readHeadings(line, nColumns);
+        for (int n_c=0; n_c < nColumns; ++n_c) {
+            splitHeading(headings[n_c], titles[n_c], units[n_c]);
+        }
+    }
+
+    // Data records end at the first empty line
+    std::vector<TextLine> lines;
+    file.ReadLines(lines);
+    int sectionSize = (int)lines.size();
+
+    // If first column contains time values, determine sampling interval:
+    const std::string& titleString = titles[0];
     int timeInFirstColumn=0;
     if (titleString.find("time")!=std::string::npos ||
             titleString.find("Time")!=std::string::npos ||
             titleString.find("TIME")!=std::string::npos)
     {
         // Read sampling information from first two time values:
+        if (sectionSize < 2) {
+            throw std::runtime_error("Error while opening ATF file:\n"
+                                     "Can't determine sampling interval");
+        }
         double time[2];
         for (int n_l=0;n_l<2;++n_l) {
-            if (!ATF_ReadDataColumn(nFileNum,0,&time[n_l],&nError)) {
-                std::string errorMsg("Exception while calling ATF_ReadDataColumn():\n");
-                errorMsg+=ATFError(fName,nError);
-                throw std::runtime_error(errorMsg);
-            }
-        }
-        if (!ATF_RewindFile(nFileNum,&nError)) {
-            std::string errorMsg("Exception while calling ATF_RewindFile():\n");
-            errorMsg+=ATFError(fName,nError);
-            throw std::runtime_error(errorMsg);
+            readField(lines[n_l].begin, lines[n_l].end, time[n_l]);
         }
-
         ReturnData.SetXScale(time[1]-time[0]);
         timeInFirstColumn=1;
     }
-    ReturnData.resize(1);
-    Channel TempChannel(nColumns-timeInFirstColumn);
-    for (int n_c=timeInFirstColumn;n_c<nColumns;++n_c) {
-        int progbar = (double)100.0*(n_c+1-timeInFirstColumn)/(double)(nColumns-timeInFirstColumn);
 
-        std::ostringstream progStr;
-        progStr << "Section #" << n_c+1-timeInFirstColumn << " of " << nColumns-timeInFirstColumn;
-        progDlg.Update(progbar, progStr.str());
+    int nSections = nColumns-timeInFirstColumn;
+    ReturnData.resize(1);
+    ReturnData[0].resize(nSections);
+    std::vector<double*> columns(nSections);
+    for (int n_s=0; n_s < nSections; ++n_s) {
         std::ostringstream label;
         label
             << fName 
-            << ", Section # " << n_c-timeInFirstColumn+1;
-        Section TempSection(sectionSize,label.str());
-        for (int n_l=0;n_l<sectionSize;++n_l) {
-            if (!ATF_ReadDataColumn(nFileNum,n_c,&TempSection[n_l],&nError)) {
-                std::string errorMsg("Exception while calling ATF_ReadDataColumn():\n");
-                errorMsg+=ATFError(fName,nError);
-                ReturnData.resize(0);
-                throw std::runtime_error(errorMsg);
-            }
-        }
-        if (n_c-timeInFirstColumn==0) {
-            std::vector<char> unitsVec(nMaxText);
-            if (!ATF_GetColumnUnits(nFileNum,n_c,&unitsVec[0],nMaxText,&nError)) {
-                std::string errorMsg("Exception while calling ATF_GetColumnUnits():\n");
-                errorMsg+=ATFError(fName,nError);
-                ReturnData.resize(0);
-                throw std::runtime_error(errorMsg);
-            }
-            ReturnData[0].SetYUnits(std::string(&unitsVec[0]));
-        }
-        try {
-            TempChannel.InsertSection(TempSection,n_c-timeInFirstColumn);
-        }
-        catch (...) {
-            throw;
-        }
-        // Rewind file before reading next column:
-        if (!ATF_RewindFile(nFileNum,&nError)) {
-            std::string errorMsg("Exception while calling ATF_RewindFile():\n");
-            errorMsg+=ATFError(fName,nError);
-            ReturnData.resize(0);
-            throw std::runtime_error(errorMsg);
-        }
+            << ", Section # " << n_s+1;
+        ReturnData[0][n_s].SetSectionDescription(label.str());
+        ReturnData[0][n_s].get_w().resize(sectionSize);
+        columns[n_s] = sectionSize > 0 ? &ReturnData[0][n_s][0] : NULL;
     }
-    try {
-        ReturnData.InsertChannel(TempChannel,0);
-    }
-    catch (...) {
-        ReturnData.resize(0);
-        throw;
+    if (nSections > 0) {
+        ReturnData[0].SetYUnits(units[timeInFirstColumn]);
     }
 
-    if (!ATF_CloseFile(nFileNum)) {
-        std::string errorMsg("Exception while calling ATF_CloseFile():\n");
-        errorMsg += "Error while closing ATF file";
-        throw std::runtime_error(errorMsg);
+    // Fill all columns from each line; lines are independent of each other
+    for (int n_block=0; n_block < sectionSize; n_block += LINES_PER_BLOCK) {
+        int blockEnd = std::min(n_block+LINES_PER_BLOCK, sectionSize);
+        int progbar = (int)(100.0*n_block/sectionSize);
+        std::ostringstream progStr;
+        progStr << "Line #" << n_block+1 << " of " << sectionSize;
+        progDlg.Update(progbar, progStr.str());
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+        for (int n_l=n_block; n_l < blockEnd; ++n_l) {
+            const char* linePos = lines[n_l].begin;
+            double value = 0;
+            for (int n_c=0; n_c < nColumns; ++n_c) {
+                linePos = readField(linePos, lines[n_l].end, value);
+                if (n_c >= timeInFirstColumn) {
+                    columns[n_c-timeInFirstColumn][n_l] = value;
+                }
+            }
+        }
     }
 }
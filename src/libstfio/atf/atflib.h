@@ -42,6 +42,14 @@ void importATFFile(const std::string& fName, Recording& ReturnData, ProgressInfo
  */
 StfioDll bool exportATFFile(const std::string& fName, const Recording& WData);
 
+//! Export the first channel of a SectionReader to an ATF file.
+/*! All sections of the first channel are held in memory because
+ *  ATF files store sections as columns.
+ *  \param fName Full path to the file to be written.
+ *  \param source The sections to be exported.
+ */
+StfioDll bool exportATFFile(const std::string& fName, SectionReader& source);
+
 }
 
 #endif
@@ -405,6 +405,154 @@ int AG_ReadColumn( filehandle refNum, const int fileFormat, const int columnNumb
     return 0;
 }
 
+static int AG_SkipBytes( filehandle refNum, AXGLONG bytes )
+{
+    int posn = 0;
+    int result = GetFilePosition( refNum, &posn );
+    if ( result )
+        return result;
+    return SetFilePosition( refNum, posn + bytes );
+}
+
+int AG_SkipColumn( filehandle refNum, const int fileFormat, const int columnNumber, ColumnData *columnData )
+{
+    // Initialize in case of error during read
+    columnData->points = 0;
+    columnData->title = "";
+
+    switch ( fileFormat )
+    {
+     case kAxoGraph_Graph_Format:
+         {
+             ColumnHeader columnHeader;
+             AXGLONG bytes = sizeof( ColumnHeader );
+             int result = ReadFromFile( refNum, &bytes, &columnHeader );
+             if ( result )
+                 return result;
+
+#ifdef __LITTLE_ENDIAN__
+             ByteSwapLong( &columnHeader.points );
+#endif
+
+             columnData->type = FloatArrayType;
+             columnData->points = columnHeader.points;
+             PascalToCString( columnHeader.title );
+             columnData->title = std::string( (char*)columnHeader.title );
+
+             return AG_SkipBytes( refNum, columnHeader.points * sizeof( float ) );
+         }
+
+     case kAxoGraph_Digitized_Format:
+         {
+             if ( columnNumber == 0 )
+             {
+                 // The first column only consists of a header
+                 return AG_ReadColumn( refNum, fileFormat, columnNumber, columnData );
+             }
+
+             DigitizedColumnHeader columnHeader;
+             AXGLONG bytes = sizeof( DigitizedColumnHeader );
+             int result = ReadFromFile( refNum, &bytes, &columnHeader );
+             if ( result )
+                 return result;
+
+#ifdef __LITTLE_ENDIAN__
+             ByteSwapLong( &columnHeader.points );
+             ByteSwapFloat( &columnHeader.scalingFactor );
+#endif
+
+             columnData->type = ScaledShortArrayType;
+             columnData->points = columnHeader.points;
+             PascalToCString( columnHeader.title );
+             columnData->title = std::string( (char*)columnHeader.title );
+             columnData->scaledShortArray.scale = columnHeader.scalingFactor;
+             columnData->scaledShortArray.offset = 0;
+
+             return AG_SkipBytes( refNum, columnHeader.points * sizeof( short ) );
+         }
+
+     case kAxoGraph_X_Format:
+         {
+             AxoGraphXColumnHeader columnHeader;
+             AXGLONG bytes = sizeof( AxoGraphXColumnHeader );
+             int result = ReadFromFile( refNum, &bytes, &columnHeader );
+             if ( result )
+                 return result;
+
+#ifdef __LITTLE_ENDIAN__
+             ByteSwapLong( &columnHeader.points );
+             ByteSwapLong( &columnHeader.dataType );
+             ByteSwapLong( &columnHeader.titleLength );
+#endif
+
+             columnData->type = (ColumnType)columnHeader.dataType;
+             columnData->points = columnHeader.points;
+
+             // sanity check on column type
+             if ( columnData->type < 0 || columnData->type > 14 )
+                 return -1;
+
+             columnData->titleLength = columnHeader.titleLength;
+             std::vector< unsigned char > charBuffer( columnHeader.titleLength, '\0' );
+             result = ReadFromFile( refNum, &columnHeader.titleLength, &charBuffer[0] );
+             if ( result )
+                 return result;
+             for (std::size_t nc=1; nc<charBuffer.size(); nc+=2) {
+                 columnData->title += char(charBuffer[nc]);
+             }
+
+             switch ( columnHeader.dataType )
+             {
+              case ShortArrayType:
+                  return AG_SkipBytes( refNum, columnHeader.points * sizeof( short ) );
+              case IntArrayType:
+                  return AG_SkipBytes( refNum, columnHeader.points * sizeof( int ) );
+              case FloatArrayType:
+                  return AG_SkipBytes( refNum, columnHeader.points * sizeof( float ) );
+              case DoubleArrayType:
+                  return AG_SkipBytes( refNum, columnHeader.points * sizeof( double ) );
+              case SeriesArrayType:
+                  {
+                      SeriesArray seriesParameters;
+                      AXGLONG bytes = sizeof( SeriesArray );
+                      result = ReadFromFile( refNum, &bytes, &seriesParameters );
+
+#ifdef __LITTLE_ENDIAN__
+                      ByteSwapDouble( &seriesParameters.firstValue );
+                      ByteSwapDouble( &seriesParameters.increment );
+#endif
+
+                      columnData->seriesArray.firstValue = seriesParameters.firstValue;
+                      columnData->seriesArray.increment = seriesParameters.increment;
+                      return result;
+                  }
+              case ScaledShortArrayType:
+                  {
+                      double scale, offset;
+                      AXGLONG bytes = sizeof( double );
+                      result = ReadFromFile( refNum, &bytes, &scale );
+                      result = ReadFromFile( refNum, &bytes, &offset );
+#ifdef __LITTLE_ENDIAN__
+                      ByteSwapDouble( &scale );
+                      ByteSwapDouble( &offset );
+#endif
+
+                      columnData->scaledShortArray.scale = scale;
+                      columnData->scaledShortArray.offset = offset;
+
+                      return AG_SkipBytes( refNum, columnHeader.points * sizeof( short ) );
+                  }
+             }
+         }
+         break;
+     default:
+         {
+             return -1;
+         }
+    }
+    return 0;
+}
+
 std::string AG_ReadComment( filehandle refNum )
 {
     // File comment
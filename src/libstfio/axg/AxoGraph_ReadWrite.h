@@ -376,6 +376,13 @@ int AG_ReadColumn( filehandle refNum, const int fileFormat, const int columnNumb
 //    This function allocates new pointers of the appropriate size, reads the data into
 //    them and returns it in columnData.
 
+int AG_SkipColumn( filehandle refNum, const int fileFormat, const int columnNumber, ColumnData *columnData );
+
+//    Read in the header of a column from any AxoGraph data file and move the
+//    file position to the start of the next column without reading the data.
+//    Returns the number of points, the column type and the column title in columnData.
+//    Series parameters and scaling factors are returned as well; data arrays are left empty.
+
 std::string AG_ReadComment( filehandle refNum );
 
 //    Read in comment from an AxoGraph X data file.
@@ -13,10 +13,18 @@
 // Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 
 #include <string>
+#include <cstring>
 #include <iomanip>
 #include <vector>
 #include <iostream>
 #include <sstream>
+#include <stdexcept>
+
+#if __cplusplus > 199711L
+#include <cstdint>
+#else
+#include <boost/cstdint.hpp>
+#endif
 
 #include "../axg/fileUtils.h"
 #include "../axg/AxoGraph_ReadWrite.h"
@@ -24,31 +32,228 @@
 #include "./axglib.h"
 #include "../recording.h"
 
-void stfio::importAXGFile(const std::string &fName, Recording &ReturnData, ProgressInfo& progDlg) {
+namespace {
 
-    std::string errorMsg("Exception while calling AXG_importAXGFile():\n");
-    std::string yunits;
-    // =====================================================================================================================
-    //
-    // Open an AxoGraph file and read in the data
-    //
-    // =====================================================================================================================
+// Header of a data column and the position of its data in the file
+struct AXGColumn {
+    AXGColumn() : type(FloatArrayType), points(0), title(), dataOffset(0), scale(1.0), offset(0.0) {}
+    ColumnType type;
+    AXGLONG points;
+    std::string title;
+    int dataOffset;
+    // ScaledShortArrayType: value = point*scale+offset
+    // SeriesArrayType: value = offset+index*scale
+    double scale;
+    double offset;
+};
 
-    progDlg.Update(0, "Opening AXG file...");
+// Columns, channels and notes of an AxoGraph file
+struct AXGLayout {
+    AXGLayout() : xscale(1.0), columns(), channel_names(), channel_units(), factors(), comment(), notes() {}
+    double xscale;
+    // Data columns, in the same order as in the file
+    std::vector<AXGColumn> columns;
+    std::vector<std::string> channel_names;
+    std::vector<std::string> channel_units;
+    std::vector<double> factors;
+    std::string comment;
+    std::string notes;
+};
+
+// Size of a data point in the file, or -1 if the column type can't be read
+int AXGPointSize(ColumnType type) {
+    switch (type) {
+     case ShortArrayType:
+     case ScaledShortArrayType:
+         return 2;
+     case IntArrayType:
+     case FloatArrayType:
+         return 4;
+     case DoubleArrayType:
+         return 8;
+     case SeriesArrayType:
+         return 0;
+     default:
+         return -1;
+    }
+}
+
+// Reads the headers of all columns and the notes without reading any data.
+// Data column j belongs to channel j % channel_names.size().
+void scanAXGFile(filehandle dataRefNum, int fileFormat, AXGLONG numberOfColumns, AXGLayout& layout) {
+    layout.columns.reserve(numberOfColumns-1);
+    for ( int columnNumber=0; columnNumber<numberOfColumns; columnNumber++ ) {
+        ColumnData column;
+        int result = AG_SkipColumn( dataRefNum, fileFormat, columnNumber, &column );
+        int posn = 0;
+        if ( result == 0 ) {
+            result = GetFilePosition( dataRefNum, &posn );
+        }
+        if ( result ) {
+            throw std::runtime_error("Error from AG_SkipColumn");
+        }
+        if ( columnNumber == 0 ) {
+            layout.xscale = column.seriesArray.increment * 1.0e3;
+            continue;
+        }
+        if (column.points<1) {
+            throw std::out_of_range("number of points too small");
+        }
+        int pointSize = AXGPointSize(column.type);
+        if (pointSize < 0) {
+            throw std::runtime_error("Unsupported column type in AxoGraph file");
+        }
+
+        AXGColumn axgColumn;
+        axgColumn.type = column.type;
+        axgColumn.points = column.points;
+        axgColumn.title = column.title;
+        axgColumn.dataOffset = posn - column.points*pointSize;
+        if (column.type == ScaledShortArrayType) {
+            axgColumn.scale = column.scaledShortArray.scale;
+            axgColumn.offset = column.scaledShortArray.offset;
+        }
+        if (column.type == SeriesArrayType) {
+            axgColumn.scale = column.seriesArray.increment;
+            axgColumn.offset = column.seriesArray.firstValue;
+        }
+        layout.columns.push_back(axgColumn);
+
+        // check whether this is a new channel:
+        bool isnew = true;
+        for (std::size_t n_c=0; n_c < layout.channel_names.size(); ++n_c) {
+            if ( column.title == layout.channel_names[n_c] || column.title.find("Column")==0 ) {
+                isnew = false;
+                break;
+            }
+        }
+        if (isnew) {
+            std::string units( column.title );
+            std::size_t left = units.find_last_of("(") + 1;
+            std::size_t right = units.find_last_of(")");
+            layout.channel_units.push_back( units.substr(left, right-left) );
+            layout.channel_names.push_back( column.title );
+        }
+    }
+    if (layout.channel_names.empty()) {
+        throw std::runtime_error("File format error: no data columns");
+    }
+
+    layout.factors.resize(layout.channel_units.size(), 1.0);
+    for (std::size_t n_c=0; n_c < layout.channel_units.size(); ++n_c) {
+        if (layout.channel_units[n_c] == "V") {
+            layout.channel_units[n_c] = "mV";
+            layout.factors[n_c] = 1.0e3;
+        }
+        if (layout.channel_units[n_c] == "A") {
+            layout.channel_units[n_c] = "pA";
+            layout.factors[n_c] = 1.0e12;
+        }
+    }
+
+    layout.comment = AG_ReadComment(dataRefNum);
+    layout.notes = AG_ReadNotes(dataRefNum);
+}
+
+// AxoGraph files are big-endian. The byte swaps are plain shifts so that
+// the compiler can vectorize the conversion loops below.
+#ifdef __LITTLE_ENDIAN__
+inline uint16_t fromBigEndian(uint16_t x) {
+    return (uint16_t)((x << 8) | (x >> 8));
+}
+
+inline uint32_t fromBigEndian(uint32_t x) {
+    return (x << 24) | ((x << 8) & 0x00FF0000u) | ((x >> 8) & 0x0000FF00u) | (x >> 24);
+}
+
+inline uint64_t fromBigEndian(uint64_t x) {
+    return ((uint64_t)fromBigEndian((uint32_t)x) << 32) | fromBigEndian((uint32_t)(x >> 32));
+}
+#else
+template <typename U>
+inline U fromBigEndian(U x) {
+    return x;
+}
+#endif
+
+// Point i of big-endian data of type T; U is an unsigned integer of the same size as T
+template <typename T, typename U>
+inline T bigEndianPoint(const char* data, std::size_t i) {
+    U raw;
+    std::memcpy(&raw, data + i*sizeof(U), sizeof(U));
+    raw = fromBigEndian(raw);
+    T value;
+    std::memcpy(&value, &raw, sizeof(T));
+    return value;
+}
+
+// Points are rounded to float before they are scaled, as in AG_ReadFloatColumn()
+template <typename T, typename U>
+void decodeAXGColumn(const char* data, std::size_t points, double factor, double* dest) {
+    for (std::size_t i=0; i < points; ++i) {
+        dest[i] = (double)(float)bigEndianPoint<T, U>(data, i) * factor;
+    }
+}
+
+// Reads a data column, converts it and scales it by factor straight into dest.
+// buffer is reused between columns to hold the raw data.
+void readAXGColumn(filehandle dataRefNum, const AXGColumn& column, double factor,
+                   std::vector<char>& buffer, double* dest)
+{
+    std::size_t points = column.points;
+    if (column.type == SeriesArrayType) {
+        for (std::size_t i=0; i < points; ++i) {
+            dest[i] = (double)(float)(column.offset + i * column.scale) * factor;
+        }
+        return;
+    }
+
+    AXGLONG bytes = column.points * AXGPointSize(column.type);
+    buffer.resize(bytes);
+    int result = SetFilePosition( dataRefNum, column.dataOffset );
+    if ( result == 0 ) {
+        result = ReadFromFile( dataRefNum, &bytes, &buffer[0] );
+    }
+    if ( result ) {
+        throw std::runtime_error("Error while reading column data from AxoGraph file");
+    }
+
+    const char* data = &buffer[0];
+    switch (column.type) {
+     case ShortArrayType:
+         decodeAXGColumn<int16_t, uint16_t>(data, points, factor, dest);
+         break;
+     case IntArrayType:
+         decodeAXGColumn<int32_t, uint32_t>(data, points, factor, dest);
+         break;
+     case FloatArrayType:
+         decodeAXGColumn<float, uint32_t>(data, points, factor, dest);
+         break;
+     case DoubleArrayType:
+         decodeAXGColumn<double, uint64_t>(data, points, factor, dest);
+         break;
+     case ScaledShortArrayType:
+         for (std::size_t i=0; i < points; ++i) {
+             int16_t point = bigEndianPoint<int16_t, uint16_t>(data, i);
+             dest[i] = (double)(float)(point * column.scale + column.offset) * factor;
+         }
+         break;
+     default:
+         throw std::runtime_error("Unsupported column type in AxoGraph file");
+    }
+}
+
+// Opens an AxoGraph file and reads the number of columns; throws on failure.
+filehandle openAXGFile(const std::string& fName, std::string errorMsg, int& fileFormat, AXGLONG& numberOfColumns) {
     filehandle dataRefNum = OpenFile( fName.c_str() );
-    
-    if ( dataRefNum == 0 )
-    {
+    if ( dataRefNum == 0 ) {
         errorMsg += "\n\nError: Could not find file.";
-        ReturnData.resize(0);
-        throw std::runtime_error(std::string(errorMsg.c_str()));
+        throw std::runtime_error(errorMsg);
     }
 
     // check the AxoGraph header, and get the number of columns to be read
-    int fileFormat = 0;
     int result = AG_GetFileFormat( dataRefNum, &fileFormat );
-    if ( result )
-    {
+    if ( result ) {
         errorMsg += "\nError from AG_GetFileFormat - ";
         if ( result == kAG_FormatErr )
             errorMsg += "file is not in AxoGraph format";
@@ -56,153 +261,162 @@ void stfio::importAXGFile(const std::string &fName, Recording &ReturnData, Progr
             errorMsg += "file is of a more recent version than supported by this code";
         else
             errorMsg += "error";
-
-        ReturnData.resize(0);
         CloseFile( dataRefNum );
         throw std::runtime_error(errorMsg);
     }
 
-    AXGLONG numberOfColumns = 0;
     result = AG_GetNumberOfColumns( dataRefNum, fileFormat, &numberOfColumns );
-    if ( result )
-    {
+    if ( result ) {
         errorMsg += "Error from AG_GetNumberOfColumns";
-        ReturnData.resize(0);
         CloseFile( dataRefNum );
         throw std::runtime_error(errorMsg);
     }
 
     // Sanity check
-    if ( numberOfColumns <= 0 )  	// negative columns
-    {
+    if ( numberOfColumns <= 0 ) {
         errorMsg += "File format error: number of columns is negative in AxoGraph data file";
-        ReturnData.resize(0);
         CloseFile( dataRefNum );
         throw std::runtime_error(errorMsg);
     }
+    return dataRefNum;
+}
+
+// Sets up the channels, section descriptions and file information of rec
+// without allocating any section data.
+void setupAXGRecording(const AXGLayout& layout, Recording& rec) {
+    std::size_t numberOfChannels = layout.channel_names.size();
+    std::size_t sectionsPerChannel = layout.columns.size() / numberOfChannels;
+    rec.resize(numberOfChannels);
+    for (std::size_t n_c=0; n_c < numberOfChannels; ++n_c) {
+        Channel TempChannel(sectionsPerChannel);
+        for (std::size_t n_s=0; n_s < sectionsPerChannel; ++n_s) {
+            TempChannel[n_s].SetSectionDescription( layout.columns[n_s*numberOfChannels+n_c].title );
+        }
+        TempChannel.SetChannelName( layout.channel_names[n_c] );
+        TempChannel.SetYUnits( layout.channel_units[n_c] );
+        rec.InsertChannel(TempChannel, n_c);
+    }
+
+    rec.SetXScale( layout.xscale );
+    rec.SetComment( layout.comment );
+    rec.SetFileDescription( layout.notes );
+    rec.SetTime( AG_ParseTime(layout.notes) );
+    rec.SetDate( AG_ParseDate(layout.notes) );
+}
+
+}
+
+void stfio::importAXGFile(const std::string &fName, Recording &ReturnData, ProgressInfo& progDlg) {
+
+    std::string errorMsg("Exception while calling AXG_importAXGFile():\n");
+
+    progDlg.Update(0, "Opening AXG file...");
+    ReturnData.resize(0);
+    int fileFormat = 0;
+    AXGLONG numberOfColumns = 0;
+    filehandle dataRefNum = openAXGFile(fName, errorMsg, fileFormat, numberOfColumns);
 
-    //	AG_ReadFloatColumn reads column data into a float column structure.
-    int numberOfChannels = 0;
+    try {
+        // All column headers are read first so that every section can be
+        // allocated in place before any data are read.
+        AXGLayout layout;
+        scanAXGFile(dataRefNum, fileFormat, numberOfColumns, layout);
+        std::size_t numberOfChannels = layout.channel_names.size();
+        if (layout.columns.size() % numberOfChannels != 0) {
+            throw std::out_of_range("Number of columns doesn't match number of channels in importAXGFile()");
+        }
+        setupAXGRecording(layout, ReturnData);
 
-    std::vector< Section > section_list;
-    std::vector< std::string > channel_names;
-    std::vector< std::string > channel_units;
-    double xscale = 1.0;
-    for ( int columnNumber=0; columnNumber<numberOfColumns; columnNumber++ )
-    {
-        if (columnNumber != 0) {
-            int progbar = int((double)columnNumber/(double)numberOfColumns * 100.0);
+        std::vector<char> buffer;
+        for (std::size_t nColumn=0; nColumn < layout.columns.size(); ++nColumn) {
+            int progbar = int((double)(nColumn+1)/(double)numberOfColumns * 100.0);
             std::ostringstream progStr;
-            progStr << "Section #" << columnNumber << " of " << numberOfColumns-1;
+            progStr << "Section #" << nColumn+1 << " of " << numberOfColumns-1;
             bool skip = false;
             progDlg.Update(progbar, progStr.str(), &skip);
             if (skip) {
                 ReturnData.resize(0);
+                CloseFile( dataRefNum );
                 return;
             }
-        }
 
-        ColumnData column;
-        result = AG_ReadFloatColumn( dataRefNum, fileFormat, columnNumber, &column );
-
-        if ( result )
-        {
-            errorMsg += "Error from AG_ReadFloatColumn";
-            ReturnData.resize(0);
-            CloseFile( dataRefNum );
-            throw std::runtime_error(std::string(errorMsg.c_str()));
+            std::size_t n_c = nColumn % numberOfChannels;
+            Section& sec = ReturnData[n_c][nColumn / numberOfChannels];
+            sec.resize(layout.columns[nColumn].points);
+            readAXGColumn(dataRefNum, layout.columns[nColumn], layout.factors[n_c], buffer, &sec[0]);
         }
-        if ( columnNumber == 0 ) {
-            xscale = column.seriesArray.increment * 1.0e3;
-        } else {
-            section_list.push_back( Section(column.points, column.title ) );
-            std::size_t last = section_list.size()-1;
+    }
+    catch (const std::runtime_error& e) {
+        ReturnData.resize(0);
+        CloseFile( dataRefNum );
+        throw std::runtime_error(errorMsg + e.what());
+    }
+    catch (...) {
+        ReturnData.resize(0);
+        CloseFile( dataRefNum );
+        throw;
+    }
 
-            if (column.points<1) {
-                throw std::out_of_range("number of points too small");
-            }
-            if ((int)column.floatArray.size()<column.points) {
-                throw std::out_of_range("floatArray too small in importAXGFile()");
-            }
-            if (section_list[last].get().size()!=column.floatArray.size()) {
-                throw std::out_of_range("section too small in importAXGFile()");
-            }
+    // Close the import file
+    CloseFile( dataRefNum );
+}
 
-            std::copy(column.floatArray.begin(),column.floatArray.end(),section_list[last].get_w().begin());
-            // check whether this is a new channel:
-            bool isnew = true;
+namespace {
 
-            // test whether this name has been used before:
-            for (std::size_t n_c=0; n_c < channel_names.size(); ++n_c) {
-                if ( column.title == channel_names[n_c] || column.title.find("Column")==0 ) {
-                    isnew = false;
-                    break;
-                }
-            }
-            if (isnew) {
-                numberOfChannels++;
-                std::string units( column.title );
-                std::size_t left = units.find_last_of("(") + 1;
-                std::size_t right = units.find_last_of(")");
-                yunits = units.substr(left, right-left);
-                channel_units.push_back( yunits );
-                channel_names.push_back( column.title );
-            }
-        }
+// Keeps an AXG file open and reads columns when they are requested.
+class AXGLazyFile : public stfio::LazyFile {
+  public:
+    AXGLazyFile(const std::string& fName);
+    ~AXGLazyFile();
+
+    void ReadSection(std::size_t n_c, std::size_t n_s, Section& ReturnSection);
+
+  private:
+    filehandle dataRefNum;
+    AXGLayout layout;
+    std::vector<char> buffer;
+};
+
+AXGLazyFile::AXGLazyFile(const std::string& fName)
+    : dataRefNum(0), layout(), buffer()
+{
+    std::string errorMsg("Exception while calling openLazyAXGFile():\n");
+    int fileFormat = 0;
+    AXGLONG numberOfColumns = 0;
+    dataRefNum = openAXGFile(fName, errorMsg, fileFormat, numberOfColumns);
+    try {
+        scanAXGFile(dataRefNum, fileFormat, numberOfColumns, layout);
+        setupAXGRecording(layout, header);
     }
-    // Distribute Sections to Channels:
-    std::size_t sectionsPerChannel = (numberOfColumns-1) / numberOfChannels;
-    for (std::size_t n_c=0; (int)n_c < numberOfChannels; ++n_c) {
-        Channel TempChannel(sectionsPerChannel);
-        double factor = 1.0;
-        if (channel_units[n_c] == "V") {
-            channel_units[n_c] = "mV";
-            factor = 1.0e3;
-        }
-        if (channel_units[n_c] == "A") {
-            channel_units[n_c] = "pA";
-            factor = 1.0e12;
-        }
-        for (std::size_t n_s=n_c; (int)n_s < numberOfColumns-1; n_s += numberOfChannels) {
-            if (factor != 1.0) {
-                section_list[n_s].get_w() = stfio::vec_scal_mul(section_list[n_s].get(), factor);
-            }
-            try {
-                TempChannel.InsertSection( section_list[n_s], (n_s-n_c)/numberOfChannels );
-            }
-            catch (...) {
-                ReturnData.resize(0);
-                CloseFile( dataRefNum );
-                throw;
-            }
-        }
-        TempChannel.SetChannelName( channel_names[n_c] );
-        TempChannel.SetYUnits( channel_units[n_c] );
-        try {
-            if ((int)ReturnData.size()<numberOfChannels) {
-                ReturnData.resize(numberOfChannels);
-            }
-            ReturnData.InsertChannel(TempChannel,n_c);
-        }
-        catch (...) {
-            ReturnData.resize(0);
-            CloseFile( dataRefNum );
-            throw;
-        }
+    catch (const std::runtime_error& e) {
+        CloseFile( dataRefNum );
+        throw std::runtime_error(errorMsg + e.what());
     }
+    catch (...) {
+        CloseFile( dataRefNum );
+        throw;
+    }
+}
+
+AXGLazyFile::~AXGLazyFile() {
+    CloseFile( dataRefNum );
+}
 
-    ReturnData.SetXScale( xscale );
+void AXGLazyFile::ReadSection(std::size_t n_c, std::size_t n_s, Section& ReturnSection) {
+    CheckRange(n_c, n_s);
+    const AXGColumn& column = layout.columns[n_s*header.size()+n_c];
+    ReturnSection = header[n_c][n_s];
+    ReturnSection.resize(column.points);
+    try {
+        readAXGColumn(dataRefNum, column, layout.factors[n_c], buffer, &ReturnSection[0]);
+    }
+    catch (const std::runtime_error& e) {
+        throw std::runtime_error(std::string("Exception while calling AXGLazyFile::ReadSection():\n") + e.what());
+    }
+}
 
-    std::string comment = AG_ReadComment(dataRefNum);
-    std::string notes = AG_ReadNotes(dataRefNum);
-    std::string date = AG_ParseDate(notes);
-    std::string time = AG_ParseTime(notes);
+}
 
-    ReturnData.SetComment(comment);
-    ReturnData.SetFileDescription(notes);
-    ReturnData.SetTime(time);
-    ReturnData.SetDate(date);
-    
-    // Close the import file
-    CloseFile( dataRefNum );
+stfio::LazyFile* stfio::openLazyAXGFile(const std::string& fName) {
+    return new AXGLazyFile(fName);
 }
@@ -49,6 +49,13 @@ namespace stfio {
  */
     void importAXGFile(const std::string& fName, Recording& ReturnData, ProgressInfo& progDlg);
 
+//! Open an AXG file for on-demand reading of its sections.
+/*! Only the column headers are read when the file is opened.
+ *  \param fName The full path to the file to be opened.
+ *  \return A new LazyFile that has to be deleted by the caller.
+ */
+    LazyFile* openLazyAXGFile(const std::string& fName);
+
 }
 
 #endif
@@ -46,6 +46,23 @@ int SetFilePosition( filehandle dataRefNum, int posn )
 #endif
 }
 
+int GetFilePosition( filehandle dataRefNum, int *posn )
+{
+#if defined(_WINDOWS) && !defined(__MINGW32__)
+    DWORD dwPos = SetFilePointer(dataRefNum, 0, NULL, FILE_CURRENT);
+    if (dwPos == INVALID_SET_FILE_POINTER)
+        return 1;
+    *posn = (int)dwPos;
+    return 0;
+#else
+    long pos = ftell( dataRefNum );
+    if (pos < 0)
+        return 1;
+    *posn = (int)pos;
+    return 0;
+#endif
+}
+
 int ReadFromFile( filehandle dataRefNum, AXGLONG *count, void *dataToRead )
 {
 #if defined(_WINDOWS) && !defined(__MINGW32__)
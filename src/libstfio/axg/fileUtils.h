@@ -27,6 +27,7 @@ filehandle OpenFile( const char *fileName );
 void CloseFile( filehandle dataRefNum );
 
 int SetFilePosition( filehandle dataRefNum, int posn );
+int GetFilePosition( filehandle dataRefNum, int *posn );
 int ReadFromFile( filehandle dataRefNum, AXGLONG *count, void *dataToRead );
 
 #endif
@@ -14,6 +14,8 @@
 
 // Copyright 2012,2013,2017 Alois Schloegl, IST Austria
 
+#include <algorithm>
+#include <cstring>
 #include <sstream>
 
 #include "../stfio.h"
@@ -94,77 +96,75 @@ bool stfio::check_biosig_version(int a, int b, int c) {
 }
 #endif
 
-stfio::filetype stfio::importBiosigFile(const std::string &fName, Recording &ReturnData, ProgressInfo& progDlg) {
-
-    std::string errorMsg("Exception while calling std::importBSFile():\n");
-    std::string yunits;
-    stfio::filetype type;
-
-    // =====================================================================================================================
-    //
-    // importBiosig opens file with libbiosig
-    //	- performs an automated identification of the file format
-    //  - and decides whether the data is imported through importBiosig (currently CFS, HEKA, ABF1, GDF, and others)
-    //  - or handed back to other import*File functions (currently ABF2, AXG, HDF5)
-    //
-    // There are two implementations, level-1 and level-2 interface of libbiosig.
-    //   level 1 is used when -DWITH_BIOSIG, -lbiosig
-    //   level 2 is used when -DWITH_BIOSIG2, -lbiosig2
-    //
-    //   level 1 is better tested, but it does not provide ABI compatibility between MinGW and VisualStudio
-    //   level 2 interface has been developed to provide ABI compatibility, but it is less tested
-    //      and the API might still undergo major changes.
-    // =====================================================================================================================
-
-
 #ifdef __LIBBIOSIG2_H__
+namespace {
 
+// Opens fName with libbiosig; returns NULL and sets type if the file
+// should be handled by one of the native import filters instead.
+HDRTYPE* openBiosigHDR(const std::string& fName, stfio::filetype& type,
+                       const stfio::ImportFilter& filter = stfio::ImportFilter()) {
     HDRTYPE* hdr =  sopen( fName.c_str(), "r", NULL );
     if (hdr==NULL) {
-        ReturnData.resize(0);
-        return stfio::none;
+        type = stfio::none;
+        return NULL;
+    }
+
+    // HEKA groups and series have to be selected before the file tree is
+    // parsed, so that only the selected series are returned; sopen() still
+    // reads the complete file. HEKA bundles are normally read by the native
+    // reader. Other formats (e.g. CFS) use the segment selection for
+    // different purposes.
+    if ((filter.group >= 0 || filter.series >= 0) && biosig_get_filetype(hdr)==HEKA) {
+        destructHDR(hdr);
+        hdr = constructHDR(0,0);
+        if (filter.group >= 0)
+            biosig_set_segment_selection(hdr, 1, filter.group+1);
+        if (filter.series >= 0)
+            biosig_set_segment_selection(hdr, 2, filter.series+1);
+        hdr = sopen( fName.c_str(), "r", hdr );
+        if (hdr==NULL) {
+            type = stfio::none;
+            return NULL;
+        }
     }
 
     type = stfio_file_type(hdr);
     if (biosig_check_error(hdr)) {
-        ReturnData.resize(0);
         destructHDR(hdr);
-        return type;
+        return NULL;
     }
     enum FileFormat biosig_filetype=biosig_get_filetype(hdr);
     if (biosig_filetype==ATF || biosig_filetype==ABF2 || biosig_filetype==HDF ) {
         // ATF, ABF2 and HDF5 support should be handled by importATF, and importABF, and importHDF5 not importBiosig
-        ReturnData.resize(0);
         destructHDR(hdr);
-        return type;
+        return NULL;
     }
 
     // earlier versions of biosig support only the file type identification, but did not properly read the files
     if ( (BIOSIG_VERSION < 10603)
       && (biosig_filetype==AXG)
        ) {
-        ReturnData.resize(0);
         destructHDR(hdr);
-        return type;
+        return NULL;
     }
 
     // ensure the event table is in chronological order	
     sort_eventtable(hdr);
+    return hdr;
+}
 
+// Generates the list of indices indicating start and end of sweeps,
+// sets the section types and returns the annotation table.
+std::string readSegments(HDRTYPE* hdr, Recording& ReturnData, std::vector<size_t>& SegIndexList) {
     // allocate local memory for intermediate results;
     const int strSize=100;
     char str[strSize];
 
-    /*
-	count sections and generate list of indices indicating start and end of sweeps
-     */	
-
-    int numberOfChannels = biosig_get_number_of_channels(hdr);
     double fs = biosig_get_eventtable_samplerate(hdr);
     size_t numberOfEvents = biosig_get_number_of_events(hdr);
     size_t nsections = biosig_get_number_of_segments(hdr);
     ReturnData.InitSectionMarkerList(nsections);
-    std::vector<size_t> SegIndexList(nsections+1);
+    SegIndexList.resize(nsections+1);
     SegIndexList[0] = 0;
     SegIndexList[nsections] = biosig_get_number_of_samples(hdr);
     std::string annotationTableDesc = std::string();
@@ -196,10 +196,12 @@ stfio::filetype stfio::importBiosigFile(const std::string &fName, Recording &Ret
             // ReturnData.SetEventDescription( currentSectionNumber-1, desc);
         }
     }
+    return annotationTableDesc;
+}
 
-    /*************************************************************************
-        rescale data to mV and pA
-     *************************************************************************/
+// Rescales data to mV and pA
+void rescaleChannels(HDRTYPE* hdr) {
+    int numberOfChannels = biosig_get_number_of_channels(hdr);
     for (int ch=0; ch < numberOfChannels; ++ch) {
         CHANNEL_TYPE *hc = biosig_get_channel(hdr, ch);
         switch (biosig_channel_get_physdimcode(hc) & 0xffe0) {
@@ -213,64 +215,11 @@ stfio::filetype stfio::importBiosigFile(const std::string &fName, Recording &Ret
 		break;
 	    }
     }
+}
 
-    /*************************************************************************
-        read bulk data
-     *************************************************************************/
-    biosig_data_type *data = biosig_get_data(hdr, 0);
-    size_t SPR = biosig_get_number_of_samples(hdr);
-
-#ifdef _STFDEBUG
-    std::cout << "Number of events: " << numberOfEvents << std::endl;
-    /*int res = */ hdr2ascii(hdr, stdout, 4);
-#endif
-
-    for (int NS=0; NS < numberOfChannels; ) {
-        CHANNEL_TYPE *hc = biosig_get_channel(hdr, NS);
-        Channel TempChannel(nsections);
-        TempChannel.SetChannelName(biosig_channel_get_label(hc));
-        TempChannel.SetYUnits(biosig_channel_get_physdim(hc));
-
-        for (size_t ns=1; ns<=nsections; ns++) {
-            if (SegIndexList[ns]-SegIndexList[ns-1] < 0) {
-                ReturnData.resize(0);
-                destructHDR(hdr);
-                return type;
-            }
-            size_t SPS = SegIndexList[ns]-SegIndexList[ns-1];	// length of segment, samples per segment
-
-            int progbar = int(100.0 * (1.0 * ns / nsections + NS) / numberOfChannels);
-            std::ostringstream progStr;
-            progStr << "Reading channel #" << NS + 1 << " of " << numberOfChannels
-                << ", Section #" << ns << " of " << nsections;
-            progDlg.Update(progbar, progStr.str());
-
-            Section TempSection(SPS, "");
-
-            std::copy(&(data[NS*SPR + SegIndexList[ns-1]]),
-			    &(data[NS*SPR + SegIndexList[ns]]),
-			    TempSection.get_w().begin() );
-
-            try {
-                TempChannel.InsertSection(TempSection, ns-1);
-            }
-            catch (...) {
-                ReturnData.resize(0);
-                destructHDR(hdr);
-                return type;
-            }
-        }   // end for sections
-        try {
-            if ((int)ReturnData.size() < numberOfChannels)
-                ReturnData.resize(numberOfChannels);
-            ReturnData.InsertChannel(TempChannel, NS++);
-        }
-        catch (...) {
-            ReturnData.resize(0);
-            destructHDR(hdr);
-            return type;
-        }
-    }   // end for channels
+void setBiosigAttributes(HDRTYPE* hdr, Recording& ReturnData, const std::string& annotationTableDesc) {
+    const int strSize=100;
+    char str[strSize];
 
     ReturnData.SetComment ( biosig_get_recording_id(hdr) );
 
@@ -309,6 +258,335 @@ stfio::filetype stfio::importBiosigFile(const std::string &fName, Recording &Ret
     struct tm T;
     biosig_get_startdatetime(hdr, &T);
     ReturnData.SetDateTime(T);
+}
+
+// Decoded data records are read in blocks of about this size
+const size_t BIOSIG_BLOCK_BYTES = 1 << 23;
+
+// Data records decoded by sread(); channels are stored in columns
+struct RecordBlock {
+    RecordBlock() : hdr(NULL), data(), firstRecord(0), records(0), rows(0), error() {}
+
+    HDRTYPE* hdr;
+    std::vector<biosig_data_type> data;
+    size_t firstRecord, records, rows;
+    std::string error;
+};
+
+void readRecordBlock(void* arg) {
+    RecordBlock* block = static_cast<RecordBlock*>(arg);
+    block->rows = 0;
+    block->error.clear();
+    biosig_reset_flag(block->hdr, BIOSIG_FLAG_ROW_BASED_CHANNELS);
+    sread(&(block->data[0]), block->firstRecord, block->records, block->hdr);
+    if (biosig_check_error(block->hdr)) {
+        block->error = biosig_get_errormsg(block->hdr);
+        return;
+    }
+    biosig_data_type* unused = NULL;
+    size_t columns = 0;
+    biosig_get_datablock(block->hdr, &unused, &block->rows, &columns);
+}
+
+// Iterates over the data records of a file in blocks of bounded size that
+// are decoded into buffers owned by the reader, so that only one block
+// (two when prefetching) has to be held in memory in addition to the
+// sections. With prefetching, the next block is decoded in a background
+// thread while the current one is being copied. The reader has to be
+// destroyed before hdr.
+class RecordBlockReader {
+  public:
+    RecordBlockReader(HDRTYPE* hdr, size_t firstSample, size_t endSample, bool prefetch);
+
+    //! Makes the next block current; returns false after the last block.
+    /*! Throws std::runtime_error if the block can't be read. */
+    bool Next();
+
+    //! Index of the first sample of the current block.
+    size_t GetFirstSample() const { return m_current->firstRecord * m_SPR; }
+
+    //! Number of samples per channel in the current block.
+    size_t GetSamples() const { return m_current->rows; }
+
+    //! Samples of a channel in the current block.
+    /*! \param n_c Index of the channel among the channels that are switched on. */
+    const biosig_data_type* GetChannel(int n_c) const { return &(m_current->data[n_c * m_current->rows]); }
+
+  private:
+    void Read(RecordBlock* block);
+
+    size_t m_SPR, m_recordsPerBlock, m_nextRecord, m_endRecord;
+    bool m_prefetch;
+    RecordBlock m_blocks[2];
+    RecordBlock* m_current;
+    RecordBlock* m_pending;
+    stfio::Thread m_thread;
+};
+
+RecordBlockReader::RecordBlockReader(HDRTYPE* hdr, size_t firstSample, size_t endSample, bool prefetch)
+    : m_SPR(1), m_recordsPerBlock(1), m_nextRecord(0), m_endRecord(0), m_prefetch(prefetch),
+      m_current(&m_blocks[0]), m_pending(NULL), m_thread()
+{
+    size_t NRec = biosig_get_number_of_records(hdr);
+    if (NRec > 0 && biosig_get_number_of_samples(hdr) >= NRec) {
+        m_SPR = biosig_get_number_of_samples(hdr) / NRec;
+    }
+    size_t numberOfChannels = std::max<long>(1, biosig_get_number_of_channels(hdr));
+    size_t recordBytes = m_SPR * numberOfChannels * sizeof(biosig_data_type);
+    m_recordsPerBlock = std::max<size_t>(1, BIOSIG_BLOCK_BYTES / recordBytes);
+    m_nextRecord = std::min(NRec, firstSample / m_SPR);
+    m_endRecord = std::min(NRec, (endSample + m_SPR - 1) / m_SPR);
+
+    // AXG and SMR files are decoded completely by sopen(), and sread()
+    // always returns all of their records
+    enum FileFormat format = biosig_get_filetype(hdr);
+    if (format == AXG || format == SMR) {
+        m_nextRecord = 0;
+        m_endRecord = NRec;
+        m_recordsPerBlock = std::max<size_t>(1, NRec);
+        m_prefetch = false;
+    }
+
+    size_t blockRecords = std::max<size_t>(1, std::min(m_recordsPerBlock, m_endRecord - m_nextRecord));
+    for (int n = 0; n < (m_prefetch ? 2 : 1); ++n) {
+        m_blocks[n].hdr = hdr;
+        m_blocks[n].data.resize(blockRecords * m_SPR * numberOfChannels);
+    }
+    if (m_prefetch && m_nextRecord < m_endRecord) {
+        Read(&m_blocks[0]);
+    }
+}
+
+void RecordBlockReader::Read(RecordBlock* block) {
+    block->firstRecord = m_nextRecord;
+    block->records = std::min(m_recordsPerBlock, m_endRecord - m_nextRecord);
+    m_nextRecord += block->records;
+    if (!m_prefetch || !m_thread.Start(readRecordBlock, block)) {
+        readRecordBlock(block);
+    }
+    m_pending = block;
+}
+
+bool RecordBlockReader::Next() {
+    if (!m_prefetch && m_nextRecord < m_endRecord) {
+        Read(m_current);
+    }
+    if (m_pending == NULL) {
+        return false;
+    }
+    m_thread.Join();
+    m_current = m_pending;
+    m_pending = NULL;
+    if (!m_current->error.empty()) {
+        std::string errorMsg("Exception while reading biosig data records:\n");
+        throw std::runtime_error(errorMsg + m_current->error);
+    }
+    if (m_prefetch && m_nextRecord < m_endRecord) {
+        Read((m_current == &m_blocks[0]) ? &m_blocks[1] : &m_blocks[0]);
+    }
+    return true;
+}
+
+// Copies the samples of the selected channels and sweeps into the sections
+// of ReturnData, which have to be allocated already. Sweep n is read from
+// samples sweepStart[n] to sweepEnd[n] of the file; columns holds the
+// column of each selected channel in the decoded data records. Sweeps that
+// follow each other without a gap are read in one pass.
+void readBiosigBlocks(HDRTYPE* hdr, Recording& ReturnData, const std::vector<int>& columns,
+                      const std::vector<size_t>& sweepStart, const std::vector<size_t>& sweepEnd,
+                      stfio::ProgressInfo& progDlg)
+{
+    size_t nSweeps = sweepStart.size();
+    size_t totalSamples = 0;
+    for (size_t n = 0; n < nSweeps; ++n) {
+        totalSamples += sweepEnd[n] - sweepStart[n];
+    }
+    size_t samplesRead = 0;
+    size_t firstRun = 0;
+    while (firstRun < nSweeps) {
+        size_t endRun = firstRun + 1;
+        while (endRun < nSweeps && sweepStart[endRun] == sweepEnd[endRun-1]) {
+            ++endRun;
+        }
+        size_t firstSample = sweepStart[firstRun];
+        size_t endSample = sweepEnd[endRun-1];
+        if (endSample <= firstSample) {
+            firstRun = endRun;
+            continue;
+        }
+        RecordBlockReader reader(hdr, firstSample, endSample, true);
+        size_t ns = firstRun;
+        while (reader.Next()) {
+            size_t blockStart = reader.GetFirstSample();
+            size_t blockEnd = blockStart + reader.GetSamples();
+
+            int progbar = int(100.0 * (samplesRead + std::min(blockEnd, endSample) - firstSample)
+                              / std::max<size_t>(1, totalSamples));
+            std::ostringstream progStr;
+            progStr << "Reading samples " << blockStart << " to " << blockEnd << " of " << endSample;
+            progDlg.Update(progbar, progStr.str());
+
+            // sweeps that end before this block have been copied completely
+            while (ns < endRun && sweepEnd[ns] <= blockStart) {
+                ++ns;
+            }
+            for (size_t n = ns; n < endRun && sweepStart[n] < blockEnd; ++n) {
+                size_t start = std::max(sweepStart[n], blockStart);
+                size_t end = std::min(sweepEnd[n], blockEnd);
+                if (end <= start) {
+                    continue;
+                }
+                for (std::size_t nSelected=0; nSelected < columns.size(); ++nSelected) {
+                    const biosig_data_type* data = reader.GetChannel(columns[nSelected]);
+                    std::copy(&(data[start - blockStart]), &(data[end - blockStart]),
+                              &(ReturnData[nSelected][n][start - sweepStart[n]]));
+                }
+            }
+        }
+        samplesRead += endSample - firstSample;
+        firstRun = endRun;
+    }
+}
+
+}
+#endif
+
+stfio::filetype stfio::importBiosigFile(const std::string &fName, Recording &ReturnData, ProgressInfo& progDlg,
+                                        const stfio::ImportFilter& filter) {
+
+    std::string errorMsg("Exception while calling std::importBSFile():\n");
+    std::string yunits;
+    stfio::filetype type;
+
+    // =====================================================================================================================
+    //
+    // importBiosig opens file with libbiosig
+    //	- performs an automated identification of the file format
+    //  - and decides whether the data is imported through importBiosig (currently CFS, HEKA, ABF1, GDF, and others)
+    //  - or handed back to other import*File functions (currently ABF2, AXG, HDF5)
+    //
+    // There are two implementations, level-1 and level-2 interface of libbiosig.
+    //   level 1 is used when -DWITH_BIOSIG, -lbiosig
+    //   level 2 is used when -DWITH_BIOSIG2, -lbiosig2
+    //
+    //   level 1 is better tested, but it does not provide ABI compatibility between MinGW and VisualStudio
+    //   level 2 interface has been developed to provide ABI compatibility, but it is less tested
+    //      and the API might still undergo major changes.
+    // =====================================================================================================================
+
+
+#ifdef __LIBBIOSIG2_H__
+
+    HDRTYPE* hdr = openBiosigHDR(fName, type, filter);
+    if (hdr==NULL) {
+        ReturnData.resize(0);
+        return type;
+    }
+
+    /*
+	count sections and generate list of indices indicating start and end of sweeps
+     */	
+
+    int numberOfChannels = biosig_get_number_of_channels(hdr);
+    std::vector<size_t> SegIndexList;
+    std::string annotationTableDesc = readSegments(hdr, ReturnData, SegIndexList);
+    size_t nsections = SegIndexList.size()-1;
+
+    std::vector<int> channels;
+    try {
+        channels = filter.SelectChannels(numberOfChannels);
+    }
+    catch (...) {
+        ReturnData.resize(0);
+        destructHDR(hdr);
+        throw;
+    }
+    int numberSelected = (int)channels.size();
+    int firstSweep = 0, endSweep = 0;
+    filter.SelectSweeps((int)nsections, firstSweep, endSweep);
+
+    /*************************************************************************
+        rescale data to mV and pA
+     *************************************************************************/
+    rescaleChannels(hdr);
+
+#ifdef _STFDEBUG
+    std::cout << "Number of events: " << biosig_get_number_of_events(hdr) << std::endl;
+    /*int res = */ hdr2ascii(hdr, stdout, 4);
+#endif
+
+    /*************************************************************************
+        allocate sections, then read data records block by block
+     *************************************************************************/
+    for (int ns=firstSweep+1; ns<=endSweep; ns++) {
+        if (SegIndexList[ns] < SegIndexList[ns-1]) {
+            ReturnData.resize(0);
+            destructHDR(hdr);
+            return type;
+        }
+    }
+    // samples of each sweep within the selected time window
+    double dt = 1000.0/biosig_get_samplerate(hdr);
+    std::vector<size_t> sweepStart(endSweep-firstSweep), sweepEnd(endSweep-firstSweep);
+    for (int ns=firstSweep; ns < endSweep; ++ns) {
+        size_t first = 0, end = 0;
+        filter.SelectSamples(SegIndexList[ns+1]-SegIndexList[ns], dt, first, end);
+        sweepStart[ns-firstSweep] = SegIndexList[ns] + first;
+        sweepEnd[ns-firstSweep] = SegIndexList[ns] + end;
+    }
+    try {
+        ReturnData.resize(numberSelected);
+        for (int nSelected=0; nSelected < numberSelected; ++nSelected) {
+            CHANNEL_TYPE *hc = biosig_get_channel(hdr, channels[nSelected]);
+            Channel TempChannel(endSweep-firstSweep);
+            TempChannel.SetChannelName(biosig_channel_get_label(hc));
+            TempChannel.SetYUnits(biosig_channel_get_physdim(hc));
+            for (int ns=firstSweep; ns < endSweep; ++ns) {
+                TempChannel[ns-firstSweep].resize(sweepEnd[ns-firstSweep]-sweepStart[ns-firstSweep]);
+            }
+            ReturnData.InsertChannel(TempChannel, nSelected);
+        }
+
+        // switch off the channels that aren't selected, so that sread()
+        // doesn't decode them; the decoded records contain the remaining
+        // channels in the order of the file
+        std::vector<CHANNEL_TYPE*> allChannels(numberOfChannels);
+        std::vector<bool> selected(numberOfChannels, false);
+        for (int nc=0; nc < numberOfChannels; ++nc) {
+            allChannels[nc] = biosig_get_channel(hdr, nc);
+        }
+        for (int nSelected=0; nSelected < numberSelected; ++nSelected) {
+            selected[channels[nSelected]] = true;
+        }
+        for (int nc=0; nc < numberOfChannels; ++nc) {
+            if (!selected[nc]) {
+                allChannels[nc]->OnOff = 0;
+            }
+        }
+        std::vector<int> columns(numberSelected);
+        for (int nSelected=0; nSelected < numberSelected; ++nSelected) {
+            columns[nSelected] = (int)std::count(selected.begin(), selected.begin() + channels[nSelected], true);
+        }
+        readBiosigBlocks(hdr, ReturnData, columns, sweepStart, sweepEnd, progDlg);
+    }
+    catch (...) {
+        // the file has been identified, but its data can't be read
+        ReturnData.resize(0);
+        destructHDR(hdr);
+        throw;
+    }
+
+    // renumber the section types of the selected sweeps
+    if (endSweep-firstSweep < (int)nsections) {
+        std::vector<int> sectionTypes;
+        for (int ns=firstSweep; ns < endSweep; ++ns)
+            sectionTypes.push_back(ReturnData.GetSectionType(ns));
+        ReturnData.InitSectionMarkerList(sectionTypes.size());
+        for (size_t ns=0; ns < sectionTypes.size(); ++ns)
+            ReturnData.SetSectionType(ns, sectionTypes[ns]);
+    }
+
+    setBiosigAttributes(hdr, ReturnData, annotationTableDesc);
 
     destructHDR(hdr);
 
@@ -573,6 +851,203 @@ stfio::filetype stfio::importBiosigFile(const std::string &fName, Recording &Ret
 }
 
 
+#ifdef __LIBBIOSIG2_H__
+namespace {
+
+// Keeps a file open with libbiosig and reads the records spanned by a
+// segment when the segment is requested.
+class BiosigLazyFile : public stfio::LazyFile {
+  public:
+    BiosigLazyFile(HDRTYPE* hdr);
+    ~BiosigLazyFile();
+
+    void ReadSection(std::size_t n_c, std::size_t n_s, Section& ReturnSection);
+
+  private:
+    HDRTYPE* hdr;
+    std::vector<size_t> SegIndexList;
+};
+
+BiosigLazyFile::BiosigLazyFile(HDRTYPE* hdr_)
+    : hdr(hdr_)
+{
+    int numberOfChannels = biosig_get_number_of_channels(hdr);
+    std::string annotationTableDesc = readSegments(hdr, header, SegIndexList);
+    size_t nsections = SegIndexList.size()-1;
+    rescaleChannels(hdr);
+
+    header.resize(numberOfChannels);
+    for (int NS=0; NS < numberOfChannels; ++NS) {
+        CHANNEL_TYPE *hc = biosig_get_channel(hdr, NS);
+        Channel TempChannel(nsections);
+        TempChannel.SetChannelName(biosig_channel_get_label(hc));
+        TempChannel.SetYUnits(biosig_channel_get_physdim(hc));
+        header.InsertChannel(TempChannel, NS);
+    }
+    setBiosigAttributes(hdr, header, annotationTableDesc);
+}
+
+BiosigLazyFile::~BiosigLazyFile() {
+    destructHDR(hdr);
+}
+
+void BiosigLazyFile::ReadSection(std::size_t n_c, std::size_t n_s, Section& ReturnSection) {
+    CheckRange(n_c, n_s);
+    size_t start = SegIndexList[n_s];
+    size_t end = SegIndexList[n_s+1];
+    if (end < start) {
+        throw std::runtime_error("Exception while calling BiosigLazyFile::ReadSection():\n"
+                                 "Invalid segment boundaries");
+    }
+    ReturnSection = header[n_c][n_s];
+    if (end == start) {
+        return;
+    }
+
+    // read all records that overlap with the segment
+    size_t SPR = biosig_get_number_of_samples(hdr) / biosig_get_number_of_records(hdr);
+    size_t firstRecord = start / SPR;
+    size_t lastRecord = (end + SPR - 1) / SPR;
+    biosig_reset_flag(hdr, BIOSIG_FLAG_ROW_BASED_CHANNELS);
+    sread(NULL, firstRecord, lastRecord - firstRecord, hdr);
+    if (biosig_check_error(hdr)) {
+        std::string errorMsg("Exception while calling BiosigLazyFile::ReadSection():\n");
+        errorMsg += biosig_get_errormsg(hdr);
+        throw std::runtime_error(errorMsg);
+    }
+
+    biosig_data_type *data = NULL;
+    size_t rows = 0, columns = 0;
+    biosig_get_datablock(hdr, &data, &rows, &columns);
+    size_t offset = start - firstRecord * SPR;
+    if (data == NULL || offset + (end - start) > rows || n_c >= columns) {
+        throw std::runtime_error("Exception while calling BiosigLazyFile::ReadSection():\n"
+                                 "Couldn't read data block");
+    }
+    // channels are stored in columns
+    ReturnSection.get_w().assign(&(data[n_c*rows + offset]),
+                                 &(data[n_c*rows + offset + (end - start)]));
+}
+
+}
+#endif
+
+stfio::LazyFile* stfio::openLazyBiosigFile(const std::string& fName, stfio::filetype& type) {
+#ifdef __LIBBIOSIG2_H__
+    HDRTYPE* hdr = openBiosigHDR(fName, type);
+    if (hdr==NULL) {
+        return NULL;
+    }
+    try {
+        return new BiosigLazyFile(hdr);
+    }
+    catch (...) {
+        destructHDR(hdr);
+        throw;
+    }
+#else
+    type = stfio::none;
+    return NULL;
+#endif
+}
+
+namespace {
+
+// GDF data records are written in blocks of about this size
+const size_t GDF_BLOCK_BYTES = 1 << 20;
+
+// Reads the size of every section. A LazyFile has to be read completely
+// for this, but only a single section is held in memory at a time.
+void readSectionSizes(stfio::SectionReader& source, std::vector< std::vector<size_t> >& points,
+                      stfio::ProgressInfo& progDlg)
+{
+    const Recording& Data = source.GetHeader();
+    points.resize(Data.size());
+    for (size_t k=0; k < Data.size(); ++k) {
+        points[k].resize(Data[k].size());
+        for (size_t m=0; m < Data[k].size(); ++m) {
+            std::ostringstream progStr;
+            progStr << "Reading channel #" << k+1 << " of " << Data.size()
+                    << ", Section #" << m+1 << " of " << Data[k].size();
+            progDlg.Update((int)(50.0*(k + (double)m/Data[k].size())/Data.size()), progStr.str());
+            points[k][m] = source.Read(k, m).size();
+        }
+    }
+}
+
+// Writes the data records of an open GDF file. The sections are read
+// sweep by sweep, so that only the records of a single sweep are held
+// in memory. bi[k] is the byte offset of channel k within a record; the
+// sizes of all sweeps have been checked by the caller.
+void writeGDFRecords(HDRTYPE* hdr, stfio::SectionReader& source, size_t NRec, size_t SPR,
+                     size_t bpb, const std::vector<size_t>& bi, stfio::ProgressInfo& progDlg)
+{
+    const Recording& Data = source.GetHeader();
+    std::vector<uint8_t> block;   // records base ... base+block.size()/bpb-1
+    size_t base = 0, len = 0;
+    size_t nSweeps = Data.size() > 0 ? Data[0].size() : 0;
+    for (size_t m=0; m < nSweeps; ++m) {
+        std::ostringstream progStr;
+        progStr << "Writing section #" << m+1 << " of " << nSweeps;
+        progDlg.Update((int)(50.0 + 50.0*m/nSweeps), progStr.str());
+
+        // Records before the first record of this sweep are complete. The
+        // first record may be shared with the previous sweep.
+        size_t first = len / SPR;
+        size_t nDone = std::min(first-base, block.size()/bpb);
+        if (nDone > 0) {
+            ifwrite(&block[0], bpb, nDone, hdr);
+            block.erase(block.begin(), block.begin()+nDone*bpb);
+            base += nDone;
+        }
+
+        size_t sweepLen = 0;
+        for (size_t k=0; k < Data.size(); ++k) {
+            const Section& sec = source.Read(k, m);
+            size_t div = lround(Data[k][m].GetXScale()/Data.GetXScale());
+            size_t div2 = SPR/div;
+            if (k == 0) {
+                sweepLen = div*sec.size();
+                if (sweepLen == 0) {
+                    break;
+                }
+                size_t last = (len + sweepLen - 1) / SPR;
+                block.resize((last+1-base)*bpb, 0);
+            }
+
+            for (size_t n=0; n < sec.size(); ++n) {
+                uint64_t val;
+                double d = sec[n];
+                std::memcpy(&val, &d, sizeof(val));
+#if !defined(__MINGW32__) && !defined(_MSC_VER) && !defined(__APPLE__)
+                val = htole64(val);
+#endif
+                size_t p, spr = (len + n*div) / SPR - base;
+                for (p=0; p < div2; p++)
+                    std::memcpy(&block[bi[k] + bpb*spr + p*8], &val, sizeof(val));
+            }
+        }
+        len += sweepLen;
+    }
+
+    // flush the remaining records; records without any data are written as zeros
+    if (!block.empty()) {
+        ifwrite(&block[0], bpb, block.size()/bpb, hdr);
+        base += block.size()/bpb;
+    }
+    if (base < NRec && bpb > 0) {
+        size_t nBlock = std::max((size_t)1, GDF_BLOCK_BYTES/bpb);
+        block.assign(nBlock*bpb, 0);
+        while (base < NRec) {
+            size_t n = std::min(nBlock, NRec-base);
+            ifwrite(&block[0], bpb, n, hdr);
+            base += n;
+        }
+    }
+}
+
+}
+
     // =====================================================================================================================
     //
     // Save file with libbiosig into GDF format
@@ -583,14 +1058,24 @@ stfio::filetype stfio::importBiosigFile(const std::string &fName, Recording &Ret
     // =====================================================================================================================
 
 bool stfio::exportBiosigFile(const std::string& fName, const Recording& Data, stfio::ProgressInfo& progDlg) {
+    SectionReader source(Data);
+    return exportBiosigFile(fName, source, progDlg);
+}
+
+bool stfio::exportBiosigFile(const std::string& fName, SectionReader& source, stfio::ProgressInfo& progDlg) {
 /*
     converts the internal data structure to libbiosig's internal structure
     and saves the file as gdf file.
 
     The data in converted into the raw data format, and not into the common
-    data matrix.
+    data matrix. Sections are read twice: once for the header, which needs
+    the sizes of all sections, and once while the data records are written.
 */
 
+    const Recording& Data = source.GetHeader();
+    std::vector< std::vector<size_t> > points;
+    readSectionSizes(source, points, progDlg);
+
 #ifdef __LIBBIOSIG2_H__
 
     size_t numberOfChannels = Data.size();
@@ -648,7 +1133,7 @@ bool stfio::exportBiosigFile(const std::string& fName, const Recording& Data, st
         for (len=0, m = 0; m < Data[k].size(); ++m) {
             unsigned div = lround(Data[k][m].GetXScale()/Data.GetXScale());
             chSPR = lcm(chSPR,div);  // sampling interval of m-th segment in k-th channel
-            len += div*Data[k][m].size();
+            len += div*points[k][m];
         }
         SPR = lcm(SPR, chSPR);
 
@@ -676,6 +1161,7 @@ bool stfio::exportBiosigFile(const std::string& fName, const Recording& Data, st
 
     biosig_set_number_of_samples(hdr, NRec, SPR);
     size_t bpb = 0;
+    std::vector<size_t> bi(numberOfChannels);
     for (k = 0; k < numberOfChannels; ++k) {
         CHANNEL_TYPE *hc = biosig_get_channel(hdr, k);
         // the 'abuse' of hc->SPR described above is corrected
@@ -687,6 +1173,7 @@ bool stfio::exportBiosigFile(const std::string& fName, const Recording& Data, st
         size_t spr = SPR/chanSPR[k];
         chanSPR[k] = spr;
 #endif
+        bi[k] = bpb;
         bpb += spr * 8; /* its always double */
     }
 
@@ -711,7 +1198,7 @@ bool stfio::exportBiosigFile(const std::string& fName, const Recording& Data, st
         }
         for (m=0; flag && (m < Data[(size_t)0].size()); ++m) {
             for (k=0; k < biosig_get_number_of_channels(hdr); ++k) {
-                pos = Data[k][m].size() * lround(Data[k][m].GetXScale()/Data.GetXScale());
+                pos = points[k][m] * lround(Data[k][m].GetXScale()/Data.GetXScale());
                 if (k==0)
                     POS = pos;
                 else
@@ -746,49 +1233,13 @@ bool stfio::exportBiosigFile(const std::string& fName, const Recording& Data, st
                     biosig_set_nth_event(hdr, N++, NULL, &pos32, &chn, &dur, NULL, Desc);   // TODO
                 */
             }
-            pos += Data[k][m].size() * lround(Data[k][m].GetXScale()/Data.GetXScale());
+            pos += points[k][m] * lround(Data[k][m].GetXScale()/Data.GetXScale());
         }
 
         biosig_set_number_of_events(hdr, N);
         biosig_set_eventtable_samplerate(hdr, fs);
         sort_eventtable(hdr);
 
-        /* convert data into GDF rawdata from  */
-        uint8_t *rawdata = (uint8_t*)malloc(bpb * NRec);
-
-        size_t bi=0;
-	for (k=0; k < numberOfChannels; ++k) {
-        CHANNEL_TYPE *hc = biosig_get_channel(hdr, k);
-#ifdef DONOTUSE_DYNAMIC_ALLOCATION_FOR_CHANSPR
-        size_t chSPR = biosig_channel_get_samples_per_record(hc);
-#else
-        size_t chSPR = chanSPR[k];
-#endif
-        size_t m,n,len=0;
-        for (m=0; m < Data[k].size(); ++m) {
-
-            size_t div = lround(Data[k][m].GetXScale()/Data.GetXScale());
-            size_t div2 = SPR/div;		  // TODO: avoid using hdr->SPR
-
-            // fprintf(stdout,"k,m,div,div2: %i,%i,%i,%i\n",(int)k,(int)m,(int)div,(int)div2);  //
-            for (n=0; n < Data[k][m].size(); ++n) {
-                uint64_t val;
-                double d = Data[k][m][n];
-#if !defined(__MINGW32__) && !defined(_MSC_VER) && !defined(__APPLE__)
-                val = htole64(*(uint64_t*)&d);
-#else
-                val = *(uint64_t*)&d;
-#endif
-                size_t p, spr = (len + n*div) / SPR;
-
-                for (p=0; p < div2; p++)
-                   *(uint64_t*)(rawdata + bi + bpb * spr + p*8) = val;
-            }
-            len += div*Data[k][m].size();
-        }
-		bi += chSPR*8;
-    }
-
 #ifndef DONOTUSE_DYNAMIC_ALLOCATION_FOR_CHANSPR
 	if (chanSPR) free(chanSPR);
 #endif
@@ -806,11 +1257,17 @@ bool stfio::exportBiosigFile(const std::string& fName, const Recording& Data, st
         return false;
     }
 
-    ifwrite(rawdata, bpb, NRec, hdr);
+    try {
+        writeGDFRecords(hdr, source, NRec, SPR, bpb, bi, progDlg);
+    }
+    catch (...) {
+        sclose(hdr);
+        destructHDR(hdr);
+        throw;
+    }
 
     sclose(hdr);
     destructHDR(hdr);
-    free(rawdata);
 
 
 #else   // #ifndef __LIBBIOSIG2_H__
@@ -890,7 +1347,7 @@ bool stfio::exportBiosigFile(const std::string& fName, const Recording& Data, st
         for (len=0, m = 0; m < Data[k].size(); ++m) {
             unsigned div = lround(Data[k][m].GetXScale()/Data.GetXScale());
             hc->SPR = lcm(hc->SPR,div);  // sampling interval of m-th segment in k-th channel
-            len += div*Data[k][m].size();
+            len += div*points[k][m];
         }
         hdr->SPR = lcm(hdr->SPR, hc->SPR);
 
@@ -939,7 +1396,7 @@ bool stfio::exportBiosigFile(const std::string& fName, const Recording& Data, st
         }
         for (m=0; flag && (m < Data[(size_t)0].size()); ++m) {
             for (k=0; k < hdr->NS; ++k) {
-                pos = Data[k][m].size() * lround(Data[k][m].GetXScale()/Data.GetXScale());
+                pos = points[k][m] * lround(Data[k][m].GetXScale()/Data.GetXScale());
                 if (k==0)
                     POS = pos;
                 else
@@ -977,7 +1434,7 @@ bool stfio::exportBiosigFile(const std::string& fName, const Recording& Data, st
             hdr->EVENT.DUR[N] = 0;
             N++;
 #endif
-            pos += Data[k][m].size() * lround(Data[k][m].GetXScale()/Data.GetXScale());
+            pos += points[k][m] * lround(Data[k][m].GetXScale()/Data.GetXScale());
         }
 
         hdr->EVENT.N = N;
@@ -985,32 +1442,11 @@ bool stfio::exportBiosigFile(const std::string& fName, const Recording& Data, st
 
         sort_eventtable(hdr);
 
-	/* convert data into GDF rawdata from  */
-	hdr->AS.rawdata = (uint8_t*)realloc(hdr->AS.rawdata, hdr->AS.bpb*hdr->NRec);
-	for (k=0; k < hdr->NS; ++k) {
-        CHANNEL_TYPE *hc = hdr->CHANNEL+k;
-
-        size_t m,n,len=0;
-        for (m=0; m < Data[k].size(); ++m) {
-            size_t div = lround(Data[k][m].GetXScale()/Data.GetXScale());
-            size_t div2 = hdr->SPR/div;
-
-            // fprintf(stdout,"k,m,div,div2: %i,%i,%i,%i\n",(int)k,(int)m,(int)div,(int)div2);  //
-            for (n=0; n < Data[k][m].size(); ++n) {
-                uint64_t val;
-                double d = Data[k][m][n];
-#if !defined(__MINGW32__) && !defined(_MSC_VER) && !defined(__APPLE__)
-                val = htole64(*(uint64_t*)&d);
-#else
-                val = *(uint64_t*)&d;
-#endif
-                size_t p, spr = (len + n*div) / hdr->SPR;
-                for (p=0; p < div2; p++)
-                   *(uint64_t*)(hdr->AS.rawdata + hc->bi + hdr->AS.bpb * spr + p*8) = val;
-            }
-            len += div*Data[k][m].size();
-        }
+    std::vector<size_t> bi(hdr->NS);
+    for (k=0; k < hdr->NS; ++k) {
+        bi[k] = hdr->CHANNEL[k].bi;
     }
+    size_t NRec = hdr->NRec, SPR = hdr->SPR, bpb = hdr->AS.bpb;
 
     /******************************
         write to file
@@ -1030,7 +1466,14 @@ bool stfio::exportBiosigFile(const std::string& fName, const Recording& Data, st
         return false;
     }
 
-    ifwrite(hdr->AS.rawdata, hdr->AS.bpb, hdr->NRec, hdr);
+    try {
+        writeGDFRecords(hdr, source, NRec, SPR, bpb, bi, progDlg);
+    }
+    catch (...) {
+        sclose(hdr);
+        destructHDR(hdr);
+        throw;
+    }
 
     sclose(hdr);
     destructHDR(hdr);
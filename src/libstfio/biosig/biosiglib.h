@@ -49,12 +49,30 @@ StfioDll bool check_biosig_version(int a, int b, int c);
  *  \param ReturnData On entry, an empty Recording object. On exit,
  *         the data stored in \e fName.
  *  \param progress True if the progress dialog should be updated.
+ *  \param filter The channels, sweeps and time window to be read. HEKA groups
+ *         and series are passed to libbiosig's segment selection, but sopen()
+ *         still reads the complete HEKA file; unselected channels and data
+ *         records outside of the time window are never decoded for formats
+ *         that libbiosig reads record by record. Throws std::out_of_range if
+ *         a selected channel doesn't exist.
  *
  *  Return value: in case of success stfio::biosig is returned,
  *    if the file format is recognized, the corresponding filetype is returned,
  *    if the filetype is not recognized or not supported. stfio::none is returned.
+ *    Throws std::runtime_error if libbiosig reads the file but fails to
+ *    read its data records.
  */
-stfio::filetype importBiosigFile(const std::string& fName, Recording& ReturnData, ProgressInfo& progDlg);
+stfio::filetype importBiosigFile(const std::string& fName, Recording& ReturnData, ProgressInfo& progDlg,
+                                 const ImportFilter& filter = ImportFilter());
+
+//! Open a file with biosig for on-demand reading of its sections.
+/*! \param fName The full path to the file to be opened.
+ *  \param type On exit, the file type as detected by biosig.
+ *  \return A new LazyFile that has to be deleted by the caller, or NULL
+ *          if the file should be read by one of the native import filters
+ *          (see importBiosigFile()).
+ */
+LazyFile* openLazyBiosigFile(const std::string& fName, stfio::filetype& type);
 
 //! Export a Recording to a GDF file using biosig.
 /*! \param fName Full path to the file to be written.
@@ -62,6 +80,14 @@ stfio::filetype importBiosigFile(const std::string& fName, Recording& ReturnData
  */
 StfioDll bool exportBiosigFile(const std::string& fName, const Recording& WData, ProgressInfo& progDlg);
 
+//! Export sections to a GDF file using biosig, one section at a time.
+/*! The sections are read twice, because the file header needs the sizes
+ *  of all sections before the data records can be written.
+ *  \param fName Full path to the file to be written.
+ *  \param source The sections to be exported.
+ */
+StfioDll bool exportBiosigFile(const std::string& fName, SectionReader& source, ProgressInfo& progDlg);
+
 
 }
 
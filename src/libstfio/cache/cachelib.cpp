@@ -0,0 +1,379 @@
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+#include <cstdio>
+#include <cstring>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+#include <iomanip>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <io.h>
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+#if __cplusplus > 199711L
+#include <cstdint>
+#else
+#include <boost/cstdint.hpp>
+#endif
+
+#include "./cachelib.h"
+#include "../recording.h"
+
+namespace {
+
+const char CACHE_MAGIC[4] = { 'S', 'T', 'F', 'C' };
+const uint32_t CACHE_VERSION = 2;
+
+// Identifies the state of a source file.
+struct SourceKey {
+    std::string path;
+    int64_t size;
+    int64_t mtime;
+};
+
+bool getSourceKey(const std::string& fName, SourceKey& key) {
+    struct stat st;
+    if (stat(fName.c_str(), &st) != 0) {
+        return false;
+    }
+    key.path = fName;
+    key.size = (int64_t)st.st_size;
+    key.mtime = (int64_t)st.st_mtime;
+    return true;
+}
+
+// 64-bit FNV-1a hash
+uint64_t hashKey(const SourceKey& key) {
+    std::ostringstream keyStr;
+    keyStr << key.path << '\0' << key.size << '\0' << key.mtime;
+    const std::string& str = keyStr.str();
+    uint64_t hash = 14695981039346656037ULL;
+    for (std::string::const_iterator it = str.begin(); it != str.end(); ++it) {
+        hash ^= (unsigned char)(*it);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Closes the file when going out of scope.
+class CacheFile {
+  public:
+    CacheFile(const std::string& fName, const char* mode) : fp(fopen(fName.c_str(), mode)) {}
+    explicit CacheFile(FILE* fp_) : fp(fp_) {}
+    ~CacheFile() { if (fp != NULL) fclose(fp); }
+    FILE* fp;
+  private:
+    CacheFile(const CacheFile&);
+    CacheFile& operator=(const CacheFile&);
+};
+
+template <typename T>
+bool writeValue(FILE* fp, T value) {
+    return fwrite(&value, sizeof(T), 1, fp) == 1;
+}
+
+template <typename T>
+bool readValue(FILE* fp, T& value) {
+    return fread(&value, sizeof(T), 1, fp) == 1;
+}
+
+bool writeString(FILE* fp, const std::string& str) {
+    if (!writeValue<uint64_t>(fp, str.size())) {
+        return false;
+    }
+    return str.empty() || fwrite(str.data(), 1, str.size(), fp) == str.size();
+}
+
+bool readString(FILE* fp, std::string& str) {
+    uint64_t size = 0;
+    if (!readValue(fp, size)) {
+        return false;
+    }
+    str.resize(size);
+    return size == 0 || fread(&str[0], 1, size, fp) == size;
+}
+
+bool writeHeader(FILE* fp, const SourceKey& key, const Recording& Data) {
+    const struct tm dt = Data.GetDateTime();
+    return fwrite(CACHE_MAGIC, 1, 4, fp) == 4 &&
+        writeValue(fp, CACHE_VERSION) &&
+        writeString(fp, key.path) &&
+        writeValue(fp, key.size) &&
+        writeValue(fp, key.mtime) &&
+        writeString(fp, Data.GetFileDescription()) &&
+        writeString(fp, Data.GetGlobalSectionDescription()) &&
+        writeString(fp, Data.GetScaling()) &&
+        writeString(fp, Data.GetComment()) &&
+        writeString(fp, Data.GetXUnits()) &&
+        writeValue(fp, Data.GetXScale()) &&
+        writeValue<int32_t>(fp, dt.tm_year) &&
+        writeValue<int32_t>(fp, dt.tm_mon) &&
+        writeValue<int32_t>(fp, dt.tm_mday) &&
+        writeValue<int32_t>(fp, dt.tm_hour) &&
+        writeValue<int32_t>(fp, dt.tm_min) &&
+        writeValue<int32_t>(fp, dt.tm_sec) &&
+        writeValue<uint64_t>(fp, Data.size());
+}
+
+// Section types and event descriptions, as set by importBiosigFile()
+bool writeMarkers(FILE* fp, const Recording& Data) {
+    bool success = writeValue<uint64_t>(fp, Data.GetSectionMarkerCount());
+    for (std::size_t n_s=0; success && n_s < Data.GetSectionMarkerCount(); ++n_s) {
+        success = writeValue<int32_t>(fp, Data.GetSectionType(n_s));
+    }
+    uint32_t ndescriptions = 0;
+    for (int type=0; type < 256; ++type) {
+        if (!Data.GetEventDescription(type).empty()) {
+            ++ndescriptions;
+        }
+    }
+    success = success && writeValue(fp, ndescriptions);
+    for (int type=0; success && type < 256; ++type) {
+        const std::string description = Data.GetEventDescription(type);
+        if (!description.empty()) {
+            success = writeValue<int32_t>(fp, type) && writeString(fp, description);
+        }
+    }
+    return success;
+}
+
+bool readMarkers(FILE* fp, Recording& ReturnData) {
+    uint64_t nmarkers = 0;
+    if (!readValue(fp, nmarkers)) {
+        return false;
+    }
+    ReturnData.InitSectionMarkerList(nmarkers);
+    for (std::size_t n_s=0; n_s < nmarkers; ++n_s) {
+        int32_t type = 0;
+        if (!readValue(fp, type)) {
+            return false;
+        }
+        ReturnData.SetSectionType(n_s, type);
+    }
+    uint32_t ndescriptions = 0;
+    if (!readValue(fp, ndescriptions) || ndescriptions > 256) {
+        return false;
+    }
+    for (uint32_t n_d=0; n_d < ndescriptions; ++n_d) {
+        int32_t type = 0;
+        std::string description;
+        if (!readValue(fp, type) || type < 0 || type >= 256 || !readString(fp, description)) {
+            return false;
+        }
+        ReturnData.SetEventDescription(type, description.c_str());
+    }
+    return true;
+}
+
+// Creates a new temporary file next to cacheName. The name is unique, so
+// that processes caching the same source file don't write to the same file.
+FILE* createTempFile(const std::string& cacheName, std::string& tmpName) {
+#ifdef _WIN32
+    for (int n=0; n < 1000; ++n) {
+        std::ostringstream name;
+        name << cacheName << '.' << _getpid() << '.' << n << ".tmp";
+        int fd = _open(name.str().c_str(), _O_CREAT | _O_EXCL | _O_WRONLY | _O_BINARY,
+                       _S_IREAD | _S_IWRITE);
+        if (fd != -1) {
+            tmpName = name.str();
+            return _fdopen(fd, "wb");
+        }
+    }
+    return NULL;
+#else
+    std::string pattern = cacheName + ".XXXXXX";
+    std::vector<char> name(pattern.begin(), pattern.end());
+    name.push_back('\0');
+    int fd = mkstemp(&name[0]);
+    if (fd == -1) {
+        return NULL;
+    }
+    tmpName = &name[0];
+    FILE* fp = fdopen(fd, "wb");
+    if (fp == NULL) {
+        close(fd);
+        std::remove(tmpName.c_str());
+    }
+    return fp;
+#endif
+}
+
+}
+
+std::string stfio::cacheFileName(const std::string& cacheDir, const std::string& fName) {
+    SourceKey key;
+    if (!getSourceKey(fName, key)) {
+        return std::string();
+    }
+    std::ostringstream cacheName;
+    cacheName << cacheDir;
+    if (!cacheDir.empty() && cacheDir[cacheDir.size()-1] != '/' && cacheDir[cacheDir.size()-1] != '\\') {
+        cacheName << '/';
+    }
+    cacheName << std::hex << std::setw(16) << std::setfill('0') << hashKey(key) << ".stfc";
+    return cacheName.str();
+}
+
+bool stfio::importCacheFile(const std::string& cacheName, const std::string& fName, Recording& ReturnData) {
+    SourceKey key;
+    if (!getSourceKey(fName, key)) {
+        return false;
+    }
+    CacheFile file(cacheName, "rb");
+    if (file.fp == NULL) {
+        return false;
+    }
+
+    // Check that the cache file belongs to the current state of the source file
+    char magic[4];
+    uint32_t version = 0;
+    SourceKey cachedKey;
+    if (fread(magic, 1, 4, file.fp) != 4 || memcmp(magic, CACHE_MAGIC, 4) != 0 ||
+        !readValue(file.fp, version) || version != CACHE_VERSION ||
+        !readString(file.fp, cachedKey.path) ||
+        !readValue(file.fp, cachedKey.size) ||
+        !readValue(file.fp, cachedKey.mtime) ||
+        cachedKey.path != key.path || cachedKey.size != key.size || cachedKey.mtime != key.mtime)
+    {
+        return false;
+    }
+
+    std::string file_description, global_section_description, scaling, comment, xunits;
+    double dt = 1.0;
+    int32_t year, mon, mday, hour, min, sec;
+    uint64_t nchannels = 0;
+    if (!readString(file.fp, file_description) ||
+        !readString(file.fp, global_section_description) ||
+        !readString(file.fp, scaling) ||
+        !readString(file.fp, comment) ||
+        !readString(file.fp, xunits) ||
+        !readValue(file.fp, dt) ||
+        !readValue(file.fp, year) || !readValue(file.fp, mon) || !readValue(file.fp, mday) ||
+        !readValue(file.fp, hour) || !readValue(file.fp, min) || !readValue(file.fp, sec) ||
+        !readValue(file.fp, nchannels))
+    {
+        return false;
+    }
+
+    // Sections are read directly into ReturnData to avoid copying the data
+    try {
+        ReturnData.resize(nchannels);
+        for (std::size_t n_c=0; n_c < nchannels; ++n_c) {
+            Channel& ch = ReturnData[n_c];
+            std::string name, yunits;
+            uint64_t nsections = 0;
+            if (!readString(file.fp, name) || !readString(file.fp, yunits) ||
+                !readValue(file.fp, nsections))
+            {
+                ReturnData.resize(0);
+                return false;
+            }
+            ch.resize(nsections);
+            ch.SetChannelName(name);
+            ch.SetYUnits(yunits);
+            for (std::size_t n_s=0; n_s < nsections; ++n_s) {
+                std::string description;
+                double xscale = 1.0;
+                uint64_t npoints = 0;
+                if (!readString(file.fp, description) || !readValue(file.fp, xscale) ||
+                    !readValue(file.fp, npoints))
+                {
+                    ReturnData.resize(0);
+                    return false;
+                }
+                Section& sec = ch[n_s];
+                sec.SetSectionDescription(description);
+                sec.SetXScale(xscale);
+                sec.get_w().resize(npoints);
+                if (npoints > 0 && fread(&sec.get_w()[0], sizeof(double), npoints, file.fp) != npoints) {
+                    ReturnData.resize(0);
+                    return false;
+                }
+            }
+        }
+        if (!readMarkers(file.fp, ReturnData)) {
+            ReturnData.resize(0);
+            return false;
+        }
+    }
+    catch (const std::bad_alloc&) {
+        // corrupted section sizes
+        ReturnData.resize(0);
+        return false;
+    }
+    catch (const std::length_error&) {
+        ReturnData.resize(0);
+        return false;
+    }
+
+    ReturnData.SetFileDescription(file_description);
+    ReturnData.SetGlobalSectionDescription(global_section_description);
+    ReturnData.SetScaling(scaling);
+    ReturnData.SetComment(comment);
+    ReturnData.SetXUnits(xunits);
+    ReturnData.SetXScale(dt);
+    ReturnData.SetDateTime(year, mon, mday, hour, min, sec);
+    return true;
+}
+
+bool stfio::exportCacheFile(const std::string& cacheName, const std::string& fName, const Recording& Data) {
+    SourceKey key;
+    if (!getSourceKey(fName, key)) {
+        return false;
+    }
+
+    // Write to a temporary file first so that other processes never
+    // see an incomplete cache file.
+    std::string tmpName;
+    bool success = false;
+    {
+        CacheFile file(createTempFile(cacheName, tmpName));
+        if (file.fp == NULL) {
+            return false;
+        }
+        success = writeHeader(file.fp, key, Data);
+        for (std::size_t n_c=0; success && n_c < Data.size(); ++n_c) {
+            const Channel& ch = Data[n_c];
+            success = writeString(file.fp, ch.GetChannelName()) &&
+                writeString(file.fp, ch.GetYUnits()) &&
+                writeValue<uint64_t>(file.fp, ch.size());
+            for (std::size_t n_s=0; success && n_s < ch.size(); ++n_s) {
+                const Section& sec = ch[n_s];
+                success = writeString(file.fp, sec.GetSectionDescription()) &&
+                    writeValue(file.fp, sec.GetXScale()) &&
+                    writeValue<uint64_t>(file.fp, sec.size()) &&
+                    (sec.size() == 0 ||
+                     fwrite(&sec.get()[0], sizeof(double), sec.size(), file.fp) == sec.size());
+            }
+        }
+        success = success && writeMarkers(file.fp, Data) && fflush(file.fp) == 0;
+    }
+    if (success) {
+        // rename() doesn't replace existing files on Windows
+        std::remove(cacheName.c_str());
+        success = (std::rename(tmpName.c_str(), cacheName.c_str()) == 0);
+    }
+    if (!success) {
+        std::remove(tmpName.c_str());
+    }
+    return success;
+}
@@ -0,0 +1,59 @@
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+/*! \file cachelib.h
+ *  \brief Cache of decoded recordings.
+ *
+ *  Recordings are stored in a native binary format that can be read
+ *  back with a single bulk read per section. Cache files are tied to the
+ *  path, size and modification time of the source file, and are only valid
+ *  on the machine that wrote them.
+ */
+
+#ifndef _CACHELIB_H
+#define _CACHELIB_H
+
+#include "../stfio.h"
+class Recording;
+
+namespace stfio {
+
+//! Get the name of the cache file for a source file.
+/*! \param cacheDir The cache directory.
+ *  \param fName Full path to the source file.
+ *  \return The full path to the cache file, or an empty string if
+ *          \e fName doesn't exist.
+ */
+std::string cacheFileName(const std::string& cacheDir, const std::string& fName);
+
+//! Read a recording from a cache file.
+/*! \param cacheName Full path to the cache file, see cacheFileName().
+ *  \param fName Full path to the source file.
+ *  \param ReturnData On exit, the cached recording.
+ *  \return true if the cache file exists and is up to date with \e fName,
+ *          false otherwise. \e ReturnData may have been emptied if false is returned.
+ */
+bool importCacheFile(const std::string& cacheName, const std::string& fName, Recording& ReturnData);
+
+//! Write a recording to a cache file.
+/*! \param cacheName Full path to the cache file, see cacheFileName().
+ *  \param fName Full path to the source file.
+ *  \param Data The recording imported from \e fName.
+ *  \return true if the cache file has been written successfully.
+ */
+bool exportCacheFile(const std::string& cacheName, const std::string& fName, const Recording& Data);
+
+}
+
+#endif
@@ -13,9 +13,17 @@
 // Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 
 
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 #include <sstream>
 
+#if __cplusplus > 199711L
+#include <cstdint>
+#else
+#include <boost/cstdint.hpp>
+#endif
+
 #include "./cfslib.h"
 #include "./cfs.h"
 
@@ -51,6 +59,96 @@ const int CFSMAXBYTES=64000; // adopted from FPCfs.ips by U Froebe
 
 }
 
+namespace {
+
+// Data sections are read in batches of about this size
+const std::size_t CFS_BATCH_BYTES = 16*1024*1024;
+
+// Position and scaling of a channel within a data section
+struct CFSChanData {
+    CFSChanData() : startOffset(0), points(0), yScale(1.0f), yOffset(0.0f), dest(NULL) {}
+
+    CFSLONG startOffset; // byte offset of the first point within the data section
+    CFSLONG points;
+    float yScale;
+    float yOffset;
+    double* dest;        // destination of the scaled data
+};
+
+// Storage format and data section layout of a channel
+struct CFSChannel {
+    CFSChannel() : dataType(INT2), spacing(0), sections() {}
+
+    TDataType dataType;
+    short spacing;       // bytes between two points
+    std::vector<CFSChanData> sections;
+};
+
+int CFSTypeSize(TDataType dataType) {
+    switch (dataType) {
+    case INT1:
+    case WRD1:
+        return 1;
+    case INT2:
+    case WRD2:
+        return 2;
+    case INT4:
+    case RL4:
+        return 4;
+    case RL8:
+        return 8;
+    default:
+        return 0;
+    }
+}
+
+// Scales the points of a channel that are stored \e spacing bytes apart.
+// The arithmetic is done in the precision of the scaling factors, as in
+// the CFS library.
+template <typename T>
+void decodeCFSChannel(const char* src, short spacing, const CFSChanData& chan) {
+    for (CFSLONG n=0; n < chan.points; ++n) {
+        T value;
+        memcpy(&value, src + n*spacing, sizeof(T));
+        chan.dest[n] = value*chan.yScale + chan.yOffset;
+    }
+}
+
+// Decodes all channels of a batch of data sections concurrently.
+void decodeCFSBatch(const std::vector<CFSChannel>& layout, const std::vector<char>& batch,
+                    const std::vector<int>& sections, const std::vector<std::size_t>& offsets)
+{
+    std::vector<std::pair<int, int> > jobs; // (batch index, channel)
+    for (std::size_t n_b=0; n_b < sections.size(); ++n_b) {
+        for (std::size_t n_c=0; n_c < layout.size(); ++n_c) {
+            if (layout[n_c].sections[sections[n_b]].points > 0) {
+                jobs.push_back(std::make_pair((int)n_b, (int)n_c));
+            }
+        }
+    }
+
+#ifdef _OPENMP
+    #pragma omp parallel for
+#endif
+    for (int n_job=0; n_job < (int)jobs.size(); ++n_job) {
+        const CFSChannel& channel = layout[jobs[n_job].second];
+        const CFSChanData& chan = channel.sections[sections[jobs[n_job].first]];
+        const char* src = &batch[offsets[jobs[n_job].first] + chan.startOffset];
+        switch (channel.dataType) {
+        case INT1: decodeCFSChannel<int8_t>(src, channel.spacing, chan); break;
+        case WRD1: decodeCFSChannel<uint8_t>(src, channel.spacing, chan); break;
+        case INT2: decodeCFSChannel<int16_t>(src, channel.spacing, chan); break;
+        case WRD2: decodeCFSChannel<uint16_t>(src, channel.spacing, chan); break;
+        case INT4: decodeCFSChannel<int32_t>(src, channel.spacing, chan); break;
+        case RL4: decodeCFSChannel<float>(src, channel.spacing, chan); break;
+        case RL8: decodeCFSChannel<double>(src, channel.spacing, chan); break;
+        default: break;
+        }
+    }
+}
+
+}
+
 stfio::CFS_IFile::CFS_IFile(const std::string& filename) {
     myHandle = OpenCFSFile(filename.c_str(),0,1);
 }
@@ -219,6 +317,12 @@ std::string stfio::CFSReadVar(short fHandle,short varNo,short varKind) {
 }
 
 bool stfio::exportCFSFile(const std::string& fName, const Recording& WData, stfio::ProgressInfo& progDlg) {
+    SectionReader source(WData);
+    return exportCFSFile(fName, source, progDlg);
+}
+
+bool stfio::exportCFSFile(const std::string& fName, SectionReader& source, stfio::ProgressInfo& progDlg) {
+    const Recording& WData = source.GetHeader();
     std::string errorMsg;
     if (fName.length()>1024) {
         throw std::runtime_error(
@@ -251,6 +355,10 @@ bool stfio::exportCFSFile(const std::string& fName, const Recording& WData, stfi
         if (CFSError(errorMsg))	throw std::runtime_error(errorMsg);
     }
 
+    // interleaved points of all channels, reused for every section
+    const int nChannels = (int)WData.size();
+    Vector_float frames;
+
     for (int n_section=0; n_section < (int)WData.GetChannelSize(0); n_section++) {
         int progbar =
             // Section contribution:
@@ -259,56 +367,56 @@ bool stfio::exportCFSFile(const std::string& fName, const Recording& WData, stfi
         progStr << "Writing section #" << n_section+1 << " of " << (int)WData.GetChannelSize(0);
         progDlg.Update(progbar, progStr.str());
 
-        for (std::size_t n_c=0;n_c<WData.size();++n_c) {
+        // The section layout is determined by the first channel;
+        // missing points of shorter channels are written as 0.
+        // Channels are read one at a time and copied into their frame slots.
+        int nPoints = 0;
+        for (int n_c=0;n_c<nChannels;++n_c) {
+            const Section& sec = source.Read(n_c, n_section);
+            if (n_c==0) {
+                nPoints = (int)sec.size();
+                if (nPoints==0) {
+                    std::runtime_error e("array has size zero in exportCFSFile()");
+                    throw e;
+                }
+                frames.resize(nPoints*nChannels);
+            }
             SetDSChan(
                 CFSFile.myHandle,
                 (short)n_c /* channel */,
                 0  /* current section */,
                 (CFSLONG)(n_c*4)/*0*/ /* startOffset */,
-                (CFSLONG)WData[n_c][n_section].size(),
+                (CFSLONG)sec.size(),
                 1.0 /* yScale */,
                 0  /* yOffset */,
                 (float)WData.GetXScale(),
                 0 /* x offset */
                 );
             if (CFSError(errorMsg))	throw std::runtime_error(errorMsg);
-        }
 
-        int maxBytes=CFSMAXBYTES/(int)WData.size();
-        // Section loop
-        int nBlocks, nBlockBytes, nStartByteOffset;
-        nBlocks=(int)(((WData[0][n_section].size()*4-1)/maxBytes) + 1);
-
-        for (int b=0; b < nBlocks; b++) {
-            // Block loop
-            nStartByteOffset=b*maxBytes*(int)WData.size();
-            if (b == nBlocks -1)
-                nBlockBytes=(int)WData[0][n_section].size()*(int)WData.size()*4 -
-                b*maxBytes*(int)WData.size();
-            else
-                nBlockBytes=maxBytes*(int)WData.size();
-
-            Vector_float faverage_small(nBlockBytes/4);
-
-            for (int n_point=0; n_point < nBlockBytes/4/(int)WData.size(); n_point++) {
-                for (std::size_t n_c=0;n_c<WData.size();++n_c) {
-                    faverage_small[n_point*WData.size()+n_c]=
-                        (float)WData[n_c][n_section][n_point + b*maxBytes/4];
-                }
-            }
-            if (faverage_small.size()==0) {
-                std::runtime_error e("array has size zero in exportCFSFile()");
-                throw e;
+            int channelPoints = std::min((int)sec.size(), nPoints);
+            const double* channelData = channelPoints > 0 ? &sec.get()[0] : NULL;
+#ifdef _OPENMP
+            #pragma omp parallel for
+#endif
+            for (int n_point=0; n_point < nPoints; n_point++) {
+                frames[n_point*nChannels+n_c] = (n_point < channelPoints) ?
+                    (float)channelData[n_point] : 0.0f;
             }
+        }
+
+        // WriteData() can't write more than 64 kB at once
+        CFSLONG nBytes = (CFSLONG)(frames.size()*sizeof(float));
+        for (CFSLONG nStartByteOffset=0; nStartByteOffset < nBytes; nStartByteOffset += CFSMAXBYTES) {
             WriteData(
                 CFSFile.myHandle,
                 0  /* "0" means current section */,
                 nStartByteOffset /* byte offset */,
-                (WORD)nBlockBytes,
-                &faverage_small[0]
+                (WORD)std::min((CFSLONG)CFSMAXBYTES, nBytes-nStartByteOffset),
+                &frames[nStartByteOffset/sizeof(float)]
             );
             if (CFSError(errorMsg))	throw std::runtime_error(errorMsg);
-        }	//End block loop
+        }
         InsertDS(CFSFile.myHandle, 0, noFlags);
         if (CFSError(errorMsg))	throw std::runtime_error(errorMsg);
     }	//End section loop
@@ -316,6 +424,85 @@ bool stfio::exportCFSFile(const std::string& fName, const Recording& WData, stfi
     return true;
 }
 
+int stfio::probeCFSFile(const std::string& fName, Recording& ReturnData) {
+
+    std::string errorMsg;
+    CFS_IFile CFSFile(fName);
+
+    if (CFSFile.myHandle<0) {
+        int err = CFSError(errorMsg);
+        if (err==-7) {
+            return err;
+        }
+        errorMsg = std::string("Error while opening file:\n") + errorMsg;
+        throw std::runtime_error(errorMsg.c_str());
+    }
+
+    TDesc time, date;
+    TComment comment;
+    GetGenInfo(CFSFile.myHandle, time, date, comment);
+    if (CFSError(errorMsg))
+        throw std::runtime_error(std::string("Error in GetGenInfo:\n") + errorMsg);
+    short channelsAvail=0, fileVars=0, DSVars=0;
+    unsigned short dataSections=0;
+    GetFileInfo(CFSFile.myHandle, &channelsAvail, &fileVars, &DSVars, &dataSections);
+    if (CFSError(errorMsg))
+        throw std::runtime_error(errorMsg);
+
+    std::string file_description, section_description;
+    for (short n_filevar=0; n_filevar < fileVars; ++n_filevar) {
+        file_description += CFSReadVar(CFSFile.myHandle,n_filevar,FILEVAR);
+    }
+    for (short n_sectionvar=0; n_sectionvar < DSVars; ++n_sectionvar) {
+        section_description+=CFSReadVar(CFSFile.myHandle,n_sectionvar,DSVAR);
+    }
+
+    // Sections and channels without any data are skipped, as in importCFSFile()
+    ReturnData.resize(0);
+    float xScale=1.0;
+    for (short n_channel=0; n_channel < channelsAvail; ++n_channel) {
+        std::vector<char> vchannel_name(22),vyUnits(10),vxUnits(10);
+        TDataType dataType;
+        TCFSKind dataKind;
+        short spacing, other;
+        GetFileChan(CFSFile.myHandle, n_channel, &vchannel_name[0],
+            &vyUnits[0], &vxUnits[0], &dataType, &dataKind,
+            &spacing, &other);
+        if (CFSError(errorMsg))	throw std::runtime_error(errorMsg);
+
+        std::deque<std::string> labels;
+        for (int n_section=0; n_section < dataSections; ++n_section) {
+            CFSLONG startOffset, points=0;
+            float yScale, yOffset, xOffset;
+            GetDSChan(CFSFile.myHandle,(short)n_channel,(WORD)n_section+1,&startOffset,
+                &points,&yScale,&yOffset,&xScale,&xOffset);
+            if (CFSError(errorMsg))	throw std::runtime_error(errorMsg);
+            if (points != 0) {
+                std::ostringstream label;
+                label << fName << ", Section # " << n_section+1;
+                labels.push_back(label.str());
+            }
+        }
+        if (!labels.empty()) {
+            Channel TempChannel(labels.size());
+            for (std::size_t n_s=0; n_s < labels.size(); ++n_s) {
+                TempChannel[n_s].SetSectionDescription(labels[n_s]);
+            }
+            TempChannel.SetChannelName(std::string(&vchannel_name[0]));
+            TempChannel.SetYUnits(std::string(&vyUnits[0]));
+            ReturnData.resize(ReturnData.size()+1);
+            ReturnData.InsertChannel(TempChannel, ReturnData.size()-1);
+        }
+    }
+    ReturnData.SetXScale(xScale);
+    ReturnData.SetFileDescription(file_description + '\0');
+    ReturnData.SetGlobalSectionDescription(section_description + '\0');
+    ReturnData.SetTime(time + '\0');
+    ReturnData.SetDate(date + '\0');
+    ReturnData.SetComment(comment + '\0');
+    return 0;
+}
+
 int stfio::importCFSFile(const std::string& fName, Recording& ReturnData, ProgressInfo& progDlg) {
 
     std::string errorMsg;
@@ -344,9 +531,6 @@ int stfio::importCFSFile(const std::string& fName, Recording& ReturnData, Progre
     if (CFSError(errorMsg))
         throw std::runtime_error(errorMsg);
 
-    //memory allocation
-    ReturnData.resize(channelsAvail);
-
     //Variables to store the Descriptions of a single variable as text
     std::string	file_description,    //File variable
         section_description; //Data section variable
@@ -382,7 +566,8 @@ int stfio::importCFSFile(const std::string& fName, Recording& ReturnData, Progre
     TCFSKind dataKind;
     short spacing, other;
     float xScale=1.0;
-    std::size_t empty_channels=0;
+    std::vector<CFSChannel> layout(channelsAvail);
+    std::vector<std::string> channelNames(channelsAvail), channelUnits(channelsAvail);
     for (short n_channel=0; n_channel < channelsAvail; ++n_channel) {
 
         //Get constant information for a particular data channel -
@@ -396,6 +581,11 @@ int stfio::importCFSFile(const std::string& fName, Recording& ReturnData, Progre
         std::string channel_name(&vchannel_name[0]),
             xUnits(&vxUnits[0]),
             yUnits(&vyUnits[0]);
+        channelNames[n_channel] = channel_name;
+        channelUnits[n_channel] = yUnits;
+        layout[n_channel].dataType = dataType;
+        layout[n_channel].spacing = spacing;
+        layout[n_channel].sections.resize(dataSections);
         //Memory allocation for the current channel
         float yScale, yOffset, xOffset;
         //Begin loop: read scaling and offsets
@@ -424,123 +614,104 @@ int stfio::importCFSFile(const std::string& fName, Recording& ReturnData, Progre
         outputstream.clear();
         outputstream << "XOffset=" <<  xOffset << "\n";
         scaling += outputstream.str();
+    }
 
-        Channel TempChannel(dataSections);
-        TempChannel.SetChannelName(channel_name);
-        TempChannel.SetYUnits(yUnits);
-        std::size_t empty_sections=0;
-        for (int n_section=0; n_section < dataSections; ++n_section) {
-            int progbar =
-                // Channel contribution:
-                (int)(((double)n_channel/(double)channelsAvail)*100.0+
-                      // Section contribution:
-                      (double)n_section/(double)dataSections*(100.0/channelsAvail));
-            std::ostringstream progStr;
-            progStr << "Reading channel #" << n_channel + 1 << " of " << channelsAvail
-                        << ", Section #" << n_section+1 << " of " << dataSections;
-            progDlg.Update(progbar, progStr.str());
-            
-            //Begin loop: n_sections
-            //Get the channel information for a data section or a file
-            //- see manual of CFS file system
-            CFSLONG startOffset;
-            float yScale, yOffset, xOffset;
-            GetDSChan(CFSFile.myHandle,(short)n_channel,(WORD)n_section+1,&startOffset,
-                &points[n_section],&yScale,&yOffset,&xScale,&xOffset);
+    //4. Position and scaling of every channel in every data section.
+    //Data section headers are read in file order.
+    for (int n_section=0; n_section < dataSections; ++n_section) {
+        for (short n_channel=0; n_channel < channelsAvail; ++n_channel) {
+            CFSChanData& chan = layout[n_channel].sections[n_section];
+            float xOffset;
+            GetDSChan(CFSFile.myHandle,(short)n_channel,(WORD)n_section+1,&chan.startOffset,
+                &chan.points,&chan.yScale,&chan.yOffset,&xScale,&xOffset);
             if (CFSError(errorMsg))	throw std::runtime_error(errorMsg);
-            std::ostringstream label;
-            label << fName << ", Section # " << n_section+1;
-            Section TempSection(
-                (int)(points[n_section]),
-                label.str()
-            );
-            //-----------------------------------------------------
-            //The following part was modified to read data sections
-            //larger than 64 KB as e.g. produced by Igor.
-            //Adopted from FPCfs.ipf by U Froebe
-            //Sections with a size larger than 64 KB have been made
-            //possible by dividing CFS-sections into 'blocks'
-            //-----------------------------------------------------
-            int nBlocks, //number of blocks
-                nBlockBytes; //number of bytes per block
-
-            //Calculation of the number of blocks depending on the data format:
-            //RL4 - 4 byte floating point numbers (2 byte int numbers otherwise)
-            if (dataType == RL4)
-                nBlocks=(int)(((points[n_section]*4-1)/CFSMAXBYTES) + 1);
-            else
-                nBlocks=(int)(((points[n_section]*2-1)/CFSMAXBYTES) + 1);
-
-            for (int b=0; b < nBlocks; ++b) {
-                //Begin loop: storage of blocks
-                if (dataType == RL4) {
-                    //4 byte data
-                    //Read data of the current channel and data section
-                    //- see manual of CFS file system
-                    //Temporary arrays to store blocks:
-                    if (b == nBlocks - 1)
-                        nBlockBytes=points[n_section]*4 - b*CFSMAXBYTES;
-                    else
-                        nBlockBytes=CFSMAXBYTES;
-                    Vector_float fTempSection_small(nBlockBytes);
-                    GetChanData(CFSFile.myHandle, (short)n_channel, (WORD)n_section+1,
-                        b*CFSMAXBYTES/4, (WORD)nBlockBytes/4, &fTempSection_small[0],
-                        4*(points[n_section]+1));
-                    if (CFSError(errorMsg))	throw std::runtime_error(errorMsg);
-                    for (int n=0; n<nBlockBytes/4; ++n) {
-                        TempSection[n + b*CFSMAXBYTES/4]=
-                            fTempSection_small[n]* yScale +
-                            yOffset;
-                    }
-                } else {
-                    //2 byte data
-                    //Read data of the current channel and data section
-                    //- see manual of CFS file system
-                    if (b == nBlocks - 1)
-                        nBlockBytes=points[n_section]*2 - b*CFSMAXBYTES;
-                    else
-                        nBlockBytes=CFSMAXBYTES;
-                    std::vector<short> TempSection_small(nBlockBytes);
-                    GetChanData(CFSFile.myHandle, (short)n_channel, (WORD)n_section+1,
-                        b*CFSMAXBYTES/2, (WORD)nBlockBytes/2, &TempSection_small[0],
-                        2*(points[n_section]+1));
-                    if (CFSError(errorMsg))	throw std::runtime_error(errorMsg);
-                    for (int n=0; n<nBlockBytes/2; ++n) {
-                        TempSection[n + b*CFSMAXBYTES/2]=
-                            TempSection_small[n]* yScale +
-                            yOffset;
-                    }
-                }
-            }	//End loop: storage of blocks
-            //-----------------------------------------------------
-            //End of the modified part to read data sections larger than
-            //64kB (as produced e.g. by Igor)
-            //-----------------------------------------------------
-            try {
-                if (TempSection.size()!=0) {
-                    TempChannel.InsertSection(TempSection,n_section-empty_sections);
-                } else {
-                    empty_sections++;
-                    TempChannel.resize(TempChannel.size()-1);
-                }
+            if (chan.points < 0) {
+                throw std::runtime_error("Invalid number of points in CFS data section");
             }
-            catch (...) {
-                throw;
+        }
+    }
+
+    //5. Memory allocation. Sections and channels without any data are skipped.
+    ReturnData.resize(0);
+    for (short n_channel=0; n_channel < channelsAvail; ++n_channel) {
+        std::vector<int> nonEmpty;
+        for (int n_section=0; n_section < dataSections; ++n_section) {
+            if (layout[n_channel].sections[n_section].points != 0) {
+                nonEmpty.push_back(n_section);
             }
-        }	//End loop: n_section
-        try {
-            if (TempChannel.size()!=0) {
-                ReturnData.InsertChannel(TempChannel,n_channel-empty_channels);
-            } else {
-                empty_channels++;
-                ReturnData.resize(ReturnData.size()-1);
+        }
+        if (nonEmpty.empty()) {
+            continue;
+        }
+        if (CFSTypeSize(layout[n_channel].dataType) == 0) {
+            throw std::runtime_error("Unsupported data type in CFS file");
+        }
+        Channel TempChannel(nonEmpty.size());
+        TempChannel.SetChannelName(channelNames[n_channel]);
+        TempChannel.SetYUnits(channelUnits[n_channel]);
+        for (std::size_t n_s=0; n_s < nonEmpty.size(); ++n_s) {
+            std::ostringstream label;
+            label << fName << ", Section # " << nonEmpty[n_s]+1;
+            TempChannel[n_s].SetSectionDescription(label.str());
+        }
+        std::size_t n_c = ReturnData.size();
+        ReturnData.resize(n_c+1);
+        ReturnData.InsertChannel(TempChannel, n_c);
+        // sections are allocated in place to avoid copying them
+        for (std::size_t n_s=0; n_s < nonEmpty.size(); ++n_s) {
+            CFSChanData& chan = layout[n_channel].sections[nonEmpty[n_s]];
+            ReturnData[n_c][n_s].resize(chan.points);
+            chan.dest = &ReturnData[n_c][n_s][0];
+        }
+    }
+
+    //6. Every data section is read in one go; all channels of a batch of
+    //sections are decoded concurrently.
+    std::vector<char> batch;
+    std::vector<int> batchSections;
+    std::vector<std::size_t> batchOffsets;
+    for (int n_section=0; n_section < dataSections; ++n_section) {
+        int progbar = (int)((double)n_section/(double)dataSections*100.0);
+        std::ostringstream progStr;
+        progStr << "Reading section #" << n_section+1 << " of " << dataSections;
+        progDlg.Update(progbar, progStr.str());
+
+        CFSLONG dsSize = GetDSSize(CFSFile.myHandle, (WORD)n_section+1);
+        if (CFSError(errorMsg))	throw std::runtime_error(errorMsg);
+        bool hasData = false;
+        for (short n_channel=0; n_channel < channelsAvail; ++n_channel) {
+            const CFSChanData& chan = layout[n_channel].sections[n_section];
+            if (chan.points == 0) {
+                continue;
+            }
+            hasData = true;
+            CFSLONG lastByte = chan.startOffset + (chan.points-1)*layout[n_channel].spacing +
+                CFSTypeSize(layout[n_channel].dataType);
+            if (chan.startOffset < 0 || layout[n_channel].spacing <= 0 || lastByte > dsSize) {
+                throw std::runtime_error("Channel data exceed the CFS data section");
             }
         }
-        catch (...) {
-            ReturnData.resize(0);
-            throw;
+        if (!hasData) {
+            continue;
+        }
+
+        std::size_t offset = batch.size();
+        batch.resize(offset + dsSize);
+        for (CFSLONG pos=0; pos < dsSize; pos += CFSMAXBYTES) {
+            WORD bytes = (WORD)std::min((CFSLONG)CFSMAXBYTES, dsSize-pos);
+            ReadData(CFSFile.myHandle, (WORD)n_section+1, pos, bytes, &batch[offset+pos]);
+            if (CFSError(errorMsg))	throw std::runtime_error(errorMsg);
         }
-    }	//Begin loop: n_channel
+        batchSections.push_back(n_section);
+        batchOffsets.push_back(offset);
+        if (batch.size() >= CFS_BATCH_BYTES) {
+            decodeCFSBatch(layout, batch, batchSections, batchOffsets);
+            batch.clear();
+            batchSections.clear();
+            batchOffsets.clear();
+        }
+    }
+    decodeCFSBatch(layout, batch, batchSections, batchOffsets);
     ReturnData.SetXScale(xScale);
     ReturnData.SetFileDescription(file_description + '\0');
     ReturnData.SetGlobalSectionDescription(section_description + '\0');
@@ -35,6 +35,14 @@ namespace stfio {
  */
 int importCFSFile(const std::string& fName, Recording& ReturnData, ProgressInfo& progDlg);
 
+//! Read the metadata of a CFS file without reading any data.
+/*! \param fName Full path to the file to be read.
+ *  \param ReturnData On entry, an empty Recording object. On exit,
+ *         the channels, sections and attributes of \e fName. All sections are empty.
+ *  \return 0 upon success, a negative error code upon failure (see importCFSFile()).
+ */
+int probeCFSFile(const std::string& fName, Recording& ReturnData);
+
 //! Export a Recording to a CFS file.
 /*! \param fName Full path to the file to be written.
  *  \param WData The data to be exported.
@@ -42,6 +50,13 @@ int importCFSFile(const std::string& fName, Recording& ReturnData, ProgressInfo&
  */
 StfioDll bool exportCFSFile(const std::string& fName, const Recording& WData, ProgressInfo& progDlg);
 
+//! Export sections to a CFS file one data section at a time.
+/*! \param fName Full path to the file to be written.
+ *  \param source The sections to be exported.
+ *  \return true upon success.
+ */
+StfioDll bool exportCFSFile(const std::string& fName, SectionReader& source, ProgressInfo& progDlg);
+
 }
 
 #endif
@@ -45,8 +45,185 @@ typedef struct st {
     char yunits[UNITLEN];
 } st;
 
-bool stfio::exportHDF5File(const std::string& fName, const Recording& WData, ProgressInfo& progDlg) {
+namespace {
+
+// Path of a section group, with the section number padded with leading
+// zeros to the width of the largest section number in the channel.
+std::string sectionPath(const std::string& channel_path, int n_s, int max_log10) {
+    int n10 = 0;
+    if (n_s > 0) {
+        n10 = int(log10((double)n_s));
+    }
+    std::ostringstream section_path;
+    section_path << channel_path << "/" << "section_";
+    for (int n_z=n10; n_z < max_log10; ++n_z) {
+        section_path << "0";
+    }
+    section_path << n_s;
+    return section_path.str();
+}
+
+void readSectionDescription(hid_t section_group, st& st_buf) {
+    const int NSFIELDS = 3;
+    size_t st_offset[NSFIELDS] = {  HOFFSET( st, dt ),
+                                    HOFFSET( st, xunits ),
+                                    HOFFSET( st, yunits )};
+    size_t st_sizes[NSFIELDS] = { sizeof( st_buf.dt),
+                                  sizeof( st_buf.xunits),
+                                  sizeof( st_buf.yunits)};
+    herr_t status=H5TBread_table( section_group, "description", sizeof(st), st_offset, st_sizes, &st_buf );
+    if (status < 0) {
+        std::string errorMsg("Exception while reading data description in stfio::importHDF5File");
+        throw std::runtime_error(errorMsg);
+    }
+}
+
+// Reads the file attributes into ReturnData and returns the number of channels.
+int readFileDescription(hid_t file_id, Recording& ReturnData) {
+    /* H5TBread_table
+       const int NRECORDS = 1;*/
+    const int NFIELDS    = 3;
+
+    /* Calculate the size and the offsets of our struct members in memory */
+    size_t rt_offset[NFIELDS] = {  HOFFSET( rt, channels ),
+                                   HOFFSET( rt, date ),
+                                   HOFFSET( rt, time )};
+    rt rt_buf[1];
+    size_t rt_sizes[NFIELDS] = { sizeof( rt_buf[0].channels),
+                                 sizeof( rt_buf[0].date),
+                                 sizeof( rt_buf[0].time)};
+    herr_t status=H5TBread_table( file_id, "description", sizeof(rt), rt_offset, rt_sizes, rt_buf );
+    if (status < 0) {
+        std::string errorMsg("Exception while reading description in stfio::importHDF5File");
+        throw std::runtime_error(errorMsg);
+    }
+    int numberChannels =rt_buf[0].channels;
+    if ( ReturnData.SetDate(rt_buf[0].date)
+      || ReturnData.SetTime(rt_buf[0].time) ) {
+        std::cout << "Warning HDF5: could not decode date/time " << rt_buf[0].date << " " << rt_buf[0].time << std::endl;
+    }
+
+
+
+    /* Create the data space for the dataset. */
+    hsize_t dims;
+    H5T_class_t class_id;
+    size_t type_size;
+
+    std::string description, comment;
+    hid_t group_id = H5Gopen2(file_id, "/comment", H5P_DEFAULT);
+    status = H5Lexists(group_id, "/comment/description", 0);
+    if (status==1) {
+        status = H5LTget_dataset_info( file_id, "/comment/description", &dims, &class_id, &type_size );
+        if (status >= 0) {
+            description.resize( type_size );
+            status = H5LTread_dataset_string (file_id, "/comment/description", &description[0]);
+            if (status < 0) {
+                std::string errorMsg("Exception while reading description in stfio::importHDF5File");
+                throw std::runtime_error(errorMsg);
+            }
+        }
+    }
+    ReturnData.SetFileDescription(description);
     
+    status = H5Lexists(group_id, "/comment/comment", 0);
+    if (status==1) {
+        status = H5LTget_dataset_info( file_id, "/comment/comment", &dims, &class_id, &type_size );
+        if (status >= 0) {
+            comment.resize( type_size );
+            status = H5LTread_dataset_string (file_id, "/comment/comment", &comment[0]);
+            if (status < 0) {
+                std::string errorMsg("Exception while reading comment in stfio::importHDF5File");
+                throw std::runtime_error(errorMsg);
+            }
+        }
+    }
+    ReturnData.SetComment(comment);
+    H5Gclose(group_id);
+
+    return numberChannels;
+}
+
+std::string readChannelName(hid_t file_id, int n_c) {
+    /* Read channel name */
+    hsize_t cdims;
+    H5T_class_t cclass_id;
+    size_t ctype_size;
+    std::ostringstream desc_path;
+    desc_path << "/channels/ch" << (n_c);
+    herr_t status = H5LTget_dataset_info( file_id, desc_path.str().c_str(), &cdims, &cclass_id, &ctype_size );
+    if (status < 0) {
+        std::string errorMsg("Exception while reading channel in stfio::importHDF5File");
+        throw std::runtime_error(errorMsg);
+    }
+    hid_t string_typec= H5Tcopy( H5T_C_S1 );
+    H5Tset_size( string_typec,  ctype_size );
+    std::vector<char> szchannel_name(ctype_size);
+    status = H5LTread_dataset(file_id, desc_path.str().c_str(), string_typec, &szchannel_name[0] );
+    H5Tclose(string_typec);
+    if (status < 0) {
+        std::string errorMsg("Exception while reading channel name in stfio::importHDF5File");
+        throw std::runtime_error(errorMsg);
+    }
+    std::ostringstream channel_name;
+    for (std::size_t c=0; c<ctype_size; ++c) {
+        channel_name << szchannel_name[c];
+    }
+    return channel_name.str();
+}
+
+int readChannelDescription(hid_t channel_group) {
+    /* Calculate the size and the offsets of our struct members in memory */
+    size_t ct_offset[1] = { HOFFSET( ct, n_sections ) };
+    ct ct_buf[1];
+    size_t ct_sizes[1] = { sizeof( ct_buf[0].n_sections) };
+    herr_t status=H5TBread_table( channel_group, "description", sizeof(ct), ct_offset, ct_sizes, ct_buf );
+    if (status < 0) {
+        std::string errorMsg("Exception while reading channel description in stfio::importHDF5File");
+        throw std::runtime_error(errorMsg);
+    }
+    return ct_buf[0].n_sections;
+}
+
+int maxLog10(int n_sections) {
+    int max_log10 = 0;
+    if (n_sections > 1) {
+        max_log10 = int(log10((double)n_sections-1.0));
+    }
+    return max_log10;
+}
+
+Vector_float readSectionData(hid_t file_id, const std::string& section_path) {
+    std::string data_path = section_path + "/data";
+    hsize_t sdims;
+    H5T_class_t sclass_id;
+    size_t stype_size;
+    herr_t status = H5LTget_dataset_info( file_id, data_path.c_str(), &sdims, &sclass_id, &stype_size );
+    if (status < 0) {
+        std::string errorMsg("Exception while reading data information in stfio::importHDF5File");
+        throw std::runtime_error(errorMsg);
+    }
+    Vector_float TempSection(sdims);
+    if (sdims > 0) {
+        status = H5LTread_dataset(file_id, data_path.c_str(), H5T_IEEE_F32LE, &TempSection[0]);
+        if (status < 0) {
+            std::string errorMsg("Exception while reading data in stfio::importHDF5File");
+            throw std::runtime_error(errorMsg);
+        }
+    }
+    return TempSection;
+}
+
+}
+
+bool stfio::exportHDF5File(const std::string& fName, const Recording& WData, ProgressInfo& progDlg) {
+    SectionReader source(WData);
+    return exportHDF5File(fName, source, progDlg);
+}
+
+bool stfio::exportHDF5File(const std::string& fName, SectionReader& source, ProgressInfo& progDlg) {
+
+    const Recording& WData = source.GetHeader();
     hid_t file_id = H5Fcreate(fName.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
     
     const int NRECORDS = 1;
@@ -89,7 +266,6 @@ bool stfio::exportHDF5File(const std::string& fName, const Recording& WData, Pro
     if (status < 0) {
         std::string errorMsg("Exception while writing description in stfio::exportHDF5File");
         H5Fclose(file_id);
-        H5close();
         throw std::runtime_error(errorMsg);
     }
 
@@ -105,7 +281,6 @@ bool stfio::exportHDF5File(const std::string& fName, const Recording& WData, Pro
     if (status < 0) {
         std::string errorMsg("Exception while writing description in stfio::exportHDF5File");
         H5Fclose(file_id);
-        H5close();
         throw std::runtime_error(errorMsg);
     }
 
@@ -118,7 +293,6 @@ bool stfio::exportHDF5File(const std::string& fName, const Recording& WData, Pro
     if (status < 0) {
         std::string errorMsg("Exception while writing comment in stfio::exportHDF5File");
         H5Fclose(file_id);
-        H5close();
         throw std::runtime_error(errorMsg);
     }
     H5Gclose(comment_group);
@@ -127,6 +301,9 @@ bool stfio::exportHDF5File(const std::string& fName, const Recording& WData, Pro
 
     hid_t channels_group = H5Gcreate2( file_id,"/channels", H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
 
+    // 32 bit copy of a section, reused for all sections
+    Vector_float data_cp;
+
     for ( std::size_t n_c=0; n_c < WData.size(); ++n_c) {
         /* Channel descriptions. */
         std::ostringstream ossname;
@@ -148,7 +325,6 @@ bool stfio::exportHDF5File(const std::string& fName, const Recording& WData, Pro
         if (status < 0) {
             std::string errorMsg("Exception while writing channel name in stfio::exportHDF5File");
             H5Fclose(file_id);
-            H5close();
             throw std::runtime_error(errorMsg);
         }
 
@@ -159,7 +335,6 @@ bool stfio::exportHDF5File(const std::string& fName, const Recording& WData, Pro
             errorMsg << "Exception while creating channel group for "
                      << channel_path.str().c_str();
             H5Fclose(file_id);
-            H5close();
             throw std::runtime_error(errorMsg.str());
         }
 
@@ -179,7 +354,6 @@ bool stfio::exportHDF5File(const std::string& fName, const Recording& WData, Pro
         if (status < 0) {
             std::string errorMsg("Exception while writing channel description in stfio::exportHDF5File");
             H5Fclose(file_id);
-            H5close();
             throw std::runtime_error(errorMsg);
         }
 
@@ -221,18 +395,18 @@ bool stfio::exportHDF5File(const std::string& fName, const Recording& WData, Pro
             hid_t section_group = H5Gcreate2( file_id, section_path.str().c_str(), H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
 
             // add data and description, store as 32 bit little endian independent of machine:
-            hsize_t dims[1] = { WData[n_c][n_s].size() };
+            const Section& sec = source.Read(n_c, n_s);
+            hsize_t dims[1] = { sec.size() };
             std::ostringstream data_path;
             data_path << section_path.str() << "/data";
-            Vector_float data_cp(WData[n_c][n_s].get().size()); /* 32 bit */
-            for (std::size_t n_cp = 0; n_cp < WData[n_c][n_s].get().size(); ++n_cp) {
-                data_cp[n_cp] = float(WData[n_c][n_s][n_cp]);
+            data_cp.resize(sec.size());
+            for (std::size_t n_cp = 0; n_cp < sec.size(); ++n_cp) {
+                data_cp[n_cp] = float(sec[n_cp]);
             }
             status = H5LTmake_dataset(file_id, data_path.str().c_str(), 1, dims, H5T_IEEE_F32LE, &data_cp[0]);
             if (status < 0) {
                 std::string errorMsg("Exception while writing data in stfio::exportHDF5File");
                 H5Fclose(file_id);
-                H5close();
                 throw std::runtime_error(errorMsg);
             }
 
@@ -276,7 +450,6 @@ bool stfio::exportHDF5File(const std::string& fName, const Recording& WData, Pro
             if (status < 0) {
                 std::string errorMsg("Exception while writing section description in stfio::exportHDF5File");
                 H5Fclose(file_id);
-                H5close();
                 throw std::runtime_error(errorMsg);
             }
             H5Gclose(section_group);
@@ -292,13 +465,6 @@ bool stfio::exportHDF5File(const std::string& fName, const Recording& WData, Pro
         throw std::runtime_error(errorMsg);
     }
 
-    /* Release all hdf5 resources */
-    status = H5close();
-    if (status < 0) {
-        std::string errorMsg("Exception while closing file in stfio::exportHDF5File");
-        throw std::runtime_error(errorMsg);
-    }
-    
     return (status >= 0);
 }
 
@@ -306,160 +472,40 @@ void stfio::importHDF5File(const std::string& fName, Recording& ReturnData, Prog
     /* Create a new file using default properties. */
     hid_t file_id = H5Fopen(fName.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
     
-    /* H5TBread_table
-       const int NRECORDS = 1;*/
-    const int NFIELDS    = 3;
-
-    /* Calculate the size and the offsets of our struct members in memory */
-    size_t rt_offset[NFIELDS] = {  HOFFSET( rt, channels ),
-                                   HOFFSET( rt, date ),
-                                   HOFFSET( rt, time )};
-    rt rt_buf[1];
-    size_t rt_sizes[NFIELDS] = { sizeof( rt_buf[0].channels),
-                                 sizeof( rt_buf[0].date),
-                                 sizeof( rt_buf[0].time)};
-    herr_t status=H5TBread_table( file_id, "description", sizeof(rt), rt_offset, rt_sizes, rt_buf );
-    if (status < 0) {
-        std::string errorMsg("Exception while reading description in stfio::importHDF5File");
-        throw std::runtime_error(errorMsg);
-    }
-    int numberChannels =rt_buf[0].channels;
-    if ( ReturnData.SetDate(rt_buf[0].date)
-      || ReturnData.SetTime(rt_buf[0].time) ) {
-        std::cout << "Warning HDF5: could not decode date/time " << rt_buf[0].date << " " << rt_buf[0].time << std::endl;
-    }
-
-
-
-    /* Create the data space for the dataset. */
-    hsize_t dims;
-    H5T_class_t class_id;
-    size_t type_size;
-
-    std::string description, comment;
-    hid_t group_id = H5Gopen2(file_id, "/comment", H5P_DEFAULT);
-    status = H5Lexists(group_id, "/comment/description", 0);
-    if (status==1) {
-        status = H5LTget_dataset_info( file_id, "/comment/description", &dims, &class_id, &type_size );
-        if (status >= 0) {
-            description.resize( type_size );
-            status = H5LTread_dataset_string (file_id, "/comment/description", &description[0]);
-            if (status < 0) {
-                std::string errorMsg("Exception while reading description in stfio::importHDF5File");
-                throw std::runtime_error(errorMsg);
-            }
-        }
-    }
-    ReturnData.SetFileDescription(description);
-    
-    status = H5Lexists(group_id, "/comment/comment", 0);
-    if (status==1) {
-        status = H5LTget_dataset_info( file_id, "/comment/comment", &dims, &class_id, &type_size );
-        if (status >= 0) {
-            comment.resize( type_size );
-            status = H5LTread_dataset_string (file_id, "/comment/comment", &comment[0]);
-            if (status < 0) {
-                std::string errorMsg("Exception while reading comment in stfio::importHDF5File");
-                throw std::runtime_error(errorMsg);
-            }
-        }
-    }
-    ReturnData.SetComment(comment);
+    int numberChannels = readFileDescription(file_id, ReturnData);
 
     double dt = 1.0;
     std::string yunits = "";
     for (int n_c=0;n_c<numberChannels;++n_c) {
-        /* Calculate the size and the offsets of our struct members in memory */
-        size_t ct_offset[NFIELDS] = { HOFFSET( ct, n_sections ) };
-        ct ct_buf[1];
-        size_t ct_sizes[NFIELDS] = { sizeof( ct_buf[0].n_sections) };
-
-        /* Read channel name */
-        hsize_t cdims;
-        H5T_class_t cclass_id;
-        size_t ctype_size;
-        std::ostringstream desc_path;
-        desc_path << "/channels/ch" << (n_c);
-        status = H5LTget_dataset_info( file_id, desc_path.str().c_str(), &cdims, &cclass_id, &ctype_size );
-        if (status < 0) {
-            std::string errorMsg("Exception while reading channel in stfio::importHDF5File");
-            throw std::runtime_error(errorMsg);
-        }
-        hid_t string_typec= H5Tcopy( H5T_C_S1 );
-        H5Tset_size( string_typec,  ctype_size );
-        std::vector<char> szchannel_name(ctype_size);
-        // szchannel_name.reset( new char[ctype_size] );
-        status = H5LTread_dataset(file_id, desc_path.str().c_str(), string_typec, &szchannel_name[0] );
-        if (status < 0) {
-            std::string errorMsg("Exception while reading channel name in stfio::importHDF5File");
-            throw std::runtime_error(errorMsg);
-        }
-        std::ostringstream channel_name;
-        for (std::size_t c=0; c<ctype_size; ++c) {
-            channel_name << szchannel_name[c];
-        }
+        std::string channel_name = readChannelName(file_id, n_c);
+        std::string channel_path = "/" + channel_name;
 
-        std::ostringstream channel_path;
-        channel_path << "/" << channel_name.str();
+        hid_t channel_group = H5Gopen2(file_id, channel_path.c_str(), H5P_DEFAULT );
+        int n_sections = readChannelDescription(channel_group);
+        Channel TempChannel(n_sections);
+        TempChannel.SetChannelName( channel_name );
+        int max_log10 = maxLog10(n_sections);
 
-        hid_t channel_group = H5Gopen2(file_id, channel_path.str().c_str(), H5P_DEFAULT );
-        status=H5TBread_table( channel_group, "description", sizeof(ct), ct_offset, ct_sizes, ct_buf );
-        if (status < 0) {
-            std::string errorMsg("Exception while reading channel description in stfio::importHDF5File");
-            throw std::runtime_error(errorMsg);
-        }
-        Channel TempChannel(ct_buf[0].n_sections);
-        TempChannel.SetChannelName( channel_name.str() );
-        int max_log10 = 0;
-        if (ct_buf[0].n_sections > 1) {
-            max_log10 = int(log10((double)ct_buf[0].n_sections-1.0));
-        }
-
-        for (int n_s=0; n_s < ct_buf[0].n_sections; ++n_s) {
+        for (int n_s=0; n_s < n_sections; ++n_s) {
             int progbar =
                 // Channel contribution:
                 (int)(((double)n_c/(double)numberChannels)*100.0+
                       // Section contribution:
-                      (double)(n_s)/(double)ct_buf[0].n_sections*(100.0/numberChannels));
+                      (double)(n_s)/(double)n_sections*(100.0/numberChannels));
             std::ostringstream progStr;
             progStr << "Reading channel #" << n_c + 1 << " of " << numberChannels
-                    << ", Section #" << n_s+1 << " of " << ct_buf[0].n_sections;
+                    << ", Section #" << n_s+1 << " of " << n_sections;
             progDlg.Update(progbar, progStr.str());
             
-            // construct a number with leading zeros:
-            int n10 = 0;
-            if (n_s > 0) {
-                n10 = int(log10((double)n_s));
-            }
-            std::ostringstream strZero; strZero << "";
-            for (int n_z=n10; n_z < max_log10; ++n_z) {
-                strZero << "0";
-            }
-
             // construct a section name:
             std::ostringstream section_name;
             section_name << "sec" << n_s;
 
             // create a child group in the channel:
-            std::ostringstream section_path;
-            section_path << channel_path.str() << "/" << "section_" << strZero.str() << n_s;
-            hid_t section_group = H5Gopen2(file_id, section_path.str().c_str(), H5P_DEFAULT );
+            std::string section_path = sectionPath(channel_path, n_s, max_log10);
+            hid_t section_group = H5Gopen2(file_id, section_path.c_str(), H5P_DEFAULT );
 
-            std::ostringstream data_path; data_path << section_path.str() << "/data";
-            hsize_t sdims;
-            H5T_class_t sclass_id;
-            size_t stype_size;
-            status = H5LTget_dataset_info( file_id, data_path.str().c_str(), &sdims, &sclass_id, &stype_size );
-            if (status < 0) {
-                std::string errorMsg("Exception while reading data information in stfio::importHDF5File");
-                throw std::runtime_error(errorMsg);
-            }
-            Vector_float TempSection(sdims);
-            status = H5LTread_dataset(file_id, data_path.str().c_str(), H5T_IEEE_F32LE, &TempSection[0]);
-            if (status < 0) {
-                std::string errorMsg("Exception while reading data in stfio::importHDF5File");
-                throw std::runtime_error(errorMsg);
-            }
+            Vector_float TempSection = readSectionData(file_id, section_path);
 
             Section TempSectionT(TempSection.size(), section_name.str());
             for (std::size_t cp = 0; cp < TempSectionT.size(); ++cp) {
@@ -473,26 +519,10 @@ void stfio::importHDF5File(const std::string& fName, Recording& ReturnData, Prog
                 throw;
             }
 
-
-            /* H5TBread_table
-               const int NSRECORDS = 1; */
-            const int NSFIELDS    = 3;
-
-            /* Calculate the size and the offsets of our struct members in memory */
-            size_t st_offset[NSFIELDS] = {  HOFFSET( st, dt ),
-                                            HOFFSET( st, xunits ),
-                                            HOFFSET( st, yunits )};
-            st st_buf[1];
-            size_t st_sizes[NSFIELDS] = { sizeof( st_buf[0].dt),
-                                          sizeof( st_buf[0].xunits),
-                                          sizeof( st_buf[0].yunits)};
-            status=H5TBread_table( section_group, "description", sizeof(st), st_offset, st_sizes, st_buf );
-            if (status < 0) {
-                std::string errorMsg("Exception while reading data description in stfio::importHDF5File");
-                throw std::runtime_error(errorMsg);
-            }
-            dt = st_buf[0].dt;
-            yunits = st_buf[0].yunits;
+            st st_buf;
+            readSectionDescription(section_group, st_buf);
+            dt = st_buf.dt;
+            yunits = st_buf.yunits;
             H5Gclose( section_group );
         }
         try {
@@ -510,19 +540,104 @@ void stfio::importHDF5File(const std::string& fName, Recording& ReturnData, Prog
     }
     ReturnData.SetXScale(dt);
     /* Terminate access to the file. */
-    status = H5Fclose(file_id);
+    herr_t status = H5Fclose(file_id);
     if (status < 0) {
         std::string errorMsg("Exception while closing file in stfio::importHDF5File");
         throw std::runtime_error(errorMsg);
     }
+}
 
-    /* Release all hdf5 resources */
-    status = H5close();
-    if (status < 0) {
-        std::string errorMsg("Exception while closing file in stfio::exportHDF5File");
-        throw std::runtime_error(errorMsg);
+namespace {
+
+// Keeps a HDF5 file open and reads sections when they are requested.
+class HDF5LazyFile : public stfio::LazyFile {
+  public:
+    HDF5LazyFile(const std::string& fName);
+    ~HDF5LazyFile();
+
+    void ReadSection(std::size_t n_c, std::size_t n_s, Section& ReturnSection);
+
+  private:
+    hid_t file_id;
+    std::vector<std::string> channel_paths;
+    std::vector<int> max_log10s;
+};
+
+HDF5LazyFile::HDF5LazyFile(const std::string& fName)
+    : file_id(H5Fopen(fName.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT))
+{
+    if (file_id < 0) {
+        throw std::runtime_error("Couldn't open file in stfio::openLazyHDF5File");
     }
-    
+    try {
+        int numberChannels = readFileDescription(file_id, header);
+        header.resize(numberChannels);
+
+        double dt = 1.0;
+        for (int n_c=0; n_c < numberChannels; ++n_c) {
+            std::string channel_name = readChannelName(file_id, n_c);
+            std::string channel_path = "/" + channel_name;
+
+            hid_t channel_group = H5Gopen2(file_id, channel_path.c_str(), H5P_DEFAULT );
+            int n_sections = 0;
+            try {
+                n_sections = readChannelDescription(channel_group);
+            } catch (...) {
+                H5Gclose( channel_group );
+                throw;
+            }
+            H5Gclose( channel_group );
+
+            Channel TempChannel(n_sections);
+            TempChannel.SetChannelName( channel_name );
+            for (int n_s=0; n_s < n_sections; ++n_s) {
+                std::ostringstream section_name;
+                section_name << "sec" << n_s;
+                TempChannel[n_s].SetSectionDescription(section_name.str());
+            }
+            int max_log10 = maxLog10(n_sections);
+
+            // Units and sampling interval are stored with every section;
+            // the importer uses the values of the last one.
+            if (n_sections > 0) {
+                std::string section_path = sectionPath(channel_path, n_sections-1, max_log10);
+                hid_t section_group = H5Gopen2(file_id, section_path.c_str(), H5P_DEFAULT );
+                st st_buf;
+                try {
+                    readSectionDescription(section_group, st_buf);
+                } catch (...) {
+                    H5Gclose( section_group );
+                    throw;
+                }
+                H5Gclose( section_group );
+                dt = st_buf.dt;
+                TempChannel.SetYUnits( st_buf.yunits );
+            }
+            header.InsertChannel(TempChannel, n_c);
+            channel_paths.push_back(channel_path);
+            max_log10s.push_back(max_log10);
+        }
+        header.SetXScale(dt);
+    } catch (...) {
+        H5Fclose(file_id);
+        throw;
+    }
+}
+
+HDF5LazyFile::~HDF5LazyFile() {
+    H5Fclose(file_id);
 }
 
+void HDF5LazyFile::ReadSection(std::size_t n_c, std::size_t n_s, Section& ReturnSection) {
+    CheckRange(n_c, n_s);
+    Vector_float TempSection =
+        readSectionData(file_id, sectionPath(channel_paths[n_c], n_s, max_log10s[n_c]));
+    ReturnSection = header[n_c][n_s];
+    ReturnSection.get_w().assign(TempSection.begin(), TempSection.end());
+}
 
+}
+
+stfio::LazyFile* stfio::openLazyHDF5File(const std::string& fName) {
+    return new HDF5LazyFile(fName);
+}
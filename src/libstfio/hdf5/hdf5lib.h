@@ -41,6 +41,19 @@ void importHDF5File(const std::string& fName, Recording& ReturnData, ProgressInf
  */
 StfioDll  bool exportHDF5File(const std::string& fName, const Recording& WData, ProgressInfo& progDlg);
 
+//! Export sections to a HDF5 file one at a time.
+/*! \param fName Full path to the file to be written.
+ *  \param source The sections to be exported.
+ *  \return true upon success.
+ */
+StfioDll  bool exportHDF5File(const std::string& fName, SectionReader& source, ProgressInfo& progDlg);
+
+//! Open a HDF5 file for on-demand reading of its sections.
+/*! \param fName Full path to the file to be read.
+ *  \return A new LazyFile that has to be deleted by the caller.
+ */
+LazyFile* openLazyHDF5File(const std::string& fName);
+
 }
 
 #endif
@@ -34,6 +34,8 @@
 #include <sstream>
 #include <vector>
 #include <algorithm> //required for std::swap
+#include <cstring>
+#include <cmath>
 
 #include "./hekalib.h"
 #include "../recording.h"
@@ -727,109 +729,93 @@ std::string time2date(double t) {
     return datestr;
 }
 
-void ReadData(FILE* fh, const Tree& tree, Recording& RecordingInOut,
-              stfio::ProgressInfo& progDlg)
-{
-
-    int nsweeps = tree.SweepList.size();
-    int ntraces = tree.TraceList.size();
-
-    int nchannels = ntraces/nsweeps;
-    RecordingInOut.resize(nchannels);
-    int res = 0;
-    for (int nc=0; nc<nchannels; ++nc) {
-        RecordingInOut[nc].resize(nsweeps);
-        for (int ns=0; ns<nsweeps; ++ns) {
-            // nstree=nc; nstree<ntraces; nstree += nchannels) {
-            // int ns = nstree/nchannels;
-            int nstree = (ns*nchannels)+nc;
-            int progbar =
-                // Channel contribution:
-                (int)(((double)nc/(double)nchannels)*100.0+
-                      // Section contribution:
-                      (double)ns/(double)nsweeps*(100.0/nchannels));
-            std::ostringstream progStr;
-            progStr << "Reading channel #" << nc + 1 << " of " << nchannels
-                    << ", Section #" << ns + 1 << " of " << nsweeps;
-            bool skip = false;
-            progDlg.Update(progbar, progStr.str(), &skip);
-            if (skip) {
-                RecordingInOut.resize(0);
-                return;
-            }
-
-            int npoints = tree.TraceList[nstree].TrDataPoints;
-            RecordingInOut[nc][ns].resize(npoints);
-
-            fseek(fh, tree.TraceList[nstree].TrData, SEEK_SET);
-            switch (int(tree.TraceList[nstree].TrDataFormat)) {
-             case 0: {
-                 /*int16*/
-                 std::vector<short> tmpSection(npoints);
-                 res = fread(&tmpSection[0], sizeof(short), npoints, fh);
-                 if (res != npoints)
-                     throw std::runtime_error("getBundleHeader: Error in fread()");
-                 if (tree.needsByteSwap) 
-                     std::for_each(tmpSection.begin(), tmpSection.end(), ShortByteSwap);
-
-                 std::copy(tmpSection.begin(), tmpSection.end(), RecordingInOut[nc][ns].get_w().begin());
-                 break;
-             }
-             case 1: {
-                 /*int32*/
-                 std::vector<int> tmpSection(npoints);
-                 res = fread(&tmpSection[0], sizeof(int), npoints, fh);
-                 if (res != npoints)
-                     throw std::runtime_error("getBundleHeader: Error in fread()");
-                 if (tree.needsByteSwap) 
-                     std::for_each(tmpSection.begin(), tmpSection.end(), IntByteSwap);
-                 std::copy(tmpSection.begin(), tmpSection.end(), RecordingInOut[nc][ns].get_w().begin());
-                 break;
+// The selected traces of a file, ordered by channel and section:
+// traces[n_c][n_s] is an index into Tree::TraceList, or -1 if
+// sweep n_s has no trace for channel n_c.
+typedef std::vector< std::vector<int> > TraceTable;
+
+TraceTable selectTraces(const Tree& tree, const stfio::ImportFilter& filter) {
+    // the tree is stored depth-first, so that the traces of a sweep
+    // follow the sweep record
+    std::vector< std::vector<int> > sweeps;
+    int ngroup = -1, nseries = -1;
+    bool selected = false;
+    for (std::size_t n=0; n<tree.entries.size(); ++n) {
+        switch (tree.entries[n].level) {
+         case group:
+             ++ngroup;
+             nseries = -1;
+             break;
+         case series:
+             ++nseries;
+             selected = (filter.group < 0 || filter.group == ngroup) &&
+                        (filter.series < 0 || filter.series == nseries);
+             break;
+         case sweep:
+             if (selected) {
+                 sweeps.push_back(std::vector<int>());
              }
-             case 2: {
-                 /*double16*/
-                 std::vector<float> tmpSection(npoints);
-                 res = fread(&tmpSection[0], sizeof(float), npoints, fh);
-                 if (res != npoints)
-                     throw std::runtime_error("getBundleHeader: Error in fread()");
-                 if (tree.needsByteSwap) 
-                     std::for_each(tmpSection.begin(), tmpSection.end(), FloatByteSwap);
-                 std::copy(tmpSection.begin(), tmpSection.end(), RecordingInOut[nc][ns].get_w().begin());
-                 break;
+             break;
+         case trace:
+             if (selected && !sweeps.empty()) {
+                 sweeps.back().push_back(tree.entries[n].idx);
              }
-             case 3: {
-                 /*double32*/
-                 std::vector<double> tmpSection(npoints);
-                 res = fread(&tmpSection[0], sizeof(double), npoints, fh);
-                 if (res != npoints)
-                     throw std::runtime_error("getBundleHeader: Error in fread()");
-                 if (tree.needsByteSwap) 
-                     std::for_each(tmpSection.begin(), tmpSection.end(), DoubleByteSwap);
-                 std::copy(tmpSection.begin(), tmpSection.end(), RecordingInOut[nc][ns].get_w().begin());
-                 break;
-             }
-             default:
-                 throw std::runtime_error("Unknown data format while reading heka file");
-            }
-            double factor = 1.0;
-            if (std::string(tree.TraceList[nc].TrYUnit) == "V") {
-                RecordingInOut[nc].SetYUnits("mV");
-                factor = 1.0e3;
-            } else if (std::string(tree.TraceList[nc].TrYUnit) == "A") {
-                RecordingInOut[nc].SetYUnits("pA");
-                factor = 1.0e12;
-            } else {
-                RecordingInOut[nc].SetYUnits(tree.TraceList[nc].TrYUnit);
+             break;
+         default:
+             break;
+        }
+    }
+
+    std::size_t nchannels = 0;
+    for (std::size_t ns=0; ns<sweeps.size(); ++ns) {
+        nchannels = std::max(nchannels, sweeps[ns].size());
+    }
+    std::vector<int> channels = filter.SelectChannels((int)nchannels);
+    int firstSweep = 0, endSweep = 0;
+    filter.SelectSweeps((int)sweeps.size(), firstSweep, endSweep);
+
+    TraceTable traces(channels.size(), std::vector<int>(endSweep-firstSweep, -1));
+    for (std::size_t nc=0; nc<channels.size(); ++nc) {
+        for (int ns=firstSweep; ns<endSweep; ++ns) {
+            if (channels[nc] < (int)sweeps[ns].size()) {
+                traces[nc][ns-firstSweep] = sweeps[ns][channels[nc]];
             }
-            factor *=  tree.TraceList[nc].TrDataScaler;
-            RecordingInOut[nc][ns].get_w() = stfio::vec_scal_mul(RecordingInOut[nc][ns].get(), factor);
-            RecordingInOut[nc][ns].get_w() = stfio::vec_scal_plus(RecordingInOut[nc][ns].get(), tree.TraceList[nc].TrZeroData);
         }
-        RecordingInOut[nc].SetChannelName(tree.TraceList[nc].TrLabel);
-        
     }
+    return traces;
+}
+
+// Returns the first trace of a channel
+const TraceRecord* firstTrace(const Tree& tree, const std::vector<int>& channel) {
+    for (std::size_t ns=0; ns<channel.size(); ++ns) {
+        if (channel[ns] >= 0) {
+            return &tree.TraceList[channel[ns]];
+        }
+    }
+    return NULL;
+}
+
+// Returns the factor that converts the stored values of a trace to
+// mV or pA, and the units after the conversion
+double traceFactor(const TraceRecord& trace, std::string& yunits) {
+    std::string units(trace.TrYUnit, strnlen(trace.TrYUnit, sizeof(trace.TrYUnit)));
+    double factor = 1.0;
+    if (units == "V") {
+        yunits = "mV";
+        factor = 1.0e3;
+    } else if (units == "A") {
+        yunits = "pA";
+        factor = 1.0e12;
+    } else {
+        yunits = units;
+    }
+    return factor * trace.TrDataScaler;
+}
+
+// Returns the sampling interval of a trace in ms
+double traceXInterval(const TraceRecord& trace) {
     double tsc = 1.0;
-    std::string xunits(tree.TraceList[0].TrXUnit);
+    std::string xunits(trace.TrXUnit, strnlen(trace.TrXUnit, sizeof(trace.TrXUnit)));
     if (xunits == "s") {
         tsc=1.0e3;
     } else if (xunits == "ms") {
@@ -839,91 +825,359 @@ void ReadData(FILE* fh, const Tree& tree, Recording& RecordingInOut,
     } else {
         throw std::runtime_error("Unsupported time units");
     }
-    RecordingInOut.SetXScale(tree.TraceList[0].TrXInterval*tsc);
+    return trace.TrXInterval*tsc;
+}
 
+// Sets channel names, units and the sampling interval, and creates
+// empty sections for all traces in the table. A Recording has a single
+// sampling interval, so all traces in the table must share it.
+void setHeader(const Tree& tree, const TraceTable& traces, Recording& RecordingInOut) {
+    RecordingInOut.resize(traces.size());
+    double dt = 0.0;
+    bool found = false;
+    for (std::size_t nc=0; nc<traces.size(); ++nc) {
+        RecordingInOut[nc].resize(traces[nc].size());
+        const TraceRecord* trace = firstTrace(tree, traces[nc]);
+        if (trace == NULL) {
+            continue;
+        }
+        std::string yunits;
+        traceFactor(*trace, yunits);
+        RecordingInOut[nc].SetYUnits(yunits);
+        RecordingInOut[nc].SetChannelName(std::string(trace->TrLabel, strnlen(trace->TrLabel, sizeof(trace->TrLabel))));
+
+        for (std::size_t ns=0; ns<traces[nc].size(); ++ns) {
+            if (traces[nc][ns] < 0) {
+                continue;
+            }
+            double traceDt = traceXInterval(tree.TraceList[traces[nc][ns]]);
+            if (!found) {
+                dt = traceDt;
+                found = true;
+            } else if (fabs(traceDt-dt) > 1.0e-9*fabs(dt)) {
+                throw std::runtime_error("The selected HEKA traces have different sampling rates;\n"
+                                         "select a single series to read them");
+            }
+        }
+    }
+    if (found) {
+        RecordingInOut.SetXScale(dt);
+    }
 }
 
-void stfio::importHEKAFile(const std::string &fName, Recording &ReturnData, ProgressInfo& progDlg) {
-    std::string warnStr("Warning: HEKA support is experimental.\n" \
-        "Please check sampling rate and report errors to\nchristsc_at_gmx.de." );
-    progDlg.Update(0, warnStr);
+// A trace that is read from the data file
+struct TraceJob {
+    long offset;     // position in the file
+    int npoints;
+    int format;      // TrDataFormat
+    double factor;   // scaling including unit conversion
+    double offset0;  // TrZeroData
+    double* dest;
+};
 
-    std::string errorMsg("Exception while calling importHEKAFile():\n");
+bool compareOffsets(const TraceJob& a, const TraceJob& b) {
+    return a.offset < b.offset;
+}
+
+int formatSize(int format) {
+    switch (format) {
+     case 0: return sizeof(short);  /*int16*/
+     case 1: return sizeof(int);    /*int32*/
+     case 2: return sizeof(float);  /*double16*/
+     case 3: return sizeof(double); /*double32*/
+     default:
+         throw std::runtime_error("Unknown data format while reading heka file");
+    }
+}
+
+TraceJob makeJob(const TraceRecord& trace) {
+    TraceJob job;
+    job.offset = trace.TrData;
+    job.npoints = trace.TrDataPoints;
+    job.format = int(trace.TrDataFormat);
+    formatSize(job.format); // throws on unknown formats
     std::string yunits;
-    int res = 0;
-    
-    // Open file
-    FILE* dat_fh = fopen(fName.c_str(), "rb");
-    
-    if (dat_fh==NULL) {
-        return;
+    job.factor = traceFactor(trace, yunits);
+    job.offset0 = trace.TrZeroData;
+    job.dest = NULL;
+    return job;
+}
+
+// Byte-swaps, converts and scales a trace in a single pass
+template <typename T>
+void decodeTrace(const char* src, bool needsByteSwap, const TraceJob& job) {
+    double* dest = job.dest;
+    T value;
+    if (needsByteSwap) {
+        for (int n=0; n<job.npoints; ++n) {
+            memcpy(&value, src+n*sizeof(T), sizeof(T));
+            ByteSwap((unsigned char *) &value, sizeof(T));
+            dest[n] = value*job.factor + job.offset0;
+        }
+    } else {
+        for (int n=0; n<job.npoints; ++n) {
+            memcpy(&value, src+n*sizeof(T), sizeof(T));
+            dest[n] = value*job.factor + job.offset0;
+        }
     }
+}
+
+void decodeTrace(const char* src, bool needsByteSwap, const TraceJob& job) {
+    switch (job.format) {
+     case 0: decodeTrace<short>(src, needsByteSwap, job); break;
+     case 1: decodeTrace<int>(src, needsByteSwap, job); break;
+     case 2: decodeTrace<float>(src, needsByteSwap, job); break;
+     case 3: decodeTrace<double>(src, needsByteSwap, job); break;
+    }
+}
 
+// Traces that are closer than this are read with a single fread()
+const long MAX_READ_GAP = 65536;
+// Upper limit for the size of a single read
+const long MAX_READ_SIZE = 16*1024*1024;
+
+void ReadData(FILE* fh, const Tree& tree, const TraceTable& traces, const stfio::ImportFilter& filter,
+              Recording& RecordingInOut, stfio::ProgressInfo& progDlg)
+{
+    setHeader(tree, traces, RecordingInOut);
+
+    std::vector<TraceJob> jobs;
+    for (std::size_t nc=0; nc<traces.size(); ++nc) {
+        for (std::size_t ns=0; ns<traces[nc].size(); ++ns) {
+            if (traces[nc][ns] < 0) {
+                continue;
+            }
+            TraceJob job = makeJob(tree.TraceList[traces[nc][ns]]);
+            if (job.npoints <= 0) {
+                continue;
+            }
+            // only the samples within the time window are read
+            std::size_t first = 0, end = 0;
+            filter.SelectSamples(job.npoints, RecordingInOut.GetXScale(), first, end);
+            job.offset += (long)first*formatSize(job.format);
+            job.npoints = (int)(end-first);
+            if (job.npoints <= 0) {
+                continue;
+            }
+            RecordingInOut[nc][ns].resize(job.npoints);
+            job.dest = &RecordingInOut[nc][ns][0];
+            jobs.push_back(job);
+        }
+    }
+
+    // Read traces in file order, and merge neighbouring traces into one read
+    std::sort(jobs.begin(), jobs.end(), compareOffsets);
+    std::vector<char> buffer;
+    std::size_t njob = 0;
+    while (njob < jobs.size()) {
+        long readStart = jobs[njob].offset;
+        long readEnd = readStart + (long)jobs[njob].npoints*formatSize(jobs[njob].format);
+        std::size_t lastJob = njob+1;
+        for (; lastJob < jobs.size(); ++lastJob) {
+            long jobEnd = jobs[lastJob].offset + (long)jobs[lastJob].npoints*formatSize(jobs[lastJob].format);
+            if (jobs[lastJob].offset > readEnd + MAX_READ_GAP ||
+                std::max(readEnd, jobEnd) - readStart > MAX_READ_SIZE) {
+                break;
+            }
+            readEnd = std::max(readEnd, jobEnd);
+        }
+
+        int progbar = (int)(100.0*njob/jobs.size());
+        std::ostringstream progStr;
+        progStr << "Reading trace #" << njob + 1 << " of " << jobs.size();
+        bool skip = false;
+        progDlg.Update(progbar, progStr.str(), &skip);
+        if (skip) {
+            RecordingInOut.resize(0);
+            return;
+        }
+
+        buffer.resize(readEnd-readStart);
+        fseek(fh, readStart, SEEK_SET);
+        std::size_t res = fread(&buffer[0], 1, buffer.size(), fh);
+        if (res != buffer.size())
+            throw std::runtime_error("ReadData: Error in fread()");
+
+        // Sweeps don't depend on each other
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+        for (int n=(int)njob; n<(int)lastJob; ++n) {
+            decodeTrace(&buffer[jobs[n].offset-readStart], tree.needsByteSwap, jobs[n]);
+        }
+        njob = lastJob;
+    }
+}
+
+// Closes a file when it goes out of scope
+class FileCloser {
+ public:
+    explicit FileCloser(FILE* fh) : m_fh(fh) {}
+    ~FileCloser() { if (m_fh != NULL) fclose(m_fh); }
+ private:
+    FileCloser(const FileCloser&);
+    FileCloser& operator=(const FileCloser&);
+    FILE* m_fh;
+};
+
+// Reads the bundle header and the pulse tree of an open file
+Tree readBundleTree(FILE* dat_fh) {
     BundleHeader header = getBundleHeader(dat_fh);
     bool needsByteSwap = (int(header.oIsLittleEndian[0]) == 0);
     if (needsByteSwap) {
         SwapHeader(header);
     }
 
-    int start = 0;
-    bool isBundled = false;
-    if (std::string(header.oSignature)=="DAT2") {
-        // find the pulse data
-        isBundled = true;
-        int extNo = findExt(header, ".pul");
-        if (extNo < 0) {
-            throw std::runtime_error("Couldn't find .pul file in bundle");
-        }
-        start = header.oBundleItems[extNo].oStart;
-    } else {
+    if (std::string(header.oSignature, strnlen(header.oSignature, sizeof(header.oSignature))) != "DAT2") {
         throw std::runtime_error("Can only deal with bundled data at present");
     }
+    // find the pulse data
+    int extNo = findExt(header, ".pul");
+    if (extNo < 0) {
+        throw std::runtime_error("Couldn't find .pul file in bundle");
+    }
+    if (findExt(header, ".dat") < 0) {
+        throw std::runtime_error("Couldn't find .dat file in bundle");
+    }
+    int start = header.oBundleItems[extNo].oStart;
 
     // Base of tree
     fseek(dat_fh, start, SEEK_SET);
     char cMagic[4];
-    res = fread(&cMagic[0], sizeof(char), 4, dat_fh);
+    int res = fread(&cMagic[0], sizeof(char), 4, dat_fh);
     if (res != 4)
-        throw std::runtime_error("getBundleHeader: Error in fread()");
-    std::string magic(cMagic);
+        throw std::runtime_error("readBundleTree: Error in fread()");
+    std::string magic(cMagic, 4);
+    if (magic != "Tree" && magic != "eerT") {
+        throw std::runtime_error("Couldn't find the pulse tree in bundle");
+    }
     int levels = 0;
     res = fread(&levels, sizeof(int), 1, dat_fh);
     if (res != 1)
-        throw std::runtime_error("getBundleHeader: Error in fread()");
+        throw std::runtime_error("readBundleTree: Error in fread()");
     if (needsByteSwap) {
         ByteSwap32(levels);
     }
+    if (levels <= trace || levels > 16) {
+        throw std::runtime_error("Unexpected number of levels in pulse tree");
+    }
 
     std::vector<int> sizes(levels);
-    if (levels!=0)
-        res = fread(&sizes[0], sizeof(int), levels, dat_fh);
-
+    res = fread(&sizes[0], sizeof(int), levels, dat_fh);
+    if (res != levels)
+        throw std::runtime_error("readBundleTree: Error in fread()");
     if (needsByteSwap)
         std::for_each(sizes.begin(), sizes.end(), IntByteSwap);
 
     // Get the tree from the pulse file
     int pos = ftell(dat_fh);
-    Tree tree = getTree(dat_fh, sizes, pos, needsByteSwap);
-    std::string date = ""; //time2date(tree.RootList[0].RoStartTime);
-
-    if (isBundled) {
-        // find the data
-        int extNo = findExt(header, ".dat");
-        if (extNo < 0) {
-            throw std::runtime_error("Couldn't find .dat file in bundle");
-        }
-        start = header.oBundleItems[extNo].oStart;
-    } else {
-        throw std::runtime_error("Can only deal with bundled data at present");
+    return getTree(dat_fh, sizes, pos, needsByteSwap);
+}
+
+bool stfio::isHEKABundle(const std::string& fName) {
+    FILE* fh = fopen(fName.c_str(), "rb");
+    if (fh == NULL) {
+        return false;
     }
+    char signature[4];
+    bool isBundle = (fread(signature, sizeof(char), 4, fh) == 4 &&
+                     std::string(signature, 4) == "DAT2");
+    fclose(fh);
+    return isBundle;
+}
 
-    // Now set pointer to the start of the data
-    fseek(dat_fh, start, SEEK_SET);
+void stfio::importHEKAFile(const std::string &fName, Recording &ReturnData, ProgressInfo& progDlg,
+                           const ImportFilter& filter) {
+    std::string warnStr("Warning: HEKA support is experimental.\n" \
+        "Please check sampling rate and report errors to\nchristsc_at_gmx.de." );
+    progDlg.Update(0, warnStr);
+
+    // Open file
+    FILE* dat_fh = fopen(fName.c_str(), "rb");
+    if (dat_fh==NULL) {
+        throw std::runtime_error("Couldn't open " + fName);
+    }
+    FileCloser closer(dat_fh);
+
+    Tree tree = readBundleTree(dat_fh);
 
     // NOW IMPORT
-    ReadData(dat_fh, tree, ReturnData, progDlg);
+    ReadData(dat_fh, tree, selectTraces(tree, filter), filter, ReturnData, progDlg);
+}
+
+namespace {
+
+// Keeps a HEKA bundle open and reads a single trace when its section
+// is requested.
+class HEKALazyFile : public stfio::LazyFile {
+  public:
+    explicit HEKALazyFile(FILE* fh);
+    ~HEKALazyFile();
+
+    void ReadSection(std::size_t n_c, std::size_t n_s, Section& ReturnSection);
+
+  private:
+    FILE* m_fh;
+    Tree m_tree;
+    TraceTable m_traces;
+    std::vector<char> m_buffer;
+};
+
+HEKALazyFile::HEKALazyFile(FILE* fh)
+    : m_fh(fh), m_tree(readBundleTree(fh)), m_traces(), m_buffer()
+{
+    m_traces = selectTraces(m_tree, stfio::ImportFilter());
+    setHeader(m_tree, m_traces, header);
+}
+
+HEKALazyFile::~HEKALazyFile() {
+    fclose(m_fh);
+}
+
+void HEKALazyFile::ReadSection(std::size_t n_c, std::size_t n_s, Section& ReturnSection) {
+    CheckRange(n_c, n_s);
+    ReturnSection = header[n_c][n_s];
+    if (m_traces[n_c][n_s] < 0) {
+        return;
+    }
+    TraceJob job = makeJob(m_tree.TraceList[m_traces[n_c][n_s]]);
+    if (job.npoints <= 0) {
+        return;
+    }
+    m_buffer.resize((std::size_t)job.npoints*formatSize(job.format));
+    fseek(m_fh, job.offset, SEEK_SET);
+    if (fread(&m_buffer[0], 1, m_buffer.size(), m_fh) != m_buffer.size()) {
+        throw std::runtime_error("Exception while calling HEKALazyFile::ReadSection():\n"
+                                 "Error in fread()");
+    }
+    ReturnSection.resize(job.npoints);
+    job.dest = &ReturnSection[0];
+    decodeTrace(&m_buffer[0], m_tree.needsByteSwap, job);
+}
 
-    // Close file
-    fclose(dat_fh);
 }
 
+stfio::LazyFile* stfio::openLazyHEKAFile(const std::string& fName) {
+    FILE* dat_fh = fopen(fName.c_str(), "rb");
+    if (dat_fh==NULL) {
+        throw std::runtime_error("Couldn't open " + fName);
+    }
+    try {
+        return new HEKALazyFile(dat_fh);
+    }
+    catch (...) {
+        fclose(dat_fh);
+        throw;
+    }
+}
+
+void stfio::probeHEKAFile(const std::string& fName, Recording& ReturnData) {
+    FILE* dat_fh = fopen(fName.c_str(), "rb");
+    if (dat_fh==NULL) {
+        throw std::runtime_error("Couldn't open " + fName);
+    }
+    FileCloser closer(dat_fh);
+
+    Tree tree = readBundleTree(dat_fh);
+    setHeader(tree, selectTraces(tree, ImportFilter()), ReturnData);
+}
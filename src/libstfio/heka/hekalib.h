@@ -36,12 +36,46 @@ class Recording;
 namespace stfio {
 
 //! Open an HEKA file and store its contents to a Recording object.
-/*! \param fName The full path to the file to be opened.
+/*! Only bundled files (DAT2) can be read. Channels correspond to the
+ *  traces of a sweep; sweeps of all selected groups and series are
+ *  concatenated. Throws std::runtime_error if the file can't be read or
+ *  if the selected traces have different sampling intervals.
+ *  \param fName The full path to the file to be opened.
  *  \param ReturnData On entry, an empty Recording object. On exit,
  *         the data stored in \e fName.
  *  \param progress True if the progress dialog should be updated.
+ *  \param filter The groups, series, channels, sweeps and time window to
+ *         be read. Only the samples of the selected traces are read from
+ *         the file. Throws std::out_of_range if a selected channel doesn't exist.
  */
-    void importHEKAFile(const std::string& fName, Recording& ReturnData, ProgressInfo& progDlg);
+    void importHEKAFile(const std::string& fName, Recording& ReturnData, ProgressInfo& progDlg,
+                        const ImportFilter& filter = ImportFilter());
+
+//! Reads the channels and sections of a HEKA file without reading its data.
+/*! Only the bundle header and the pulse tree are read.
+ *  Throws std::runtime_error if the file can't be read or if its traces
+ *  have different sampling intervals.
+ *  \param fName The full path to the file to be opened.
+ *  \param ReturnData On exit, a Recording with the channel names and units,
+ *         the sampling interval and the correct number of (empty) sections.
+ */
+    void probeHEKAFile(const std::string& fName, Recording& ReturnData);
+
+//! Opens a HEKA file for on-demand reading of its sections.
+/*! Only the bundle header and the pulse tree are read when the file is
+ *  opened; each section is read from its trace offset when it is
+ *  requested. Throws std::runtime_error if the file can't be read or if
+ *  its traces have different sampling intervals.
+ *  \param fName The full path to the file to be opened.
+ *  \return A new LazyFile that has to be deleted by the caller.
+ */
+    LazyFile* openLazyHEKAFile(const std::string& fName);
+
+//! Checks whether a file is a bundled HEKA file.
+/*! \param fName The full path to the file.
+ *  \return true if the file starts with the DAT2 bundle signature.
+ */
+    bool isHEKABundle(const std::string& fName);
 
 }
 
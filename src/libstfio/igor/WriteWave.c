@@ -142,16 +142,17 @@ WriteVersion2NumericWave(CP_FILE_REF fr, WaveHeader2* whp, const void* data, con
 	return err;
 }
 
-/*	WriteVersion5NumericWave(fr, whp, data, waveNote, noteSize)
+/*	WriteVersion5NumericWaveHeader(fr, whp, noteSize)
 
-	Writes an Igor version 5 binary wave with the properties specified in
-	whp, the data specified by data, and the wave note specified by waveNote
-	and noteSize.
+	Writes the binary header and the wave header of an Igor version 5 binary
+	wave with the properties specified in whp. The whp->npnts points of wave
+	data and the wave note of size noteSize have to be written directly
+	afterwards, in this order.
 	
 	Returns 0 or an error code.
 */
 int
-WriteVersion5NumericWave(CP_FILE_REF fr, WaveHeader5* whp, const void* data, const char* waveNote, long noteSize)
+WriteVersion5NumericWaveHeader(CP_FILE_REF fr, WaveHeader5* whp, long noteSize)
 {
         unsigned long numBytesToWrite;
 	unsigned long numBytesWritten;
@@ -216,9 +217,34 @@ WriteVersion5NumericWave(CP_FILE_REF fr, WaveHeader5* whp, const void* data, con
 		err = CPWriteFile(fr, numBytesToWrite, whp, &numBytesWritten);
 		if (err)
 			break;
+	} while(0);
+
+	return err;
+}
+
+/*	WriteVersion5NumericWave(fr, whp, data, waveNote, noteSize)
+
+	Writes an Igor version 5 binary wave with the properties specified in
+	whp, the data specified by data, and the wave note specified by waveNote
+	and noteSize.
+	
+	Returns 0 or an error code.
+*/
+int
+WriteVersion5NumericWave(CP_FILE_REF fr, WaveHeader5* whp, const void* data, const char* waveNote, long noteSize)
+{
+	unsigned long numBytesToWrite;
+	unsigned long numBytesWritten;
+	int err;
+
+	do {
+		// Write the BinHeader and the WaveHeader.
+		err = WriteVersion5NumericWaveHeader(fr, whp, noteSize);
+		if (err)
+			break;
 		
 		// Write the wave data.
-		numBytesToWrite = waveDataSize;
+		numBytesToWrite = whp->npnts * NumBytesPerPoint(whp->type);
 		err = CPWriteFile(fr, numBytesToWrite, data, &numBytesWritten);
 		if (err)
 			break;
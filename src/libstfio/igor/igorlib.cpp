@@ -45,7 +45,7 @@ extern "C" {
 #include "../igor/IgorBin.h"
 #include "../igor/CrossPlatformFileIO.h"
 
-    int WriteVersion5NumericWave(CP_FILE_REF fr, WaveHeader5* whp, const void* data, const char* waveNote, long noteSize);
+    int WriteVersion5NumericWaveHeader(CP_FILE_REF fr, WaveHeader5* whp, long noteSize);
 
 #ifdef __cplusplus
 }
@@ -59,6 +59,9 @@ namespace stfio {
 // Check compatibility before exporting:
 bool CheckComp(const Recording& ReturnData);
 
+// Get unambiguous channel names:
+std::vector<std::string> IGORChannelNames(const Recording& Data);
+
 }
 
 std::string
@@ -88,18 +91,8 @@ stfio::CheckComp(const Recording& Data) {
     return true;
 }
 
-bool
-stfio::exportIGORFile(const std::string& fileBase,const Recording& Data, ProgressInfo& progDlg)
-{
-    // Check compatibility:
-    if (!CheckComp(Data)) {
-        throw std::runtime_error(
-                "File can't be exported:\n"
-                "Traces have different sizes"
-        );
-    }
-
-    // Get unambiguous channel names:
+std::vector<std::string>
+stfio::IGORChannelNames(const Recording& Data) {
     std::vector<std::string> channel_name(Data.size());
     bool ident=false;
     for (std::size_t n_c=0;n_c<Data.size()-1 && !ident; ++n_c) {
@@ -119,9 +112,53 @@ stfio::exportIGORFile(const std::string& fileBase,const Recording& Data, Progres
     } else {
         channel_name[Data.size()-1]=Data[Data.size()-1].GetChannelName();
     }
+    return channel_name;
+}
+
+std::vector<std::string>
+stfio::IGORFileNames(const std::string& fileBase, const Recording& Data) {
+    std::vector<std::string> channel_name = IGORChannelNames(Data);
+    std::vector<std::string> fileNames(channel_name.size());
+    for (std::size_t n_c=0;n_c<channel_name.size();++n_c) {
+        fileNames[n_c] = fileBase + "_" + channel_name[n_c] + ".ibw";
+    }
+    return fileNames;
+}
+
+bool
+stfio::exportIGORFile(const std::string& fileBase,const Recording& Data, ProgressInfo& progDlg)
+{
+    // Check compatibility:
+    if (!CheckComp(Data)) {
+        throw std::runtime_error(
+                "File can't be exported:\n"
+                "Traces have different sizes"
+        );
+    }
+    SectionReader source(Data);
+    return exportIGORFile(fileBase, source, progDlg);
+}
+
+bool
+stfio::exportIGORFile(const std::string& fileBase, SectionReader& source, ProgressInfo& progDlg)
+{
+    const Recording& Data = source.GetHeader();
+
+    std::vector<std::string> channel_name = IGORChannelNames(Data);
+    std::vector<std::string> fileNames = IGORFileNames(fileBase, Data);
 
     // Export channels individually:
     for (std::size_t n_c=0;n_c<Data.size();++n_c) {
+        if (Data[n_c].size() == 0) {
+            throw std::runtime_error(
+                    "File can't be exported:\n"
+                    "Traces have different sizes"
+            );
+        }
+        // The wave dimensions are taken from the first section; all other
+        // sections are checked while they are written.
+        std::size_t nPoints = source.Read(n_c, 0).size();
+
         unsigned IGORLONG now;
         now = 0;			// It would be possible to write a Windows equivalent for the Macintosh GetDateTime function but it is not easy.
 
@@ -135,8 +172,8 @@ stfio::exportIGORFile(const std::string& fileBase,const Recording& Data, Progres
             strcpy(wh.dataUnits, Data[n_c].GetYUnits().c_str());
         if (Data.GetXUnits().length() < MAX_UNIT_CHARS+1)
             strcpy(wh.dimUnits[0], Data.GetXUnits().c_str());
-        wh.npnts = (IGORLONG)(Data[n_c][0].size()*Data[n_c].size());
-        wh.nDim[0] = (IGORLONG)Data[n_c][0].size();
+        wh.npnts = (IGORLONG)(nPoints*Data[n_c].size());
+        wh.nDim[0] = (IGORLONG)nPoints;
         wh.nDim[1] = (IGORLONG)Data[n_c].size();
         wh.sfA[0] = Data.GetXScale();
         wh.sfB[0] = 0.0e0;								// Starting from zero.
@@ -146,28 +183,23 @@ stfio::exportIGORFile(const std::string& fileBase,const Recording& Data, Progres
         std::string waveNote("Wave exported from Stimfit");
 
         // Create a file:
-        std::stringstream filePath;
-        filePath 
-            << fileBase
-            << "_" << channel_name[n_c] << ".ibw";
-        int err = CPCreateFile(filePath.str().c_str(), 1);
+        const std::string& filePath = fileNames[n_c];
+        int err = CPCreateFile(filePath.c_str(), 1);
         if (err) {
             throw std::runtime_error(IGORError("Error in CPCreateFile()\n", err));
         }
 
         // Open the file:
         CP_FILE_REF fr;
-        err = CPOpenFile(filePath.str().c_str(), 1, &fr);
+        err = CPOpenFile(filePath.c_str(), 1, &fr);
         if (err) {
             throw std::runtime_error(IGORError("Error in CPOpenFile()\n", err));
         }
 
-        // Write the data:
-        Vector_double cpData(wh.npnts);
-
-        // One unnecessary copy operation due to const-correctness (couldn't const_cast<>)
-        Channel TempChannel(Data[n_c]);
-        for (std::size_t n_s=0;n_s<Data[n_c].size();++n_s) {
+        // Write the headers, then the sections one by one straight from the
+        // section data, and finally the wave note:
+        err = WriteVersion5NumericWaveHeader( fr, &wh, (long)waveNote.length() );
+        for (std::size_t n_s=0;n_s<Data[n_c].size() && !err;++n_s) {
             std::ostringstream progStr;
             progStr << "Writing channel #" << (int)n_c + 1 << " of " << (int)Data.size()
                     << ", Section #" << (int)n_s+1 << " of " << (int)Data[n_c].size();
@@ -179,19 +211,27 @@ stfio::exportIGORFile(const std::string& fileBase,const Recording& Data, Progres
                     progStr.str()
             );
 
-            // std::copy is faster than explicitly assigning to cpData[c][s][p]
-            if (n_s*wh.nDim[0]+Data[n_c][n_s].size() > cpData.size() ||
-                Data[n_c][n_s].size() > TempChannel[n_s].size()) {
-                    throw std::out_of_range("Out of range exception in WriteVersion5NumericWave");
+            const Section& sec = source.Read(n_c, n_s);
+            if (sec.size() != nPoints) {
+                CPCloseFile(fr);
+                remove(filePath.c_str());
+                throw std::runtime_error(
+                        "File can't be exported:\n"
+                        "Traces have different sizes"
+                );
             }
-            std::copy( TempChannel[n_s].get_w().begin(), 
-                       TempChannel[n_s].get_w().begin()+Data[n_c][n_s].size(),
-                       &cpData[n_s*wh.nDim[0]] );
+            unsigned long numBytesWritten = 0;
+            if (nPoints > 0) {
+                err = CPWriteFile(fr, (unsigned long)(nPoints*sizeof(double)), &sec.get()[0], &numBytesWritten);
+            }
+        }
+        if (!err) {
+            unsigned long numBytesWritten = 0;
+            err = CPWriteFile(fr, (unsigned long)waveNote.length(), waveNote.c_str(), &numBytesWritten);
         }
-        err=WriteVersion5NumericWave( fr, &wh, &cpData[0], waveNote.c_str(),
-                                      (long)waveNote.length() );
         if (err)
         {
+            CPCloseFile(fr);
             throw std::runtime_error( std::string(IGORError("Error in WriteVersion5NumericWave()\n", err).c_str()) );
         }
         CPCloseFile(fr);
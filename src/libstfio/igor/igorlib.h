@@ -36,6 +36,26 @@ namespace stfio {
 StfioDll bool
     exportIGORFile(const std::string& fName, const Recording& WData, ProgressInfo& progDlg);
 
+//! Export sections to Igor binary waves one at a time.
+/*! All sections of a channel need to have the same size; otherwise,
+ *  the incomplete wave is deleted and std::runtime_error is thrown.
+ *  \param fName Full path to the file to be written.
+ *  \param source The sections to be exported.
+ *  \return At present, always returns true.
+ */
+StfioDll bool
+    exportIGORFile(const std::string& fName, SectionReader& source, ProgressInfo& progDlg);
+
+//! Returns the names of the files that exportIGORFile() writes.
+/*! One file is written for each channel. Its name is made up of \e fName
+ *  and the channel name, or the channel index if names are ambiguous.
+ *  \param fName Full path to the file to be written, as passed to exportIGORFile().
+ *  \param Data The data to be exported; only the channel names are used.
+ *  \return The full paths of the files, one per channel.
+ */
+StfioDll std::vector<std::string>
+    IGORFileNames(const std::string& fName, const Recording& Data);
+
 }
 
 #endif
@@ -25,6 +25,8 @@ as of 2016-11-05
 */
 
 #include <vector>
+#include <algorithm>
+#include <cstring>
 
 #include "intanlib.h"
 #include "streams.h"
@@ -185,56 +187,115 @@ IntanHeader read_header(BinaryReader& binreader) {
     return hIntan;
 }
 
-std::vector<std::vector<float> > read_data(BinaryReader& binreader, const IntanHeader& hIntan) {
-    uint64_t bytes_remaining = binreader.bytesRemaining();
-    uint64_t length = bytes_remaining / (4+4+4+4);
-    std::vector<uint32_t> timestamps(length);
-    std::vector<float> applied(length);
-    std::vector<float> totalClamp(length);
-    std::vector<std::vector<float> > channels(2);
-    channels[0].resize(length);
-    channels[1].resize(length);
-    for (unsigned int idata = 0; idata < length; ++idata) {
-        binreader >> timestamps[idata];
-        binreader >> applied[idata]; 
-        binreader >> channels[1][idata];
-        binreader >> channels[0][idata];
-        float vfactor = 1e3; // V -> mV
-        float ifactor = 1e12; // A -> pA
-        if (hIntan.Settings.isVoltageClamp) {
-            channels[0][idata] *= ifactor;
-            channels[1][idata] *= vfactor;
-        } else {
-            channels[1][idata] *= ifactor;
-            channels[0][idata] *= vfactor;
+namespace {
+
+// Number of records that are decoded per block read
+const uint64_t BLOCK_RECORDS = 65536;
+
+// Data are stored in little-endian byte order
+inline uint32_t read_le_uint32(const unsigned char* data) {
+    return data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+inline uint16_t read_le_uint16(const unsigned char* data) {
+    return data[0] | (data[1] << 8);
+}
+
+inline float read_le_float(const unsigned char* data) {
+    uint32_t tmp = read_le_uint32(data);
+    float value;
+    memcpy(&value, &tmp, sizeof(value));
+    return value;
+}
+
+}
+
+void read_data(BinaryReader& binreader, const IntanHeader& hIntan,
+               Vector_double& channel0, Vector_double& channel1)
+{
+    const uint64_t recordSize = 4+4+4+4; // timestamp, applied, channel 1, channel 0
+    uint64_t length = binreader.bytesRemaining() / recordSize;
+    channel0.resize(length);
+    channel1.resize(length);
+
+    const float vfactor = 1e3; // V -> mV
+    const float ifactor = 1e12; // A -> pA
+    const float factor0 = hIntan.Settings.isVoltageClamp ? ifactor : vfactor;
+    const float factor1 = hIntan.Settings.isVoltageClamp ? vfactor : ifactor;
+
+    // Decode blocks of records straight into the channels; timestamps
+    // and applied values are not used.
+    std::vector<unsigned char> buffer(std::min(length, BLOCK_RECORDS)*recordSize);
+    for (uint64_t start = 0; start < length; start += BLOCK_RECORDS) {
+        uint64_t nrecords = std::min(length-start, BLOCK_RECORDS);
+        binreader.read(reinterpret_cast<char*>(&buffer[0]), (int)(nrecords*recordSize));
+        const unsigned char* record = &buffer[0];
+        double* data0 = &channel0[start];
+        double* data1 = &channel1[start];
+        for (uint64_t idata = 0; idata < nrecords; ++idata, record += recordSize) {
+            data1[idata] = read_le_float(record+8) * factor1;
+            data0[idata] = read_le_float(record+12) * factor0;
         }
     }
-
-    return channels;
 }
 
-std::vector<std::vector<float> > read_aux_data(BinaryReader& binreader, uint16_t numADCs) {
-    uint64_t bytes_remaining = binreader.bytesRemaining();
-    uint64_t length = bytes_remaining / (4+2+2+2*numADCs);
-    std::vector<uint32_t> timestamps(length);
-    std::vector<uint16_t> digitalIn(length);
-    std::vector<uint16_t> digitalOut(length);
-    std::vector<std::vector<float> > adc(numADCs);
-    for (unsigned int iadc = 0; iadc < numADCs; ++iadc) {
-        adc[iadc].resize(length);
+void read_aux_data(BinaryReader& binreader, uint16_t numADCs, Vector_double& adc0) {
+    if (numADCs == 0) {
+        throw std::runtime_error("File contains no ADC channels");
     }
-    for (unsigned int idata = 0; idata < length; ++idata) {
-        binreader >> timestamps[idata];
-        binreader >> digitalIn[idata]; 
-        binreader >> digitalOut[idata];
-        for (unsigned int iadc = 0; iadc < numADCs; ++iadc) {
-            uint16_t tmpui;
-            binreader >> tmpui;
-            adc[iadc][idata] = tmpui*0.0003125 - (1<<15);
+    const uint64_t recordSize = 4+2+2+2*numADCs; // timestamp, digital in, digital out, ADCs
+    uint64_t length = binreader.bytesRemaining() / recordSize;
+    adc0.resize(length);
+
+    // Only the first ADC channel is imported
+    std::vector<unsigned char> buffer(std::min(length, BLOCK_RECORDS)*recordSize);
+    for (uint64_t start = 0; start < length; start += BLOCK_RECORDS) {
+        uint64_t nrecords = std::min(length-start, BLOCK_RECORDS);
+        binreader.read(reinterpret_cast<char*>(&buffer[0]), (int)(nrecords*recordSize));
+        const unsigned char* record = &buffer[0];
+        double* data = &adc0[start];
+        for (uint64_t idata = 0; idata < nrecords; ++idata, record += recordSize) {
+            data[idata] = (float)(read_le_uint16(record+8)*0.0003125 - (1<<15));
         }
     }
+}
+
+void stfio::probeIntanFile(const std::string &fName, Recording &ReturnData) {
+    unique_ptr<FileInStream> fs(new FileInStream());
+
+#ifdef _WINDOWS
+    std::wstring wfName(fName.begin(), fName.end());
+#else
+    std::string wfName(fName);
+#endif
+
+    fs->open(wfName);
 
-    return adc;
+    unique_ptr<BinaryReader> binreader(new BinaryReader(move(fs)));
+
+    IntanHeader hIntan = read_header(*binreader);
+    if (hIntan.datatype == 0) {
+        ReturnData.resize(2);
+        ReturnData.SetXScale(1e3/hIntan.Settings.samplingRate);
+        ReturnData.SetXUnits("ms");
+        int mon = hIntan.date_Month-1;
+        int year = hIntan.date_Year - 1900;
+        ReturnData.SetDateTime(year, mon, hIntan.date_Day,
+                               hIntan.date_Hour, hIntan.date_Minute, hIntan.date_Second);
+        for (unsigned int nchan = 0; nchan < ReturnData.size(); ++nchan) {
+            ReturnData[nchan].resize(1);
+        }
+        if (hIntan.Settings.isVoltageClamp) {
+            ReturnData[0].SetYUnits("pA");
+            ReturnData[1].SetYUnits("mV");
+        } else {
+            ReturnData[1].SetYUnits("pA");
+            ReturnData[0].SetYUnits("mV");
+        }
+    } else {
+        ReturnData.resize(1);
+        ReturnData[0].resize(1);
+    }
 }
 
 void stfio::importIntanFile(const std::string &fName, Recording &ReturnData, ProgressInfo& progDlg) {
@@ -252,15 +313,14 @@ void stfio::importIntanFile(const std::string &fName, Recording &ReturnData, Pro
 
     IntanHeader hIntan = read_header(*binreader);
     if (hIntan.datatype == 0) {
-        std::vector<std::vector<float> > channels = read_data(*binreader, hIntan);
-        ReturnData.resize(channels.size());
+        ReturnData.resize(2);
         ReturnData.SetXScale(1e3/hIntan.Settings.samplingRate);
         ReturnData.SetXUnits("ms");
         int mon = hIntan.date_Month-1;
         int year = hIntan.date_Year - 1900;
         ReturnData.SetDateTime(year, mon, hIntan.date_Day,
                                hIntan.date_Hour, hIntan.date_Minute, hIntan.date_Second);
-        for (unsigned int nchan = 0; nchan < channels.size(); ++nchan) {
+        for (unsigned int nchan = 0; nchan < ReturnData.size(); ++nchan) {
             // ReturnData[nchan].resize(hIntan.Settings.waveform.size());
             ReturnData[nchan].resize(1);
         }
@@ -272,11 +332,7 @@ void stfio::importIntanFile(const std::string &fName, Recording &ReturnData, Pro
             ReturnData[0].SetYUnits("mV");
         }
         unsigned int nsec = 0;
-        for (unsigned int nchan = 0; nchan < channels.size(); ++nchan) {
-            ReturnData[nchan][nsec].resize(channels[nchan].size());
-            std::copy(channels[nchan].begin(), channels[nchan].end(),
-                      ReturnData[nchan][nsec].get_w().begin());
-        }
+        read_data(*binreader, hIntan, ReturnData[0][nsec].get_w(), ReturnData[1][nsec].get_w());
 
         // for (std::vector<Segment>::const_iterator it = hIntan.Settings.waveform.begin();
         //      it != hIntan.Settings.waveform.end();
@@ -291,11 +347,9 @@ void stfio::importIntanFile(const std::string &fName, Recording &ReturnData, Pro
         // }
 
     } else {
-        std::vector<std::vector<float> > aux_data = read_aux_data(*binreader, hIntan.numADCs);
         ReturnData.resize(1);
         ReturnData[0].resize(1);
-        ReturnData[0][0].resize(aux_data[0].size());
-        std::copy(aux_data[0].begin(), aux_data[0].end(), ReturnData[0][0].get_w().begin());
+        read_aux_data(*binreader, hIntan.numADCs, ReturnData[0][0].get_w());
     }
 
 }
@@ -140,5 +140,12 @@ namespace stfio {
  */
     void importIntanFile(const std::string &fName, Recording &ReturnData, ProgressInfo& progDlg);
 
+//! Read the metadata of an Intan CLAMP file without reading any data.
+/*! \param fName The full path to the file to be opened.
+ *  \param ReturnData On entry, an empty Recording object. On exit,
+ *         the channels, sections and attributes of \e fName. All sections are empty.
+ */
+    void probeIntanFile(const std::string &fName, Recording &ReturnData);
+
 }
 #endif
\ No newline at end of file
@@ -92,6 +92,9 @@ public:
     uint64_t bytesRemaining() { return other->bytesRemaining();  }
     std::istream::pos_type currentPos() { return other->currentPos(); }
 
+    // Reads len raw bytes without any conversion
+    int read(char* data, int len) { return other->read(data, len); }
+
 protected:
     friend BinaryReader& operator>>(BinaryReader& istream, int32_t& value);
     friend BinaryReader& operator>>(BinaryReader& istream, uint32_t& value);
@@ -383,12 +383,15 @@ void Recording::AddRec(const Recording &toAdd) {
 }
 
 
-std::string Recording::GetEventDescription(int type) {
+std::string Recording::GetEventDescription(int type) const {
+    if (type < 0 || type >= 256) {
+        return std::string();
+    }
     return listOfMarkers[type];
 }
 
 void Recording::SetEventDescription(int type, const char* Description) {
-    listOfMarkers[type] = Description;
+    listOfMarkers[type] = (Description != NULL) ? Description : "";
 }
 
 void Recording::InitSectionMarkerList(size_t n) {
@@ -396,7 +399,11 @@ void Recording::InitSectionMarkerList(size_t n) {
     return;
 }
 
-int Recording::GetSectionType(size_t section_number) {
+int Recording::GetSectionType(size_t section_number) const {
+    // files that don't store section types have an empty marker list
+    if (section_number >= sectionMarker.size()) {
+        return 0;
+    }
     return sectionMarker[section_number];
 }
 
@@ -368,7 +368,9 @@ class StfioDll Recording {
     const Channel& operator[](std::size_t at) const { return ChannelArray[at]; }
 
     //! Get Description of Event Type
-    std::string GetEventDescription(int type);
+    /*! \return The description, or an empty string if none has been set.
+     */
+    std::string GetEventDescription(int type) const;
 
     //! Set Description of Event Type
     void SetEventDescription(int type, const char* Description);
@@ -377,7 +379,12 @@ class StfioDll Recording {
     void InitSectionMarkerList(size_t n);
 
     //! Get Type of Section
-    int GetSectionType(size_t section_number);
+    /*! \return The type of the section, or 0 if no type has been set.
+     */
+    int GetSectionType(size_t section_number) const;
+
+    //! Number of sections in the list of section markers
+    std::size_t GetSectionMarkerCount() const { return sectionMarker.size(); }
 
     //! Set Type of Section
     void SetSectionType(size_t section_number, int type);
@@ -412,7 +419,7 @@ class StfioDll Recording {
     Vector_double selectBase;
     
     // defined when data is loaded
-    const char* listOfMarkers[256];
+    std::string listOfMarkers[256];
 
     /* SectionMarker contains, for each section, it's type
        as defined event table. 
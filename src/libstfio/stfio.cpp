@@ -24,11 +24,19 @@
 // Copyright 2012 Alois Schloegl, IST Austria <alois.schloegl@ist.ac.at>
 
 
+#include <algorithm>
 #include <sstream>
+#include <stdexcept>
+
+#if defined(_WIN32)
+  #include <windows.h>
+#else
+  #include <pthread.h>
+#endif
 
 #include "stfio.h"
 
-// TODO #include "./ascii/asciilib.h"
+#include "./ascii/asciilib.h"
 #include "./hdf5/hdf5lib.h"
 #include "./abf/abflib.h"
 #include "./atf/atflib.h"
@@ -39,6 +47,7 @@
 #endif
 #include "./cfs/cfslib.h"
 #include "./intan/intanlib.h"
+#include "./cache/cachelib.h"
 #ifndef TEST_MINIMAL
   #include "./heka/hekalib.h"
 #else
@@ -61,6 +70,141 @@
     }
 #endif
 
+namespace {
+    // Libraries that keep global state (file tables, error buffers) and
+    // must not be entered from several threads at once.
+    stfio::Mutex axonMutex; // ATF file descriptor table (ATF export only)
+    stfio::Mutex cfsMutex;  // CFS file info table
+    stfio::Mutex hdf5Mutex; // HDF5 is only reentrant in thread-safe builds
+
+    stfio::Mutex cacheMutex; // guards cacheDirectory
+    std::string cacheDirectory;
+}
+
+stfio::Mutex::Mutex()
+{
+#if defined(_WIN32)
+    CRITICAL_SECTION* cs = new CRITICAL_SECTION;
+    InitializeCriticalSection(cs);
+    m_handle = cs;
+#else
+    // writers lock their library's mutex and may read from a LazyFile
+    // that locks the same mutex
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_t* mutex = new pthread_mutex_t;
+    pthread_mutex_init(mutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+    m_handle = mutex;
+#endif
+}
+
+stfio::Mutex::~Mutex()
+{
+#if defined(_WIN32)
+    CRITICAL_SECTION* cs = static_cast<CRITICAL_SECTION*>(m_handle);
+    DeleteCriticalSection(cs);
+    delete cs;
+#else
+    pthread_mutex_t* mutex = static_cast<pthread_mutex_t*>(m_handle);
+    pthread_mutex_destroy(mutex);
+    delete mutex;
+#endif
+}
+
+void stfio::Mutex::Lock()
+{
+#if defined(_WIN32)
+    EnterCriticalSection(static_cast<CRITICAL_SECTION*>(m_handle));
+#else
+    pthread_mutex_lock(static_cast<pthread_mutex_t*>(m_handle));
+#endif
+}
+
+void stfio::Mutex::Unlock()
+{
+#if defined(_WIN32)
+    LeaveCriticalSection(static_cast<CRITICAL_SECTION*>(m_handle));
+#else
+    pthread_mutex_unlock(static_cast<pthread_mutex_t*>(m_handle));
+#endif
+}
+
+namespace {
+
+// Function and argument of a stfio::Thread
+struct ThreadStart {
+    ThreadStart(void (*f)(void*), void* a) : function(f), arg(a) {}
+
+    void (*function)(void*);
+    void* arg;
+};
+
+#if defined(_WIN32)
+DWORD WINAPI threadMain(LPVOID param) {
+#else
+void* threadMain(void* param) {
+#endif
+    ThreadStart* start = static_cast<ThreadStart*>(param);
+    start->function(start->arg);
+    delete start;
+#if defined(_WIN32)
+    return 0;
+#else
+    return NULL;
+#endif
+}
+
+}
+
+stfio::Thread::Thread()
+    : m_handle(NULL)
+{}
+
+stfio::Thread::~Thread()
+{
+    Join();
+}
+
+bool stfio::Thread::Start(void (*function)(void*), void* arg)
+{
+    Join();
+    ThreadStart* start = new ThreadStart(function, arg);
+#if defined(_WIN32)
+    m_handle = CreateThread(NULL, 0, threadMain, start, 0, NULL);
+#else
+    pthread_t* thread = new pthread_t;
+    if (pthread_create(thread, NULL, threadMain, start) == 0) {
+        m_handle = thread;
+    } else {
+        delete thread;
+    }
+#endif
+    if (m_handle == NULL) {
+        delete start;
+        return false;
+    }
+    return true;
+}
+
+void stfio::Thread::Join()
+{
+    if (m_handle == NULL) {
+        return;
+    }
+#if defined(_WIN32)
+    HANDLE thread = static_cast<HANDLE>(m_handle);
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+#else
+    pthread_t* thread = static_cast<pthread_t*>(m_handle);
+    pthread_join(*thread, NULL);
+    delete thread;
+#endif
+    m_handle = NULL;
+}
+
 stfio::StdoutProgressInfo::StdoutProgressInfo(const std::string& title, const std::string& message, int maximum, bool verbose)
     : ProgressInfo(title, message, maximum, verbose),
       verbosity(verbose)
@@ -142,20 +286,92 @@ stfio::findExtension(stfio::filetype ftype) {
     }
 }
 
-bool stfio::importFile(
+bool stfio::ImportFilter::empty() const {
+    return channels.empty() && firstSweep <= 0 && lastSweep < 0 && group < 0 && series < 0 &&
+           tStart <= 0 && tEnd < 0;
+}
+
+std::vector<int> stfio::ImportFilter::SelectChannels(int nChannels) const {
+    if (channels.empty()) {
+        std::vector<int> all(nChannels);
+        for (int n_c=0; n_c < nChannels; ++n_c) {
+            all[n_c] = n_c;
+        }
+        return all;
+    }
+    for (std::size_t n=0; n < channels.size(); ++n) {
+        if (channels[n] < 0 || channels[n] >= nChannels) {
+            std::ostringstream errorMsg;
+            errorMsg << "Channel #" << channels[n] << " doesn't exist; the file has "
+                     << nChannels << " channels";
+            throw std::out_of_range(errorMsg.str());
+        }
+    }
+    return channels;
+}
+
+void stfio::ImportFilter::SelectSweeps(int nSweeps, int& first, int& end) const {
+    first = std::min(std::max(firstSweep, 0), nSweeps);
+    end = (lastSweep < 0) ? nSweeps : std::min(lastSweep+1, nSweeps);
+    if (end < first) {
+        end = first;
+    }
+}
+
+void stfio::ImportFilter::SelectSamples(std::size_t nSamples, double dt,
+                                        std::size_t& first, std::size_t& end) const {
+    first = 0;
+    end = nSamples;
+    if (dt <= 0) {
+        return;
+    }
+    // window boundaries are rounded to the nearest sample
+    if (tStart > 0) {
+        first = std::min(nSamples, (std::size_t)(tStart/dt + 0.5));
+    }
+    if (tEnd >= 0) {
+        end = std::min(nSamples, (std::size_t)(tEnd/dt + 0.5));
+    }
+    if (end < first) {
+        end = first;
+    }
+}
+
+namespace {
+
+bool importFileUncached(
         const std::string& fName,
         stfio::filetype type,
         Recording& ReturnData,
         const stfio::txtImportSettings& txtImport,
-        ProgressInfo& progDlg
+        stfio::ProgressInfo& progDlg
 ) {
     try {
 
+#ifndef TEST_MINIMAL
+        // HEKA bundles are read by the native reader, which reads the
+        // traces straight from the file; bundles it can't read, e.g.
+        // series with different sampling rates, are left to libbiosig
+        if (stfio::isHEKABundle(fName)) {
+            try {
+                stfio::importHEKAFile(fName, ReturnData, progDlg);
+                return true;
+            }
+            catch (const std::runtime_error&) {
+#if (!defined(WITH_BIOSIG) && !defined(WITH_BIOSIG2))
+                throw;
+#endif
+                // libbiosig may still be able to read the file
+                ReturnData.resize(0);
+            }
+        }
+#endif
+
 #if (defined(WITH_BIOSIG) || defined(WITH_BIOSIG2))
        // make use of automated file type identification
 
 #ifndef WITHOUT_ABF
-        if (!check_biosig_version(1,6,3)) {
+        if (!stfio::check_biosig_version(1,6,3)) {
             try {
                 // workaround for older versions of libbiosig
                 stfio::importABFFile(fName, ReturnData, progDlg);
@@ -182,13 +398,16 @@ bool stfio::importFile(
             }
         }
         catch (...) {
-                // this should never occur, importBiosigFile should always return without exception
-                std::cout << "importBiosigFile failed with an exception - this is a bug";
+                // importBiosigFile only throws if it has identified the file
+                // but can't read its data records
+                ReturnData.resize(0);
+                throw;
         }
 #endif
 
         switch (type) {
         case stfio::hdf5: {
+            stfio::MutexLocker lock(hdf5Mutex);
             stfio::importHDF5File(fName, ReturnData, progDlg);
             break;
         }
@@ -216,43 +435,23 @@ bool stfio::importFile(
 #ifndef TEST_MINIMAL
         case stfio::cfs: {
             {
-            int res = stfio::importCFSFile(fName, ReturnData, progDlg);
-         /*
-            // disable old Heka import - its broken and will not be fixed, use biosig instead
-            if (res==-7) {
-                stfio::importHEKAFile(fName, ReturnData, progDlg);
-            }
-         */
+            stfio::MutexLocker lock(cfsMutex);
+            // HEKA bundles with a CFS file name have been read above
+            stfio::importCFSFile(fName, ReturnData, progDlg);
           break;
             }
         }
-        /*
-	// disable old Heka import - its broken and will not be fixed, use biosig instead
         case stfio::heka: {
-            {
-                try {
-                    stfio::importHEKAFile(fName, ReturnData, progDlg);
-                } catch (const std::runtime_error& e) {
-                    stfio::importCFSFile(fName, ReturnData, progDlg);
-                }
-                break;
-            }
+            // bundles have been read above; this reports why the file
+            // can't be read
+            stfio::importHEKAFile(fName, ReturnData, progDlg);
+            break;
         }
-        */
 #endif // TEST_MINIMAL
 
-        default:
-            throw std::runtime_error("Unknown or unsupported file type");
-	}
-
-#if 0
-        case stfio::son: {
-            stfio::SON::importSONFile(fName,ReturnData);
-            break;
-        }
         case stfio::ascii: {
             stfio::importASCIIFile( fName, txtImport.hLines, txtImport.ncolumns,
-                    txtImport.firstIsTime, txtImport.toSection, ReturnData );
+                    txtImport.firstIsTime, txtImport.toSection, ReturnData, progDlg );
             if (!txtImport.firstIsTime) {
                 ReturnData.SetXScale(1.0/txtImport.sr);
             }
@@ -263,6 +462,16 @@ bool stfio::importFile(
             ReturnData.SetXUnits(txtImport.xUnits);
             break;
         }
+
+        default:
+            throw std::runtime_error("Unknown or unsupported file type");
+	}
+
+#if 0
+        case stfio::son: {
+            stfio::SON::importSONFile(fName,ReturnData);
+            break;
+        }
 #endif
     }
     catch (...) {
@@ -271,33 +480,76 @@ bool stfio::importFile(
     return true;
 }
 
-bool stfio::exportFile(const std::string& fName, stfio::filetype type, const Recording& Data,
-                       ProgressInfo& progDlg)
+}
+
+void stfio::SetCacheDirectory(const std::string& dir) {
+    stfio::MutexLocker lock(cacheMutex);
+    cacheDirectory = dir;
+}
+
+std::string stfio::GetCacheDirectory() {
+    stfio::MutexLocker lock(cacheMutex);
+    return cacheDirectory;
+}
+
+bool stfio::importFile(
+        const std::string& fName,
+        stfio::filetype type,
+        Recording& ReturnData,
+        const stfio::txtImportSettings& txtImport,
+        ProgressInfo& progDlg
+) {
+    // generic text files depend on the import settings
+    std::string cacheDir = GetCacheDirectory();
+    std::string cacheName;
+    if (!cacheDir.empty() && type != stfio::ascii) {
+        cacheName = stfio::cacheFileName(cacheDir, fName);
+    }
+    if (!cacheName.empty() && stfio::importCacheFile(cacheName, fName, ReturnData)) {
+        return true;
+    }
+
+    bool success = importFileUncached(fName, type, ReturnData, txtImport, progDlg);
+
+    // a cache that can't be written shouldn't affect the import
+    if (success && !cacheName.empty()) {
+        stfio::exportCacheFile(cacheName, fName, ReturnData);
+    }
+    return success;
+}
+
+namespace {
+
+bool exportSections(const std::string& fName, stfio::filetype type, stfio::SectionReader& source,
+                    stfio::ProgressInfo& progDlg)
 {
     try {
         switch (type) {
 #ifndef WITHOUT_ABF
         case stfio::atf: {
-            stfio::exportATFFile(fName, Data);
+            stfio::MutexLocker lock(axonMutex);
+            stfio::exportATFFile(fName, source);
             break;
         }
 #endif
 #if (defined(WITH_BIOSIG) || defined(WITH_BIOSIG2))
         case stfio::biosig: {
-            stfio::exportBiosigFile(fName, Data, progDlg);
+            stfio::exportBiosigFile(fName, source, progDlg);
             break;
         }
 #endif
         case stfio::cfs: {
-            stfio::exportCFSFile(fName, Data, progDlg);
+            stfio::MutexLocker lock(cfsMutex);
+            stfio::exportCFSFile(fName, source, progDlg);
             break;
         }
         case stfio::hdf5: {
-            stfio::exportHDF5File(fName, Data, progDlg);
+            stfio::MutexLocker lock(hdf5Mutex);
+            stfio::exportHDF5File(fName, source, progDlg);
             break;
         }
         case stfio::igor: {
-            stfio::exportIGORFile(fName, Data, progDlg);
+            stfio::exportIGORFile(fName, source, progDlg);
             break;
         }
         default:
@@ -310,6 +562,488 @@ bool stfio::exportFile(const std::string& fName, stfio::filetype type, const Rec
     return true;
 }
 
+}
+
+bool stfio::exportFile(const std::string& fName, stfio::filetype type, const Recording& Data,
+                       ProgressInfo& progDlg)
+{
+    stfio::SectionReader source(Data);
+    return exportSections(fName, type, source, progDlg);
+}
+
+void stfio::LazyFile::CheckRange(std::size_t n_c, std::size_t n_s) const {
+    if (n_c >= header.size() || n_s >= header[n_c].size()) {
+        throw std::out_of_range("Section index out of range in stfio::LazyFile::ReadSection()");
+    }
+}
+
+namespace {
+
+// Serializes all accesses to a LazyFile whose library keeps global state.
+class LockedLazyFile : public stfio::LazyFile {
+  public:
+    LockedLazyFile(stfio::LazyFile* file, stfio::Mutex& mutex)
+        : m_file(file), m_mutex(mutex)
+    {
+        header = m_file->GetHeader();
+    }
+
+    ~LockedLazyFile() {
+        stfio::MutexLocker lock(m_mutex);
+        delete m_file;
+    }
+
+    void ReadSection(std::size_t n_c, std::size_t n_s, Section& ReturnSection) {
+        stfio::MutexLocker lock(m_mutex);
+        m_file->ReadSection(n_c, n_s, ReturnSection);
+    }
+
+    stfio::Mutex& GetMutex() const { return m_mutex; }
+
+  private:
+    stfio::LazyFile* m_file;
+    stfio::Mutex& m_mutex;
+};
+
+// Fallback for file types that can't be read section by section:
+// the file is imported completely when it is opened.
+class ImportedLazyFile : public stfio::LazyFile {
+  public:
+    ImportedLazyFile(const std::string& fName, stfio::filetype type,
+                     const stfio::txtImportSettings& txtImport = stfio::txtImportSettings())
+    {
+        stfio::StdoutProgressInfo progDlg("File import", "Starting file import", 100, false);
+        stfio::importFile(fName, type, data, txtImport, progDlg);
+
+        header.resize(data.size());
+        for (std::size_t n_c=0; n_c < data.size(); ++n_c) {
+            Channel TempChannel(data[n_c].size());
+            for (std::size_t n_s=0; n_s < data[n_c].size(); ++n_s) {
+                TempChannel[n_s].SetSectionDescription(data[n_c][n_s].GetSectionDescription());
+            }
+            TempChannel.SetChannelName(data[n_c].GetChannelName());
+            header.InsertChannel(TempChannel, n_c);
+        }
+        header.CopyAttributes(data);
+        header.SetXUnits(data.GetXUnits());
+    }
+
+    void ReadSection(std::size_t n_c, std::size_t n_s, Section& ReturnSection) {
+        CheckRange(n_c, n_s);
+        ReturnSection = data[n_c][n_s];
+    }
+
+  private:
+    Recording data;
+};
+
+// Opens a file with one of the readers that only parse the file headers;
+// returns NULL if there is no such reader for the file type.
+stfio::LazyFile* openHeaderLazyFile(const std::string& fName, stfio::filetype type) {
+    switch (type) {
+    case stfio::hdf5: {
+        stfio::MutexLocker lock(hdf5Mutex);
+        return new LockedLazyFile(stfio::openLazyHDF5File(fName), hdf5Mutex);
+    }
+#ifndef WITHOUT_ABF
+    case stfio::abf:
+        return stfio::openLazyABFFile(fName);
+#endif
+#ifndef WITHOUT_AXG
+    case stfio::axg:
+        return stfio::openLazyAXGFile(fName);
+#endif
+#ifndef TEST_MINIMAL
+    case stfio::heka:
+        return stfio::openLazyHEKAFile(fName);
+#endif
+    default:
+        return NULL;
+    }
+}
+
+// Discards the samples of a section outside of the selected time window.
+void cropSection(Section& section, const stfio::ImportFilter& filter, double dt) {
+    std::size_t first = 0, end = 0;
+    filter.SelectSamples(section.size(), dt, first, end);
+    if (first == 0 && end == section.size()) {
+        return;
+    }
+    Vector_double& data = section.get_w();
+    data.erase(data.begin() + end, data.end());
+    data.erase(data.begin(), data.begin() + first);
+}
+
+// Reads the selected sections of a file.
+void readSelection(stfio::LazyFile& file, Recording& ReturnData,
+                   const stfio::ImportFilter& filter, stfio::ProgressInfo& progDlg)
+{
+    const Recording& header = file.GetHeader();
+    std::vector<int> channels = filter.SelectChannels((int)header.size());
+    ReturnData.resize(channels.size());
+    for (std::size_t n=0; n < channels.size(); ++n) {
+        const Channel& headerChannel = header[channels[n]];
+        int firstSweep = 0, endSweep = 0;
+        filter.SelectSweeps((int)headerChannel.size(), firstSweep, endSweep);
+        Channel TempChannel(endSweep-firstSweep);
+        for (int n_s=firstSweep; n_s < endSweep; ++n_s) {
+            int progbar = (int)(100.0*(n + (double)(n_s-firstSweep)/(endSweep-firstSweep))/channels.size());
+            std::ostringstream progStr;
+            progStr << "Reading channel #" << channels[n] + 1 << " of " << header.size()
+                    << ", Section #" << n_s + 1 << " of " << headerChannel.size();
+            progDlg.Update(progbar, progStr.str());
+            file.ReadSection(channels[n], n_s, TempChannel[n_s-firstSweep]);
+            cropSection(TempChannel[n_s-firstSweep], filter, header.GetXScale());
+        }
+        TempChannel.SetChannelName(headerChannel.GetChannelName());
+        ReturnData.InsertChannel(TempChannel, n);
+    }
+    ReturnData.CopyAttributes(header);
+    ReturnData.SetXUnits(header.GetXUnits());
+    for (std::size_t n=0; n < channels.size(); ++n) {
+        ReturnData[n].SetYUnits(header[channels[n]].GetYUnits());
+    }
+}
+
+// The mutex that a writer holds while it writes files of the given type
+stfio::Mutex* exportMutex(stfio::filetype type) {
+    switch (type) {
+    case stfio::atf: return &axonMutex;
+    case stfio::cfs: return &cfsMutex;
+    case stfio::hdf5: return &hdf5Mutex;
+    default: return NULL;
+    }
+}
+
+}
+
+// A section that is being read in a background thread
+struct stfio::SectionPrefetch {
+    SectionPrefetch(stfio::LazyFile* s, std::size_t c, std::size_t n, Section* d)
+        : source(s), n_c(c), n_s(n), dest(d), error(), failed(false), thread() {}
+
+    stfio::LazyFile* source;
+    std::size_t n_c, n_s;
+    Section* dest;
+    std::string error;
+    bool failed;
+    stfio::Thread thread;
+};
+
+namespace {
+
+void runPrefetch(void* arg) {
+    stfio::SectionPrefetch* prefetch = static_cast<stfio::SectionPrefetch*>(arg);
+    try {
+        prefetch->source->ReadSection(prefetch->n_c, prefetch->n_s, *prefetch->dest);
+    }
+    catch (const std::exception& e) {
+        prefetch->error = e.what();
+        prefetch->failed = true;
+    }
+    catch (...) {
+        prefetch->error = "Unknown error while reading a section";
+        prefetch->failed = true;
+    }
+}
+
+}
+
+stfio::SectionReader::SectionReader(const Recording& data)
+    : m_data(&data), m_source(NULL), m_prefetch(false), m_current(&m_buffers[0]),
+      m_last_c(0), m_last_s(0), m_previous_c(0), m_previous_s(0), m_pending(NULL)
+{}
+
+stfio::SectionReader::SectionReader(LazyFile& source, bool prefetch)
+    : m_data(NULL), m_source(&source), m_prefetch(prefetch), m_current(&m_buffers[0]),
+      m_last_c(0), m_last_s(0), m_previous_c(0), m_previous_s(0), m_pending(NULL)
+{}
+
+stfio::SectionReader::~SectionReader() {
+    if (m_pending != NULL) {
+        try {
+            FinishPrefetch(0, 0);
+        }
+        catch (...) {
+        }
+    }
+}
+
+const Recording& stfio::SectionReader::GetHeader() const {
+    return (m_data != NULL) ? *m_data : m_source->GetHeader();
+}
+
+const Section& stfio::SectionReader::Read(std::size_t n_c, std::size_t n_s) {
+    if (m_data != NULL) {
+        if (n_c >= m_data->size() || n_s >= (*m_data)[n_c].size()) {
+            throw std::out_of_range("Section index out of range in stfio::SectionReader::Read()");
+        }
+        return (*m_data)[n_c][n_s];
+    }
+
+    if (m_pending == NULL || !FinishPrefetch(n_c, n_s)) {
+        m_source->ReadSection(n_c, n_s, *m_current);
+    }
+    m_previous_c = m_last_c;
+    m_previous_s = m_last_s;
+    m_last_c = n_c;
+    m_last_s = n_s;
+
+    std::size_t next_c = 0, next_s = 0;
+    if (m_prefetch && NextSection(next_c, next_s)) {
+        StartPrefetch(next_c, next_s);
+    }
+    return *m_current;
+}
+
+bool stfio::SectionReader::NextSection(std::size_t& n_c, std::size_t& n_s) const {
+    const Recording& header = m_source->GetHeader();
+    if (m_last_c != m_previous_c) {
+        // sweep by sweep: all channels of a section before the next section
+        n_c = m_last_c+1;
+        n_s = m_last_s;
+        if (n_c >= header.size()) {
+            n_c = 0;
+            ++n_s;
+        }
+    } else {
+        // channel by channel
+        n_c = m_last_c;
+        n_s = m_last_s+1;
+        if (n_s >= header[n_c].size()) {
+            ++n_c;
+            n_s = 0;
+        }
+    }
+    return n_c < header.size() && n_s < header[n_c].size();
+}
+
+void stfio::SectionReader::StartPrefetch(std::size_t n_c, std::size_t n_s) {
+    Section* spare = (m_current == &m_buffers[0]) ? &m_buffers[1] : &m_buffers[0];
+    m_pending = new SectionPrefetch(m_source, n_c, n_s, spare);
+    if (!m_pending->thread.Start(runPrefetch, m_pending)) {
+        // the section is read when it is requested
+        delete m_pending;
+        m_pending = NULL;
+    }
+}
+
+bool stfio::SectionReader::FinishPrefetch(std::size_t n_c, std::size_t n_s) {
+    m_pending->thread.Join();
+    bool hit = (m_pending->n_c == n_c && m_pending->n_s == n_s);
+    bool failed = m_pending->failed;
+    std::string error = m_pending->error;
+    Section* dest = m_pending->dest;
+    delete m_pending;
+    m_pending = NULL;
+    if (!hit) {
+        return false;
+    }
+    if (failed) {
+        throw std::runtime_error(error);
+    }
+    m_current = dest;
+    return true;
+}
+
+bool stfio::exportFile(const std::string& fName, stfio::filetype type, LazyFile& source,
+                       ProgressInfo& progDlg, bool prefetch)
+{
+    // Writers hold the mutex of their library; a background thread that
+    // reads from a file of the same library would block until the export
+    // has finished.
+    LockedLazyFile* locked = dynamic_cast<LockedLazyFile*>(&source);
+    if (locked != NULL && exportMutex(type) == &locked->GetMutex()) {
+        prefetch = false;
+    }
+    stfio::SectionReader reader(source, prefetch);
+    return exportSections(fName, type, reader, progDlg);
+}
+
+stfio::LazyFile* stfio::openLazyFile(const std::string& fName, stfio::filetype type) {
+
+#ifndef TEST_MINIMAL
+    if (stfio::isHEKABundle(fName)) {
+        type = stfio::heka;
+    }
+#endif
+
+    // The native readers only parse the file headers, whereas libbiosig's
+    // sopen() decodes e.g. HEKA and AXG files completely; libbiosig is
+    // only asked if the file can't be read natively.
+    try {
+        stfio::LazyFile* file = openHeaderLazyFile(fName, type);
+        if (file != NULL) {
+            return file;
+        }
+    }
+    catch (const std::runtime_error&) {
+#if (!defined(WITH_BIOSIG) && !defined(WITH_BIOSIG2))
+        throw;
+#endif
+    }
+
+#if (defined(WITH_BIOSIG) || defined(WITH_BIOSIG2))
+    // make use of automated file type identification, as in importFile()
+    stfio::filetype type1 = stfio::none;
+    stfio::LazyFile* biosigFile = stfio::openLazyBiosigFile(fName, type1);
+    if (biosigFile != NULL) {
+        return biosigFile;
+    }
+    if (type1 != stfio::none && type1 != type) {
+        type = type1;
+        stfio::LazyFile* file = openHeaderLazyFile(fName, type);
+        if (file != NULL) {
+            return file;
+        }
+    }
+#endif
+
+    return new ImportedLazyFile(fName, type);
+}
+
+bool stfio::importFile(
+        const std::string& fName,
+        stfio::filetype type,
+        Recording& ReturnData,
+        const stfio::txtImportSettings& txtImport,
+        const stfio::ImportFilter& filter,
+        ProgressInfo& progDlg
+) {
+    if (filter.empty()) {
+        return importFile(fName, type, ReturnData, txtImport, progDlg);
+    }
+
+#ifndef TEST_MINIMAL
+    // only the selected traces of HEKA bundles are read
+    if (stfio::isHEKABundle(fName)) {
+        try {
+            stfio::importHEKAFile(fName, ReturnData, progDlg, filter);
+            return true;
+        }
+        catch (const std::runtime_error&) {
+#if (!defined(WITH_BIOSIG) && !defined(WITH_BIOSIG2))
+            throw;
+#endif
+            // libbiosig may still be able to read the file
+            ReturnData.resize(0);
+        }
+    }
+#endif
+
+#if (defined(WITH_BIOSIG) || defined(WITH_BIOSIG2))
+    // make use of automated file type identification, as in importFile()
+    stfio::filetype type1 = stfio::importBiosigFile(fName, ReturnData, progDlg, filter);
+    switch (type1) {
+    case stfio::biosig:
+        return true;
+    case stfio::none:
+        break;
+    default:
+        type = type1;
+    }
+#endif
+
+    switch (type) {
+#ifndef WITHOUT_ABF
+    case stfio::abf: {
+        stfio::importABFFile(fName, ReturnData, progDlg, filter);
+        for (std::size_t n_c=0; n_c < ReturnData.size(); ++n_c) {
+            for (std::size_t n_s=0; n_s < ReturnData[n_c].size(); ++n_s) {
+                cropSection(ReturnData[n_c][n_s], filter, ReturnData.GetXScale());
+            }
+        }
+        return true;
+    }
+#endif
+    case stfio::hdf5:
+#ifndef WITHOUT_AXG
+    case stfio::axg:
+#endif
+    {
+        // unselected sections are never read
+        stfio::LazyFile* file = stfio::openLazyFile(fName, type);
+        try {
+            readSelection(*file, ReturnData, filter, progDlg);
+        }
+        catch (...) {
+            delete file;
+            throw;
+        }
+        delete file;
+        return true;
+    }
+    default: {
+        ImportedLazyFile file(fName, type, txtImport);
+        readSelection(file, ReturnData, filter, progDlg);
+        return true;
+    }
+    }
+}
+
+stfio::FileInfo stfio::probeFile(const std::string& fName, stfio::filetype type) {
+    Recording header;
+#ifndef TEST_MINIMAL
+    if (stfio::isHEKABundle(fName)) {
+        type = stfio::heka;
+    }
+#endif
+    switch (type) {
+#ifndef TEST_MINIMAL
+    case stfio::cfs: {
+        stfio::MutexLocker lock(cfsMutex);
+        if (stfio::probeCFSFile(fName, header) != 0) {
+            throw std::runtime_error("Error while probing CFS file");
+        }
+        break;
+    }
+#endif
+    case stfio::intan:
+        stfio::probeIntanFile(fName, header);
+        break;
+#ifndef TEST_MINIMAL
+    case stfio::heka:
+        stfio::probeHEKAFile(fName, header);
+        break;
+#endif
+    default: {
+        stfio::LazyFile* file = openHeaderLazyFile(fName, type);
+#if (defined(WITH_BIOSIG) || defined(WITH_BIOSIG2))
+        // libbiosig only parses the headers of its own formats (e.g. GDF);
+        // it decodes HEKA, AXG or SMR files completely
+        bool biosigType = (type == stfio::biosig);
+#ifdef TEST_MINIMAL
+        biosigType = biosigType || (type == stfio::none);
+#endif
+        if (file == NULL && biosigType) {
+            stfio::filetype type1 = stfio::none;
+            file = stfio::openLazyBiosigFile(fName, type1);
+        }
+#endif
+        if (file == NULL) {
+            throw std::runtime_error("The metadata of this file type can't be read "
+                                     "without reading the complete file");
+        }
+        header = file->GetHeader();
+        delete file;
+    }
+    }
+
+    FileInfo info;
+    info.dt = header.GetXScale();
+    info.xunits = header.GetXUnits();
+    info.datetime = header.GetDateTime();
+    info.comment = header.GetComment();
+    info.file_description = header.GetFileDescription();
+    info.channels.resize(header.size());
+    for (std::size_t n_c=0; n_c < header.size(); ++n_c) {
+        info.channels[n_c].name = header[n_c].GetChannelName();
+        info.channels[n_c].yunits = header[n_c].GetYUnits();
+        info.channels[n_c].sections = header[n_c].size();
+    }
+    return info;
+}
+
 Vector_double stfio::vec_scal_plus(const Vector_double& vec, double scalar) {
     Vector_double ret_vec(vec.size(), scalar);
     std::transform(vec.begin(), vec.end(), ret_vec.begin(), ret_vec.begin(), std::plus<double>());
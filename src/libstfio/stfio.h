@@ -31,6 +31,7 @@
 #include <map>
 #include <string>
 #include <cmath>
+#include <ctime>
 
 #ifdef _MSC_VER
 #pragma warning( disable : 4251 )  // Disable warning messages
@@ -132,6 +133,162 @@ class StfioDll StdoutProgressInfo : public stfio::ProgressInfo {
     bool verbosity;
 };
 
+//! Mutex class
+/*! Minimal portable mutex used to serialize calls into code that is not
+ *  reentrant, such as file format libraries that keep global file tables.
+ */
+class StfioDll Mutex {
+ public:
+    Mutex();
+    ~Mutex();
+
+    //! Blocks until the mutex has been acquired.
+    /*! The mutex is recursive: a thread that holds it may lock it again. */
+    void Lock();
+
+    //! Releases the mutex.
+    void Unlock();
+
+ private:
+    Mutex(const Mutex&);
+    Mutex& operator=(const Mutex&);
+
+    void* m_handle;
+};
+
+//! MutexLocker class
+/*! Locks a Mutex for the lifetime of the object, so that it is released
+ *  even if an exception is thrown.
+ */
+class StfioDll MutexLocker {
+ public:
+    explicit MutexLocker(Mutex& mutex) : m_mutex(mutex) { m_mutex.Lock(); }
+    ~MutexLocker() { m_mutex.Unlock(); }
+
+ private:
+    MutexLocker(const MutexLocker&);
+    MutexLocker& operator=(const MutexLocker&);
+
+    Mutex& m_mutex;
+};
+
+//! Thread class
+/*! Minimal portable thread that runs a single function in the background,
+ *  e.g. to read the next block of a file while the current one is processed.
+ */
+class StfioDll Thread {
+ public:
+    Thread();
+
+    //! Waits for the thread to finish if it is still running.
+    ~Thread();
+
+    //! Calls \e function with \e arg in a new thread.
+    /*! \return false if no thread could be created; the caller then has
+     *          to call the function itself.
+     */
+    bool Start(void (*function)(void*), void* arg);
+
+    //! Blocks until the thread has finished.
+    /*! Returns immediately if no thread is running. */
+    void Join();
+
+ private:
+    Thread(const Thread&);
+    Thread& operator=(const Thread&);
+
+    void* m_handle;
+};
+
+//! LazyFile class
+/*! Abstract interface for reading the sections of a file on demand.
+ *  Instances are created by stfio::openLazyFile(); depending on the file
+ *  type, sample data are read section by section or when the file is
+ *  opened.
+ *  Different LazyFile objects may be read concurrently, but a single
+ *  object must not be read from several threads at once.
+ */
+class StfioDll LazyFile {
+ public:
+    virtual ~LazyFile() {}
+
+    //! Retrieves the file metadata.
+    /*! \return A Recording with all attributes of the file and the correct
+     *          number of channels and sections. All sections are empty.
+     */
+    const Recording& GetHeader() const { return header; }
+
+    //! Reads a single section.
+    /*! Throws std::out_of_range if \e n_c or \e n_s is out of range.
+     *  \param n_c The channel index.
+     *  \param n_s The section index.
+     *  \param ReturnSection On exit, the section data.
+     */
+    virtual void ReadSection(std::size_t n_c, std::size_t n_s, Section& ReturnSection) = 0;
+
+ protected:
+    //! Throws std::out_of_range unless the section exists in the header.
+    void CheckRange(std::size_t n_c, std::size_t n_s) const;
+
+    Recording header;
+};
+
+struct SectionPrefetch;
+
+//! SectionReader class
+/*! Provides the sections of a Recording or of a LazyFile to the file
+ *  writers one at a time, so that files that don't fit into memory can
+ *  be converted. Sections of a Recording are returned without copying
+ *  them; sections of a LazyFile are read into a buffer that is reused.
+ */
+class StfioDll SectionReader {
+ public:
+    //! Reads the sections of a Recording.
+    /*! \param data The Recording; it has to outlive the reader.
+     */
+    explicit SectionReader(const Recording& data);
+
+    //! Reads the sections of a LazyFile.
+    /*! \param source The file; it has to outlive the reader.
+     *  \param prefetch If true, the section that is likely to be requested
+     *         next is read in a background thread while the current one is
+     *         being written. The next section is guessed from the order in
+     *         which sections have been requested so far.
+     */
+    explicit SectionReader(LazyFile& source, bool prefetch=false);
+
+    ~SectionReader();
+
+    //! Retrieves the metadata; sections of a LazyFile are empty.
+    const Recording& GetHeader() const;
+
+    //! Reads a single section.
+    /*! Throws std::out_of_range if \e n_c or \e n_s is out of range.
+     *  \param n_c The channel index.
+     *  \param n_s The section index.
+     *  \return The section, which remains valid until the next call.
+     */
+    const Section& Read(std::size_t n_c, std::size_t n_s);
+
+ private:
+    SectionReader(const SectionReader&);
+    SectionReader& operator=(const SectionReader&);
+
+    // Guesses the next section from the last two requests.
+    bool NextSection(std::size_t& n_c, std::size_t& n_s) const;
+    void StartPrefetch(std::size_t n_c, std::size_t n_s);
+    // Waits for the background read; returns true if it has read (n_c, n_s).
+    bool FinishPrefetch(std::size_t n_c, std::size_t n_s);
+
+    const Recording* m_data;
+    LazyFile* m_source;
+    bool m_prefetch;
+    Section m_buffers[2];
+    Section* m_current;
+    std::size_t m_last_c, m_last_s, m_previous_c, m_previous_s;
+    SectionPrefetch* m_pending;
+};
+
 //! Text file import filter settings
 struct txtImportSettings {
   txtImportSettings() : hLines(1),toSection(true),firstIsTime(true),ncolumns(2),
@@ -147,6 +304,50 @@ struct txtImportSettings {
     std::string xUnits;    /*!< x units string. */
 };
 
+//! Selects the data to be read by stfio::importFile()
+/*! The default filter selects the complete file.
+ */
+struct StfioDll ImportFilter {
+    ImportFilter() : channels(), firstSweep(0), lastSweep(-1), group(-1), series(-1),
+                     tStart(0), tEnd(-1) {}
+
+    //! true if the complete file is selected.
+    bool empty() const;
+
+    //! Returns the indices of the selected channels.
+    /*! Throws std::out_of_range if a selected channel doesn't exist.
+     *  \param nChannels The number of channels in the file.
+     *  \return The selected channel indices, in the order in which they
+     *          will appear in the Recording.
+     */
+    std::vector<int> SelectChannels(int nChannels) const;
+
+    //! Returns the selected range of sweeps.
+    /*! \param nSweeps The number of sweeps in the file.
+     *  \param first On exit, the first selected sweep.
+     *  \param end On exit, one past the last selected sweep; equal to
+     *         \e first if no sweep is selected.
+     */
+    void SelectSweeps(int nSweeps, int& first, int& end) const;
+
+    //! Returns the selected range of samples within a sweep.
+    /*! \param nSamples The number of samples in the sweep.
+     *  \param dt The sampling interval, in x units.
+     *  \param first On exit, the first selected sample.
+     *  \param end On exit, one past the last selected sample; equal to
+     *         \e first if no sample is selected.
+     */
+    void SelectSamples(std::size_t nSamples, double dt, std::size_t& first, std::size_t& end) const;
+
+    std::vector<int> channels; /*!< Zero-based indices of the channels to be read; empty for all channels. */
+    int firstSweep;            /*!< Zero-based index of the first sweep to be read. */
+    int lastSweep;             /*!< Zero-based index of the last sweep to be read; -1 for the last sweep of the file. */
+    int group;                 /*!< Zero-based index of the HEKA group to be read; -1 for all groups. */
+    int series;                /*!< Zero-based index of the HEKA series to be read; -1 for all series. */
+    double tStart;             /*!< Start of the time window to be read, in x units relative to the start of each sweep. */
+    double tEnd;               /*!< End (excluded) of the time window to be read, in x units; negative for the end of each sweep. */
+};
+
 //! File types
 enum filetype {
     atf,    /*!< Axon text file. */
@@ -164,6 +365,27 @@ enum filetype {
     none    /*!< Undefined file type. */
 };
 
+//! Channel metadata returned by stfio::probeFile()
+struct StfioDll ChannelInfo {
+    ChannelInfo() : name(), yunits(), sections(0) {}
+
+    std::string name;      /*!< Channel name. */
+    std::string yunits;    /*!< y units string. */
+    std::size_t sections;  /*!< Number of sections. */
+};
+
+//! File metadata returned by stfio::probeFile()
+struct StfioDll FileInfo {
+    FileInfo() : dt(1.0), xunits(), datetime(), comment(), file_description(), channels() {}
+
+    double dt;                         /*!< Sampling interval. */
+    std::string xunits;                /*!< x units string. */
+    struct tm datetime;                /*!< Date and time of recording. */
+    std::string comment;               /*!< Comment on the recording. */
+    std::string file_description;      /*!< File description. */
+    std::vector<ChannelInfo> channels; /*!< Channel metadata. */
+};
+
   
 #ifndef TEST_MINIMAL
 //! Attempts to determine the filetype from the filter extension.
@@ -182,7 +404,10 @@ StfioDll std::string
 findExtension(stfio::filetype ftype);
 
 //! Generic file import.
-/*! \param fName The full path name of the file. 
+/*! May be called concurrently from several threads; file formats whose
+ *  libraries keep global state are serialized internally. Files are read
+ *  from the cache if one has been set with SetCacheDirectory().
+ *  \param fName The full path name of the file. 
  *  \param type The file type. 
  *  \param ReturnData Will contain the file data on return.
  *  \param txtImport The text import filter settings.
@@ -198,6 +423,35 @@ importFile(
         stfio::ProgressInfo& progDlg
 );
 
+//! Imports selected channels, sweeps and time windows of a file.
+/*! Unselected channels and sweeps of ABF, AXG and HDF5 files are never
+ *  read from disk. Only the selected traces and time windows of HEKA
+ *  bundles are read. Files read by libbiosig only decode the selected
+ *  channels and the data records within the time window, except for
+ *  formats that libbiosig decodes completely when opening them (e.g.
+ *  HEKA files that aren't bundles). Other file types are imported
+ *  completely before the selection is applied. Filtered
+ *  imports bypass the cache. Throws std::out_of_range if a selected
+ *  channel doesn't exist.
+ *  \param fName The full path name of the file.
+ *  \param type The file type.
+ *  \param ReturnData Will contain the selected data on return. Sweeps
+ *         are renumbered starting from 0.
+ *  \param txtImport The text import filter settings.
+ *  \param filter The channels, sweeps and time window to be read.
+ *  \param ProgressInfo Progress indicator
+ *  \return true if the file has successfully been read, false otherwise.
+ */
+StfioDll bool
+importFile(
+        const std::string& fName,
+        stfio::filetype type,
+        Recording& ReturnData,
+        const stfio::txtImportSettings& txtImport,
+        const stfio::ImportFilter& filter,
+        stfio::ProgressInfo& progDlg
+);
+
 //! Generic file export.
 /*! \param fName The full path name of the file. 
  *  \param type The file type. 
@@ -209,6 +463,72 @@ StfioDll bool
 exportFile(const std::string& fName, stfio::filetype type, const Recording& Data,
            ProgressInfo& progDlg);
 
+//! Generic file export, reading one section at a time.
+/*! Only a single section (two with \e prefetch) is held in memory, so
+ *  that files that are larger than the available memory can be converted.
+ *  Text-based ATF files store sections as columns; here, the exported
+ *  first channel is held in memory.
+ *  \param fName The full path name of the file.
+ *  \param type The file type.
+ *  \param source The file to be converted.
+ *  \param progDlg Progress indicator
+ *  \param prefetch Read the next section in a background thread while the
+ *         current one is being written.
+ *  \return true if the file has successfully been written, false otherwise.
+ */
+StfioDll bool
+exportFile(const std::string& fName, stfio::filetype type, LazyFile& source,
+           ProgressInfo& progDlg, bool prefetch=false);
+
+//! Opens a file for on-demand reading.
+/*! HDF5, ABF, AXG and HEKA bundle files are read by the native readers,
+ *  which only parse the file headers and read each section when it is
+ *  requested. HEKA bundles whose series have different sampling
+ *  intervals can't be read natively and, like other files, are opened
+ *  with libbiosig if it is available:
+ *  formats that libbiosig reads record by record (e.g. GDF, EDF) are read
+ *  section by section, but sopen() decodes some formats (e.g. SMR, and
+ *  HEKA files that aren't bundles) completely when the file is opened.
+ *  All other types are imported completely when the file is opened.
+ *  Throws std::runtime_error if the file can't be opened.
+ *  \param fName The full path name of the file.
+ *  \param type The file type.
+ *  \return A new LazyFile that has to be deleted by the caller.
+ */
+StfioDll LazyFile*
+openLazyFile(const std::string& fName, stfio::filetype type);
+
+//! Reads the metadata of a file without reading its data.
+/*! Only the file headers are parsed. ABF, AXG, CFS, HDF5, Intan and
+ *  HEKA bundle files are supported, as well as the formats that libbiosig
+ *  reads record by record (stfio::biosig, e.g. GDF). Throws
+ *  std::runtime_error if the file can't be read, if its type can't be
+ *  probed without reading the complete file, or if the series of a HEKA
+ *  bundle have different sampling intervals.
+ *  \param fName The full path name of the file.
+ *  \param type The file type.
+ *  \return The channel names, units, section counts and attributes of the file.
+ */
+StfioDll FileInfo
+probeFile(const std::string& fName, stfio::filetype type);
+
+//! Sets the directory used to cache decoded recordings.
+/*! When a cache directory is set, importFile() stores every file it has
+ *  read there and reads it back from the cache the next time as long as
+ *  the path, size and modification time of the file are unchanged.
+ *  Generic text files are never cached. The directory has to exist.
+ *  \param dir The cache directory; an empty string disables the cache
+ *         (the default).
+ */
+StfioDll void
+SetCacheDirectory(const std::string& dir);
+
+//! Returns the directory used to cache decoded recordings.
+/*! \return The cache directory, or an empty string if caching is disabled.
+ */
+StfioDll std::string
+GetCacheDirectory();
+
 //! Produce new recording with concatenated sections
 /*! \param src Source recording
  *  \param sections Indices of selected sections
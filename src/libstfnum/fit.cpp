@@ -15,6 +15,7 @@
 #include "./fit.h"
 #include "./levmar/levmar.h"
 
+#include <algorithm>
 #include <float.h>
 #include <cmath>
 
@@ -22,48 +23,57 @@ namespace stfnum {
 // C-style functions for Lourakis' routines:
 void c_func_lour(double *p, double* hx, int m, int n, void *adata);
 void c_jac_lour(double *p, double *j, int m, int n, void *adata);
-
-// Helper functions for lmFit to store the function at global scope:
-void saveFunc(stfnum::Func func);
-void saveJac(stfnum::Jac jac);
+// Scales data in place; xyscale needs to have a size of 4.
+void scale_data(Vector_double& data, double oldx, Vector_double& xyscale);
+// Describes levmar's reason for stopping and sets the warning code.
+void stopInfo(double reason, std::ostringstream& str_info, int& warning);
 
 // A struct that will be passed as a pointer to
 // Lourakis' C-functions. It is used to:
 // (1) specify which parameters are to be fitted, and
 // (2) pass the constant parameters
 // (3) the sampling interval
+// (4) the function and its Jacobian
+// (5) buffers for all parameters and for the Jacobian
+// Keeping the function here rather than at global scope allows
+// several fits to run concurrently.
 struct fitInfo {
     fitInfo(const std::deque<bool>& fit_p_arg,
             const Vector_double& const_p_arg,
-            double dt_arg)
-        :   fit_p(fit_p_arg), const_p(const_p_arg),
-            dt(dt_arg)
+            Vector_double& p_f_arg,
+            Vector_double& jac_f_arg,
+            double dt_arg,
+            const stfnum::storedFunc& fitFunc)
+        :   fit_p(fit_p_arg), const_p(const_p_arg), p_f(p_f_arg), jac_f(jac_f_arg),
+            dt(dt_arg), func(fitFunc.func), jac(fitFunc.jac),
+            gridFunc(fitFunc.gridFunc), gridJac(fitFunc.gridJac)
     {}
 
     // Specifies for each parameter whether the client
     // wants to fit it (true) or to keep it constant (false)
-    std::deque<bool> fit_p;
+    const std::deque<bool>& fit_p;
 
     // A valarray containing the parameters that
     // will be kept constant:
-    Vector_double const_p;
+    const Vector_double& const_p;
+
+    // All parameters, including constants; filled on each call
+    Vector_double& p_f;
+
+    // Jacobian of all parameters on the whole grid
+    Vector_double& jac_f;
 
     // sampling interval
     double dt;
-};
-}
-
-// Functions stored at global scope to be called by c_func_lour
-// and c_jac_lour
-stfnum::Func func_lour;
-stfnum::Jac jac_lour; 
 
-void stfnum::saveFunc(stfnum::Func func) {
-    func_lour=func;
-}
+    // the function to be fitted and its Jacobian
+    const stfnum::Func& func;
+    const stfnum::Jac& jac;
 
-void stfnum::saveJac(stfnum::Jac jac) {
-    jac_lour=jac;
+    // the same, evaluated on the whole grid at once (may be empty)
+    const stfnum::GridFunc& gridFunc;
+    const stfnum::GridJac& gridJac;
+};
 }
 
 void stfnum::c_func_lour(double *p, double* hx, int m, int n, void *adata) {
@@ -74,7 +84,7 @@ void stfnum::c_func_lour(double *p, double* hx, int m, int n, void *adata) {
     // total number of parameters, including constants:
     int tot_p=(int)fInfo->fit_p.size();
     // all parameters, including constants:
-    Vector_double p_f(tot_p);
+    Vector_double& p_f = fInfo->p_f;
     for (int n_tp=0, n_p=0, n_f=0;n_tp<tot_p;++n_tp) {
         // if the parameter needs to be fitted...
         if (fInfo->fit_p[n_tp]) {
@@ -85,8 +95,12 @@ void stfnum::c_func_lour(double *p, double* hx, int m, int n, void *adata) {
             p_f[n_tp] = fInfo->const_p[n_f++];
         }
     }
+    if (!fInfo->gridFunc.empty()) {
+        fInfo->gridFunc(fInfo->dt, n, p_f, hx);
+        return;
+    }
     for (int n_x=0;n_x<n;++n_x) {
-        hx[n_x]=func_lour( (double)n_x*fInfo->dt, p_f);
+        hx[n_x]=fInfo->func( (double)n_x*fInfo->dt, p_f);
     }	
 }
 
@@ -98,7 +112,7 @@ void stfnum::c_jac_lour(double *p, double *jac, int m, int n, void *adata) {
     // total number of parameters, including constants:
     int tot_p=(int)fInfo->fit_p.size();
     // all parameters, including constants:
-    Vector_double p_f(tot_p);
+    Vector_double& p_f = fInfo->p_f;
     for (int n_tp=0,n_p=0,n_f=0;n_tp<tot_p;++n_tp) {
         // if the parameter needs to be fitted...
         if (fInfo->fit_p[n_tp]) {
@@ -109,10 +123,25 @@ void stfnum::c_jac_lour(double *p, double *jac, int m, int n, void *adata) {
             p_f[n_tp] = fInfo->const_p[n_f++];
         }
     }
+    if (!fInfo->gridJac.empty()) {
+        // derivatives of all parameters at all points...
+        Vector_double& jac_f = fInfo->jac_f;
+        jac_f.resize((std::size_t)n*tot_p);
+        fInfo->gridJac(fInfo->dt, n, p_f, &jac_f[0]);
+        // ... of which we only need those of the non-constants:
+        for (int n_x=0,n_j=0;n_x<n;++n_x) {
+            for (int n_tp=0;n_tp<tot_p;++n_tp) {
+                if (fInfo->fit_p[n_tp]) {
+                    jac[n_j++]=jac_f[(std::size_t)n_x*tot_p+n_tp];
+                }
+            }
+        }
+        return;
+    }
     for (int n_x=0,n_j=0;n_x<n;++n_x) {
         // jac_f will calculate the derivatives of all parameters,
         // including the constants...
-        Vector_double jac_f(jac_lour((double)n_x*fInfo->dt,p_f));
+        Vector_double jac_f(fInfo->jac((double)n_x*fInfo->dt,p_f));
         // ... but we only need the derivatives of the non-constants...
         for (int n_tp=0;n_tp<tot_p;++n_tp) {
             // ... hence, we will eliminate the derivatives of the constants:
@@ -123,16 +152,62 @@ void stfnum::c_jac_lour(double *p, double *jac, int m, int n, void *adata) {
     }
 }
 
+void stfnum::stopInfo(double reason, std::ostringstream& str_info, int& warning) {
+    switch ((int)reason) {
+     case 1:
+         str_info << "\nStopped by small gradient of squared error.";
+         warning = 0;
+         break;
+     case 2:
+         str_info << "\nStopped by small rel. parameter change.";
+         warning = 0;
+         break;
+     case 3:
+         str_info << "\nReached max. number of iterations. Restart\n"
+                  << "with smarter initial parameters and / or with\n"
+                  << "increased initial scaling factor and / or with\n"
+                  << "increased max. number of iterations.";
+         warning = 3;
+         break;
+     case 4:
+         str_info << "\nSingular matrix. Restart from current parameters\n"
+                  << "with increased initial scaling factor.";
+         warning = 4;
+         break;
+     case 5:
+         str_info << "\nNo further error reduction is possible.\n"
+                  << "Restart with increased initial scaling factor.";
+         warning = 5;
+         break;
+     case 6:
+         str_info << "\nStopped by small squared error.";
+         warning = 0;
+         break;
+     case 7:
+         str_info << "\nStopped by invalid (i.e. NaN or Inf) \"func\" values.\n";
+         str_info << "This is a user error.";
+         warning = 7;
+         break;
+     default:
+         str_info << "\nUnknown reason for stopping the fit.";
+         warning = -1;
+    }
+}
+
 Vector_double stfnum::get_scale(Vector_double& data, double oldx) {
     Vector_double xyscale(4);
+    scale_data(data, oldx, xyscale);
+    return xyscale;
+}
 
+void stfnum::scale_data(Vector_double& data, double oldx, Vector_double& xyscale) {
     if (data.size() == 0) {
         xyscale[0] = 1.0/oldx;
         xyscale[1] = 0.0;
         xyscale[2] = 1.0;
         xyscale[3] = 0.0;
 
-        return xyscale;
+        return;
     }
 
     double ymin,ymax,amp,off;
@@ -147,21 +222,32 @@ Vector_double stfnum::get_scale(Vector_double& data, double oldx) {
     amp = ymax - ymin;
     off = ymin / amp;
 
-    data = stfio::vec_scal_mul(data, 1.0 / amp);
-    data = stfio::vec_scal_minus(data, off);
+    // scale in place rather than through temporary vectors:
+    double inv_amp = 1.0 / amp;
+    for (Vector_double::iterator it = data.begin(); it != data.end(); ++it) {
+        *it = *it * inv_amp - off;
+    }
 
     xyscale[0] = 1.0/(data.size()*oldx);
     xyscale[1] = 0;
     xyscale[2] = 1.0/amp;
     xyscale[3] = off;
-    
-    return xyscale;
 }
 
 double stfnum::lmFit( const Vector_double& data, double dt,
                    const stfnum::storedFunc& fitFunc, const Vector_double& opts,
                    bool use_scaling,
                    Vector_double& p, std::string& info, int& warning )
+{
+    FitContext context;
+    return lmFit(data, dt, fitFunc, opts, use_scaling, p, info, warning, context);
+}
+
+double stfnum::lmFit( const Vector_double& data, double dt,
+                   const stfnum::storedFunc& fitFunc, const Vector_double& opts,
+                   bool use_scaling,
+                   Vector_double& p, std::string& info, int& warning,
+                   stfnum::FitContext& context )
 {
     // Basic range checking:
     if (fitFunc.pInfo.size()!=p.size()) {
@@ -176,8 +262,12 @@ double stfnum::lmFit( const Vector_double& data, double dt,
     }
 
     bool constrained = false;
-    std::vector< double > constrains_lm_lb( fitFunc.pInfo.size() );
-    std::vector< double > constrains_lm_ub( fitFunc.pInfo.size() );
+    // All buffers are taken from the context; resize() doesn't
+    // allocate if the context has been used for a fit of the same size.
+    Vector_double& constrains_lm_lb = context.lb;
+    Vector_double& constrains_lm_ub = context.ub;
+    constrains_lm_lb.resize( fitFunc.pInfo.size() );
+    constrains_lm_ub.resize( fitFunc.pInfo.size() );
 
     bool can_scale = use_scaling;
     
@@ -197,15 +287,13 @@ double stfnum::lmFit( const Vector_double& data, double dt,
         }
     }
 
-    // Store the functions at global scope:
-    saveFunc(fitFunc.func);
-    saveJac(fitFunc.jac);
-
     double info_id[LM_INFO_SZ];
-    Vector_double data_ptr(data);
-    Vector_double xyscale(4);
+    Vector_double& data_ptr = context.data;
+    data_ptr.assign(data.begin(), data.end());
+    Vector_double& xyscale = context.xyscale;
+    xyscale.resize(4);
     if (can_scale) {
-        xyscale = get_scale(data_ptr, dt);
+        scale_data(data_ptr, dt, xyscale);
     }
     
     // The parameters need to be separated into two parts:
@@ -220,10 +308,14 @@ double stfnum::lmFit( const Vector_double& data, double dt,
         n_fitted += fitFunc.pInfo[n_p].toFit;
     }
     // parameters that need to be fitted:
-    Vector_double p_toFit(n_fitted);
-    std::deque<bool> p_fit_bool( fitFunc.pInfo.size() );
+    Vector_double& p_toFit = context.p_toFit;
+    p_toFit.resize(n_fitted);
+    std::deque<bool>& p_fit_bool = context.fit_p;
+    p_fit_bool.resize( fitFunc.pInfo.size() );
     // parameters that are held constant:
-    Vector_double p_const( fitFunc.pInfo.size()-n_fitted );
+    Vector_double& p_const = context.p_const;
+    p_const.resize( fitFunc.pInfo.size()-n_fitted );
+    context.p_f.resize( fitFunc.pInfo.size() );
     for ( unsigned n_p=0, n_c=0, n_f=0; n_p < fitFunc.pInfo.size(); ++n_p ) {
         if (fitFunc.pInfo[n_p].toFit) {
             p_toFit[n_f++] = p[n_p];
@@ -245,18 +337,25 @@ double stfnum::lmFit( const Vector_double& data, double dt,
     if (can_scale)
         dt_finfo = 1.0/data_ptr.size();
 
-    fitInfo fInfo( p_fit_bool, p_const, dt_finfo );
+    fitInfo fInfo( p_fit_bool, p_const, context.p_f, context.jac_f, dt_finfo, fitFunc );
 
     // make l-value of opts:
-    Vector_double opts_l(5);
+    Vector_double& opts_l = context.opts;
+    opts_l.resize(5);
     for (std::size_t n=0; n < 4; ++n) opts_l[n] = opts[n];
     opts_l[4] = -1e-6;
     int it = 0;
     if (p_toFit.size()!=0 && data_ptr.size()!=0) {
         double old_info_id[LM_INFO_SZ];
 
+        // levmar workspace; LM_DIF_WORKSZ is the largest of
+        // the four variants used below:
+        Vector_double& work = context.work;
+        work.resize( LM_DIF_WORKSZ(n_fitted, (int)data.size()) );
+
         // initialize with initial parameter guess:
-        Vector_double old_p_toFit(p_toFit);
+        Vector_double& old_p_toFit = context.old_p_toFit;
+        old_p_toFit = p_toFit;
 
 #ifdef _DEBUG
         std::ostringstream optsMsg;
@@ -289,22 +388,22 @@ double stfnum::lmFit( const Vector_double& data, double dt,
                 if ( !constrained ) {
                     dlevmar_dif( c_func_lour, &p_toFit[0], &data_ptr[0], n_fitted, 
                             (int)data.size(), (int)opts[4], &opts_l[0], info_id,
-                            NULL, NULL, &fInfo );
+                            &work[0], NULL, &fInfo );
                 } else {
                     dlevmar_bc_dif( c_func_lour, &p_toFit[0], &data_ptr[0], n_fitted, 
                             (int)data.size(), &constrains_lm_lb[0], &constrains_lm_ub[0], NULL,
-                            (int)opts[4], &opts_l[0], info_id, NULL, NULL, &fInfo );
+                            (int)opts[4], &opts_l[0], info_id, &work[0], NULL, &fInfo );
                 }
             } else {
                 if ( !constrained ) {
                     dlevmar_der( c_func_lour, c_jac_lour, &p_toFit[0], &data_ptr[0], 
                             n_fitted, (int)data.size(), (int)opts[4], &opts_l[0], info_id,
-                            NULL, NULL, &fInfo );                
+                            &work[0], NULL, &fInfo );                
                 } else {
                     dlevmar_bc_der( c_func_lour,  c_jac_lour, &p_toFit[0], 
                             &data_ptr[0], n_fitted, (int)data.size(), &constrains_lm_lb[0], 
                             &constrains_lm_ub[0], NULL, (int)opts[4], &opts_l[0], info_id,
-                            NULL, NULL, &fInfo );
+                            &work[0], NULL, &fInfo );
                 }
             }
             it++;
@@ -356,45 +455,7 @@ double stfnum::lmFit( const Vector_double& data, double dt,
     str_info << "Passes: " << it;
     str_info << "\nIterations during last pass: " << info_id[5];
     str_info << "\nStopping reason during last pass:";
-    switch ((int)info_id[6]) {
-     case 1:
-         str_info << "\nStopped by small gradient of squared error.";
-         warning = 0;
-         break;
-     case 2:
-         str_info << "\nStopped by small rel. parameter change.";
-         warning = 0;
-         break;
-     case 3:
-         str_info << "\nReached max. number of iterations. Restart\n"
-                  << "with smarter initial parameters and / or with\n"
-                  << "increased initial scaling factor and / or with\n"
-                  << "increased max. number of iterations.";
-         warning = 3;
-         break;
-     case 4:
-         str_info << "\nSingular matrix. Restart from current parameters\n"
-                  << "with increased initial scaling factor.";
-         warning = 4;
-         break;
-     case 5:
-         str_info << "\nNo further error reduction is possible.\n"
-                  << "Restart with increased initial scaling factor.";
-         warning = 5;
-         break;
-     case 6:
-         str_info << "\nStopped by small squared error.";
-         warning = 0;
-         break;
-     case 7:
-         str_info << "\nStopped by invalid (i.e. NaN or Inf) \"func\" values.\n";
-         str_info << "This is a user error.";
-         warning = 7;
-         break;
-     default:
-         str_info << "\nUnknown reason for stopping the fit.";
-         warning = -1;
-    }
+    stopInfo(info_id[6], str_info, warning);
     if (use_scaling && !can_scale) {
         str_info << "\nCouldn't use scaling because one or more "
                  << "of the parameters don't allow it.";
@@ -403,6 +464,531 @@ double stfnum::lmFit( const Vector_double& data, double dt,
     return info_id[1];
 }
 
+namespace {
+// Element of the Halton sequence with the given prime base; values are
+// evenly distributed in [0, 1).
+double halton(int index, int base) {
+    double f = 1.0, r = 0.0;
+    while (index > 0) {
+        f /= base;
+        r += f * (index % base);
+        index /= base;
+    }
+    return r;
+}
+
+const int haltonPrimes[] = {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53};
+const int nHaltonPrimes = sizeof(haltonPrimes)/sizeof(haltonPrimes[0]);
+}
+
+double stfnum::lmFitMultiStart( const Vector_double& data, double dt,
+                   const stfnum::storedFunc& fitFunc, const Vector_double& opts,
+                   bool use_scaling, Vector_double& p, std::string& info, int& warning,
+                   int n_starts, double spread )
+{
+    if (n_starts < 1 || spread < 1.0) {
+        throw std::runtime_error("Error in stfnum::lmFitMultiStart()\n"
+                                 "invalid number of starts or spread");
+    }
+    if (fitFunc.pInfo.size()!=p.size()) {
+        throw std::runtime_error("Error in stfnum::lmFitMultiStart()\n"
+                "function parameters (p_fit) and parameters entered (p) have different sizes");
+    }
+
+    // Initial guesses; the first one is left unchanged:
+    std::vector<Vector_double> starts(n_starts, p);
+    double logSpread = log(spread);
+    for (int n_s=1; n_s < n_starts; ++n_s) {
+        for (std::size_t n_p=0, n_dim=0; n_p < p.size(); ++n_p) {
+            const stfnum::parInfo& pInfo = fitFunc.pInfo[n_p];
+            if (!pInfo.toFit) continue;
+            double u = halton(n_s, haltonPrimes[n_dim++ % nHaltonPrimes]);
+            starts[n_s][n_p] *= exp((2.0*u-1.0)*logSpread);
+            if (pInfo.constrained) {
+                starts[n_s][n_p] = std::min(std::max(starts[n_s][n_p], pInfo.constr_lb),
+                                            pInfo.constr_ub);
+            }
+        }
+    }
+
+    Vector_double chisqr(n_starts, NAN);
+    std::vector<std::string> infos(n_starts);
+    std::vector<int> warnings(n_starts, 0);
+
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+    {
+        stfnum::FitContext context;
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+        for (int n_s=0; n_s < n_starts; ++n_s) {
+            // Exceptions mustn't leave the parallel region:
+            try {
+                chisqr[n_s] = lmFit(data, dt, fitFunc, opts, use_scaling, starts[n_s],
+                                    infos[n_s], warnings[n_s], context);
+            }
+            catch (const std::exception&) {
+                chisqr[n_s] = NAN;
+            }
+        }
+    }
+
+    int best = -1;
+    for (int n_s=0; n_s < n_starts; ++n_s) {
+        if (chisqr[n_s] == chisqr[n_s] && (best < 0 || chisqr[n_s] < chisqr[best])) {
+            best = n_s;
+        }
+    }
+    if (best < 0) {
+        // All starts failed; repeat the first one so that its exception is passed on:
+        return lmFit(data, dt, fitFunc, opts, use_scaling, p, info, warning);
+    }
+
+    p = starts[best];
+    warning = warnings[best];
+    std::ostringstream str_info;
+    str_info << "Best of " << n_starts << " starts: #" << best+1 << "\n" << infos[best];
+    info = str_info.str();
+    return chisqr[best];
+}
+
+namespace stfnum {
+// Parameters of a global fit. Parameters of all data sets are stored in one
+// vector: the shared parameters come first, followed by the local parameters
+// of each data set, n_local per data set. col gives the position of each
+// parameter of each data set in that vector, or -1 if the parameter is kept
+// constant.
+struct globalFitInfo {
+    globalFitInfo(const std::vector<Vector_double>& data_arg,
+                  const std::vector<Vector_double>& p_arg,
+                  const std::vector<int>& col_arg,
+                  std::size_t n_shared_arg, std::size_t n_local_arg,
+                  double dt_arg,
+                  const stfnum::storedFunc& fitFunc_arg)
+        :   data(data_arg), p(p_arg), col(col_arg), n_shared(n_shared_arg),
+            n_local(n_local_arg), dt(dt_arg), fitFunc(fitFunc_arg),
+            p_f(fitFunc_arg.pInfo.size()), f(), f_d(), jac_f()
+    {}
+
+    // Fills p_f with all parameters of data set n_set:
+    void assemble(const double* q, std::size_t n_set) {
+        std::size_t n_par = p_f.size();
+        for (std::size_t n_p=0; n_p < n_par; ++n_p) {
+            int c = col[n_set*n_par+n_p];
+            p_f[n_p] = (c < 0) ? p[n_set][n_p] : q[c];
+        }
+    }
+
+    // Evaluates the function with the parameters in p_f on the grid of data set n_set:
+    void evaluate(std::size_t n_set, Vector_double& hx) {
+        std::size_t n_x = data[n_set].size();
+        hx.resize(n_x);
+        if (!fitFunc.gridFunc.empty()) {
+            fitFunc.gridFunc(dt, n_x, p_f, &hx[0]);
+        } else {
+            for (std::size_t i=0; i < n_x; ++i) {
+                hx[i] = fitFunc.func((double)i*dt, p_f);
+            }
+        }
+    }
+
+    // Returns the sum of squared errors of data set n_set; f holds the fitted function on return
+    double sqrError(const double* q, std::size_t n_set) {
+        assemble(q, n_set);
+        evaluate(n_set, f);
+        double sqr = 0.0;
+        for (std::size_t i=0; i < f.size(); ++i) {
+            double e = data[n_set][i]-f[i];
+            sqr += e*e;
+        }
+        return sqr;
+    }
+
+    // Fills jac_f (row-major, one row per data point and one column per
+    // parameter of fitFunc) and f for data set n_set. Columns of constant
+    // parameters are undefined. Uses central differences if fitFunc has
+    // no Jacobian.
+    void jacobian(const double* q, std::size_t n_set) {
+        std::size_t n_x = data[n_set].size(), n_par = p_f.size();
+        const int* c = &col[n_set*n_par];
+        assemble(q, n_set);
+        jac_f.resize(n_x*n_par);
+        if (fitFunc.hasJac) {
+            if (!fitFunc.gridJac.empty()) {
+                fitFunc.gridJac(dt, n_x, p_f, &jac_f[0]);
+            } else {
+                for (std::size_t i=0; i < n_x; ++i) {
+                    Vector_double jac_i(fitFunc.jac((double)i*dt, p_f));
+                    std::copy(&jac_i[0], &jac_i[0]+n_par, &jac_f[i*n_par]);
+                }
+            }
+            evaluate(n_set, f);
+            return;
+        }
+        for (std::size_t n_p=0; n_p < n_par; ++n_p) {
+            if (c[n_p] < 0) continue;
+            double p0 = p_f[n_p];
+            double d = std::max(fabs(1e-4*p0), 1e-6);
+            p_f[n_p] = p0+d;
+            evaluate(n_set, f_d);
+            p_f[n_p] = p0-d;
+            evaluate(n_set, f);
+            p_f[n_p] = p0;
+            for (std::size_t i=0; i < n_x; ++i) {
+                jac_f[i*n_par+n_p] = (f_d[i]-f[i])/(2.0*d);
+            }
+        }
+        evaluate(n_set, f);
+    }
+
+    const std::vector<Vector_double>& data;
+    const std::vector<Vector_double>& p;
+    const std::vector<int>& col;
+    std::size_t n_shared, n_local;
+    double dt;
+    const stfnum::storedFunc& fitFunc;
+    Vector_double p_f, f, f_d, jac_f;
+};
+
+// Cholesky decomposition of the symmetric n x n matrix a, in place (lower triangle).
+// Returns false if a is not positive definite.
+bool cholesky(double* a, std::size_t n) {
+    for (std::size_t j=0; j < n; ++j) {
+        double d = a[j*n+j];
+        for (std::size_t k=0; k < j; ++k) d -= a[j*n+k]*a[j*n+k];
+        if (!(d > 0.0)) return false;
+        d = sqrt(d);
+        a[j*n+j] = d;
+        for (std::size_t i=j+1; i < n; ++i) {
+            double s = a[i*n+j];
+            for (std::size_t k=0; k < j; ++k) s -= a[i*n+k]*a[j*n+k];
+            a[i*n+j] = s/d;
+        }
+    }
+    return true;
+}
+
+// Solves L L^T x = b in place, where L has been computed by cholesky().
+void choleskySolve(const double* L, std::size_t n, double* b) {
+    for (std::size_t i=0; i < n; ++i) {
+        double s = b[i];
+        for (std::size_t k=0; k < i; ++k) s -= L[i*n+k]*b[k];
+        b[i] = s/L[i*n+i];
+    }
+    for (std::size_t i=n; i-- > 0; ) {
+        double s = b[i];
+        for (std::size_t k=i+1; k < n; ++k) s -= L[k*n+i]*b[k];
+        b[i] = s/L[i*n+i];
+    }
+}
+
+// Normal equations J^T J Dp = J^T e of a global fit, split into the blocks
+// of the shared (s) and local (l) parameters of each data set:
+// U = sum(J_s^T J_s), W = J_s^T J_l and V = J_l^T J_l per data set,
+// and g = J^T e. Off-diagonal blocks between data sets are zero.
+struct globalNormalEq {
+    globalNormalEq(std::size_t n_sets_arg, std::size_t n_shared_arg, std::size_t n_local_arg)
+        :   n_sets(n_sets_arg), n_shared(n_shared_arg), n_local(n_local_arg),
+            U(n_shared*n_shared), W(n_sets*n_shared*n_local), V(n_sets*n_local*n_local),
+            g(n_shared + n_sets*n_local), S(), Y(W.size()), z(n_sets*n_local), Vk()
+    {}
+
+    // Builds the blocks at q and returns the sum of squared errors
+    double build(globalFitInfo& gInfo, const double* q) {
+        std::fill(U.begin(), U.end(), 0.0);
+        std::fill(W.begin(), W.end(), 0.0);
+        std::fill(V.begin(), V.end(), 0.0);
+        std::fill(g.begin(), g.end(), 0.0);
+        std::size_t n_par = gInfo.p_f.size();
+        std::vector<std::size_t> cols;
+        std::vector<std::size_t> pos;
+        double sqr = 0.0;
+        for (std::size_t n_set=0; n_set < gInfo.data.size(); ++n_set) {
+            gInfo.jacobian(q, n_set);
+            // fitted parameters of this data set, and their index in the shared or local block
+            cols.clear();
+            pos.clear();
+            for (std::size_t n_p=0; n_p < n_par; ++n_p) {
+                int c = gInfo.col[n_set*n_par+n_p];
+                if (c < 0) continue;
+                cols.push_back(n_p);
+                // local parameters follow the shared ones in pos
+                pos.push_back(((std::size_t)c < n_shared) ? c : c - n_set*n_local);
+            }
+            // blocks of the local parameters are empty without local parameters
+            double* Wk = W.empty() ? NULL : &W[n_set*n_shared*n_local];
+            double* Vk_ = V.empty() ? NULL : &V[n_set*n_local*n_local];
+            double* gk = (n_local == 0) ? NULL : &g[n_shared + n_set*n_local];
+            const Vector_double& y = gInfo.data[n_set];
+            for (std::size_t i=0; i < y.size(); ++i) {
+                const double* jac_i = &gInfo.jac_f[i*n_par];
+                double e = y[i]-gInfo.f[i];
+                sqr += e*e;
+                for (std::size_t a=0; a < cols.size(); ++a) {
+                    double ja = jac_i[cols[a]];
+                    bool a_shared = (pos[a] < n_shared);
+                    if (a_shared) g[pos[a]] += ja*e;
+                    else gk[pos[a]-n_shared] += ja*e;
+                    for (std::size_t b=0; b <= a; ++b) {
+                        double jj = ja*jac_i[cols[b]];
+                        bool b_shared = (pos[b] < n_shared);
+                        if (a_shared && b_shared) {
+                            U[pos[a]*n_shared+pos[b]] += jj;
+                        } else if (!a_shared && !b_shared) {
+                            Vk_[(pos[a]-n_shared)*n_local+(pos[b]-n_shared)] += jj;
+                        } else if (a_shared) {
+                            Wk[pos[a]*n_local+(pos[b]-n_shared)] += jj;
+                        } else {
+                            Wk[pos[b]*n_local+(pos[a]-n_shared)] += jj;
+                        }
+                    }
+                }
+            }
+        }
+        // U and V have been filled in their lower triangles
+        mirror(&U[0], n_shared);
+        for (std::size_t n_set=0; n_set < gInfo.data.size(); ++n_set) {
+            mirror(&V[n_set*n_local*n_local], n_local);
+        }
+        return sqr;
+    }
+
+    // Largest diagonal element of J^T J
+    double maxDiag() const {
+        double d = 0.0;
+        for (std::size_t i=0; i < n_shared; ++i) d = std::max(d, U[i*n_shared+i]);
+        for (std::size_t n_set=0; n_set < n_sets; ++n_set)
+            for (std::size_t i=0; i < n_local; ++i) d = std::max(d, V[(n_set*n_local+i)*n_local+i]);
+        return d;
+    }
+
+    // Solves (J^T J + mu I) Dp = g: the local parameters of each data set
+    // are eliminated, and the Schur complement of the shared parameters is
+    // solved. Returns false if the system can't be solved.
+    bool solve(double mu, Vector_double& Dp) {
+        S.assign(U.begin(), U.end());
+        for (std::size_t i=0; i < n_shared; ++i) S[i*n_shared+i] += mu;
+        Dp.assign(g.begin(), g.end());
+        double* ds = &Dp[0];
+        for (std::size_t n_set=0; n_set < n_sets && n_local > 0; ++n_set) {
+            const double* Wk = W.empty() ? NULL : &W[n_set*n_shared*n_local];
+            double* Yk = Y.empty() ? NULL : &Y[n_set*n_shared*n_local];
+            double* zk = &z[n_set*n_local];
+            Vk.assign(V.begin()+n_set*n_local*n_local, V.begin()+(n_set+1)*n_local*n_local);
+            for (std::size_t i=0; i < n_local; ++i) Vk[i*n_local+i] += mu;
+            if (!cholesky(&Vk[0], n_local)) return false;
+            // z = V^-1 g_l, Y = V^-1 W^T (stored column by column of W^T, i.e. row by row of W)
+            std::copy(&g[n_shared+n_set*n_local], &g[n_shared+(n_set+1)*n_local], zk);
+            choleskySolve(&Vk[0], n_local, zk);
+            for (std::size_t r=0; r < n_shared; ++r) {
+                std::copy(Wk+r*n_local, Wk+(r+1)*n_local, Yk+r*n_local);
+                choleskySolve(&Vk[0], n_local, Yk+r*n_local);
+            }
+            // S -= W V^-1 W^T, rhs -= W V^-1 g_l
+            for (std::size_t r=0; r < n_shared; ++r) {
+                for (std::size_t i=0; i < n_local; ++i) {
+                    ds[r] -= Wk[r*n_local+i]*zk[i];
+                }
+                for (std::size_t s=0; s < n_shared; ++s) {
+                    double sum = 0.0;
+                    for (std::size_t i=0; i < n_local; ++i) sum += Wk[r*n_local+i]*Yk[s*n_local+i];
+                    S[r*n_shared+s] -= sum;
+                }
+            }
+        }
+        if (n_shared > 0) {
+            if (!cholesky(&S[0], n_shared)) return false;
+            choleskySolve(&S[0], n_shared, ds);
+        }
+        // back substitution: Dp_l = z - Y Dp_s
+        for (std::size_t n_set=0; n_set < n_sets && n_local > 0; ++n_set) {
+            const double* Yk = Y.empty() ? NULL : &Y[n_set*n_shared*n_local];
+            double* dl = &Dp[n_shared+n_set*n_local];
+            for (std::size_t i=0; i < n_local; ++i) {
+                double sum = z[n_set*n_local+i];
+                for (std::size_t s=0; s < n_shared; ++s) sum -= Yk[s*n_local+i]*ds[s];
+                dl[i] = sum;
+            }
+        }
+        return true;
+    }
+
+    static void mirror(double* a, std::size_t n) {
+        for (std::size_t i=0; i < n; ++i)
+            for (std::size_t j=i+1; j < n; ++j)
+                a[i*n+j] = a[j*n+i];
+    }
+
+    std::size_t n_sets, n_shared, n_local;
+    Vector_double U, W, V, g, S, Y, z, Vk;
+};
+}
+
+double stfnum::lmFitGlobal( const std::vector<Vector_double>& data, double dt,
+                   const stfnum::storedFunc& fitFunc, const Vector_double& opts,
+                   const std::deque<bool>& shared, std::vector<Vector_double>& p,
+                   std::string& info, int& warning )
+{
+    std::size_t n_par = fitFunc.pInfo.size();
+    std::size_t n_sets = data.size();
+    if (n_sets == 0 || p.size() != n_sets || shared.size() != n_par) {
+        throw std::runtime_error("Error in stfnum::lmFitGlobal()\n"
+                                 "number of data sets, parameter sets and shared parameters don't match");
+    }
+    for (std::size_t n_set=0; n_set < n_sets; ++n_set) {
+        if (p[n_set].size() != n_par) {
+            throw std::runtime_error("Error in stfnum::lmFitGlobal()\n"
+                "function parameters (p_fit) and parameters entered (p) have different sizes");
+        }
+    }
+    if ( opts.size() != 6 ) {
+        throw std::runtime_error("Error in stfnum::lmFitGlobal()\nwrong number of options");
+    }
+
+    // Position of each parameter in the vector of fitted parameters;
+    // shared parameters come first:
+    std::vector<int> col(n_sets*n_par, -1);
+    Vector_double q, lb, ub;
+    for (std::size_t n_p=0; n_p < n_par; ++n_p) {
+        const stfnum::parInfo& pInfo = fitFunc.pInfo[n_p];
+        if (!pInfo.toFit || !shared[n_p]) continue;
+        double mean = 0.0;
+        for (std::size_t n_set=0; n_set < n_sets; ++n_set) {
+            col[n_set*n_par+n_p] = (int)q.size();
+            mean += p[n_set][n_p];
+        }
+        q.push_back(mean/n_sets);
+        lb.push_back(pInfo.constrained ? pInfo.constr_lb : -DBL_MAX);
+        ub.push_back(pInfo.constrained ? pInfo.constr_ub : DBL_MAX);
+    }
+    std::size_t n_shared = q.size();
+    for (std::size_t n_set=0; n_set < n_sets; ++n_set) {
+        for (std::size_t n_p=0; n_p < n_par; ++n_p) {
+            const stfnum::parInfo& pInfo = fitFunc.pInfo[n_p];
+            if (!pInfo.toFit || shared[n_p]) continue;
+            col[n_set*n_par+n_p] = (int)q.size();
+            q.push_back(p[n_set][n_p]);
+            lb.push_back(pInfo.constrained ? pInfo.constr_lb : -DBL_MAX);
+            ub.push_back(pInfo.constrained ? pInfo.constr_ub : DBL_MAX);
+        }
+    }
+    std::size_t n_local = (q.size()-n_shared)/n_sets;
+
+    std::size_t n_points = 0;
+    for (std::size_t n_set=0; n_set < n_sets; ++n_set) {
+        n_points += data[n_set].size();
+    }
+    if (q.empty() || n_points == 0) {
+        throw std::runtime_error("Array of size zero in lmFitGlobal");
+    }
+
+    // Levenberg-Marquardt iterations as in Lourakis' dlevmar_der(), with
+    // steps projected onto the bounds of constrained parameters:
+    globalFitInfo gInfo(data, p, col, n_shared, n_local, dt, fitFunc);
+    globalNormalEq normalEq(n_sets, n_shared, n_local);
+    double eps1 = opts[1], eps2_sq = opts[2]*opts[2], eps3 = opts[3];
+    // A single pass with as many iterations as lmFit would allow in all passes:
+    int itmax = (int)(opts[4]*opts[5]);
+    std::size_t m = q.size();
+    for (std::size_t i=0; i < m; ++i) {
+        q[i] = std::min(ub[i], std::max(lb[i], q[i]));
+    }
+    Vector_double Dp(m), q_new(m);
+    double mu = 0.0, sqr = 0.0;
+    int nu = 2, stop = 0, iter = 0;
+    for (iter=0; iter < itmax && !stop; ++iter) {
+        sqr = normalEq.build(gInfo, &q[0]);
+        if (!(sqr == sqr) || sqr > DBL_MAX) {
+            stop = 7;
+            break;
+        }
+        if (iter == 0) {
+            mu = opts[0]*normalEq.maxDiag();
+        }
+        double g_inf = 0.0;
+        for (std::size_t i=0; i < m; ++i) g_inf = std::max(g_inf, fabs(normalEq.g[i]));
+        if (g_inf <= eps1) {
+            stop = 1;
+            break;
+        }
+        if (sqr <= eps3) {
+            stop = 6;
+            break;
+        }
+
+        // Increase the damping until the error decreases:
+        while (true) {
+            if (normalEq.solve(mu, Dp)) {
+                double Dp_L2 = 0.0, p_L2 = 0.0;
+                for (std::size_t i=0; i < m; ++i) {
+                    Dp_L2 += Dp[i]*Dp[i];
+                    p_L2 += q[i]*q[i];
+                }
+                if (Dp_L2 <= eps2_sq*p_L2) {
+                    stop = 2;
+                    break;
+                }
+                if (Dp_L2 >= (p_L2+opts[2])/(DBL_EPSILON*DBL_EPSILON)) {
+                    stop = 4;
+                    break;
+                }
+                for (std::size_t i=0; i < m; ++i) {
+                    q_new[i] = std::min(ub[i], std::max(lb[i], q[i]+Dp[i]));
+                    Dp[i] = q_new[i]-q[i];
+                }
+                double sqr_new = 0.0;
+                for (std::size_t n_set=0; n_set < n_sets; ++n_set) {
+                    sqr_new += gInfo.sqrError(&q_new[0], n_set);
+                }
+                if (!(sqr_new == sqr_new) || sqr_new > DBL_MAX) {
+                    stop = 7;
+                    break;
+                }
+                double dL = 0.0;
+                for (std::size_t i=0; i < m; ++i) dL += Dp[i]*(mu*Dp[i]+normalEq.g[i]);
+                double dF = sqr-sqr_new;
+                if (dL > 0.0 && dF > 0.0) {
+                    double tmp = 2.0*dF/dL-1.0;
+                    tmp = 1.0-tmp*tmp*tmp;
+                    mu *= std::max(tmp, 1.0/3.0);
+                    nu = 2;
+                    q.swap(q_new);
+                    sqr = sqr_new;
+                    break;
+                }
+            }
+            mu *= nu;
+            int nu2 = nu << 1;
+            if (nu2 <= nu) {
+                stop = 5;
+                break;
+            }
+            nu = nu2;
+        }
+    }
+    if (!stop) {
+        stop = 3;
+    }
+
+    // copy back the fitted parameters:
+    for (std::size_t n_set=0; n_set < n_sets; ++n_set) {
+        for (std::size_t n_p=0; n_p < n_par; ++n_p) {
+            int c = col[n_set*n_par+n_p];
+            if (c >= 0) p[n_set][n_p] = q[c];
+        }
+    }
+
+    std::ostringstream str_info;
+    str_info << "Data sets: " << n_sets;
+    str_info << "\nIterations: " << iter;
+    str_info << "\nStopping reason:";
+    stopInfo(stop, str_info, warning);
+    info = str_info.str();
+    return sqr;
+}
+
 double stfnum::flin(double x, const Vector_double& p) { return p[0]*x + p[1]; }
 
 //! Dummy function to be passed to stfnum::storedFunc for linear functions.
@@ -66,6 +66,103 @@ double StfioDll lmFit(const Vector_double& data, double dt,
                       const stfnum::storedFunc& fitFunc, const Vector_double& opts,
                       bool use_scaling, Vector_double& p, std::string& info, int& warning );
 
+class FitContext;
+
+//! Performs a non-linear least-squares fit using the buffers of a fit context.
+/*! Same as the overload above, but the work arrays are taken from \e context,
+ *  which can be reused for subsequent fits.
+ *  \param context An stfnum::FitContext holding the work arrays.
+ *  \return The sum of squared errors between \e data and the best-fit function.
+ */
+double StfioDll lmFit(const Vector_double& data, double dt,
+                      const stfnum::storedFunc& fitFunc, const Vector_double& opts,
+                      bool use_scaling, Vector_double& p, std::string& info, int& warning,
+                      FitContext& context );
+
+//! Work arrays of stfnum::lmFit() that can be reused across fits.
+/*! Holds the levmar workspace, the (scaled) copy of the data and the parameter
+ *  buffers. Buffers only grow, so that fitting many data sets of the same
+ *  size with a single context doesn't allocate any memory after the first fit.
+ *  A context must not be used by several threads at the same time; use one
+ *  context per thread instead.
+ */
+class StfioDll FitContext {
+  public:
+    //! Constructor
+    FitContext() {}
+
+  private:
+    friend double lmFit(const Vector_double& data, double dt,
+                        const stfnum::storedFunc& fitFunc, const Vector_double& opts,
+                        bool use_scaling, Vector_double& p, std::string& info, int& warning,
+                        FitContext& context );
+
+    Vector_double work;        // levmar workspace
+    Vector_double data;        // (scaled) copy of the data
+    Vector_double xyscale;     // scaling factors
+    Vector_double p_toFit;     // parameters that are fitted
+    Vector_double old_p_toFit; // parameters of the previous pass
+    Vector_double p_const;     // parameters that are held constant
+    Vector_double p_f;         // all parameters, assembled for function evaluation
+    Vector_double jac_f;       // Jacobian of all parameters on the whole grid
+    std::deque<bool> fit_p;    // whether a parameter is fitted
+    Vector_double lb, ub;      // box constraints
+    Vector_double opts;        // levmar options
+};
+
+//! Performs several fits from different initial guesses and keeps the best one.
+/*! The first start uses \e p unchanged; the others multiply each fitted
+ *  parameter by a factor between 1/\e spread and \e spread, taken from a
+ *  Halton sequence, so that the starts are reproducible and evenly cover
+ *  the parameter space. Parameters are kept within their box constraints.
+ *  Starts are fitted in parallel if OpenMP is available.
+ *  \param data A valarray containing the data.
+ *  \param dt The sampling interval of \e data.
+ *  \param fitFunc An stfnum::storedFunc to be fitted to \e data.
+ *  \param opts Options controlling Lourakis' implementation of the algorithm.
+ *  \param use_scaling Whether to scale x and y-amplitudes to 1.0
+ *  \param p \e func's parameters. Should be set to an initial guess
+ *         on entry. Will contain the best-fit values of the best start on exit.
+ *  \param info Information about why the best fit stopped iterating
+ *  \param warning The warning code of the best fit on return.
+ *  \param n_starts Number of starts, including the initial guess.
+ *  \param spread Largest factor by which initial parameters are changed.
+ *  \return The smallest sum of squared errors of all starts.
+ */
+double StfioDll lmFitMultiStart(const Vector_double& data, double dt,
+                                const stfnum::storedFunc& fitFunc, const Vector_double& opts,
+                                bool use_scaling, Vector_double& p, std::string& info, int& warning,
+                                int n_starts=16, double spread=4.0 );
+
+//! Fits a function to several data sets at once, with some parameters shared.
+/*! Shared parameters have a single value for all data sets (e.g. a common
+ *  time constant across sweeps), all other parameters are fitted separately
+ *  for each data set. Parameters that are not fitted (parInfo::toFit==false)
+ *  keep the value given for each data set. Since every data set only depends
+ *  on the shared and on its own parameters, the normal equations are built
+ *  one data set at a time and the local parameters are eliminated, leaving a
+ *  system in the shared parameters only (Schur complement). Memory therefore
+ *  grows with the number of data sets and parameters, not with the total
+ *  number of data points. Bounds are enforced by projecting each step.
+ *  Data are not scaled.
+ *  \param data The data sets. All data sets have the sampling interval \e dt.
+ *  \param dt The sampling interval.
+ *  \param fitFunc An stfnum::storedFunc to be fitted to \e data.
+ *  \param opts Options as for lmFit(): initial damping, gradient, step and
+ *         error thresholds, and iteration limits.
+ *  \param shared For each parameter of \e fitFunc, whether it is shared.
+ *  \param p One parameter vector per data set, set to an initial guess on entry.
+ *         Shared parameters start from their mean across data sets. On exit,
+ *         contains the best-fit values; shared parameters are identical.
+ *  \param info Information about why the fit stopped iterating
+ *  \param warning A warning code on return.
+ *  \return The sum of squared errors across all data sets.
+ */
+double StfioDll lmFitGlobal(const std::vector<Vector_double>& data, double dt,
+                            const stfnum::storedFunc& fitFunc, const Vector_double& opts,
+                            const std::deque<bool>& shared, std::vector<Vector_double>& p,
+                            std::string& info, int& warning );
+
 //! Linear function.
 /*! \f[f(x)=p_0 x + p_1\f]
  *  \param x Function argument.
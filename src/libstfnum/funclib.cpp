@@ -12,6 +12,7 @@
 // along with this program; if not, write to the Free Software
 // Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 
+#include <algorithm>
 #include <cfloat>
 #include <cmath>
 #include <sstream>
@@ -39,7 +40,7 @@ std::vector< stfnum::storedFunc > stfnum::GetFuncLib() {
     parInfoMExpDe[2].toFit=true; parInfoMExpDe[2].desc="tau"; parInfoMExpDe[0].scale=stfnum::xscale; parInfoMExpDe[0].unscale=stfnum::xunscale;
     parInfoMExpDe[3].toFit=true; parInfoMExpDe[3].desc="Peak"; parInfoMExpDe[0].scale=stfnum::yscale; parInfoMExpDe[0].unscale=stfnum::yunscale;
     funcList.push_back(stfnum::storedFunc("Monoexponential with delay, start fixed to baseline",
-                                         parInfoMExpDe,fexpde,fexpde_init,stfnum::nojac,false));
+                                         parInfoMExpDe,fexpde,fexpde_init,fexpde_jac,true));
 
     // Biexponential function, free fit:
     std::vector<stfnum::parInfo> parInfoBExp=getParInfoExp(2);
@@ -63,7 +64,7 @@ std::vector< stfnum::storedFunc > stfnum::GetFuncLib() {
     // parInfoBExpDe[4].constrained = true; parInfoBExpDe[4].constr_lb = 1.0e-16; parInfoBExpDe[4].constr_ub = DBL_MAX;
     funcList.push_back(stfnum::storedFunc(
                                        "Biexponential with delay, start fixed to baseline, delay constrained to > 0",
-                                       parInfoBExpDe,fexpbde,fexpbde_init,stfnum::nojac,false));
+                                       parInfoBExpDe,fexpbde,fexpbde_init,fexpbde_jac,true));
 
     // Triexponential function, free fit:
     std::vector<stfnum::parInfo> parInfoTExp=getParInfoExp(3);
@@ -94,7 +95,7 @@ std::vector< stfnum::storedFunc > stfnum::GetFuncLib() {
     parInfoHH[2].toFit=true; parInfoHH[2].desc="tau_h";
     parInfoHH[3].toFit=false; parInfoHH[3].desc="offset";
     funcList.push_back(stfnum::storedFunc(
-                                         "Hodgkin-Huxley g_Na function, offset fixed to baseline", parInfoHH, fHH, fHH_init, stfnum::nojac, false));
+                                         "Hodgkin-Huxley g_Na function, offset fixed to baseline", parInfoHH, fHH, fHH_init, fHH_jac, true));
 
     // power of 1 gNa function:
     funcList.push_back(stfnum::storedFunc(
@@ -125,7 +126,15 @@ std::vector< stfnum::storedFunc > stfnum::GetFuncLib() {
     parInfoTExpDe[6].toFit=true;  parInfoTExpDe[6].desc="ptau1b"; parInfoTExpDe[6].scale=stfnum::noscale; parInfoTExpDe[6].unscale=stfnum::noscale;
     funcList.push_back(stfnum::storedFunc(
                                        "Triexponential with delay, start fixed to baseline, delay constrained to > 0",
-                                       parInfoTExpDe,fexptde,fexptde_init,stfnum::nojac,false));
+                                       parInfoTExpDe,fexptde,fexptde_init,fexptde_jac,true));
+
+    // Sums of exponentials can be evaluated on whole grids:
+    for (std::size_t n_f=0; n_f < funcList.size(); ++n_f) {
+        if (funcList[n_f].func == &fexp) {
+            funcList[n_f].gridFunc = fexp_grid;
+            funcList[n_f].gridJac = fexp_grid_jac;
+        }
+    }
 
     return funcList;
 }
@@ -150,6 +159,49 @@ Vector_double stfnum::fexp_jac(double x, const Vector_double& p) {
     return jac;
 }
 
+namespace {
+// Number of points after which the recurrence in fexp_grid is
+// restarted from exp():
+const std::size_t expBlock = 256;
+}
+
+void stfnum::fexp_grid(double dx, std::size_t n, const Vector_double& p, double* y) {
+    std::fill(y, y+n, p[p.size()-1]);
+    for (std::size_t n_p=0;n_p<p.size()-1;n_p+=2) {
+        double amp=p[n_p], tau=p[n_p+1];
+        double r=exp(-dx/tau);
+        for (std::size_t i0=0;i0<n;i0+=expBlock) {
+            std::size_t i1=std::min(n, i0+expBlock);
+            double e=exp(-(double)i0*dx/tau);
+            for (std::size_t i=i0;i<i1;++i) {
+                y[i]+=amp*e;
+                e*=r;
+            }
+        }
+    }
+}
+
+void stfnum::fexp_grid_jac(double dx, std::size_t n, const Vector_double& p, double* jac) {
+    std::size_t n_par=p.size();
+    for (std::size_t n_p=0;n_p<n_par-1;n_p+=2) {
+        double amp=p[n_p], tau=p[n_p+1];
+        double r=exp(-dx/tau);
+        double fac=amp/(tau*tau);
+        for (std::size_t i0=0;i0<n;i0+=expBlock) {
+            std::size_t i1=std::min(n, i0+expBlock);
+            double e=exp(-(double)i0*dx/tau);
+            for (std::size_t i=i0;i<i1;++i) {
+                jac[i*n_par+n_p]=e;
+                jac[i*n_par+n_p+1]=fac*((double)i*dx)*e;
+                e*=r;
+            }
+        }
+    }
+    for (std::size_t i=0;i<n;++i) {
+        jac[i*n_par+n_par-1]=1.0;
+    }
+}
+
 void stfnum::fexp_init(const Vector_double& data, double base, double peak, double RTLoHi, double HalfWidth, double dt, Vector_double& pInit ) {
     // Find out direction:
     bool increasing = data[0] < data[data.size()-1];
@@ -244,24 +296,19 @@ double stfnum::fexpde(double x, const Vector_double& p) {
     }
 }
 
-#if 0
 Vector_double stfnum::fexpde_jac(double x, const Vector_double& p) {
-    Vector_double jac(4);
-    if (x<p[3]) {
+    Vector_double jac(4, 0.0);
+    if (x<p[1]) {
         jac[0]=1.0;
-        jac[1]=0.0;
-        jac[2]=0.0;
-        jac[3]=0.0;
     } else {
-        double e=exp((p[3]-x)/p[1]);
+        double e=exp((p[1]-x)/p[2]);
         jac[0]=e;
-        jac[1]=(p[0]-p[2])*(p[3]-x)*(-1.0/(p[1]*p[1]))*e;
-        jac[2]=-e+1.0;
-        jac[3]=(p[0]-p[2])*(1.0/p[1])*e;
+        jac[1]=(p[0]-p[3])*e/p[2];
+        jac[2]=(p[0]-p[3])*(x-p[1])/(p[2]*p[2])*e;
+        jac[3]=1.0-e;
     }
     return jac;
 }
-#endif 
 
 void stfnum::fexpde_init(const Vector_double& data, double base, double peak, double RTLoHI, double HalfWidth, double dt, Vector_double& pInit ) {
     // Find the peak position in data:
@@ -301,29 +348,36 @@ double stfnum::fexptde(double x, const Vector_double& p) {
     }
 }
 
-#if 0
 Vector_double stfnum::fexpbde_jac(double x, const Vector_double& p) {
-    Vector_double jac(5);
-    if (x<p[1]) {
-        jac[0]=1.0;
-        jac[1]=0.0;
-        jac[2]=0.0;
-        jac[3]=0.0;
-        jac[4]=0.0;
-    } else {
-        double tpeak = p[4]*p[2]*log(p[4]/p[2])/(p[4]-p[2]);
-        double adjust = 1.0/((1.0-exp(-tpeak/p[4]))-(1.0-exp(-tpeak/p[2])));
+    Vector_double jac(5, 0.0);
+    jac[0]=1.0;
+    if (x>=p[1]) {
         double e1=exp((p[1]-x)/p[2]);
         double e2=exp((p[1]-x)/p[4]);
-        jac[0]=1.0;
-        jac[1]=adjust*p[3]/p[2] * e1 - adjust*p[3]/p[4] * e2;
-        jac[2]=adjust*p[3]*(p[1]-x)*(-1.0/(p[2]*p[2]))*e1;
-        jac[3]=adjust*e1-adjust*e2;
-        jac[4]=adjust*p[3]*(p[1]-x)*(1.0/(p[4]*p[4]))*e2;
+        jac[1]=p[3]*e1/p[2] - p[3]*e2/p[4];
+        jac[2]=p[3]*(x-p[1])/(p[2]*p[2])*e1;
+        jac[3]=e1-e2;
+        jac[4]=-p[3]*(x-p[1])/(p[4]*p[4])*e2;
+    }
+    return jac;
+}
+
+Vector_double stfnum::fexptde_jac(double x, const Vector_double& p) {
+    Vector_double jac(7, 0.0);
+    jac[0]=1.0;
+    if (x>=p[1]) {
+        double e1=exp((p[1]-x)/p[2]);
+        double e2=exp((p[1]-x)/p[4]);
+        double e3=exp((p[1]-x)/p[5]);
+        jac[1]=p[6]*p[3]*e1/p[2] + (1.0-p[6])*p[3]*e3/p[5] - p[3]*e2/p[4];
+        jac[2]=p[6]*p[3]*(x-p[1])/(p[2]*p[2])*e1;
+        jac[3]=p[6]*e1 + (1.0-p[6])*e3 - e2;
+        jac[4]=-p[3]*(x-p[1])/(p[4]*p[4])*e2;
+        jac[5]=(1.0-p[6])*p[3]*(x-p[1])/(p[5]*p[5])*e3;
+        jac[6]=p[3]*(e1-e3);
     }
     return jac;
 }
-#endif
 
 void stfnum::fexpbde_init(const Vector_double& data, double base, double peak, double RTLoHi, double HalfWidth, double dt, Vector_double& pInit ) {
     // Find the peak position in data:
@@ -410,6 +464,18 @@ double stfnum::fHH(double x, const Vector_double& p) {
     return p[0] * (m*m*m) * h + p[3];
 }
 
+Vector_double stfnum::fHH_jac(double x, const Vector_double& p) {
+    Vector_double jac(4);
+    double em = exp(-x/p[1]);
+    double m = 1 - em;
+    double h = exp(-x/p[2]);
+    jac[0] = m*m*m * h;
+    jac[1] = -3.0 * p[0] * m*m * h * x * em / (p[1]*p[1]);
+    jac[2] = p[0] * m*m*m * h * x / (p[2]*p[2]);
+    jac[3] = 1.0;
+    return jac;
+}
+
 double stfnum::fgnabiexp(double x, const Vector_double& p) {
     // p[0]: gprime_na
     // p[1]: tau_m
@@ -63,6 +63,28 @@ namespace stfnum {
      */
     Vector_double fexp_jac(double x, const Vector_double& p);
 
+    //! Evaluates stfnum::fexp() on a grid of equally spaced points.
+    /*! Computes \e y[i] = stfnum::fexp(\e i * \e dx, \e p). Rather than calling exp()
+     *  for every point, each exponential term is computed by repeated multiplication
+     *  with \f$\mathrm{e}^{-dx/p_{2i+1}}\f$, starting again from exp() every
+     *  few hundred points to limit rounding errors.
+     *  \param dx Spacing of the grid.
+     *  \param n Number of grid points.
+     *  \param p A valarray of parameters, see stfnum::fexp().
+     *  \param y On exit, the evaluated function; needs to hold \e n points.
+     */
+    void fexp_grid(double dx, std::size_t n, const Vector_double& p, double* y);
+
+    //! Evaluates stfnum::fexp_jac() on a grid of equally spaced points.
+    /*! \param dx Spacing of the grid.
+     *  \param n Number of grid points.
+     *  \param p A valarray of parameters, see stfnum::fexp().
+     *  \param jac On exit, the Jacobian in row-major order, i.e.
+     *         \e jac[i * \e p.size() + \e k] is the derivative with respect to
+     *         \e p[k] at \e i * \e dx; needs to hold \e n * \e p.size() points.
+     */
+    void fexp_grid_jac(double dx, std::size_t n, const Vector_double& p, double* jac);
+
     //! Initialises parameters for fitting stfnum::fexp() to \e data.
     /*! This needs to be made more robust.
      *  \param data The waveform of the data for the fit.
@@ -106,44 +128,21 @@ namespace stfnum {
      */
     double fexpde(double x, const Vector_double& p);
 
-#if 0
     //! Computes the Jacobian of stfnum::fexpde().
-    /*! \f{eqnarray*}
-     *      j_0(x)&=& \frac{df(x)}{dp_0} = 
-     *      \begin{cases}
-     *          1, & \mbox{if }x < p_3 \\ 
-     *          \mathrm{e}^{\frac{p_3 - x}{p_1}}, & \mbox{if }x \geq p_3
-     *      \end{cases} \\
-     *      j_1(x)&=& \frac{df(x)}{dp_1} = 
-     *      \begin{cases}
-     *          0, & \mbox{if }x < p_3 \\ 
-     *          \left( p_0-p_2 \right) \left( p_3-x \right) \frac{-1}{p_1^2} \mathrm{e}^{\frac{p_3 - x}{p_1}}, & \mbox{if }x \geq p_3
-     *      \end{cases} \\
-     *      j_2(x)&=& \frac{df(x)}{dp_2} = 
-     *      \begin{cases}
-     *          0, & \mbox{if }x < p_3 \\ 
-     *          1 - \mathrm{e}^{\frac{p_3 - x}{p_1}}, & \mbox{if }x \geq p_3
-     *      \end{cases} \\
-     *      j_3(x)&=& \frac{df(x)}{dp_3} = 
-     *      \begin{cases}
-     *          0, & \mbox{if }x < p_3 \\ 
-     *          \left( p_0-p_2 \right) \frac{1}{p_1} \mathrm{e}^{\frac{p_3 - x}{p_1}}, & \mbox{if }x \geq p_3
-     *      \end{cases}
-     *  \f} 
+    /*! With \f$e = \mathrm{e}^{\frac{p_1 - x}{p_2}}\f$ and \f$x \geq p_1\f$:
+     *  \f{eqnarray*}
+     *      j_0(x)&=& \frac{\partial f(x)}{\partial p_0} = e \\
+     *      j_1(x)&=& \frac{\partial f(x)}{\partial p_1} = \frac{p_0-p_3}{p_2} e \\
+     *      j_2(x)&=& \frac{\partial f(x)}{\partial p_2} = \left( p_0-p_3 \right) \frac{x-p_1}{p_2^2} e \\
+     *      j_3(x)&=& \frac{\partial f(x)}{\partial p_3} = 1 - e
+     *  \f}
+     *  For \f$x < p_1\f$, \f$j_0 = 1\f$ and all other derivatives are 0.
      *  \param x Function argument.
-     *  \param p A valarray of parameters, where \n
-     *         \e p[0] is the baseline, \n
-     *         \e p[1] is the time constant, \n
-     *         \e p[2] is the amplitude and \n
-     *         \e p[3] is the delay.
-     *  \return A valarray \e j with the evaluated Jacobian, where \n
-     *          \e j[0] contains the derivative with respect to \e p[0], \n
-     *          \e j[1] contains the derivative with respect to \e p[1], \n
-     *          \e j[2] contains the derivative with respect to \e p[2] and \n
-     *          \e j[3] contains the derivative with respect to \e p[3].
+     *  \param p A valarray of parameters, see stfnum::fexpde().
+     *  \return A valarray \e j with the evaluated Jacobian, where
+     *          \e j[i] contains the derivative with respect to \e p[i].
      */
     Vector_double fexpde_jac(double x, const Vector_double& p);
-#endif
     
     //! Initialises parameters for fitting stfnum::fexpde() to \e data.
     /*! \param data The waveform of the data for the fit.
@@ -196,44 +195,41 @@ namespace stfnum {
      */
     double fexptde(double x, const Vector_double& p);
 
-#if 0
-    //! Computes the Jacobian of stfnum::fexpde().
-    /*! \f{eqnarray*}
-     *      j_0(x)&=& \frac{df(x)}{dp_0} = 
-     *      \begin{cases}
-     *          1, & \mbox{if }x < p_3 \\ 
-     *          \mathrm{e}^{\frac{p_3 - x}{p_1}}, & \mbox{if }x \geq p_3
-     *      \end{cases} \\
-     *      j_1(x)&=& \frac{df(x)}{dp_1} = 
-     *      \begin{cases}
-     *          0, & \mbox{if }x < p_3 \\ 
-     *          \left( p_0-p_2 \right) \left( p_3-x \right) \frac{-1}{p_1^2} \mathrm{e}^{\frac{p_3 - x}{p_1}}, & \mbox{if }x \geq p_3
-     *      \end{cases} \\
-     *      j_2(x)&=& \frac{df(x)}{dp_2} = 
-     *      \begin{cases}
-     *          0, & \mbox{if }x < p_3 \\ 
-     *          1 - \mathrm{e}^{\frac{p_3 - x}{p_1}}, & \mbox{if }x \geq p_3
-     *      \end{cases} \\
-     *      j_3(x)&=& \frac{df(x)}{dp_3} = 
-     *      \begin{cases}
-     *          0, & \mbox{if }x < p_3 \\ 
-     *          \left( p_0-p_2 \right) \frac{1}{p_1} \mathrm{e}^{\frac{p_3 - x}{p_1}}, & \mbox{if }x \geq p_3
-     *      \end{cases}
-     *  \f} 
+    //! Computes the Jacobian of stfnum::fexpbde().
+    /*! With \f$e_i = \mathrm{e}^{\frac{p_1 - x}{p_i}}\f$ and \f$x \geq p_1\f$:
+     *  \f{eqnarray*}
+     *      j_0(x)&=& 1 \\
+     *      j_1(x)&=& p_3 \left( \frac{e_2}{p_2} - \frac{e_4}{p_4} \right) \\
+     *      j_2(x)&=& p_3 \frac{x-p_1}{p_2^2} e_2 \\
+     *      j_3(x)&=& e_2 - e_4 \\
+     *      j_4(x)&=& -p_3 \frac{x-p_1}{p_4^2} e_4
+     *  \f}
+     *  For \f$x < p_1\f$, \f$j_0 = 1\f$ and all other derivatives are 0.
      *  \param x Function argument.
-     *  \param p A valarray of parameters, where \n
-     *         \e p[0] is the baseline, \n
-     *         \e p[1] is the time constant, \n
-     *         \e p[2] is the amplitude and \n
-     *         \e p[3] is the delay.
-     *  \return A valarray \e j with the evaluated Jacobian, where \n
-     *          \e j[0] contains the derivative with respect to \e p[0], \n
-     *          \e j[1] contains the derivative with respect to \e p[1], \n
-     *          \e j[2] contains the derivative with respect to \e p[2] and \n
-     *          \e j[3] contains the derivative with respect to \e p[3].
+     *  \param p A valarray of parameters, see stfnum::fexpbde().
+     *  \return A valarray \e j with the evaluated Jacobian, where
+     *          \e j[i] contains the derivative with respect to \e p[i].
      */
     Vector_double fexpbde_jac(double x, const Vector_double& p);
-#endif
+
+    //! Computes the Jacobian of stfnum::fexptde().
+    /*! With \f$e_i = \mathrm{e}^{\frac{p_1 - x}{p_i}}\f$ and \f$x \geq p_1\f$:
+     *  \f{eqnarray*}
+     *      j_0(x)&=& 1 \\
+     *      j_1(x)&=& p_3 \left( p_6 \frac{e_2}{p_2} + (1-p_6) \frac{e_5}{p_5} - \frac{e_4}{p_4} \right) \\
+     *      j_2(x)&=& p_6 p_3 \frac{x-p_1}{p_2^2} e_2 \\
+     *      j_3(x)&=& p_6 e_2 + (1-p_6) e_5 - e_4 \\
+     *      j_4(x)&=& -p_3 \frac{x-p_1}{p_4^2} e_4 \\
+     *      j_5(x)&=& (1-p_6) p_3 \frac{x-p_1}{p_5^2} e_5 \\
+     *      j_6(x)&=& p_3 \left( e_2 - e_5 \right)
+     *  \f}
+     *  For \f$x < p_1\f$, \f$j_0 = 1\f$ and all other derivatives are 0.
+     *  \param x Function argument.
+     *  \param p A valarray of parameters, see stfnum::fexptde().
+     *  \return A valarray \e j with the evaluated Jacobian, where
+     *          \e j[i] contains the derivative with respect to \e p[i].
+     */
+    Vector_double fexptde_jac(double x, const Vector_double& p);
     
     //! Initialises parameters for fitting stfnum::fexpde() to \e data.
     /*! \param data The waveform of the data for the fit.
@@ -297,6 +293,21 @@ namespace stfnum {
      */
     double fHH(double x, const Vector_double& p);
 
+    //! Computes the Jacobian of stfnum::fHH().
+    /*! With \f$m = 1-\mathrm{e}^{\frac{-x}{p_1}}\f$ and \f$h = \mathrm{e}^{\frac{-x}{p_2}}\f$:
+     *  \f{eqnarray*}
+     *   j_0(x) &=& m^3 h \\
+     *   j_1(x) &=& -3 p_0 m^2 h \frac{x}{p_1^2} \mathrm{e}^{\frac{-x}{p_1}} \\
+     *   j_2(x) &=& p_0 m^3 h \frac{x}{p_2^2} \\
+     *   j_3(x) &=& 1
+     *  \f}
+     *  \param x Function argument.
+     *  \param p A valarray of parameters, see stfnum::fHH().
+     *  \return A valarray \e j with the evaluated Jacobian, where
+     *          \e j[i] contains the derivative with respect to \e p[i].
+     */
+    Vector_double fHH_jac(double x, const Vector_double& p);
+
     //! Computes the sum of an arbitrary number of Gaussians.
     /*! \f[
      *      f(x) = \sum_{i=0}^{n-1}p_{3i}\mathrm{e}^{- \left( \frac{x-p_{3i+1}}{p_{3i+2}} \right) ^2}
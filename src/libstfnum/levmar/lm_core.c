@@ -114,7 +114,9 @@ LM_REAL tau, eps1, eps2, eps2_sq, eps3;
 LM_REAL init_p_eL2;
 int nu=2, nu2, stop=0, nfev, njev=0, nlss=0;
 const int nm=n*m;
+#ifdef LINSOLVERS_RETAIN_MEMORY
 int (*linsolver)(LM_REAL *A, LM_REAL *B, LM_REAL *x, int m)=NULL;
+#endif
 
   mu=jacTe_inf=0.0; /* -Wall */
 
@@ -305,7 +307,10 @@ if(!(k%100)){
        * slower than LDLt; LDLt offers a good tradeoff between robustness and speed
        */
 
-      issolved=AX_EQ_B_BK(jacTjac, jacTe, Dp, m); ++nlss; linsolver=AX_EQ_B_BK;
+      issolved=AX_EQ_B_BK(jacTjac, jacTe, Dp, m); ++nlss;
+#ifdef LINSOLVERS_RETAIN_MEMORY
+      linsolver=AX_EQ_B_BK;
+#endif
       //issolved=AX_EQ_B_LU(jacTjac, jacTe, Dp, m); ++nlss; linsolver=AX_EQ_B_LU;
       //issolved=AX_EQ_B_CHOL(jacTjac, jacTe, Dp, m); ++nlss; linsolver=AX_EQ_B_CHOL;
 #ifdef HAVE_PLASMA
@@ -317,7 +322,10 @@ if(!(k%100)){
 
 #else
       /* use the LU included with levmar */
-      issolved=AX_EQ_B_LU(jacTjac, jacTe, Dp, m); ++nlss; linsolver=AX_EQ_B_LU;
+      issolved=AX_EQ_B_LU(jacTjac, jacTe, Dp, m); ++nlss;
+#ifdef LINSOLVERS_RETAIN_MEMORY
+      linsolver=AX_EQ_B_LU;
+#endif
 #endif /* HAVE_LAPACK */
 
       if(issolved){
@@ -494,7 +502,9 @@ LM_REAL tau, eps1, eps2, eps2_sq, eps3, delta;
 LM_REAL init_p_eL2;
 int nu, nu2, stop=0, nfev, njap=0, nlss=0, K=(m>=10)? m: 10, updjac, updp=1, newjac;
 const int nm=n*m;
+#ifdef LINSOLVERS_RETAIN_MEMORY
 int (*linsolver)(LM_REAL *A, LM_REAL *B, LM_REAL *x, int m)=NULL;
+#endif
 
   mu=jacTe_inf=p_L2=0.0; /* -Wall */
   updjac=newjac=0; /* -Wall */
@@ -701,7 +711,10 @@ if(!(k%100)){
      * slower than LDLt; LDLt offers a good tradeoff between robustness and speed
      */
 
-    issolved=AX_EQ_B_BK(jacTjac, jacTe, Dp, m); ++nlss; linsolver=AX_EQ_B_BK;
+    issolved=AX_EQ_B_BK(jacTjac, jacTe, Dp, m); ++nlss;
+#ifdef LINSOLVERS_RETAIN_MEMORY
+    linsolver=AX_EQ_B_BK;
+#endif
     //issolved=AX_EQ_B_LU(jacTjac, jacTe, Dp, m); ++nlss; linsolver=AX_EQ_B_LU;
     //issolved=AX_EQ_B_CHOL(jacTjac, jacTe, Dp, m); ++nlss; linsolver=AX_EQ_B_CHOL;
 #ifdef HAVE_PLASMA
@@ -712,7 +725,10 @@ if(!(k%100)){
     //issolved=AX_EQ_B_SVD(jacTjac, jacTe, Dp, m); ++nlss; linsolver=AX_EQ_B_SVD;
 #else
     /* use the LU included with levmar */
-    issolved=AX_EQ_B_LU(jacTjac, jacTe, Dp, m); ++nlss; linsolver=AX_EQ_B_LU;
+    issolved=AX_EQ_B_LU(jacTjac, jacTe, Dp, m); ++nlss;
+#ifdef LINSOLVERS_RETAIN_MEMORY
+    linsolver=AX_EQ_B_LU;
+#endif
 #endif /* HAVE_LAPACK */
 
     if(issolved){
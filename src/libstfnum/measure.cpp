@@ -31,6 +31,8 @@
 #endif
 
 #include "./stfnum.h"
+#include "./fit.h"
+#include "./funclib.h"
 #include "./measure.h"
 
 int compareDouble(const void *a, const void *b)
@@ -545,3 +547,165 @@ double stfnum::pslope(const std::vector<double>& data, std::size_t left, std::si
 #endif // WITH_PSLOPE
 
 
+
+std::vector<stfnum::MeasureResult>
+stfnum::measureBatch( const Channel& channel, const std::vector<std::size_t>& sections,
+                      const stfnum::MeasureSettings& settings, double dt )
+{
+    for (std::size_t n=0; n < sections.size(); ++n) {
+        if (sections[n] >= channel.size()) {
+            throw std::out_of_range("Section index out of range in stfnum::measureBatch()");
+        }
+    }
+
+    // same slope window as in wxStfDoc::Measure(): about 0.05 ms, at least 1 sample
+    long windowLength = lround(0.05 / dt);
+    if (windowLength < 1) windowLength = 1;
+    double factor = settings.rtFactor*0.01;
+
+    std::vector<stfnum::MeasureResult> results(sections.size());
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+    for (int n=0; n < (int)sections.size(); ++n) {
+        const Vector_double& data = channel[sections[n]].get();
+        stfnum::MeasureResult& res = results[n];
+
+        res.base = res.baseSD = res.peak = res.peakT = res.amplitude = NAN;
+        res.threshold = res.thresholdT = res.risetime = res.tLoReal = NAN;
+        res.halfwidth = res.t50LeftReal = res.maxRise = res.maxRiseT = NAN;
+        res.maxDecay = res.maxDecayT = res.slopeRatio = NAN;
+        if (data.size() < 2) continue;
+
+        double var = 0.0;
+        res.base = stfnum::base(settings.baselineMethod, var, data, settings.baseBeg, settings.baseEnd);
+        res.baseSD = sqrt(var);
+        res.peak = stfnum::peak(data, res.base, settings.peakBeg, settings.peakEnd,
+                                settings.pM, settings.dir, res.peakT);
+        res.threshold = stfnum::threshold(data, settings.peakBeg, settings.peakEnd,
+                                          settings.slopeForThreshold*dt, res.thresholdT,
+                                          windowLength);
+        // peakT is NAN if the peak window is invalid:
+        if (!(res.peakT >= 0)) continue;
+
+        double reference = res.base;
+        if (!settings.fromBase && res.thresholdT >= 0) {
+            reference = res.threshold;
+        }
+        res.amplitude = res.peak-reference;
+
+        std::size_t tLoIndex=0, tHiIndex=0, t50LeftIndex=0, t50RightIndex=0;
+        res.risetime = stfnum::risetime(data, reference, res.amplitude, 0.0, res.peakT, factor,
+                                        tLoIndex, tHiIndex, res.tLoReal) * dt;
+        res.halfwidth = stfnum::t_half(data, reference, res.amplitude, 0.0, (double)data.size()-1,
+                                       res.peakT, t50LeftIndex, t50RightIndex, res.t50LeftReal) * dt;
+
+        double maxRiseY=0.0, maxDecayY=0.0;
+        res.maxRise = stfnum::maxRise(data, (double)settings.peakBeg, res.peakT, res.maxRiseT,
+                                      maxRiseY, windowLength);
+        double t_half_3 = t50RightIndex+2.0*((double)t50RightIndex-(double)t50LeftIndex);
+        double right_decay = settings.peakEnd<=t_half_3 ? settings.peakEnd : t_half_3+1;
+        res.maxDecay = stfnum::maxDecay(data, res.peakT, right_decay, res.maxDecayT,
+                                        maxDecayY, windowLength);
+        if (res.maxDecay != 0) res.slopeRatio = res.maxRise/res.maxDecay;
+        else res.slopeRatio = 0.0;
+        res.maxRise /= dt;
+        res.maxDecay /= dt;
+    }
+
+    return results;
+}
+
+Vector_double
+stfnum::extractEvents( const Vector_double& data, const std::vector<std::size_t>& onsets,
+                       const stfnum::EventSettings& settings, double dt,
+                       std::vector<stfnum::EventResult>& results )
+{
+    if (data.empty() || settings.after == 0) {
+        throw std::out_of_range("Empty data or event window in stfnum::extractEvents()");
+    }
+    const std::size_t width = settings.before + settings.after;
+    const std::size_t onset = settings.before;
+    const long last = (long)data.size()-1;
+    double factor = settings.rtFactor*0.01;
+
+    // Monoexponential function, offset fixed to baseline:
+    std::vector<stfnum::storedFunc> funcLib = stfnum::GetFuncLib();
+    const stfnum::storedFunc& decayFunc = funcLib[1];
+    Vector_double opts = stfnum::LM_default_opts();
+
+    Vector_double block(onsets.size()*width);
+    results.resize(onsets.size());
+
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+    {
+        // per-thread buffers, reused for all events of a thread:
+        Vector_double window(width), decay, p(decayFunc.pInfo.size());
+        stfnum::FitContext fitContext;
+        std::string info;
+
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic, 16)
+#endif
+        for (int n=0; n < (int)onsets.size(); ++n) {
+            // Copy the window in three parts rather than clamping each index:
+            // points before the start and after the end of data are replaced
+            // by the first and the last point, respectively.
+            long first = (long)onsets[n] - (long)onset;
+            long end = first + (long)width;
+            long copyBeg = std::min(std::max(first, 0L), end);
+            long copyEnd = std::max(std::min(end, last+1), copyBeg);
+            std::fill(window.begin(), window.begin()+(copyBeg-first), data[0]);
+            std::copy(data.begin()+copyBeg, data.begin()+copyEnd, window.begin()+(copyBeg-first));
+            std::fill(window.begin()+(copyEnd-first), window.end(), data[last]);
+            std::copy(window.begin(), window.end(), block.begin()+(std::size_t)n*width);
+
+            stfnum::EventResult& res = results[n];
+            res.base = res.amplitude = res.peakT = res.risetime = res.tau = res.charge = NAN;
+
+            double base = window[0];
+            if (onset > 0) {
+                base = 0.0;
+                for (std::size_t n_p=0; n_p < onset; ++n_p) {
+                    base += window[n_p];
+                }
+                base /= onset;
+            }
+            res.base = base;
+            double peak = stfnum::peak(window, base, onset, width-1, 1, settings.dir, res.peakT);
+            // peakT is NAN if the peak couldn't be found:
+            if (!(res.peakT >= 0)) continue;
+            res.amplitude = peak-base;
+
+            std::size_t tLoIndex=0, tHiIndex=0;
+            double tLoReal=0.0;
+            res.risetime = stfnum::risetime(window, base, res.amplitude, (double)onset, res.peakT,
+                                            factor, tLoIndex, tHiIndex, tLoReal) * dt;
+            if (width-1 > onset) {
+                res.charge = stfnum::integrate_trapezium(window, onset, width-1, dt)
+                    - base*(width-1-onset)*dt;
+            }
+
+            // fit the decay from the peak to the end of the window:
+            std::size_t peakIndex = (std::size_t)res.peakT;
+            if (settings.fitDecay && width-peakIndex > decayFunc.pInfo.size()) {
+                decay.assign(window.begin()+peakIndex, window.end());
+                try {
+                    decayFunc.init(decay, base, peak, 0.0, 0.0, dt, p);
+                    p[2] = base;
+                    int warning = 0;
+                    stfnum::lmFit(decay, dt, decayFunc, opts, true, p, info, warning, fitContext);
+                    res.tau = p[1];
+                }
+                catch (const std::exception&) {
+                    res.tau = NAN;
+                }
+            }
+        }
+    }
+
+    return block;
+}
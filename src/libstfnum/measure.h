@@ -194,6 +194,116 @@ double  maxDecay( const std::vector<double>& data, double left, double right, do
 double pslope( const std::vector<double>& data, std::size_t left, std::size_t right);
 
 #endif
+
+//! Cursor settings used by stfnum::measureBatch().
+/*! Mirrors the measurement settings of a document. All cursor positions
+ *  are given in units of sampling points.
+ */
+struct StfioDll MeasureSettings {
+    //! Default constructor
+    MeasureSettings()
+    : baseBeg(0), baseEnd(0), peakBeg(0), peakEnd(0), pM(1),
+      dir(stfnum::both), baselineMethod(stfnum::mean_sd),
+      rtFactor(20), slopeForThreshold(20.0), fromBase(true) {}
+
+    std::size_t baseBeg;   /*!< First point of the baseline window. */
+    std::size_t baseEnd;   /*!< Last point of the baseline window. */
+    std::size_t peakBeg;   /*!< First point of the peak window. */
+    std::size_t peakEnd;   /*!< Last point of the peak window. */
+    int pM;                /*!< Number of points used for the sliding peak average. */
+    stfnum::direction dir; /*!< Peak direction. */
+    stfnum::baseline_method baselineMethod; /*!< Mean/s.d. or median/IQR. */
+    int rtFactor;          /*!< Lower rise time limit in percent (e.g. 20 for 20-80%). */
+    double slopeForThreshold; /*!< Slope (per x unit) at which the threshold is detected. */
+    bool fromBase;         /*!< Measure amplitudes from baseline rather than from threshold. */
+};
+
+//! Results of a single-section measurement computed by stfnum::measureBatch().
+/*! Durations and slopes are given in x units (typically ms), time points
+ *  in units of sampling points. Values that could not be determined are NAN.
+ */
+struct StfioDll MeasureResult {
+    double base;        /*!< Baseline value. */
+    double baseSD;      /*!< Baseline s.d. or IQR, depending on the baseline method. */
+    double peak;        /*!< Peak value, measured from 0. */
+    double peakT;       /*!< Peak time point. */
+    double amplitude;   /*!< Peak value measured from the reference (baseline or threshold). */
+    double threshold;   /*!< Threshold value. */
+    double thresholdT;  /*!< Threshold time point. */
+    double risetime;    /*!< Lo-Hi% rise time. */
+    double tLoReal;     /*!< Interpolated Lo% time point. */
+    double halfwidth;   /*!< Full width at half-maximal amplitude. */
+    double t50LeftReal; /*!< Interpolated left 50% time point. */
+    double maxRise;     /*!< Maximal slope of rise. */
+    double maxRiseT;    /*!< Time point of the maximal slope of rise. */
+    double maxDecay;    /*!< Maximal slope of decay. */
+    double maxDecayT;   /*!< Time point of the maximal slope of decay. */
+    double slopeRatio;  /*!< Ratio of the maximal slopes of rise and decay. */
+};
+
+//! Measure several sections of a channel in a single call.
+/*! Applies the same kernels as wxStfDoc::Measure() to each of the requested
+ *  sections. Sections are measured in parallel if OpenMP is available.
+ *  Throws std::out_of_range if a section index is out of range.
+ *  \param channel The channel containing the sections.
+ *  \param sections Indices of the sections to be measured.
+ *  \param settings Cursor settings applied to every section.
+ *  \param dt The sampling interval.
+ *  \return One MeasureResult per entry in \e sections, in the same order.
+ */
+StfioDll
+std::vector<MeasureResult> measureBatch( const Channel& channel, const std::vector<std::size_t>& sections,
+                                         const MeasureSettings& settings, double dt );
+
+//! Window and measurement settings used by stfnum::extractEvents().
+/*! All lengths are given in units of sampling points. */
+struct StfioDll EventSettings {
+    //! Default constructor
+    EventSettings()
+    : before(0), after(0), dir(stfnum::both), rtFactor(20), fitDecay(true) {}
+
+    std::size_t before;    /*!< Number of points before the event onset; these form the baseline. */
+    std::size_t after;     /*!< Number of points from the event onset to the end of the window. */
+    stfnum::direction dir; /*!< Peak direction. */
+    int rtFactor;          /*!< Lower rise time limit in percent (e.g. 20 for 20-80%). */
+    bool fitDecay;         /*!< Fit a monoexponential function to the decay of each event. */
+};
+
+//! Measurements of a single event computed by stfnum::extractEvents().
+/*! Durations are given in x units (typically ms), time points in units of
+ *  sampling points relative to the start of the event window. Values that
+ *  could not be determined are NAN.
+ */
+struct StfioDll EventResult {
+    double base;      /*!< Mean of the points before the event onset. */
+    double amplitude; /*!< Peak value measured from the baseline. */
+    double peakT;     /*!< Peak time point. */
+    double risetime;  /*!< Lo-Hi% rise time. */
+    double tau;       /*!< Time constant of a monoexponential fit from the peak to the end
+                           of the window, with the offset fixed to the baseline. */
+    double charge;    /*!< Integral of the event above the baseline from the onset to the
+                           end of the window (trapezium rule). */
+};
+
+//! Extract and measure events in a single pass.
+/*! Copies a window of (\e before + \e after) points around each event onset
+ *  into one contiguous block and measures each event in the same pass.
+ *  Points outside of \e data are replaced by the first or last point of
+ *  \e data. Events are processed in parallel if OpenMP is available.
+ *  Throws std::out_of_range if \e data is empty or \e after is 0.
+ *  \param data The waveform containing the events.
+ *  \param onsets Indices of the event onsets within \e data.
+ *  \param settings Window and measurement settings.
+ *  \param dt The sampling interval.
+ *  \param results On exit, one EventResult per onset.
+ *  \return The event windows, stored event by event; the window of
+ *          event n starts at n*(\e before + \e after).
+ */
+StfioDll
+Vector_double extractEvents( const Vector_double& data, const std::vector<std::size_t>& onsets,
+                             const EventSettings& settings, double dt,
+                             std::vector<EventResult>& results );
+
 /*@}*/
 
 }
@@ -28,6 +28,12 @@
 int isnan(double x) { return x != x; }
 int isinf(double x) { return !isnan(x) && isnan(x - x); }
 
+namespace {
+    // Only fftw_execute is thread-safe; planning and destroying plans
+    // has to be serialized.
+    stfio::Mutex fftwMutex;
+}
+
 stfnum::Table::Table(std::size_t nRows,std::size_t nCols) :
 values(nRows,std::vector<double>(nCols,1.0)),
     empty(nRows,std::deque<bool>(nCols,false)),
@@ -204,7 +210,10 @@ stfnum::filter( const Vector_double& data, std::size_t filter_start,
     }
 
     //plan the fft and execute it:
-    p1 =fftw_plan_dft_r2c_1d((int)filter_size,in,out,FFTW_ESTIMATE);
+    {
+        stfio::MutexLocker lock(fftwMutex);
+        p1 =fftw_plan_dft_r2c_1d((int)filter_size,in,out,FFTW_ESTIMATE);
+    }
     fftw_execute(p1);
 
     for (std::size_t n_point=0; n_point < (unsigned int)(filter_size/2)+1; ++n_point) {
@@ -216,7 +225,10 @@ stfnum::filter( const Vector_double& data, std::size_t filter_start,
     }
 
     //do the reverse fft:
-    p2=fftw_plan_dft_c2r_1d((int)filter_size,out,in,FFTW_ESTIMATE);
+    {
+        stfio::MutexLocker lock(fftwMutex);
+        p2=fftw_plan_dft_c2r_1d((int)filter_size,out,in,FFTW_ESTIMATE);
+    }
     fftw_execute(p2);
 
     //fill the return array, adding the offset, and scaling by filter_size
@@ -225,8 +237,11 @@ stfnum::filter( const Vector_double& data, std::size_t filter_start,
     for (std::size_t n_point=0; n_point < filter_size; ++n_point) {
         data_return[n_point]=(in[n_point]/filter_size + offset_0 + offset_step*n_point);
     }
-    fftw_destroy_plan(p1);
-    fftw_destroy_plan(p2);
+    {
+        stfio::MutexLocker lock(fftwMutex);
+        fftw_destroy_plan(p1);
+        fftw_destroy_plan(p2);
+    }
     fftw_free(in);fftw_free(out);
     return data_return;
 }
@@ -745,16 +760,22 @@ stfnum::deconvolve(const Vector_double& dataIn, const Vector_double& templ,
     fftw_complex* out_data = (fftw_complex *)fftw_malloc(sizeof(fftw_complex) * ((int)(data.size()/2)+1));
 
     //plan the ffts and execute them:
-    p_data =fftw_plan_dft_r2c_1d((int)data.size(), in_data, out_data,
-                                 FFTW_ESTIMATE);
+    {
+        stfio::MutexLocker lock(fftwMutex);
+        p_data =fftw_plan_dft_r2c_1d((int)data.size(), in_data, out_data,
+                                     FFTW_ESTIMATE);
+    }
     fftw_execute(p_data);
     if (isnan(out_data[0][0]) || isinf(out_data[0][0])) {
         data_return.resize(0);
         throw std::runtime_error("Unstable fft; try again avoiding any test pulses (if present)");
     }
     fftw_complex* out_templ_padded = (fftw_complex *)fftw_malloc(sizeof(fftw_complex) * ((int)(data.size()/2)+1));
-    p_templ =fftw_plan_dft_r2c_1d((int)data.size(),
-                                  in_templ_padded, out_templ_padded, FFTW_ESTIMATE);
+    {
+        stfio::MutexLocker lock(fftwMutex);
+        p_templ =fftw_plan_dft_r2c_1d((int)data.size(),
+                                      in_templ_padded, out_templ_padded, FFTW_ESTIMATE);
+    }
     fftw_execute(p_templ);
 
     double SI=1.0/SR; //the sampling interval
@@ -793,7 +814,10 @@ stfnum::deconvolve(const Vector_double& dataIn, const Vector_double& templ,
     }
 
     //do the reverse fft:
-    p_inv = fftw_plan_dft_c2r_1d((int)data.size(),out_data, in_data, FFTW_ESTIMATE);
+    {
+        stfio::MutexLocker lock(fftwMutex);
+        p_inv = fftw_plan_dft_c2r_1d((int)data.size(),out_data, in_data, FFTW_ESTIMATE);
+    }
     fftw_execute(p_inv);
 
     //fill the return array, adding the offset, and scaling by data.size()
@@ -802,9 +826,12 @@ stfnum::deconvolve(const Vector_double& dataIn, const Vector_double& templ,
         data_return[n_point]= in_data[n_point]/data.size();
     }
 
-    fftw_destroy_plan(p_data);
-    fftw_destroy_plan(p_templ);
-    fftw_destroy_plan(p_inv);
+    {
+        stfio::MutexLocker lock(fftwMutex);
+        fftw_destroy_plan(p_data);
+        fftw_destroy_plan(p_templ);
+        fftw_destroy_plan(p_inv);
+    }
 
     fftw_free(in_data);
     fftw_free(out_data);
@@ -66,6 +66,18 @@ typedef boost::function<double(double, const Vector_double&)> Func;
 //! The jacobian of a stfnum::Func.
 typedef boost::function<Vector_double(double, const Vector_double&)> Jac;
 
+//! A stfnum::Func evaluated on a grid of equally spaced points.
+/*! Takes the grid spacing, the number of points, the parameters and a pointer
+ *  to the result, so that a whole fit window is evaluated in a single call.
+ */
+typedef boost::function<void(double, std::size_t, const Vector_double&, double*)> GridFunc;
+
+//! A stfnum::Jac evaluated on a grid of equally spaced points.
+/*! Same as stfnum::GridFunc; the result is stored in row-major order with
+ *  one row of derivatives per grid point.
+ */
+typedef boost::function<void(double, std::size_t, const Vector_double&, double*)> GridJac;
+
 //! Scaling function for fit parameters
 typedef boost::function<double(double, double, double, double, double)> Scale;
 
@@ -258,6 +270,8 @@ struct StfioDll storedFunc {
     Jac jac;                     /*!< Jacobian of func. */
     bool hasJac;                 /*!< True if the function has an analytic Jacobian. */
     Output output;               /*!< Output of the fit. */
+    GridFunc gridFunc;           /*!< Optional evaluation of func on a whole grid; empty if not available. */
+    GridJac gridJac;             /*!< Optional evaluation of jac on a whole grid; empty if not available. */
 //    bool hasId;                  /*!< Determines whether a function should have an id. */
 
 };
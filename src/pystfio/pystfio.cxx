@@ -92,63 +92,301 @@ bool _read(const std::string& filename, const std::string& ftype, bool verbose,
 
     stfio::txtImportSettings tis;
     stfio::StdoutProgressInfo progDlg("File import", "Starting file import", 100, verbose);
-    
+    bool success = false;
+
+    /* No Python objects are touched during the import, so that other
+       Python threads can run while the file is being read. */
+    Py_BEGIN_ALLOW_THREADS
     try {
-        if (!stfio::importFile(filename, stftype, Data, tis, progDlg)) {
+        success = stfio::importFile(filename, stftype, Data, tis, progDlg);
+        if (!success) {
             std::cerr << "Error importing file\n";
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error importing file:\n"
+                  << e.what() << std::endl;
+        success = false;
+    }
+    Py_END_ALLOW_THREADS
+
+    return success;
+}
+
+bool _read_text(const std::string& filename, int hlines, int ncolumns, bool first_is_time,
+                bool to_section, double sr, const std::string& yunits,
+                const std::string& yunits_ch2, const std::string& xunits,
+                bool verbose, Recording& Data)
+{
+    stfio::txtImportSettings tis;
+    tis.hLines = hlines;
+    tis.ncolumns = ncolumns;
+    tis.firstIsTime = first_is_time;
+    tis.toSection = to_section;
+    tis.sr = sr;
+    tis.yUnits = yunits;
+    tis.yUnitsCh2 = yunits_ch2;
+    tis.xUnits = xunits;
+    stfio::StdoutProgressInfo progDlg("File import", "Starting file import", 100, verbose);
+    bool success = false;
+
+    Py_BEGIN_ALLOW_THREADS
+    try {
+        success = stfio::importFile(filename, stfio::ascii, Data, tis, progDlg);
+        if (!success) {
+            std::cerr << "Error importing file\n";
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error importing file:\n"
+                  << e.what() << std::endl;
+        success = false;
+    }
+    Py_END_ALLOW_THREADS
+
+    return success;
+}
+
+bool _read_selection(const std::string& filename, const std::string& ftype, bool verbose,
+                     PyObject* channels, int first_sweep, int last_sweep, int group, int series,
+                     double t_start, double t_end, Recording& Data)
+{
+#ifndef TEST_MINIMAL
+    stfio::filetype stftype = gettype(ftype);
+#else
+    const stfio::filetype stftype = stfio::none;
+#endif // TEST_MINIMAL
+
+    stfio::ImportFilter filter;
+    if (channels != NULL && channels != Py_None) {
+        PyObject* seq = PySequence_Fast(channels, "channels must be a sequence of integers");
+        if (seq == NULL) {
+            PyErr_Clear();
+            std::cerr << "channels must be a sequence of integers\n";
             return false;
         }
+        Py_ssize_t nchannels = PySequence_Fast_GET_SIZE(seq);
+        for (Py_ssize_t n = 0; n < nchannels; ++n) {
+            Py_ssize_t n_c = PyNumber_AsSsize_t(PySequence_Fast_GET_ITEM(seq, n), NULL);
+            if (n_c == -1 && PyErr_Occurred()) {
+                PyErr_Clear();
+                Py_DECREF(seq);
+                std::cerr << "channels must be a sequence of integers\n";
+                return false;
+            }
+            filter.channels.push_back((int)n_c);
+        }
+        Py_DECREF(seq);
+    }
+    filter.firstSweep = first_sweep;
+    filter.lastSweep = last_sweep;
+    filter.group = group;
+    filter.series = series;
+    filter.tStart = t_start;
+    filter.tEnd = t_end;
+
+    stfio::txtImportSettings tis;
+    stfio::StdoutProgressInfo progDlg("File import", "Starting file import", 100, verbose);
+    bool success = false;
+
+    Py_BEGIN_ALLOW_THREADS
+    try {
+        success = stfio::importFile(filename, stftype, Data, tis, filter, progDlg);
+        if (!success) {
+            std::cerr << "Error importing file\n";
+        }
     } catch (const std::exception& e) {
         std::cerr << "Error importing file:\n"
                   << e.what() << std::endl;
+        success = false;
+    }
+    Py_END_ALLOW_THREADS
+
+    return success;
+}
+
+stfio::LazyFile* _open_lazy(const std::string& filename, const std::string& ftype) {
+
+#ifndef TEST_MINIMAL
+    stfio::filetype stftype = gettype(ftype);
+#else
+    const stfio::filetype stftype = stfio::none;
+#endif // TEST_MINIMAL
+
+    stfio::LazyFile* file = NULL;
+
+    Py_BEGIN_ALLOW_THREADS
+    try {
+        file = stfio::openLazyFile(filename, stftype);
+    } catch (const std::exception& e) {
+        std::cerr << "Error opening file:\n"
+                  << e.what() << std::endl;
+        file = NULL;
+    }
+    Py_END_ALLOW_THREADS
+
+    return file;
+}
+
+bool _lazy_header(stfio::LazyFile* file, Recording& Data) {
+    if (file == NULL) {
         return false;
     }
-        
+    Data = file->GetHeader();
     return true;
 }
 
+Section* _lazy_section(stfio::LazyFile* file, int n_c, int n_s) {
+    if (file == NULL || n_c < 0 || n_s < 0) {
+        return NULL;
+    }
+    Section* sec = new Section();
+    bool success = false;
+
+    Py_BEGIN_ALLOW_THREADS
+    try {
+        file->ReadSection(n_c, n_s, *sec);
+        success = true;
+    } catch (const std::exception& e) {
+        std::cerr << "Error reading section:\n"
+                  << e.what() << std::endl;
+    }
+    Py_END_ALLOW_THREADS
+
+    if (!success) {
+        delete sec;
+        return NULL;
+    }
+    return sec;
+}
+
+bool _lazy_write(stfio::LazyFile* file, const std::string& fname, const std::string& ftype, bool verbose) {
+    if (file == NULL) {
+        return false;
+    }
+    stfio::filetype stftype = gettype(ftype);
+    bool success = false;
+
+    Py_BEGIN_ALLOW_THREADS
+    stfio::StdoutProgressInfo progDlg("File export", "Writing file", 100, verbose);
+    try {
+        success = stfio::exportFile(fname, stftype, *file, progDlg, true);
+    } catch (const std::exception& e) {
+        std::cerr << "Couldn't write to file:\n"
+                  << e.what() << std::endl;
+        success = false;
+    }
+    Py_END_ALLOW_THREADS
+
+    return success;
+}
+
+PyObject* _probe(const std::string& filename, const std::string& ftype) {
+
+#ifndef TEST_MINIMAL
+    stfio::filetype stftype = gettype(ftype);
+#else
+    const stfio::filetype stftype = stfio::none;
+#endif // TEST_MINIMAL
+
+    stfio::FileInfo info;
+    bool success = false;
+
+    Py_BEGIN_ALLOW_THREADS
+    try {
+        info = stfio::probeFile(filename, stftype);
+        success = true;
+    } catch (const std::exception& e) {
+        std::cerr << "Error reading file header:\n"
+                  << e.what() << std::endl;
+    }
+    Py_END_ALLOW_THREADS
+
+    if (!success) {
+        Py_INCREF(Py_None);
+        return Py_None;
+    }
+
+    PyObject* channels = PyList_New(info.channels.size());
+    for (std::size_t n_c=0; n_c < info.channels.size(); ++n_c) {
+        PyList_SetItem(channels, n_c,
+                       Py_BuildValue("{s:s,s:s,s:n}",
+                                     "name", info.channels[n_c].name.c_str(),
+                                     "yunits", info.channels[n_c].yunits.c_str(),
+                                     "sections", (Py_ssize_t)info.channels[n_c].sections));
+    }
+    const struct tm& dt = info.datetime;
+    return Py_BuildValue("{s:d,s:s,s:(iiiiii),s:s,s:s,s:N}",
+                         "dt", info.dt,
+                         "xunits", info.xunits.c_str(),
+                         "datetime", dt.tm_year+1900, dt.tm_mon+1, dt.tm_mday,
+                                     dt.tm_hour, dt.tm_min, dt.tm_sec,
+                         "comment", info.comment.c_str(),
+                         "file_description", info.file_description.c_str(),
+                         "channels", channels);
+}
+
+void set_cache_directory(const std::string& dir) {
+    stfio::SetCacheDirectory(dir);
+}
+
+std::string get_cache_directory() {
+    return stfio::GetCacheDirectory();
+}
+
 PyObject* detect_events(double* data, int size_data, double* templ, int size_templ,
                         double dt, const std::string& mode, bool norm, double lowpass, double highpass)
 {
     wrap_array();
 
-    Vector_double vtempl(templ, &templ[size_templ]);
-    if (norm) {
-        double fmin = *std::min_element(vtempl.begin(), vtempl.end());
-        double fmax = *std::max_element(vtempl.begin(), vtempl.end());
-        double basel = 0;
-        double normval = 1.0;
-        if (fabs(fmin) > fabs(fmax)) {
-            basel = fmax;
-        } else {
-            basel = fmin;
-        }
-        vtempl = stfio::vec_scal_minus(vtempl, basel);
-        fmin = *std::min_element(vtempl.begin(), vtempl.end());
-        fmax = *std::max_element(vtempl.begin(), vtempl.end());
-        if (fabs(fmin) > fabs(fmax)) {
-            normval = fabs(fmin);
-        } else {
-            normval = fabs(fmax);
+    Vector_double detect;
+    std::string errorMsg;
+
+    /* Exceptions must not leave the block without the GIL; the error is
+       reported after it has been reacquired. */
+    Py_BEGIN_ALLOW_THREADS
+    try {
+        Vector_double vtempl(templ, &templ[size_templ]);
+        if (norm) {
+            double fmin = *std::min_element(vtempl.begin(), vtempl.end());
+            double fmax = *std::max_element(vtempl.begin(), vtempl.end());
+            double basel = 0;
+            double normval = 1.0;
+            if (fabs(fmin) > fabs(fmax)) {
+                basel = fmax;
+            } else {
+                basel = fmin;
+            }
+            vtempl = stfio::vec_scal_minus(vtempl, basel);
+            fmin = *std::min_element(vtempl.begin(), vtempl.end());
+            fmax = *std::max_element(vtempl.begin(), vtempl.end());
+            if (fabs(fmin) > fabs(fmax)) {
+                normval = fabs(fmin);
+            } else {
+                normval = fabs(fmax);
+            }
+            vtempl = stfio::vec_scal_div(vtempl, normval);
         }
-        vtempl = stfio::vec_scal_div(vtempl, normval);
-    }
-    Vector_double trace(data, &data[size_data]);
-    Vector_double detect(size_data);
-    if (mode=="criterion") {
-        stfio::StdoutProgressInfo progDlg("Computing detection criterion...", "Computing detection criterion...", 100, true);
-        detect = stfnum::detectionCriterion(trace, vtempl, progDlg);
-    } else if (mode=="correlation") {
-        stfio::StdoutProgressInfo progDlg("Computing linear correlation...", "Computing linear correlation...", 100, true);
-        detect = stfnum::linCorr(trace, vtempl, progDlg);
-    } else if (mode=="deconvolution") {
-        stfio::StdoutProgressInfo progDlg("Computing detection criterion...", "Computing detection criterion...", 100, true);
-        try {
+        Vector_double trace(data, &data[size_data]);
+        detect.resize(size_data);
+        if (mode=="criterion") {
+            stfio::StdoutProgressInfo progDlg("Computing detection criterion...", "Computing detection criterion...", 100, true);
+            detect = stfnum::detectionCriterion(trace, vtempl, progDlg);
+        } else if (mode=="correlation") {
+            stfio::StdoutProgressInfo progDlg("Computing linear correlation...", "Computing linear correlation...", 100, true);
+            detect = stfnum::linCorr(trace, vtempl, progDlg);
+        } else if (mode=="deconvolution") {
+            stfio::StdoutProgressInfo progDlg("Computing detection criterion...", "Computing detection criterion...", 100, true);
             detect = stfnum::deconvolve(trace, vtempl, 1.0/dt, highpass, lowpass, progDlg);
-        } catch (const std::runtime_error& e) {
-            std::cerr << e.what() << std::endl;
-            return Py_BuildValue("");
         }
+    } catch (const std::exception& e) {
+        errorMsg = std::string("Error while detecting events:\n") + e.what();
+    } catch (...) {
+        errorMsg = "Unknown error while detecting events";
+    }
+    Py_END_ALLOW_THREADS
+
+    if (!errorMsg.empty()) {
+        std::cerr << errorMsg << std::endl;
+        return Py_BuildValue("");
     }
     npy_intp dims[1] = {(int)detect.size()};
     PyObject* np_array = PyArray_SimpleNew(1, dims, NPY_DOUBLE);
@@ -163,9 +401,24 @@ PyObject* detect_events(double* data, int size_data, double* templ, int size_tem
 PyObject* peak_detection(double* invec, int size, double threshold, int min_distance) {
     wrap_array();
 
-    Vector_double data(invec, &invec[size]);
+    std::vector<int> peak_idcs;
+    std::string errorMsg;
+
+    Py_BEGIN_ALLOW_THREADS
+    try {
+        Vector_double data(invec, &invec[size]);
+        peak_idcs = stfnum::peakIndices(data, threshold, min_distance);
+    } catch (const std::exception& e) {
+        errorMsg = std::string("Error while detecting peaks:\n") + e.what();
+    } catch (...) {
+        errorMsg = "Unknown error while detecting peaks";
+    }
+    Py_END_ALLOW_THREADS
 
-    std::vector<int> peak_idcs = stfnum::peakIndices(data, threshold, min_distance);
+    if (!errorMsg.empty()) {
+        std::cerr << errorMsg << std::endl;
+        return Py_BuildValue("");
+    }
 
     npy_intp dims[1] = {(int)peak_idcs.size()};
     PyObject* np_array = PyArray_SimpleNew(1, dims, NPY_INT);
@@ -192,17 +445,116 @@ PyObject* peak_detection(double* invec, int size, double threshold, int min_dist
 double risetime(double* invec, int size, double base, double amp, double frac) {
     wrap_array();
 
-    Vector_double data(invec, &invec[size]);
-    double itLoReal, itHiReal, otLoReal, otHiReal;
-    std::size_t argmax = 0;
-    if (size > 0) {
-        double max = data[0];
-        for (std::size_t nd=1; nd < data.size(); ++nd) {
-            if (data[nd] > max) {
-                max = data[nd];
-                argmax = nd;
+    double rt = 0;
+    std::string errorMsg;
+
+    Py_BEGIN_ALLOW_THREADS
+    try {
+        Vector_double data(invec, &invec[size]);
+        double itLoReal, itHiReal, otLoReal, otHiReal;
+        std::size_t argmax = 0;
+        if (size > 0) {
+            double max = data[0];
+            for (std::size_t nd=1; nd < data.size(); ++nd) {
+                if (data[nd] > max) {
+                    max = data[nd];
+                    argmax = nd;
+                }
             }
         }
+        rt = stfnum::risetime2(data, base, amp, 0, argmax, frac, itLoReal, itHiReal, otLoReal, otHiReal);
+    } catch (const std::exception& e) {
+        errorMsg = std::string("Error while measuring the rise time:\n") + e.what();
+    } catch (...) {
+        errorMsg = "Unknown error while measuring the rise time";
     }
-    return stfnum::risetime2(data, base, amp, 0, argmax, frac, itLoReal, itHiReal, otLoReal, otHiReal);
+    Py_END_ALLOW_THREADS
+
+    if (!errorMsg.empty()) {
+        std::cerr << errorMsg << std::endl;
+        return NAN;
+    }
+    return rt;
+}
+
+PyObject* extract_events(double* data, int size_data, double* onsets, int n_onsets, double dt,
+                         int before, int after, const std::string& direction,
+                         int rt_factor, bool fit_decay)
+{
+    wrap_array();
+
+    stfnum::EventSettings settings;
+    if (before < 0 || after < 1) {
+        std::cerr << "Invalid event window" << std::endl;
+        return Py_BuildValue("");
+    }
+    settings.before = before;
+    settings.after = after;
+    if (direction=="up") {
+        settings.dir = stfnum::up;
+    } else if (direction=="down") {
+        settings.dir = stfnum::down;
+    } else if (direction=="both") {
+        settings.dir = stfnum::both;
+    } else {
+        std::cerr << "Direction must be one of \"up\", \"down\" or \"both\"" << std::endl;
+        return Py_BuildValue("");
+    }
+    settings.rtFactor = rt_factor;
+    settings.fitDecay = fit_decay;
+
+    std::vector<std::size_t> vonsets(n_onsets);
+    for (int n=0; n < n_onsets; ++n) {
+        if (onsets[n] < 0 || onsets[n] >= size_data) {
+            std::cerr << "Event onset out of range" << std::endl;
+            return Py_BuildValue("");
+        }
+        vonsets[n] = (std::size_t)onsets[n];
+    }
+
+    Vector_double block;
+    std::vector<stfnum::EventResult> results;
+    std::string errorMsg;
+
+    Py_BEGIN_ALLOW_THREADS
+    try {
+        Vector_double trace(data, &data[size_data]);
+        block = stfnum::extractEvents(trace, vonsets, settings, dt, results);
+    } catch (const std::exception& e) {
+        errorMsg = std::string("Error while extracting events:\n") + e.what();
+    } catch (...) {
+        errorMsg = "Unknown error while extracting events";
+    }
+    Py_END_ALLOW_THREADS
+
+    if (!errorMsg.empty()) {
+        std::cerr << errorMsg << std::endl;
+        return Py_BuildValue("");
+    }
+
+    npy_intp dims[2] = {(npy_intp)n_onsets, (npy_intp)(before+after)};
+    PyObject* np_block = PyArray_SimpleNew(2, dims, NPY_DOUBLE);
+    std::copy(block.begin(), block.end(), (double*)array_data(np_block));
+
+    const char* labels[] = {"base", "amplitude", "peak_t", "risetime", "tau", "charge"};
+    PyObject* table = PyDict_New();
+    for (int nl=0; nl < 6; ++nl) {
+        PyObject* column = PyArray_SimpleNew(1, dims, NPY_DOUBLE);
+        double* gDataP = (double*)array_data(column);
+        for (std::size_t n=0; n < results.size(); ++n) {
+            const stfnum::EventResult& res = results[n];
+            switch (nl) {
+             case 0: gDataP[n] = res.base; break;
+             case 1: gDataP[n] = res.amplitude; break;
+             case 2: gDataP[n] = res.peakT; break;
+             case 3: gDataP[n] = res.risetime; break;
+             case 4: gDataP[n] = res.tau; break;
+             default: gDataP[n] = res.charge; break;
+            }
+        }
+        PyDict_SetItemString(table, labels[nl], column);
+        Py_DECREF(column);
+    }
+
+    return Py_BuildValue("(NN)", np_block, table);
 }
@@ -17,10 +17,27 @@ wrap_array();
 
 stfio::filetype gettype(const std::string& ftype);
 bool _read(const std::string& filename, const std::string& ftype, bool verbose, Recording& Data);
+bool _read_text(const std::string& filename, int hlines, int ncolumns, bool first_is_time,
+                bool to_section, double sr, const std::string& yunits,
+                const std::string& yunits_ch2, const std::string& xunits,
+                bool verbose, Recording& Data);
+bool _read_selection(const std::string& filename, const std::string& ftype, bool verbose,
+                     PyObject* channels, int first_sweep, int last_sweep, int group, int series,
+                     double t_start, double t_end, Recording& Data);
+stfio::LazyFile* _open_lazy(const std::string& filename, const std::string& ftype);
+bool _lazy_header(stfio::LazyFile* file, Recording& Data);
+Section* _lazy_section(stfio::LazyFile* file, int n_c, int n_s);
+bool _lazy_write(stfio::LazyFile* file, const std::string& fname, const std::string& ftype, bool verbose);
+PyObject* _probe(const std::string& filename, const std::string& ftype);
+void set_cache_directory(const std::string& dir);
+std::string get_cache_directory();
 PyObject* detect_events(double* data, int size_data, double* templ, int size_templ, double dt,
                         const std::string& mode="criterion",
                         bool norm=true, double lowpass=0.5, double highpass=0.0001);
 PyObject* peak_detection(double* invec, int size, double threshold, int min_distance);
 double risetime(double* invec, int size, double base, double amp, double frac=0.2);
+PyObject* extract_events(double* data, int size_data, double* onsets, int n_onsets, double dt,
+                         int before, int after, const std::string& direction="both",
+                         int rt_factor=20, bool fit_decay=true);
 
 #endif
@@ -38,6 +38,7 @@ static int myErr = 0; // flag to save error state
 %apply (TYPE* IN_ARRAY1, int DIM1) {(TYPE* invec, int size)};
 %apply (TYPE* IN_ARRAY1, int DIM1) {(TYPE* data, int size_data)};
 %apply (TYPE* IN_ARRAY1, int DIM1) {(TYPE* templ, int size_templ)};
+%apply (TYPE* IN_ARRAY1, int DIM1) {(TYPE* onsets, int n_onsets)};
 
 %enddef    /* %apply_numpy_typemaps() macro */
 
@@ -70,6 +71,12 @@ class Channel {
 class Section {
 };
 
+namespace stfio {
+%nodefaultctor LazyFile;
+class LazyFile {
+};
+}
+
 %exception Recording::__getitem__ {
     assert(!myErr);
     $action
@@ -304,6 +311,27 @@ class Section {
         }
     }
     int __len__() { return $self->size(); }
+
+    %feature("autodoc", "Returns all sections of the channel as a 2D numpy array
+of shape (number of sections, number of sampling points).
+Sections that are shorter than the longest section are padded with NaN.") asarray;
+    PyObject* asarray() {
+        std::size_t n_points = 0;
+        for (std::size_t n_s = 0; n_s < $self->size(); ++n_s) {
+            n_points = std::max(n_points, (*($self))[n_s].size());
+        }
+        npy_intp dims[2] = {(npy_intp)$self->size(), (npy_intp)n_points};
+        PyObject* np_array = PyArray_SimpleNew(2, dims, NPY_DOUBLE);
+        double* gDataP = (double*)array_data(np_array);
+
+        for (std::size_t n_s = 0; n_s < $self->size(); ++n_s) {
+            const Vector_double& sec = (*($self))[n_s].get();
+            double* row = &gDataP[n_s*n_points];
+            std::copy(sec.begin(), sec.end(), row);
+            std::fill(row+sec.size(), row+n_points, NAN);
+        }
+        return np_array;
+    };
 }
 
 %{
@@ -379,6 +407,65 @@ verbose  -- Show info while reading
 Returns:
 A recording object.") _read;
 bool _read(const std::string& filename, const std::string& ftype, bool verbose, Recording& Data);
+
+%feature("autodoc", 0) _read_text;
+%feature("docstring", "Reads a text file. Use read_text() instead.") _read_text;
+bool _read_text(const std::string& filename, int hlines, int ncolumns, bool first_is_time,
+                bool to_section, double sr, const std::string& yunits,
+                const std::string& yunits_ch2, const std::string& xunits,
+                bool verbose, Recording& Data);
+
+%feature("autodoc", 0) _read_selection;
+%feature("docstring", "Reads selected channels and sweeps of a file.
+Use read(..., channels=..., sweeps=..., window=...) instead.") _read_selection;
+bool _read_selection(const std::string& filename, const std::string& ftype, bool verbose,
+                     PyObject* channels, int first_sweep, int last_sweep, int group, int series,
+                     double t_start, double t_end, Recording& Data);
+//--------------------------------------------------------------------
+
+//--------------------------------------------------------------------
+%extend stfio::LazyFile {
+    ~LazyFile() {delete $self;}
+}
+
+%newobject _open_lazy;
+%feature("autodoc", 0) _open_lazy;
+%feature("docstring", "Opens a file for on-demand reading of its sections.
+Use read(..., lazy=True) instead.") _open_lazy;
+stfio::LazyFile* _open_lazy(const std::string& filename, const std::string& ftype);
+
+%feature("autodoc", 0) _lazy_header;
+bool _lazy_header(stfio::LazyFile* file, Recording& Data);
+
+%newobject _lazy_section;
+%feature("autodoc", 0) _lazy_section;
+Section* _lazy_section(stfio::LazyFile* file, int n_c, int n_s);
+
+%feature("autodoc", 0) _lazy_write;
+%feature("docstring", "Writes a lazily read file section by section.
+Use LazyRecording.write() instead.") _lazy_write;
+bool _lazy_write(stfio::LazyFile* file, const std::string& fname, const std::string& ftype, bool verbose);
+
+%feature("autodoc", 0) _probe;
+%feature("docstring", "Reads the metadata of a file. Use probe() instead.") _probe;
+PyObject* _probe(const std::string& filename, const std::string& ftype);
+
+%feature("autodoc", 0) set_cache_directory;
+%feature("docstring", "Sets the directory used to cache decoded files.
+
+Files read with read() are stored in this directory and read
+back from there as long as they haven't been modified. Generic
+text files are never cached.
+
+Arguments:
+dir -- An existing directory, or an empty string to
+       disable the cache (the default).") set_cache_directory;
+void set_cache_directory(const std::string& dir);
+
+%feature("autodoc", 0) get_cache_directory;
+%feature("docstring", "Returns the directory used to cache decoded
+files, or an empty string if the cache is disabled.") get_cache_directory;
+std::string get_cache_directory();
 //--------------------------------------------------------------------
 
 //--------------------------------------------------------------------
@@ -413,6 +500,34 @@ Arguments:
 double risetime(double* invec, int size, double base, double amp, double frac=0.2);
 //--------------------------------------------------------------------
 
+//--------------------------------------------------------------------
+%feature("autodoc", 0) extract_events;
+%feature("kwargs") extract_events;
+%feature("docstring", "Extracts events into a 2D array and measures them.
+
+Arguments:
+data       -- 1D numpy array with the trace.
+onsets     -- Event onsets in sampling points, e.g. from peak_detection().
+dt         -- Sampling interval.
+before     -- Number of points before each onset (used as baseline).
+after      -- Number of points from each onset to the end of the window.
+direction  -- Peak direction, one of \"up\", \"down\" or \"both\".
+rt_factor  -- Lower rise time limit in percent (20 for 20-80%).
+fit_decay  -- Fit a monoexponential function to each decay.
+
+Returns:
+A tuple (events, table). events is a 2D array with one row of
+before+after points per event; points outside of data are
+replaced by the first or last point of data. table is a dict of
+1D arrays with the keys \"base\", \"amplitude\", \"peak_t\" (in
+points relative to the window start), \"risetime\", \"tau\" and
+\"charge\" (in x units). Values that could not be determined are
+nan. Returns None on failure.") extract_events;
+PyObject* extract_events(double* data, int size_data, double* onsets, int n_onsets, double dt,
+                         int before, int after, const std::string& direction="both",
+                         int rt_factor=20, bool fit_decay=true);
+//--------------------------------------------------------------------
+
 //--------------------------------------------------------------------
 %pythoncode {
 import os
@@ -433,7 +548,103 @@ filetype = {
     '.axgd':'axg',
     '.axgx':'axg'}
 
-def read(fname, ftype=None, verbose=False):
+class LazyChannel(object):
+    """ A channel of a LazyRecording. Sections are read from the
+    file when they are first accessed and cached afterwards. """
+    def __init__(self, lazyrec, n_c, channel):
+        self._rec = lazyrec
+        self._n_c = n_c
+        self._sections = [None] * len(channel)
+        self.name = channel.name
+        self.yunits = channel.yunits
+
+    def __len__(self):
+        return len(self._sections)
+
+    def __getitem__(self, at):
+        if at < 0:
+            at += len(self._sections)
+        if at < 0 or at >= len(self._sections):
+            raise IndexError("Index out of bounds")
+        if self._sections[at] is None:
+            self._sections[at] = self._rec._read_section(self._n_c, at)
+        return self._sections[at]
+
+    def asarray(self):
+        """Returns all sections of the channel as a 2D numpy array
+        (see Channel.asarray())."""
+        return Channel([sec for sec in self], self.yunits).asarray()
+
+class LazyRecording(object):
+    """ A Recording whose sections are read from the file on demand.
+    For the file types listed in read(), only the file headers are read
+    when the object is created. Use load() to obtain a complete Recording. """
+    def __init__(self, fname, ftype):
+        import threading
+        self._file = _open_lazy(fname, ftype)
+        if self._file is None:
+            raise StfIOException('Error reading file')
+        # a single file must not be read from several threads at once
+        self._lock = threading.Lock()
+        header = Recording()
+        _lazy_header(self._file, header)
+        self.dt = header.dt
+        self.file_description = header.file_description
+        self.time = header.time
+        self.date = header.date
+        self.comment = header.comment
+        self.xunits = header.xunits
+        self.datetime = header.datetime
+        self._channels = [LazyChannel(self, n_c, header[n_c])
+                          for n_c in range(len(header))]
+
+    def __len__(self):
+        return len(self._channels)
+
+    def __getitem__(self, at):
+        return self._channels[at]
+
+    def _read_section(self, n_c, n_s):
+        with self._lock:
+            sec = _lazy_section(self._file, n_c, n_s)
+        if sec is None:
+            raise StfIOException('Error reading section %d of channel %d' % (n_s, n_c))
+        return sec
+
+    def write(self, fname, ftype="hdf5", verbose=False):
+        """Writes the recording to a file, reading one section at a time,
+        so that files that don't fit into memory can be converted.
+        The next section is read while the current one is written.
+
+        Arguments:
+        fname  -- file name
+        ftype  -- file type (string), as in Recording.write()
+        verbose-- Show info while writing
+
+        Returns:
+        True upon successful completion."""
+        with self._lock:
+            return _lazy_write(self._file, fname, ftype, verbose)
+
+    def load(self):
+        """Reads all remaining sections and returns a Recording object."""
+        channels = []
+        for ch in self._channels:
+            channel = Channel([sec for sec in ch], ch.yunits)
+            channel.name = ch.name
+            channels.append(channel)
+        rec = Recording(channels)
+        rec.dt = self.dt
+        rec.file_description = self.file_description
+        rec.time = self.time
+        rec.date = self.date
+        rec.comment = self.comment
+        rec.xunits = self.xunits
+        rec.datetime = self.datetime
+        return rec
+
+def read(fname, ftype=None, verbose=False, lazy=False, channels=None,
+         sweeps=None, group=None, series=None, window=None):
     """Reads a file and returns a Recording object.
 
     Arguments:
@@ -455,9 +666,42 @@ def read(fname, ftype=None, verbose=False):
               parameter become obsolete; eventually it will be removed.
 #endif // TEST_MINIMAL
     verbose-- Show info while reading file
+    lazy   -- If True, a LazyRecording is returned that reads each section
+              when it is first accessed.
+              HDF5, ABF, AXG, HEKA bundles and files that libbiosig reads
+              record by record (e.g. GDF) are read section by section;
+              other file types (e.g. SMR) are read completely when the
+              file is opened. HEKA bundles whose series have different
+              sampling rates are left to libbiosig.
+    channels -- list of zero-based indices of the channels to be read, in
+              the order in which they should appear in the Recording;
+              None (default) reads all channels
+    sweeps -- the zero-based sweeps to be read, either as a range object
+              or as a (start, stop) tuple where stop is excluded as in
+              range(); None (default) reads all sweeps
+    group  -- zero-based index of the HEKA group to be read; None (default)
+              reads all groups
+    series -- zero-based index of the HEKA series to be read; None
+              (default) reads all series
+    window -- (start, stop) tuple with the time window to be read from
+              each sweep, in x units (usually ms) relative to the start of
+              the sweep; stop is excluded, and either of them can be None.
+              None (default) reads complete sweeps
+
+    Unselected channels and sweeps of ABF, AXG and HDF5 files are never
+    read from disk, and only the selected traces of HEKA bundles are read.
+    Files read by libbiosig (e.g. GDF, EDF, CFS) only decode the selected
+    channels and the data records within the time window, unless libbiosig
+    decodes the complete file when opening it (e.g. HEKA files that aren't
+    bundles). Other file types are read completely before the selection
+    is applied.
+    Selections can't be combined with lazy reading.
+
+    The GIL is released while the file is being read, so that several
+    files can be read concurrently from different Python threads.
 
     Returns:
-    A Recording object.
+    A Recording object, or a LazyRecording object if lazy is True.
     """
     if not os.path.exists(fname):
         raise StfIOException('File %s does not exist' % fname)
@@ -471,8 +715,48 @@ def read(fname, ftype=None, verbose=False):
             raise StfIOException('Couldn\'t guess file type from extension (%s)' % ext)
 #endif // TEST_MINIMAL
 
+    selection = (channels is not None or sweeps is not None or
+                 group is not None or series is not None or
+                 window is not None)
+
+    if lazy:
+        if selection:
+            raise StfIOException('Selections can\'t be combined with lazy reading')
+        return LazyRecording(fname, ftype)
+
     rec = Recording()
-    if not _read(fname, ftype, verbose, rec):
+    if selection:
+        first_sweep, last_sweep = 0, -1
+        if sweeps is not None:
+            try:
+                start, stop = sweeps.start, sweeps.stop
+                if getattr(sweeps, 'step', None) not in (None, 1):
+                    raise StfIOException('Sweeps have to be contiguous')
+            except AttributeError:
+                start, stop = sweeps
+            if start is not None:
+                first_sweep = start
+            if stop is not None:
+                if stop <= first_sweep:
+                    raise StfIOException('No sweeps selected')
+                last_sweep = stop-1
+        if group is None:
+            group = -1
+        if series is None:
+            series = -1
+        t_start, t_end = 0.0, -1.0
+        if window is not None:
+            start, stop = window
+            if start is not None:
+                t_start = start
+            if stop is not None:
+                if stop <= t_start:
+                    raise StfIOException('Empty time window')
+                t_end = stop
+        if not _read_selection(fname, ftype, verbose, channels, first_sweep,
+                               last_sweep, group, series, t_start, t_end, rec):
+            raise StfIOException('Error reading file')
+    elif not _read(fname, ftype, verbose, rec):
         raise StfIOException('Error reading file')
 
     if verbose:
@@ -481,6 +765,90 @@ def read(fname, ftype=None, verbose=False):
     return rec
 
 
+def read_text(fname, ncolumns=2, hlines=1, first_is_time=True, to_section=True,
+              sr=20.0, yunits="mV", yunits_ch2="pA", xunits="ms", verbose=False):
+    """Reads a text file with one row of numbers per line and returns
+    a Recording object.
+
+    Arguments:
+    fname         -- file name
+    ncolumns      -- number of columns, including the time column
+    hlines        -- number of header lines; they are stored in the
+                     file description
+    first_is_time -- True if the first column contains time values,
+                     which are used to determine the sampling interval
+    to_section    -- True if columns should be put into different sections
+                     of a single channel, False if they should be put into
+                     different channels
+    sr            -- sampling rate in kHz if first_is_time is False
+    yunits        -- y units of the first channel
+    yunits_ch2    -- y units of the second channel
+    xunits        -- x units
+    verbose       -- Show info while reading file
+
+    Numbers may be separated by spaces, tabs or commas and always use '.'
+    as the decimal separator. The GIL is released while the file is being
+    read.
+
+    Returns:
+    A Recording object.
+    """
+    if not os.path.exists(fname):
+        raise StfIOException('File %s does not exist' % fname)
+
+    rec = Recording()
+    if not _read_text(fname, hlines, ncolumns, first_is_time, to_section, sr,
+                      yunits, yunits_ch2, xunits, verbose, rec):
+        raise StfIOException('Error reading file')
+
+    if verbose:
+        print("")
+
+    return rec
+
+
+def probe(fname, ftype=None):
+    """Reads the metadata of a file without reading its data.
+
+    Arguments:
+    fname  -- file name
+    ftype  -- file type (string), see read()
+
+    Only the file headers are read. ABF, AXG, CFS, HDF5, Intan, HEKA
+    bundles and GDF files are supported; other file types can't be
+    probed without reading them completely, and StfIOException is raised.
+    It is also raised for HEKA bundles whose series have different
+    sampling intervals, which a single "dt" can't describe.
+
+    Returns:
+    A dictionary with the keys "dt", "xunits", "datetime" (a
+    datetime.datetime object or None if the date is invalid), "comment",
+    "file_description" and "channels". "channels" is a list of
+    dictionaries with the keys "name", "yunits" and "sections".
+    """
+    import datetime
+    if not os.path.exists(fname):
+        raise StfIOException('File %s does not exist' % fname)
+
+#ifndef TEST_MINIMAL
+    if ftype is None:
+        ext = os.path.splitext(fname)[1]
+        try:
+            ftype = filetype[ext]
+        except KeyError:
+            raise StfIOException('Couldn\'t guess file type from extension (%s)' % ext)
+#endif // TEST_MINIMAL
+
+    info = _probe(fname, ftype)
+    if info is None:
+        raise StfIOException('Error reading file')
+    try:
+        info["datetime"] = datetime.datetime(*info["datetime"])
+    except ValueError:
+        info["datetime"] = None
+    return info
+
+
 def read_tdms(fn):
     import numpy as np
     import sys
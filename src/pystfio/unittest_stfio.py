@@ -20,6 +20,9 @@ Number of traces = 3
 Sampling interval  = 0.05
  
 """
+import os
+import shutil
+import tempfile
 import numpy as np
 import unittest
 
@@ -58,6 +61,106 @@ class DataListTest(unittest.TestCase):
     #     # test if Recording object was created
     #     self.assertTrue(True, isinstance(rec, stfio.Recording))
 
+    def testReadLazy(self):
+        """ testReadLazy() Read sections on demand """
+        lazyrec = stfio.read('test.h5', lazy=True)
+        self.assertEquals(len(rec), len(lazyrec))
+        self.assertEquals(len(rec[0]), len(lazyrec[0]))
+        self.assertEquals(rec[1].yunits, lazyrec[1].yunits)
+        self.assertAlmostEqual(rec.dt, lazyrec.dt, 3)
+        np.testing.assert_array_equal(rec[0][2].asarray(), lazyrec[0][2].asarray())
+        self.assertRaises(IndexError, lazyrec[0].__getitem__, len(rec[0]))
+
+    def testWriteLazy(self):
+        """ testWriteLazy() Convert a file section by section """
+        lazyrec = stfio.read('test.h5', lazy=True)
+        self.assertTrue(lazyrec.write('lazy.h5'))
+        newrec = stfio.read('lazy.h5')
+        self.assertEquals(len(rec), len(newrec))
+        self.assertEquals(rec[1].name, newrec[1].name)
+        np.testing.assert_array_equal(rec[1][2].asarray(), newrec[1][2].asarray())
+        self.assertEquals(False, lazyrec.write('lazy.abf', 'abf'))
+
+    def testReadSelection(self):
+        """ testReadSelection() Read selected channels and sweeps """
+        selrec = stfio.read('test.h5', channels=[2, 0], sweeps=range(1, 3))
+        self.assertEquals(len(selrec), 2)
+        self.assertEquals(selrec[0].name, rec[2].name)
+        self.assertEquals(selrec[1].yunits, rec[0].yunits)
+        self.assertEquals(len(selrec[0]), 2)
+        np.testing.assert_array_equal(selrec[0][0].asarray(), rec[2][1].asarray())
+        np.testing.assert_array_equal(selrec[1][1].asarray(), rec[0][2].asarray())
+
+        selrec = stfio.read('test.h5', sweeps=(2, None))
+        self.assertEquals(len(selrec), len(rec))
+        self.assertEquals(len(selrec[3]), 1)
+
+        selrec = stfio.read('test.h5', channels=[1], window=(10*rec.dt, 20*rec.dt))
+        self.assertEquals(len(selrec[0][0]), 10)
+        np.testing.assert_array_equal(selrec[0][2].asarray(), rec[1][2].asarray()[10:20])
+        self.assertRaises(stfio.StfIOException, stfio.read, 'test.h5', channels=[4])
+        self.assertRaises(stfio.StfIOException, stfio.read, 'test.h5',
+                          channels=[0], lazy=True)
+
+    def testProbe(self):
+        """ testProbe() Read metadata without reading data """
+        info = stfio.probe('test.h5')
+        self.assertEquals(len(rec), len(info["channels"]))
+        self.assertEquals(len(rec[0]), info["channels"][0]["sections"])
+        self.assertEquals(rec[0].name, info["channels"][0]["name"])
+        self.assertEquals(rec[1].yunits, info["channels"][1]["yunits"])
+        self.assertAlmostEqual(rec.dt, info["dt"], 3)
+
+    def testCache(self):
+        """ testCache() Read files from the cache directory """
+        cachedir = tempfile.mkdtemp()
+        stfio.set_cache_directory(cachedir)
+        try:
+            self.assertEquals(cachedir, stfio.get_cache_directory())
+            rec1 = stfio.read('test.h5')
+            self.assertEquals(1, len(os.listdir(cachedir)))
+            rec2 = stfio.read('test.h5')
+        finally:
+            stfio.set_cache_directory("")
+            shutil.rmtree(cachedir)
+        self.assertEquals(len(rec1), len(rec2))
+        self.assertEquals(rec1[1].yunits, rec2[1].yunits)
+        self.assertAlmostEqual(rec1.dt, rec2.dt, 3)
+        np.testing.assert_array_equal(rec1[0][2].asarray(), rec2[0][2].asarray())
+
+    def testReadText(self):
+        """ testReadText() Read a generic text file """
+        fd, fname = tempfile.mkstemp(suffix='.txt')
+        with os.fdopen(fd, 'w') as f:
+            f.write("time\tch0\tch1\n")
+            for n in range(100):
+                f.write("%g\t%.17g\t%.17g\n" % (0.05*n, n/3.0, -n))
+        try:
+            txtrec = stfio.read_text(fname, ncolumns=3)
+        finally:
+            os.remove(fname)
+        self.assertEquals(1, len(txtrec))
+        self.assertEquals(2, len(txtrec[0]))
+        self.assertAlmostEqual(0.05, txtrec.dt, 6)
+        np.testing.assert_array_equal(np.arange(100)/3.0, txtrec[0][0].asarray())
+        np.testing.assert_array_equal(-np.arange(100.0), txtrec[0][1].asarray())
+
+    def testExtractEvents(self):
+        """ testExtractEvents() Extract and measure events """
+        dt = 0.01
+        trace = np.zeros(3000)
+        onsets = np.array([500, 1500])
+        for onset in onsets:
+            trace[onset:onset+20] += np.arange(20)/20.0
+            trace[onset+20:onset+400] += np.exp(-np.arange(380)*dt)
+        events, table = stfio.extract_events(trace, onsets, dt, 50, 400,
+                                             direction="up")
+        self.assertEquals((2, 450), events.shape)
+        np.testing.assert_array_equal(trace[450:900], events[0])
+        self.assertAlmostEqual(1.0, table["amplitude"][1], 2)
+        self.assertAlmostEqual(1.0, table["tau"][0], 2)
+        self.assertEquals(None, stfio.extract_events(trace, onsets, dt, 50, 0))
+
     def testReadStfException(self):
         """ Raises a StfException if file format to read is not supported"""
 
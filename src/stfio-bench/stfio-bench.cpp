@@ -0,0 +1,983 @@
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+/*! \file stfio-bench.cpp
+ *  \brief Micro- and macro-benchmarks of libstfio and libstfnum.
+ *
+ *  Times file import per format, filtering, template matching, fitting
+ *  of every function in the library, the basic measurements and averaging.
+ *  All data are synthetic and generated from a fixed seed, so that results
+ *  of different builds and machines can be compared. Formats that libstfio
+ *  can't write (ABF, AXG, HEKA, Intan) are only timed when a file is given
+ *  on the command line. Every benchmark writes one JSON object (or one
+ *  tab-separated line) to the output.
+ *
+ *  Usage: stfio-bench [options]
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cctype>
+#include <cstring>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/time.h>
+#endif
+
+#include "../libstfio/stfio.h"
+#include "../libstfnum/stfnum.h"
+#include "../libstfnum/measure.h"
+#include "../libstfnum/fit.h"
+#include "../libstfnum/funclib.h"
+
+namespace {
+
+//! Settings from the command line
+struct BenchOptions {
+    BenchOptions()
+        : repeats(5), minTime(0.05), scale(1.0), seed(1), threads(0),
+          filter(), format("json"), outName(), tmpDir("."), inputs(),
+          list(false), quiet(false)
+    {}
+
+    int repeats;           /*!< Number of timed samples per benchmark. */
+    double minTime;        /*!< Minimal duration of a single sample in s. */
+    double scale;          /*!< Factor applied to all problem sizes. */
+    unsigned long seed;    /*!< Seed of the synthetic data. */
+    int threads;           /*!< Number of OpenMP threads; 0 for the default. */
+    std::string filter;    /*!< Only run benchmarks whose name contains this string. */
+    std::string format;    /*!< Output format: json or tsv. */
+    std::string outName;   /*!< Output file; empty for stdout. */
+    std::string tmpDir;    /*!< Directory for the synthetic files. */
+    std::vector<std::pair<stfio::filetype, std::string> > inputs; /*!< Files to be imported. */
+    bool list;             /*!< Only list the benchmarks. */
+    bool quiet;            /*!< Don't report progress on stderr. */
+};
+
+//! Timing statistics and additional metrics of a single benchmark
+struct BenchResult {
+    BenchResult()
+        : name(), label(), status("ok"), message(), size(0), unit("samples"),
+          iterations(0), times(), metrics()
+    {}
+
+    std::string name;        /*!< Benchmark name, e.g. "import/hdf5". */
+    std::string label;       /*!< Model or file name; may be empty. */
+    std::string status;      /*!< "ok", "skipped" or "failed". */
+    std::string message;     /*!< Reason for skipped or failed benchmarks. */
+    double size;             /*!< Problem size processed by a single iteration. */
+    std::string unit;        /*!< Unit of \e size. */
+    long iterations;         /*!< Iterations per timed sample. */
+    std::vector<double> times; /*!< Time per iteration of every sample in s. */
+    std::vector<std::pair<std::string, double> > metrics; /*!< Additional results. */
+};
+
+void usage(std::ostream& os) {
+    os << "Usage: stfio-bench [options]\n"
+       << "\n"
+       << "Benchmarks libstfio and libstfnum on synthetic data.\n"
+       << "\n"
+       << "Options:\n"
+       << "  -r, --repeats N      timed samples per benchmark (default: 5)\n"
+       << "  -m, --min-time S     minimal duration of a sample in s (default: 0.05)\n"
+       << "  -s, --scale F        factor applied to all problem sizes (default: 1)\n"
+       << "      --seed N         seed of the synthetic data (default: 1)\n"
+       << "  -j, --threads N      number of OpenMP threads\n"
+       << "  -b, --bench TEXT     only run benchmarks whose name contains TEXT\n"
+       << "  -i, --input [TYPE=]FILE\n"
+       << "                       also time the import of FILE; TYPE is one of abf,\n"
+       << "                       atf, axg, cfs, h5, heka, intan, son, tdms or gdf and\n"
+       << "                       is guessed from the extension if omitted\n"
+       << "  -t, --tmpdir DIR     directory for the synthetic files (default: .)\n"
+       << "  -f, --format FMT     output format: json (default) or tsv\n"
+       << "  -o, --output FILE    write the results to FILE instead of stdout\n"
+       << "  -l, --list           list the benchmarks and exit\n"
+       << "  -q, --quiet          don't report progress on stderr\n"
+       << "  -h, --help           show this help\n";
+}
+
+double wallTime() {
+#ifdef _OPENMP
+    return omp_get_wtime();
+#elif defined(_WIN32)
+    return GetTickCount() / 1000.0;
+#else
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec * 1.0e-6;
+#endif
+}
+
+double fileSize(const std::string& fName) {
+    struct stat st;
+    if (stat(fName.c_str(), &st) != 0) {
+        return 0.0;
+    }
+    return (double)st.st_size;
+}
+
+std::string toLower(std::string str) {
+    for (std::size_t n = 0; n < str.size(); ++n) {
+        str[n] = (char)std::tolower((unsigned char)str[n]);
+    }
+    return str;
+}
+
+std::string baseName(const std::string& path) {
+    std::size_t sep = path.find_last_of("/\\");
+    return (sep == std::string::npos) ? path : path.substr(sep+1);
+}
+
+stfio::filetype parseInputType(const std::string& name) {
+    std::string type = toLower(name);
+    if (type == "abf") return stfio::abf;
+    if (type == "atf") return stfio::atf;
+    if (type == "axg" || type == "axgd" || type == "axgx") return stfio::axg;
+    if (type == "cfs") return stfio::cfs;
+    if (type == "h5" || type == "hdf5") return stfio::hdf5;
+    if (type == "heka") return stfio::heka;
+    if (type == "intan" || type == "clp") return stfio::intan;
+    if (type == "son" || type == "smr") return stfio::son;
+    if (type == "tdms") return stfio::tdms;
+#if (defined(WITH_BIOSIG) || defined(WITH_BIOSIG2))
+    if (type == "gdf" || type == "biosig") return stfio::biosig;
+#endif
+    return stfio::none;
+}
+
+//! Short name of a file type, used in the benchmark names.
+std::string typeName(stfio::filetype type) {
+    switch (type) {
+    case stfio::abf: return "abf";
+    case stfio::atf: return "atf";
+    case stfio::axg: return "axg";
+    case stfio::cfs: return "cfs";
+    case stfio::hdf5: return "hdf5";
+    case stfio::heka: return "heka";
+    case stfio::intan: return "intan";
+    case stfio::son: return "son";
+    case stfio::tdms: return "tdms";
+    case stfio::biosig: return "gdf";
+    default: return "unknown";
+    }
+}
+
+//! Parses an argument of --input; "TYPE=FILE" or "FILE".
+/*! Without an explicit type, ".dat" files are read as HEKA files, since
+ *  synthetic CFS files are benchmarked anyway.
+ */
+bool parseInput(const std::string& arg, BenchOptions& options) {
+    std::string fName = arg;
+    stfio::filetype type = stfio::none;
+    std::size_t eq = arg.find('=');
+    if (eq != std::string::npos && eq > 0) {
+        type = parseInputType(arg.substr(0, eq));
+        fName = arg.substr(eq+1);
+    } else {
+        std::size_t dot = fName.rfind('.');
+        if (dot != std::string::npos) {
+            type = parseInputType(fName.substr(dot+1));
+            if (type == stfio::none) {
+                type = stfio::findType("*." + toLower(fName.substr(dot+1)));
+            }
+        }
+    }
+    if (type == stfio::none || fName.empty()) {
+        return false;
+    }
+    options.inputs.push_back(std::make_pair(type, fName));
+    return true;
+}
+
+//! Deterministic pseudo-random numbers.
+/*! A linear congruential generator, so that the synthetic data only
+ *  depend on the seed and not on the platform's C or C++ library.
+ */
+class Random {
+  public:
+    explicit Random(unsigned long seed) : state((unsigned int)(seed * 2654435761UL + 1)) {}
+
+    //! Uniformly distributed in [0, 1)
+    double uniform() {
+        state = 1664525u * state + 1013904223u;
+        return (state >> 8) / 16777216.0;
+    }
+
+    //! Normally distributed with mean 0 and standard deviation 1 (Box-Muller)
+    double normal() {
+        double u1 = 1.0 - uniform();
+        double u2 = uniform();
+        return std::sqrt(-2.0 * std::log(u1)) * std::cos(6.283185307179586 * u2);
+    }
+
+  private:
+    unsigned int state;
+};
+
+//! Sampling interval of all synthetic data in ms (20 kHz).
+const double benchDt = 0.05;
+
+//! A biexponential synaptic current with a peak amplitude of \e ampl.
+Vector_double eventTemplate(std::size_t n, double dt, double tauRise, double tauDecay, double ampl) {
+    Vector_double templ(n);
+    double tPeak = tauRise * tauDecay / (tauDecay - tauRise) * std::log(tauDecay / tauRise);
+    double norm = std::exp(-tPeak / tauDecay) - std::exp(-tPeak / tauRise);
+    for (std::size_t n_p = 0; n_p < n; ++n_p) {
+        double t = n_p * dt;
+        templ[n_p] = ampl * (std::exp(-t / tauDecay) - std::exp(-t / tauRise)) / norm;
+    }
+    return templ;
+}
+
+//! Gaussian noise with inward currents at random intervals.
+/*! Events of -20 pA (on noise with a standard deviation of 2 pA)
+ *  occur every 50 ms on average.
+ */
+Vector_double eventTrace(std::size_t n, Random& rng) {
+    Vector_double trace(n);
+    for (std::size_t n_p = 0; n_p < n; ++n_p) {
+        trace[n_p] = 2.0 * rng.normal();
+    }
+    Vector_double templ = eventTemplate(std::size_t(40.0 / benchDt), benchDt, 0.5, 5.0, -20.0);
+    std::size_t onset = 0;
+    for (;;) {
+        onset += 100 + std::size_t(rng.uniform() * 1800);
+        if (onset >= n) {
+            break;
+        }
+        std::size_t len = std::min(templ.size(), n - onset);
+        for (std::size_t n_p = 0; n_p < len; ++n_p) {
+            trace[onset + n_p] += templ[n_p];
+        }
+    }
+    return trace;
+}
+
+//! A recording with \e n_channels channels of \e n_sections sweeps.
+Recording syntheticRecording(std::size_t n_channels, std::size_t n_sections,
+                             std::size_t n_points, Random& rng)
+{
+    Recording rec(n_channels, n_sections, n_points);
+    for (std::size_t n_c = 0; n_c < n_channels; ++n_c) {
+        std::ostringstream name;
+        name << "Im" << n_c;
+        rec[n_c].SetChannelName(name.str());
+        rec[n_c].SetYUnits("pA");
+        for (std::size_t n_s = 0; n_s < n_sections; ++n_s) {
+            rec[n_c][n_s].get_w() = eventTrace(n_points, rng);
+        }
+    }
+    rec.SetXScale(benchDt);
+    rec.SetXUnits("ms");
+    rec.SetComment("stfio-bench synthetic data");
+    return rec;
+}
+
+//! Keeps the results of the timed operations alive.
+volatile double checksum = 0.0;
+
+//! A single benchmark.
+/*! setup() and teardown() are called once and aren't timed; run() is
+ *  called repeatedly and has to return a value depending on its result,
+ *  so that the work can't be optimised away.
+ */
+class Benchmark {
+  public:
+    Benchmark(const std::string& name_, const std::string& label_ = "")
+        : name(name_), label(label_) {}
+    virtual ~Benchmark() {}
+
+    //! Prepares the data. Throws if the benchmark can't run.
+    virtual void setup(BenchResult& result) {}
+    //! Runs the timed operation once.
+    virtual double run() = 0;
+    //! Adds metrics of the last run to \e result.
+    virtual void report(BenchResult& result) {}
+    //! Releases resources acquired in setup().
+    virtual void teardown() {}
+
+    std::string name;
+    std::string label;
+};
+
+//! Returned by Benchmark::setup() to report a skipped benchmark
+class SkipBenchmark : public std::runtime_error {
+  public:
+    explicit SkipBenchmark(const std::string& msg) : std::runtime_error(msg) {}
+};
+
+// ---------------------------------------------------------------------------
+// libstfio
+// ---------------------------------------------------------------------------
+
+//! Reads a complete file.
+/*! Synthetic files are written in setup(). Since the file is read once
+ *  before timing starts, the timings are those of a warm file system cache.
+ */
+class ImportBench : public Benchmark {
+  public:
+    //! Times the import of a synthetic file.
+    ImportBench(stfio::filetype type_, const Recording& source_, const std::string& tmpName)
+        : Benchmark("import/" + typeName(type_)), type(type_), fName(tmpName),
+          source(&source_), progDlg("", "", 100, false) {}
+    //! Times the import of an existing file.
+    ImportBench(stfio::filetype type_, const std::string& fName_)
+        : Benchmark("import/" + typeName(type_), baseName(fName_)), type(type_), fName(fName_),
+          source(NULL), progDlg("", "", 100, false) {}
+
+    virtual void setup(BenchResult& result) {
+        if (source != NULL) {
+            if (!stfio::exportFile(fName, type, *source, progDlg)) {
+                throw std::runtime_error("couldn't write " + fName);
+            }
+        }
+        result.size = fileSize(fName);
+        result.unit = "bytes";
+        if (result.size == 0) {
+            throw std::runtime_error("couldn't read " + fName);
+        }
+    }
+
+    virtual double run() {
+        stfio::txtImportSettings txtImport;
+        Recording rec;
+        if (!stfio::importFile(fName, type, rec, txtImport, progDlg)) {
+            throw std::runtime_error("couldn't read " + fName);
+        }
+        n_samples = 0;
+        for (std::size_t n_c = 0; n_c < rec.size(); ++n_c) {
+            for (std::size_t n_s = 0; n_s < rec[n_c].size(); ++n_s) {
+                n_samples += rec[n_c][n_s].size();
+            }
+        }
+        return (double)n_samples;
+    }
+
+    virtual void report(BenchResult& result) {
+        result.metrics.push_back(std::make_pair(std::string("samples"), (double)n_samples));
+    }
+
+    virtual void teardown() {
+        if (source != NULL) {
+            std::remove(fName.c_str());
+        }
+    }
+
+  private:
+    stfio::filetype type;
+    std::string fName;
+    const Recording* source;
+    stfio::StdoutProgressInfo progDlg;
+    std::size_t n_samples;
+};
+
+//! Placeholder for a format that can only be read, but not written.
+class MissingImportBench : public Benchmark {
+  public:
+    explicit MissingImportBench(stfio::filetype type)
+        : Benchmark("import/" + typeName(type)) {}
+
+    virtual void setup(BenchResult& result) {
+        throw SkipBenchmark("format can't be written; use --input " + name.substr(7) + "=FILE");
+    }
+    virtual double run() { return 0.0; }
+};
+
+class MakeAverageBench : public Benchmark {
+  public:
+    MakeAverageBench(const Recording& rec_)
+        : Benchmark("average"), rec(rec_), average(), sd(), sections(), shift() {}
+
+    virtual void setup(BenchResult& result) {
+        std::size_t n_points = rec[0][0].size();
+        average = Section(n_points);
+        sd = Section(n_points);
+        sections.resize(rec[0].size());
+        for (std::size_t n_s = 0; n_s < sections.size(); ++n_s) {
+            sections[n_s] = n_s;
+        }
+        shift.assign(sections.size(), 0);
+        result.size = (double)(n_points * sections.size());
+    }
+
+    virtual double run() {
+        rec.MakeAverage(average, sd, 0, sections, true, shift);
+        return average[0] + sd[0];
+    }
+
+  private:
+    const Recording& rec;
+    Section average, sd;
+    std::vector<std::size_t> sections;
+    std::vector<int> shift;
+};
+
+// ---------------------------------------------------------------------------
+// libstfnum
+// ---------------------------------------------------------------------------
+
+class FilterBench : public Benchmark {
+  public:
+    FilterBench(const std::string& name_, const Vector_double& trace_, stfnum::Func func_)
+        : Benchmark(name_), trace(trace_), func(func_), a(1, 1.0) {}
+
+    virtual void setup(BenchResult& result) {
+        result.size = (double)trace.size();
+    }
+
+    virtual double run() {
+        Vector_double filtered = stfnum::filter(trace, 0, trace.size()-1, a,
+                                                (int)(1.0/benchDt), func, false);
+        return filtered[filtered.size()/2];
+    }
+
+  private:
+    const Vector_double& trace;
+    stfnum::Func func;
+    Vector_double a; // cutoff frequency in kHz
+};
+
+//! Template matching with one of the event detection criteria.
+class DetectionBench : public Benchmark {
+  public:
+    enum Method { criterion, correlation, deconvolution };
+
+    DetectionBench(const std::string& name_, Method method_, const Vector_double& trace_,
+                   const Vector_double& templ_)
+        : Benchmark(name_), method(method_), trace(trace_), templ(templ_),
+          progDlg("", "", 100, false) {}
+
+    virtual void setup(BenchResult& result) {
+        result.size = (double)trace.size();
+        result.metrics.push_back(std::make_pair(std::string("template"), (double)templ.size()));
+    }
+
+    virtual double run() {
+        Vector_double detect;
+        switch (method) {
+        case criterion:
+            detect = stfnum::detectionCriterion(trace, templ, progDlg);
+            break;
+        case correlation:
+            detect = stfnum::linCorr(trace, templ, progDlg);
+            break;
+        case deconvolution:
+            detect = stfnum::deconvolve(trace, templ, (int)(1.0/benchDt), 0.001, 0.5, progDlg);
+            break;
+        }
+        return detect.empty() ? 0.0 : detect[detect.size()/2];
+    }
+
+  private:
+    Method method;
+    const Vector_double& trace;
+    const Vector_double& templ;
+    stfio::StdoutProgressInfo progDlg;
+};
+
+//! Baseline, peak and rise time of a single event, as measured in every sweep.
+class MeasureBench : public Benchmark {
+  public:
+    enum Method { base_mean, base_median, peak, risetime };
+
+    MeasureBench(const std::string& name_, Method method_, Random& rng)
+        : Benchmark(name_), method(method_), sweep(), onset(0), base(0), ampl(0), peakT(0)
+    {
+        sweep = eventTrace(20000, rng);
+        Vector_double templ = eventTemplate(std::size_t(40.0 / benchDt), benchDt, 0.5, 5.0, -50.0);
+        onset = 10000;
+        for (std::size_t n_p = 0; n_p < templ.size(); ++n_p) {
+            sweep[onset + n_p] += templ[n_p];
+        }
+    }
+
+    virtual void setup(BenchResult& result) {
+        double var = 0;
+        base = stfnum::base(stfnum::mean_sd, var, sweep, 0, onset-1);
+        ampl = stfnum::peak(sweep, base, onset, onset+1000, 1, stfnum::down, peakT) - base;
+        switch (method) {
+        case base_mean:
+        case base_median:
+            result.size = (double)onset;
+            break;
+        case peak:
+            result.size = 1000.0;
+            break;
+        case risetime:
+            result.size = peakT - onset;
+            break;
+        }
+    }
+
+    virtual double run() {
+        double var = 0, maxT = 0, tLoReal = 0;
+        std::size_t tLoId = 0, tHiId = 0;
+        switch (method) {
+        case base_mean:
+            return stfnum::base(stfnum::mean_sd, var, sweep, 0, onset-1) + var;
+        case base_median:
+            return stfnum::base(stfnum::median_iqr, var, sweep, 0, onset-1) + var;
+        case peak:
+            return stfnum::peak(sweep, base, onset, onset+1000, 1, stfnum::down, maxT) + maxT;
+        case risetime:
+            return stfnum::risetime(sweep, base, ampl, (double)onset, peakT, 0.2,
+                                    tLoId, tHiId, tLoReal);
+        }
+        return 0.0;
+    }
+
+  private:
+    Method method;
+    Vector_double sweep;
+    std::size_t onset;
+    double base, ampl, peakT;
+};
+
+//! Fits a function of the library to an event, as done by Analysis->Fit.
+/*! The parameters are initialised by the function's init() from the
+ *  baseline, peak, rise time and half duration of the event, so that every
+ *  run starts from the same point.
+ */
+class FitBench : public Benchmark {
+  public:
+    FitBench(std::size_t index_, const stfnum::storedFunc& func_, Random& rng)
+        : Benchmark(fitName(index_), func_.name), func(func_), data(), pInit(), p(),
+          opts(stfnum::LM_default_opts()), context(), info(), warning(0), chisqr(0)
+    {
+        data = eventTemplate(std::size_t(60.0 / benchDt), benchDt, 1.0, 10.0, 20.0);
+        for (std::size_t n_p = 0; n_p < data.size(); ++n_p) {
+            data[n_p] += -60.0 + 0.2 * rng.normal();
+        }
+    }
+
+    static std::string fitName(std::size_t index) {
+        std::ostringstream name;
+        name << "lmfit/" << index;
+        return name.str();
+    }
+
+    virtual void setup(BenchResult& result) {
+        double var = 0, maxT = 0, t50LeftReal = 0, tLoReal = 0;
+        std::size_t tLoId = 0, tHiId = 0, t50LeftId = 0, t50RightId = 0;
+        double base = stfnum::base(stfnum::mean_sd, var, data, data.size()-100, data.size()-1);
+        double peak = stfnum::peak(data, base, 0, data.size()-1, 1, stfnum::up, maxT);
+        double ampl = peak - base;
+        double rt = stfnum::risetime(data, base, ampl, 0.0, maxT, 0.2, tLoId, tHiId, tLoReal);
+        double hd = stfnum::t_half(data, base, ampl, 0.0, (double)data.size()-1, maxT,
+                                   t50LeftId, t50RightId, t50LeftReal);
+        pInit.resize(func.pInfo.size());
+        func.init(data, base, peak, rt * benchDt, hd * benchDt, benchDt, pInit);
+        result.size = (double)data.size();
+        result.metrics.push_back(std::make_pair(std::string("parameters"), (double)pInit.size()));
+    }
+
+    virtual double run() {
+        p = pInit;
+        chisqr = stfnum::lmFit(data, benchDt, func, opts, true, p, info, warning, context);
+        return chisqr;
+    }
+
+    virtual void report(BenchResult& result) {
+        result.metrics.push_back(std::make_pair(std::string("chisqr"), chisqr));
+        result.metrics.push_back(std::make_pair(std::string("warning"), (double)warning));
+    }
+
+  private:
+    const stfnum::storedFunc& func;
+    Vector_double data, pInit, p, opts;
+    stfnum::FitContext context;
+    std::string info;
+    int warning;
+    double chisqr;
+};
+
+// ---------------------------------------------------------------------------
+// Timing and output
+// ---------------------------------------------------------------------------
+
+double median(std::vector<double> values) {
+    std::sort(values.begin(), values.end());
+    std::size_t n = values.size();
+    return (n % 2 == 1) ? values[n/2] : 0.5 * (values[n/2-1] + values[n/2]);
+}
+
+//! Runs a benchmark.
+/*! The first run is a warm-up that also determines the number of
+ *  iterations per sample, so that a sample takes at least
+ *  BenchOptions::minTime.
+ */
+BenchResult measure(Benchmark& bench, const BenchOptions& options) {
+    BenchResult result;
+    result.name = bench.name;
+    result.label = bench.label;
+    bool isSetUp = false;
+    try {
+        bench.setup(result);
+        isSetUp = true;
+
+        double start = wallTime();
+        checksum = checksum + bench.run();
+        double first = wallTime() - start;
+        result.iterations = 1;
+        if (first < options.minTime) {
+            result.iterations = (first > 0) ? (long)std::ceil(options.minTime / first) : 1000000L;
+            result.iterations = std::min(result.iterations, 1000000L);
+        }
+
+        for (int n_r = 0; n_r < options.repeats; ++n_r) {
+            start = wallTime();
+            for (long n_i = 0; n_i < result.iterations; ++n_i) {
+                checksum = checksum + bench.run();
+            }
+            result.times.push_back((wallTime() - start) / result.iterations);
+        }
+        bench.report(result);
+    }
+    catch (const SkipBenchmark& e) {
+        result.status = "skipped";
+        result.message = e.what();
+    }
+    catch (const std::exception& e) {
+        result.status = "failed";
+        result.message = e.what();
+    }
+    if (isSetUp) {
+        bench.teardown();
+    }
+    return result;
+}
+
+std::string jsonString(const std::string& str) {
+    std::ostringstream json;
+    json << '"';
+    for (std::size_t n = 0; n < str.size(); ++n) {
+        unsigned char c = (unsigned char)str[n];
+        if (c == '"' || c == '\\') {
+            json << '\\' << c;
+        } else if (c < 0x20) {
+            char esc[8];
+            std::sprintf(esc, "\\u%04x", c);
+            json << esc;
+        } else {
+            json << c;
+        }
+    }
+    json << '"';
+    return json.str();
+}
+
+std::string jsonNumber(double value) {
+    if (value != value || std::fabs(value) > 1.0e300) {
+        return "null";
+    }
+    std::ostringstream json;
+    json.precision(6);
+    json << value;
+    return json.str();
+}
+
+//! Writes the results in JSON lines or tab-separated format.
+class ResultWriter {
+  public:
+    ResultWriter(std::ostream& os_, const std::string& format_)
+        : os(os_), tsv(format_ == "tsv") {}
+
+    //! Writes a record describing the run.
+    void header(const BenchOptions& options, int threads) {
+        if (tsv) {
+            os << "# stfio-bench seed=" << options.seed << " scale=" << options.scale
+               << " repeats=" << options.repeats << " threads=" << threads << "\n"
+               << "name\tlabel\tstatus\tsize\tunit\titerations\tmin_s\tmedian_s\tmean_s\tmax_s"
+               << "\trate\tmetrics\tmessage" << std::endl;
+        } else {
+            os << "{\"suite\":\"stfio-bench\",\"seed\":" << options.seed
+               << ",\"scale\":" << jsonNumber(options.scale)
+               << ",\"repeats\":" << options.repeats
+               << ",\"min_time\":" << jsonNumber(options.minTime)
+               << ",\"threads\":" << threads << "}" << std::endl;
+        }
+    }
+
+    void write(const BenchResult& result) {
+        double tMin = 0, tMedian = 0, tMean = 0, tMax = 0, rate = 0;
+        if (!result.times.empty()) {
+            tMin = *std::min_element(result.times.begin(), result.times.end());
+            tMax = *std::max_element(result.times.begin(), result.times.end());
+            tMedian = median(result.times);
+            for (std::size_t n = 0; n < result.times.size(); ++n) {
+                tMean += result.times[n] / result.times.size();
+            }
+            rate = (tMedian > 0) ? result.size / tMedian : 0;
+        }
+        bool timed = result.status == "ok";
+        if (tsv) {
+            os << result.name << "\t" << result.label << "\t" << result.status << "\t"
+               << jsonNumber(result.size) << "\t" << result.unit << "\t" << result.iterations;
+            if (timed) {
+                os << "\t" << jsonNumber(tMin) << "\t" << jsonNumber(tMedian)
+                   << "\t" << jsonNumber(tMean) << "\t" << jsonNumber(tMax)
+                   << "\t" << jsonNumber(rate) << "\t";
+            } else {
+                os << "\t\t\t\t\t\t";
+            }
+            for (std::size_t n = 0; n < result.metrics.size(); ++n) {
+                os << (n ? "," : "") << result.metrics[n].first << "="
+                   << jsonNumber(result.metrics[n].second);
+            }
+            os << "\t" << result.message << std::endl;
+            return;
+        }
+        os << "{\"name\":" << jsonString(result.name);
+        if (!result.label.empty()) {
+            os << ",\"label\":" << jsonString(result.label);
+        }
+        os << ",\"status\":" << jsonString(result.status);
+        if (!result.message.empty()) {
+            os << ",\"message\":" << jsonString(result.message);
+        }
+        if (timed) {
+            os << ",\"size\":" << jsonNumber(result.size)
+               << ",\"unit\":" << jsonString(result.unit)
+               << ",\"iterations\":" << result.iterations
+               << ",\"times_s\":[";
+            for (std::size_t n = 0; n < result.times.size(); ++n) {
+                os << (n ? "," : "") << jsonNumber(result.times[n]);
+            }
+            os << "],\"min_s\":" << jsonNumber(tMin)
+               << ",\"median_s\":" << jsonNumber(tMedian)
+               << ",\"mean_s\":" << jsonNumber(tMean)
+               << ",\"max_s\":" << jsonNumber(tMax)
+               << ",\"rate\":" << jsonNumber(rate);
+            for (std::size_t n = 0; n < result.metrics.size(); ++n) {
+                os << "," << jsonString(result.metrics[n].first) << ":"
+                   << jsonNumber(result.metrics[n].second);
+            }
+        }
+        os << "}" << std::endl;
+    }
+
+  private:
+    std::ostream& os;
+    bool tsv;
+};
+
+bool isValueOption(const std::string& arg) {
+    const char* names[] = { "-r", "--repeats", "-m", "--min-time", "-s", "--scale", "--seed",
+                            "-j", "--threads", "-b", "--bench", "-i", "--input",
+                            "-t", "--tmpdir", "-f", "--format", "-o", "--output" };
+    for (std::size_t n = 0; n < sizeof(names)/sizeof(names[0]); ++n) {
+        if (arg == names[n]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::size_t scaled(std::size_t n, double scale) {
+    return std::max((std::size_t)1, (std::size_t)(n * scale));
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    BenchOptions options;
+    for (int narg = 1; narg < argc; ++narg) {
+        std::string arg(argv[narg]);
+        bool hasValue = narg+1 < argc;
+        if (arg == "-h" || arg == "--help") {
+            usage(std::cout);
+            return 0;
+        } else if (arg == "-l" || arg == "--list") {
+            options.list = true;
+        } else if (arg == "-q" || arg == "--quiet") {
+            options.quiet = true;
+        } else if (!hasValue && isValueOption(arg)) {
+            std::cerr << "stfio-bench: option " << arg << " requires a value" << std::endl;
+            return 2;
+        } else if (arg == "-r" || arg == "--repeats") {
+            if ((options.repeats = std::atoi(argv[++narg])) < 1) {
+                std::cerr << "stfio-bench: the number of repeats has to be positive" << std::endl;
+                return 2;
+            }
+        } else if (arg == "-m" || arg == "--min-time") {
+            options.minTime = std::atof(argv[++narg]);
+        } else if (arg == "-s" || arg == "--scale") {
+            if ((options.scale = std::atof(argv[++narg])) <= 0) {
+                std::cerr << "stfio-bench: the scale has to be positive" << std::endl;
+                return 2;
+            }
+        } else if (arg == "--seed") {
+            options.seed = std::strtoul(argv[++narg], NULL, 10);
+        } else if (arg == "-j" || arg == "--threads") {
+            if ((options.threads = std::atoi(argv[++narg])) < 1) {
+                std::cerr << "stfio-bench: the number of threads has to be positive" << std::endl;
+                return 2;
+            }
+        } else if (arg == "-b" || arg == "--bench") {
+            options.filter = argv[++narg];
+        } else if (arg == "-i" || arg == "--input") {
+            if (!parseInput(argv[++narg], options)) {
+                std::cerr << "stfio-bench: unknown file type of " << argv[narg] << std::endl;
+                return 2;
+            }
+        } else if (arg == "-t" || arg == "--tmpdir") {
+            options.tmpDir = argv[++narg];
+        } else if (arg == "-f" || arg == "--format") {
+            options.format = toLower(argv[++narg]);
+            if (options.format != "json" && options.format != "tsv") {
+                std::cerr << "stfio-bench: unsupported output format" << std::endl;
+                return 2;
+            }
+        } else if (arg == "-o" || arg == "--output") {
+            options.outName = argv[++narg];
+        } else {
+            std::cerr << "stfio-bench: unknown option " << arg << std::endl;
+            usage(std::cerr);
+            return 2;
+        }
+    }
+
+    int threads = 1;
+#ifdef _OPENMP
+    if (options.threads > 0) {
+        omp_set_num_threads(options.threads);
+    }
+    threads = omp_get_max_threads();
+#endif
+
+    // Synthetic data; the generator is consumed in a fixed order
+    Random rng(options.seed);
+    Recording fileRec = syntheticRecording(4, scaled(20, options.scale), 50000, rng);
+    Recording textRec = syntheticRecording(1, scaled(10, options.scale), 20000, rng);
+    Recording avgRec = syntheticRecording(1, scaled(100, options.scale), 20000, rng);
+    Vector_double trace = eventTrace(scaled(1 << 20, options.scale), rng);
+    Vector_double templ = eventTemplate(std::size_t(20.0 / benchDt), benchDt, 0.5, 5.0, -1.0);
+    Vector_double shortTrace(trace.begin(), trace.begin() + std::min(trace.size(), scaled(1 << 16, options.scale)));
+
+    std::string tmpBase = options.tmpDir;
+    if (!tmpBase.empty() && tmpBase[tmpBase.size()-1] != '/') {
+        tmpBase += "/";
+    }
+    tmpBase += "stfio-bench-synthetic";
+
+    std::vector<Benchmark*> benchmarks;
+    benchmarks.push_back(new ImportBench(stfio::hdf5, fileRec, tmpBase + ".h5"));
+    benchmarks.push_back(new ImportBench(stfio::cfs, fileRec, tmpBase + ".cfs"));
+#ifndef WITHOUT_ABF
+    // ATF files only hold a single channel
+    benchmarks.push_back(new ImportBench(stfio::atf, textRec, tmpBase + ".atf"));
+#endif
+#if (defined(WITH_BIOSIG) || defined(WITH_BIOSIG2))
+    benchmarks.push_back(new ImportBench(stfio::biosig, fileRec, tmpBase + ".gdf"));
+#endif
+    const stfio::filetype readOnly[] = { stfio::abf, stfio::axg, stfio::heka, stfio::intan };
+    for (std::size_t n_t = 0; n_t < sizeof(readOnly)/sizeof(readOnly[0]); ++n_t) {
+        bool given = false;
+        for (std::size_t n_i = 0; n_i < options.inputs.size(); ++n_i) {
+            given = given || options.inputs[n_i].first == readOnly[n_t];
+        }
+        if (!given) {
+            benchmarks.push_back(new MissingImportBench(readOnly[n_t]));
+        }
+    }
+    for (std::size_t n_i = 0; n_i < options.inputs.size(); ++n_i) {
+        benchmarks.push_back(new ImportBench(options.inputs[n_i].first, options.inputs[n_i].second));
+    }
+    benchmarks.push_back(new MakeAverageBench(avgRec));
+
+    benchmarks.push_back(new FilterBench("filter/gauss", trace, stfnum::fgaussColqu));
+    benchmarks.push_back(new FilterBench("filter/bessel4", trace, stfnum::fbessel4));
+    benchmarks.push_back(new DetectionBench("deconvolve", DetectionBench::deconvolution, trace, templ));
+    benchmarks.push_back(new DetectionBench("detection_criterion", DetectionBench::criterion, trace, templ));
+    // linCorr scales with the product of data and template length
+    benchmarks.push_back(new DetectionBench("lincorr", DetectionBench::correlation, shortTrace, templ));
+
+    benchmarks.push_back(new MeasureBench("measure/base_mean", MeasureBench::base_mean, rng));
+    benchmarks.push_back(new MeasureBench("measure/base_median", MeasureBench::base_median, rng));
+    benchmarks.push_back(new MeasureBench("measure/peak", MeasureBench::peak, rng));
+    benchmarks.push_back(new MeasureBench("measure/risetime", MeasureBench::risetime, rng));
+
+    std::vector<stfnum::storedFunc> funcLib = stfnum::GetFuncLib();
+    for (std::size_t n_f = 0; n_f < funcLib.size(); ++n_f) {
+        benchmarks.push_back(new FitBench(n_f, funcLib[n_f], rng));
+    }
+
+    std::ofstream outFile;
+    if (!options.list && !options.outName.empty()) {
+        outFile.open(options.outName.c_str());
+        if (!outFile) {
+            std::cerr << "stfio-bench: couldn't open " << options.outName << std::endl;
+            return 2;
+        }
+    }
+    ResultWriter writer(options.outName.empty() ? std::cout : outFile, options.format);
+    if (!options.list) {
+        writer.header(options, threads);
+    }
+
+    int nFailed = 0;
+    for (std::size_t n_b = 0; n_b < benchmarks.size(); ++n_b) {
+        Benchmark& bench = *benchmarks[n_b];
+        if (!options.filter.empty() && bench.name.find(options.filter) == std::string::npos) {
+            continue;
+        }
+        if (options.list) {
+            std::cout << bench.name;
+            if (!bench.label.empty()) {
+                std::cout << "\t" << bench.label;
+            }
+            std::cout << std::endl;
+            continue;
+        }
+        BenchResult result = measure(bench, options);
+        writer.write(result);
+        if (result.status == "failed") {
+            ++nFailed;
+        }
+        if (!options.quiet) {
+            std::cerr << result.name;
+            if (!result.label.empty()) {
+                std::cerr << " (" << result.label << ")";
+            }
+            if (result.status == "ok") {
+                std::cerr << ": " << median(result.times) * 1.0e3 << " ms" << std::endl;
+            } else {
+                std::cerr << ": " << result.status << ", " << result.message << std::endl;
+            }
+        }
+    }
+
+    for (std::size_t n_b = 0; n_b < benchmarks.size(); ++n_b) {
+        delete benchmarks[n_b];
+    }
+    return (nFailed == 0) ? 0 : 1;
+}
@@ -0,0 +1,466 @@
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+/*! \file stfio-convert.cpp
+ *  \brief Command-line batch conversion of electrophysiology files.
+ *
+ *  Converts any number of files that can be read by libstfio to HDF5,
+ *  GDF, ATF or IGOR binary waves. Files are converted in parallel (when
+ *  built with OpenMP); files that stfio::openLazyFile() reads on demand
+ *  are streamed section by section, so that files that are larger than
+ *  the available memory can be converted.
+ *
+ *  Usage: stfio-convert [options] file...
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cctype>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <glob.h>
+#include <sys/time.h>
+#endif
+
+#include "../libstfio/stfio.h"
+#include "../libstfio/igor/igorlib.h"
+
+namespace {
+
+//! Settings from the command line
+struct ConvertOptions {
+    ConvertOptions()
+        : type(stfio::hdf5), extension(".h5"), outDir(), jobs(0),
+          overwrite(false), progress(true)
+    {}
+
+    stfio::filetype type;  /*!< Output file type. */
+    std::string extension; /*!< Output file extension. */
+    std::string outDir;    /*!< Output directory; empty for the input directory. */
+    int jobs;              /*!< Number of worker threads; 0 for one per processor. */
+    bool overwrite;        /*!< Replace existing output files. */
+    bool progress;         /*!< Show the progress of every file. */
+};
+
+//! Outcome of a single conversion
+struct ConvertResult {
+    ConvertResult() : success(false), bytes(0), seconds(0.0), message() {}
+
+    bool success;
+    double bytes;
+    double seconds;
+    std::string message;
+};
+
+void usage(std::ostream& os) {
+    os << "Usage: stfio-convert [options] file...\n"
+       << "\n"
+       << "Converts electrophysiology files that can be read by libstfio.\n"
+       << "Wildcards are expanded, and arguments starting with '@' are read\n"
+       << "as lists of files, one per line.\n"
+       << "\n"
+       << "Options:\n"
+       << "  -t, --type TYPE      output format: h5 (default), gdf, atf or ibw\n"
+       << "  -o, --outdir DIR     write the output files to DIR instead of the\n"
+       << "                       directory of each input file\n"
+       << "  -j, --jobs N         number of files converted concurrently\n"
+       << "                       (default: one per processor)\n"
+       << "  -f, --force          overwrite existing output files\n"
+       << "  -q, --quiet          only report the result of every file\n"
+       << "  -h, --help           show this help\n";
+}
+
+double wallTime() {
+#ifdef _OPENMP
+    return omp_get_wtime();
+#elif defined(_WIN32)
+    return GetTickCount() / 1000.0;
+#else
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec * 1.0e-6;
+#endif
+}
+
+bool fileExists(const std::string& fName) {
+    struct stat st;
+    return stat(fName.c_str(), &st) == 0;
+}
+
+bool isDirectory(const std::string& path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 && (st.st_mode & S_IFMT) == S_IFDIR;
+}
+
+double fileSize(const std::string& fName) {
+    struct stat st;
+    if (stat(fName.c_str(), &st) != 0) {
+        return 0.0;
+    }
+    return (double)st.st_size;
+}
+
+bool isSeparator(char c) {
+#ifdef _WIN32
+    return c == '/' || c == '\\';
+#else
+    return c == '/';
+#endif
+}
+
+//! Splits a path into directory (including the trailing separator), stem and extension.
+void splitPath(const std::string& path, std::string& dir, std::string& stem, std::string& ext) {
+    std::size_t nameStart = path.size();
+    while (nameStart > 0 && !isSeparator(path[nameStart-1])) {
+        --nameStart;
+    }
+    dir = path.substr(0, nameStart);
+    std::string name = path.substr(nameStart);
+    std::size_t dot = name.rfind('.');
+    if (dot == std::string::npos || dot == 0) {
+        stem = name;
+        ext = "";
+    } else {
+        stem = name.substr(0, dot);
+        ext = name.substr(dot+1);
+    }
+}
+
+std::string toLower(std::string str) {
+    for (std::size_t n = 0; n < str.size(); ++n) {
+        str[n] = (char)std::tolower((unsigned char)str[n]);
+    }
+    return str;
+}
+
+//! Guesses the type of an input file from its extension.
+/*! Files with an unknown extension are passed to libbiosig, which
+ *  determines the type from the file contents. Files with a .dat
+ *  extension are taken to be HEKA files; stfio::openLazyFile() recognizes
+ *  HEKA bundles by their contents and leaves other .dat files (e.g. CFS)
+ *  to libbiosig's file type identification, if available.
+ */
+stfio::filetype probeType(const std::string& fName) {
+    std::string dir, stem, ext;
+    splitPath(fName, dir, stem, ext);
+    stfio::filetype type = stfio::none;
+    if (!ext.empty()) {
+        type = stfio::findType("*." + toLower(ext));
+    }
+#if (defined(WITH_BIOSIG) || defined(WITH_BIOSIG2))
+    if (type == stfio::none) {
+        type = stfio::biosig;
+    }
+#endif
+    return type;
+}
+
+bool parseType(const std::string& name, ConvertOptions& options) {
+    std::string type = toLower(name);
+    if (type == "h5" || type == "hdf5") {
+        options.type = stfio::hdf5;
+        options.extension = ".h5";
+        return true;
+    }
+#if (defined(WITH_BIOSIG) || defined(WITH_BIOSIG2))
+    if (type == "gdf") {
+        options.type = stfio::biosig;
+        options.extension = ".gdf";
+        return true;
+    }
+#endif
+#ifndef WITHOUT_ABF
+    if (type == "atf") {
+        options.type = stfio::atf;
+        options.extension = ".atf";
+        return true;
+    }
+#endif
+    if (type == "ibw" || type == "igor") {
+        // The IGOR writer appends the channel name and extension itself
+        options.type = stfio::igor;
+        options.extension = "";
+        return true;
+    }
+    return false;
+}
+
+//! Adds the files matching a pattern to the list.
+/*! Arguments that don't match any file are kept, so that they are
+ *  reported as missing later on. On Windows, the C runtime expands
+ *  wildcards before main() is called.
+ */
+void expandPattern(const std::string& pattern, std::vector<std::string>& files) {
+#ifndef _WIN32
+    if (pattern.find_first_of("*?[") != std::string::npos) {
+        glob_t matches;
+        if (glob(pattern.c_str(), 0, NULL, &matches) == 0) {
+            for (std::size_t n = 0; n < matches.gl_pathc; ++n) {
+                files.push_back(matches.gl_pathv[n]);
+            }
+            globfree(&matches);
+            return;
+        }
+        globfree(&matches);
+    }
+#endif
+    files.push_back(pattern);
+}
+
+bool readFileList(const std::string& listName, std::vector<std::string>& files) {
+    std::ifstream list(listName.c_str());
+    if (!list) {
+        return false;
+    }
+    std::string line;
+    while (std::getline(list, line)) {
+        if (!line.empty() && line[line.size()-1] == '\r') {
+            line.erase(line.size()-1);
+        }
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        expandPattern(line, files);
+    }
+    return true;
+}
+
+std::string outputName(const std::string& inName, const ConvertOptions& options) {
+    std::string dir, stem, ext;
+    splitPath(inName, dir, stem, ext);
+    if (!options.outDir.empty()) {
+        dir = options.outDir;
+        if (!isSeparator(dir[dir.size()-1])) {
+            dir += "/";
+        }
+    }
+    return dir + stem + options.extension;
+}
+
+ConvertResult convertFile(const std::string& inName, const std::string& outName,
+                          const ConvertOptions& options, bool showProgress)
+{
+    ConvertResult result;
+    if (!fileExists(inName)) {
+        result.message = "file not found";
+        return result;
+    }
+    stfio::filetype inType = probeType(inName);
+    if (inType == stfio::none) {
+        result.message = "unknown file type";
+        return result;
+    }
+    if (outName == inName) {
+        result.message = "input and output file are the same";
+        return result;
+    }
+    if (!options.overwrite && !options.extension.empty() && fileExists(outName)) {
+        result.message = "output file exists (use --force to overwrite)";
+        return result;
+    }
+
+    result.bytes = fileSize(inName);
+    double start = wallTime();
+    stfio::LazyFile* source = NULL;
+    try {
+        source = stfio::openLazyFile(inName, inType);
+        // the IGOR writer derives one file name per channel from outName
+        if (!options.overwrite && options.type == stfio::igor) {
+            std::vector<std::string> waveNames = stfio::IGORFileNames(outName, source->GetHeader());
+            for (std::size_t n = 0; n < waveNames.size(); ++n) {
+                if (fileExists(waveNames[n])) {
+                    result.message = waveNames[n] + " exists (use --force to overwrite)";
+                    delete source;
+                    return result;
+                }
+            }
+        }
+        stfio::StdoutProgressInfo progDlg(inName, "Writing " + outName, 100, showProgress);
+        result.success = stfio::exportFile(outName, options.type, *source, progDlg, true);
+        if (showProgress) {
+            std::cout << std::endl;
+        }
+    }
+    catch (const std::exception& e) {
+        result.success = false;
+        result.message = e.what();
+    }
+    delete source;
+    result.seconds = wallTime() - start;
+    if (!result.success && result.message.empty()) {
+        result.message = "error while writing the file";
+    }
+    return result;
+}
+
+std::string formatRate(double bytes, double seconds) {
+    std::ostringstream rate;
+    rate.precision(3);
+    rate << bytes / 1048576.0 << " MB in " << seconds << " s";
+    if (seconds > 0) {
+        rate << " (" << bytes / 1048576.0 / seconds << " MB/s)";
+    }
+    return rate.str();
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    ConvertOptions options;
+    std::vector<std::string> files;
+    for (int narg = 1; narg < argc; ++narg) {
+        std::string arg(argv[narg]);
+        bool hasValue = narg+1 < argc;
+        if (arg == "-h" || arg == "--help") {
+            usage(std::cout);
+            return 0;
+        } else if (arg == "-t" || arg == "--type") {
+            if (!hasValue || !parseType(argv[++narg], options)) {
+                std::cerr << "stfio-convert: unsupported output type" << std::endl;
+                return 2;
+            }
+        } else if (arg == "-o" || arg == "--outdir") {
+            if (!hasValue) {
+                usage(std::cerr);
+                return 2;
+            }
+            options.outDir = argv[++narg];
+        } else if (arg == "-j" || arg == "--jobs") {
+            if (!hasValue || (options.jobs = std::atoi(argv[++narg])) < 1) {
+                std::cerr << "stfio-convert: the number of jobs has to be positive" << std::endl;
+                return 2;
+            }
+        } else if (arg == "-f" || arg == "--force") {
+            options.overwrite = true;
+        } else if (arg == "-q" || arg == "--quiet") {
+            options.progress = false;
+        } else if (arg.size() > 1 && arg[0] == '@') {
+            if (!readFileList(arg.substr(1), files)) {
+                std::cerr << "stfio-convert: couldn't read file list " << arg.substr(1) << std::endl;
+                return 2;
+            }
+        } else if (arg.size() > 1 && arg[0] == '-') {
+            std::cerr << "stfio-convert: unknown option " << arg << std::endl;
+            usage(std::cerr);
+            return 2;
+        } else {
+            expandPattern(arg, files);
+        }
+    }
+    if (files.empty()) {
+        usage(std::cerr);
+        return 2;
+    }
+    if (!options.outDir.empty() && !isDirectory(options.outDir)) {
+        std::cerr << "stfio-convert: " << options.outDir << " is not a directory" << std::endl;
+        return 2;
+    }
+
+    int jobs = 1;
+#ifdef _OPENMP
+    jobs = (options.jobs > 0) ? options.jobs : omp_get_num_procs();
+    if (jobs > (int)files.size()) {
+        jobs = (int)files.size();
+    }
+#endif
+    // Progress meters of concurrent conversions would overwrite each other
+    bool showProgress = options.progress && jobs == 1;
+
+    // Inputs with the same stem (e.g. x.abf and x.dat, or a/x.abf and
+    // b/x.abf with --outdir) would be written to the same file concurrently
+    std::vector<std::string> outNames(files.size());
+    std::map<std::string, std::vector<std::size_t> > outputs;
+    for (std::size_t n_f = 0; n_f < files.size(); ++n_f) {
+        outNames[n_f] = outputName(files[n_f], options);
+        outputs[outNames[n_f]].push_back(n_f);
+    }
+    std::vector<ConvertResult> results(files.size());
+    for (std::map<std::string, std::vector<std::size_t> >::const_iterator it = outputs.begin();
+         it != outputs.end(); ++it)
+    {
+        if (it->second.size() < 2) {
+            continue;
+        }
+        for (std::size_t n_d = 0; n_d < it->second.size(); ++n_d) {
+            std::string others;
+            for (std::size_t n_o = 0; n_o < it->second.size(); ++n_o) {
+                if (n_o != n_d) {
+                    others += (others.empty() ? "" : ", ") + files[it->second[n_o]];
+                }
+            }
+            results[it->second[n_d]].message = "output file " + it->first +
+                " would also be written for " + others;
+        }
+    }
+
+    double start = wallTime();
+    int nFiles = (int)files.size();
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic, 1) num_threads(jobs)
+#endif
+    for (int n_f = 0; n_f < nFiles; ++n_f) {
+        const std::string& outName = outNames[n_f];
+        if (results[n_f].message.empty()) {
+            results[n_f] = convertFile(files[n_f], outName, options, showProgress);
+        }
+#ifdef _OPENMP
+        #pragma omp critical(stfio_convert_output)
+#endif
+        {
+            if (results[n_f].success) {
+                std::cout << files[n_f] << " -> " << outName << ": "
+                          << formatRate(results[n_f].bytes, results[n_f].seconds) << std::endl;
+            } else {
+                std::cerr << files[n_f] << ": " << results[n_f].message << std::endl;
+            }
+        }
+    }
+    double elapsed = wallTime() - start;
+
+    int nSucceeded = 0;
+    double totalBytes = 0.0;
+    for (std::size_t n_f = 0; n_f < results.size(); ++n_f) {
+        if (results[n_f].success) {
+            ++nSucceeded;
+            totalBytes += results[n_f].bytes;
+        }
+    }
+    std::cout << "Converted " << nSucceeded << " of " << nFiles << " files ("
+              << jobs << (jobs == 1 ? " job" : " jobs") << "): "
+              << formatRate(totalBytes, elapsed);
+    if (elapsed > 0) {
+        std::cout.precision(3);
+        std::cout << ", " << nSucceeded / elapsed << " files/s";
+    }
+    std::cout << std::endl;
+
+    return (nSucceeded == nFiles) ? 0 : 1;
+}
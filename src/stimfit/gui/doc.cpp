@@ -1535,6 +1535,8 @@ void wxStfDoc::OnAnalysisBatch(wxCommandEvent &WXUNUSED(event)) {
             return;
         }
     }
+    // reuse the fit buffers across sections:
+    stfnum::FitContext fitContext;
     std::size_t n_s = 0;
     for (c_st_it cit = GetSelectedSections().begin(); cit != GetSelectedSections().end(); cit++) {
         wxString progStr;
@@ -1584,7 +1586,7 @@ void wxStfDoc::OnAnalysisBatch(wxCommandEvent &WXUNUSED(event)) {
             try {
                 double chisqr = stfnum::lmFit( x, GetXScale(), wxGetApp().GetFuncLib()[fselect],
                                             FitSelDialog.GetOpts(), FitSelDialog.UseScaling(),
-                                            params, fitInfo, fitWarning );
+                                            params, fitInfo, fitWarning, fitContext );
                 SetIsFitted( GetCurChIndex(), GetCurSecIndex(), params, wxGetApp().GetFuncLibPtr(fselect),
                              chisqr, GetFitBeg(), GetFitEnd() );
             }
@@ -2310,10 +2312,11 @@ void wxStfDoc::MarkEvents(wxCommandEvent& WXUNUSED(event)) {
         wxStfView* pView = (wxStfView*)GetFirstView();
         wxStfGraph* pGraph = pView->GetGraph();
 
+        stf::EventList& eventList = sec_attr.at(GetCurChIndex()).at(GetCurSecIndex()).eventList;
+        eventList.reserve(startIndices.size());
+        std::size_t amplitudeCol = eventList.AddMeasurement("Amplitude");
         for (c_int_it cit = startIndices.begin(); cit != startIndices.end(); ++cit ) {
-            sec_attr.at(GetCurChIndex()).at(GetCurSecIndex()).eventList.push_back(
-                stf::Event( *cit, 0, templateWave.size(), new wxCheckBox(
-                    pGraph, -1, wxEmptyString) ) );
+            eventList.push_back( *cit, 0, templateWave.size() );
             // Find peak in this event:
             double baselineMean=0;
             for ( int n_mean = *cit-baseline;
@@ -2337,8 +2340,10 @@ void wxStfDoc::MarkEvents(wxCommandEvent& WXUNUSED(event)) {
             if (peakIndex != peakIndex || peakIndex < 0 || peakIndex >= cursec().get().size()) {
                 throw std::runtime_error("Error during peak detection (result is NAN)\n");
             }
-            // set peak index of this event:
-            sec_attr.at(GetCurChIndex()).at(GetCurSecIndex()).eventList.back().SetEventPeakIndex((int)peakIndex);
+            // set peak index and amplitude of this event:
+            eventList.SetEventPeakIndex(eventList.size()-1, (std::size_t)peakIndex);
+            eventList.SetMeasurement(amplitudeCol, eventList.size()-1,
+                                     cursec()[(std::size_t)peakIndex] - baselineMean);
         }
 
         if (pGraph != NULL) {
@@ -2358,52 +2363,57 @@ void wxStfDoc::MarkEvents(wxCommandEvent& WXUNUSED(event)) {
 
 void wxStfDoc::Extract( wxCommandEvent& WXUNUSED(event) ) {
     try {
-        stfnum::Table events(GetCurrentSectionAttributes().eventList.size(), 2);
-        events.SetColLabel(0, "Time of event onset");
-        events.SetColLabel(1, "Inter-event interval");
+        const stf::EventList& eventList = GetCurrentSectionAttributes().eventList;
         // using the peak indices (these are the locations of the beginning of an optimal
-        // template matching), new sections are created:
-
-        // count non-discarded events:
-        std::size_t n_real = 0;
-        for (c_event_it cit = GetCurrentSectionAttributes().eventList.begin();
-             cit != GetCurrentSectionAttributes().eventList.end(); ++cit) {
-            n_real += (int)(!cit->GetDiscard());
-        }
-        Channel TempChannel2(n_real);
-        std::vector<int> peakIndices(n_real);
-        n_real = 0;
-        c_event_it lastEventIt = GetCurrentSectionAttributes().eventList.begin();
-        for (c_event_it it = GetCurrentSectionAttributes().eventList.begin();
-             it != GetCurrentSectionAttributes().eventList.end(); ++it) {
-            if (!it->GetDiscard()) {
-                wxString miniName; miniName << wxT( "Event #" ) << (int)n_real+1;
-                events.SetRowLabel(n_real, stf::wx2std(miniName));
-                events.at(n_real,0) = (double)it->GetEventStartIndex() / GetSR();
-                events.at(n_real,1)=
-                    ((double)(it->GetEventStartIndex() -
-                            lastEventIt->GetEventStartIndex())) / GetSR();
-                // add some baseline at the beginning and end:
-                std::size_t eventSize = it->GetEventSize() + 2*baseline;
-                Section TempSection2( eventSize );
-                for ( std::size_t n_new = 0; n_new < eventSize; ++n_new ) {
-                    // make sure index is not out of range:
-                    int index = it->GetEventStartIndex() + n_new - baseline;
-                    if (index < 0)
-                        index = 0;
-                    if (index >= (int)cursec().size())
-                        index = cursec().size()-1;
-                    TempSection2[n_new] = cursec()[index];
-                }
-                std::ostringstream eventDesc;
-                eventDesc << "Extracted event #" << (int)n_real;
-                TempSection2.SetSectionDescription(eventDesc.str());
-                TempSection2.SetXScale(get()[GetCurChIndex()][GetCurSecIndex()].GetXScale());
-                TempChannel2.InsertSection( TempSection2, n_real );
-                n_real++;
-                lastEventIt = it;
+        // template matching), new sections are created. All events share one
+        // window with some baseline at the beginning and end:
+        std::vector<std::size_t> onsets;
+        onsets.reserve(eventList.CountKept());
+        std::size_t eventSize = 0;
+        for (std::size_t n_event = 0; n_event < eventList.size(); ++n_event) {
+            if (!eventList.GetDiscard(n_event)) {
+                onsets.push_back(eventList.GetEventStartIndex(n_event));
+                eventSize = std::max(eventSize, eventList.GetEventSize(n_event));
             }
         }
+        stfnum::EventSettings settings;
+        settings.before = baseline;
+        settings.after = eventSize + baseline;
+        settings.dir = GetDirection();
+        settings.rtFactor = GetRTFactor();
+        std::vector<stfnum::EventResult> results;
+        Vector_double block;
+        if (!onsets.empty()) {
+            block = stfnum::extractEvents(cursec().get(), onsets, settings, GetXScale(), results);
+        }
+
+        stfnum::Table events(onsets.size(), 6);
+        events.SetColLabel(0, "Time of event onset");
+        events.SetColLabel(1, "Inter-event interval");
+        events.SetColLabel(2, "Amplitude");
+        events.SetColLabel(3, "Rise time");
+        events.SetColLabel(4, "Decay time constant");
+        events.SetColLabel(5, "Charge");
+        const std::size_t width = settings.before + settings.after;
+        Channel TempChannel2(onsets.size());
+        for (std::size_t n_real = 0; n_real < onsets.size(); ++n_real) {
+            wxString miniName; miniName << wxT( "Event #" ) << (int)n_real+1;
+            events.SetRowLabel(n_real, stf::wx2std(miniName));
+            events.at(n_real,0) = (double)onsets[n_real] / GetSR();
+            events.at(n_real,1) =
+                ((double)(onsets[n_real] - onsets[n_real==0 ? 0 : n_real-1])) / GetSR();
+            events.at(n_real,2) = results[n_real].amplitude;
+            events.at(n_real,3) = results[n_real].risetime;
+            events.at(n_real,4) = results[n_real].tau;
+            events.at(n_real,5) = results[n_real].charge;
+            Section TempSection2( Vector_double(block.begin()+n_real*width,
+                                                block.begin()+(n_real+1)*width) );
+            std::ostringstream eventDesc;
+            eventDesc << "Extracted event #" << (int)n_real;
+            TempSection2.SetSectionDescription(eventDesc.str());
+            TempSection2.SetXScale(get()[GetCurChIndex()][GetCurSecIndex()].GetXScale());
+            TempChannel2.InsertSection( TempSection2, n_real );
+        }
         if (TempChannel2.size()>0) {
             Recording Minis( TempChannel2 );
             Minis.CopyAttributes( *this );
@@ -2448,8 +2458,11 @@ void wxStfDoc::AddEvent( wxCommandEvent& WXUNUSED(event) ) {
         wxStfView* pView = (wxStfView*)GetFirstView();
         wxStfGraph* pGraph = pView->GetGraph();
         int newStartPos = pGraph->get_eventPos();
-        stf::Event newEvent(newStartPos, 0, GetCurrentSectionAttributes().eventList.at(0).GetEventSize(),
-                            new wxCheckBox(pGraph, -1, wxEmptyString));
+        stf::EventList& eventList = sec_attr.at(GetCurChIndex()).at(GetCurSecIndex()).eventList;
+        if (eventList.empty()) {
+            throw std::out_of_range("No events have been detected yet");
+        }
+        std::size_t newEventSize = eventList.GetEventSize(0);
         // Find peak in this event:
         double baselineMean=0;
         for ( int n_mean = newStartPos - baseline;
@@ -2465,25 +2478,14 @@ void wxStfDoc::AddEvent( wxCommandEvent& WXUNUSED(event) ) {
         baselineMean /= baseline;
         double peakIndex=0;
         stfnum::peak( cursec().get(), baselineMean, newStartPos,
-                newStartPos + GetCurrentSectionAttributes().eventList.at(0).GetEventSize(), 1,
+                newStartPos + newEventSize, 1,
                 stfnum::both, peakIndex );
-        // set peak index of last event:
-        newEvent.SetEventPeakIndex( (int)peakIndex );
-        // find the position in the current event list where the new
-        // event should be inserted:
-        bool found = false;
-        for (event_it it = sec_attr.at(GetCurChIndex()).at(GetCurSecIndex()).eventList.begin();
-             it != sec_attr.at(GetCurChIndex()).at(GetCurSecIndex()).eventList.end(); ++it) {
-            if ( (int)(it->GetEventStartIndex()) > newStartPos ) {
-                // insert new event before this event, then break:
-                sec_attr.at(GetCurChIndex()).at(GetCurSecIndex()).eventList.insert( it, newEvent );
-                found = true;
-                break;
-            }
-        }
-        // if we are at the end of the list, append the event:
-        if (!found)
-            sec_attr.at(GetCurChIndex()).at(GetCurSecIndex()).eventList.push_back( newEvent );
+        // the new event is inserted before the first event that starts later:
+        std::size_t n_event = eventList.insert( newStartPos, (std::size_t)peakIndex, newEventSize );
+        std::size_t amplitudeCol = eventList.AddMeasurement("Amplitude");
+        eventList.SetMeasurement(amplitudeCol, n_event,
+                                 cursec().at((std::size_t)peakIndex) - baselineMean);
+        pGraph->Refresh();
     }
     catch (const std::out_of_range& e) {
         wxGetApp().ExceptMsg(wxString( e.what(), wxConvLocal ));
@@ -2518,29 +2520,24 @@ void wxStfDoc::Threshold(wxCommandEvent& WXUNUSED(event)) {
         );
     }
     // clear table from previous detection
-    wxStfView* pView=(wxStfView*)GetFirstView();
-    wxStfGraph* pGraph = pView->GetGraph();
-    sec_attr.at(GetCurChIndex()).at(GetCurSecIndex()).eventList.clear();
+    ClearEvents(GetCurChIndex(), GetCurSecIndex());
+    stf::EventList& eventList = sec_attr.at(GetCurChIndex()).at(GetCurSecIndex()).eventList;
+    eventList.reserve(startIndices.size());
     for (c_int_it cit = startIndices.begin(); cit != startIndices.end(); ++cit) {
-        sec_attr.at(GetCurChIndex()).at(GetCurSecIndex()).eventList.push_back(
-            stf::Event(*cit, 0, baseline, new wxCheckBox(pGraph, -1, wxEmptyString)));
+        eventList.push_back(*cit, 0, baseline);
     }
     // show results in a table:
-    stfnum::Table events(GetCurrentSectionAttributes().eventList.size(),2);
+    stfnum::Table events(eventList.size(),2);
     events.SetColLabel( 0, "Time of event peak");
     events.SetColLabel( 1, "Inter-event interval");
-    std::size_t n_event = 0;
-    c_event_it lastEventCit = GetCurrentSectionAttributes().eventList.begin();
-    for (c_event_it cit2 = GetCurrentSectionAttributes().eventList.begin();
-         cit2 != GetCurrentSectionAttributes().eventList.end(); ++cit2) {
+    for (std::size_t n_event = 0; n_event < eventList.size(); ++n_event) {
+        std::size_t lastEvent = (n_event > 0) ? n_event-1 : 0;
         wxString eventName; eventName << wxT("Event #") << (int)n_event+1;
         events.SetRowLabel(n_event, stf::wx2std(eventName));
-        events.at(n_event,0)= (double)cit2->GetEventStartIndex() / GetSR();
+        events.at(n_event,0)= (double)eventList.GetEventStartIndex(n_event) / GetSR();
         events.at(n_event,1)=
-            ((double)(cit2->GetEventStartIndex() -
-                    lastEventCit->GetEventStartIndex()) ) / GetSR();
-        n_event++;
-        lastEventCit = cit2;
+            ((double)(eventList.GetEventStartIndex(n_event) -
+                    eventList.GetEventStartIndex(lastEvent)) ) / GetSR();
     }
     wxStfChildFrame* pChild=(wxStfChildFrame*)GetDocumentWindow();
     if (pChild!=NULL) {
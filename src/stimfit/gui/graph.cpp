@@ -16,6 +16,8 @@
 // This is where the actual drawing happens.
 // 2007-12-27, Christoph Schmidt-Hieber, University of Freiburg
 
+#include <algorithm>
+
 #include <wx/wxprec.h>
 
 #ifndef WX_PRECOMP
@@ -92,6 +94,7 @@ EVT_MENU(ID_ZOOMH,wxStfGraph::OnZoomH)
 EVT_MENU(ID_ZOOMV,wxStfGraph::OnZoomV)
 EVT_MOUSE_EVENTS(wxStfGraph::OnMouseEvent)
 EVT_KEY_DOWN( wxStfGraph::OnKeyDown )
+EVT_CHECKBOX( wxID_ANY, wxStfGraph::OnEventCheckBox )
 #if defined __WXMAC__ && !(wxCHECK_VERSION(2, 9, 0))
 EVT_PAINT( wxStfGraph::OnPaint )
 #endif
@@ -499,7 +502,7 @@ void wxStfGraph::PlotGimmicks(wxDC& DC) {
     DrawCircle(&DC,Doc()->GetMaxDecayT(),Doc()->GetMaxDecayY(), rdPen, rdPrintPen);
     
     try {
-        stf::SectionAttributes sec_attr = Doc()->GetCurrentSectionAttributes();
+        const stf::SectionAttributes& sec_attr = Doc()->GetCurrentSectionAttributes();
         if (!sec_attr.eventList.empty()) {
             PlotEvents(DC);
         }
@@ -521,20 +524,38 @@ void wxStfGraph::PlotGimmicks(wxDC& DC) {
 void wxStfGraph::PlotEvents(wxDC& DC) {
     const int MAX_EVENTS_PLOT = 200;
 
-    stf::SectionAttributes sec_attr;
+    const stf::EventList* pEvents = NULL;
     try {
-        sec_attr = Doc()->GetCurrentSectionAttributes();
+        pEvents = &Doc()->GetCurrentSectionAttributes().eventList;
     }
     catch (const std::out_of_range& e) {
         return;
     }
+    const stf::EventList& eventList = *pEvents;
+
+    // Events are sorted by their start index, so that the events within
+    // the window can be found with a binary search
+    wxRect WindowRect=GetRect();
+    if (isPrinted) WindowRect=wxRect(printRect);
+    int right=WindowRect.width;
+    double firstIndex = -(double)SPX()/XZ();
+    std::size_t firstEvent = eventList.LowerBound(firstIndex > 0 ? (std::size_t)firstIndex : 0);
+    while (firstEvent < eventList.size() && xFormat(eventList.GetEventStartIndex(firstEvent)) <= 0) {
+        ++firstEvent;
+    }
+    std::size_t endEvent = firstEvent;
+    while (endEvent < eventList.size() && xFormat(eventList.GetEventStartIndex(endEvent)) < right) {
+        ++endEvent;
+    }
+
     DC.SetPen(eventPen);
-    for (c_event_it it = sec_attr.eventList.begin(); it != sec_attr.eventList.end(); ++it) {
+    for (std::size_t n_event = firstEvent; n_event < endEvent; ++n_event) {
         // Create small arrows indicating the start of an event:
-        eventArrow(&DC, (int)it->GetEventStartIndex());
+        eventArrow(&DC, (int)eventList.GetEventStartIndex(n_event));
         // Create circles indicating the peak of an event:
         try {
-            DrawCircle( &DC, it->GetEventPeakIndex(), Doc()->cursec().at(it->GetEventPeakIndex()), eventPen, eventPen );
+            DrawCircle( &DC, eventList.GetEventPeakIndex(n_event),
+                        Doc()->cursec().at(eventList.GetEventPeakIndex(n_event)), eventPen, eventPen );
         }
         catch (const std::out_of_range& e) {
             wxGetApp().ExceptMsg( wxString( e.what(), wxConvLocal ) );
@@ -542,31 +563,25 @@ void wxStfGraph::PlotEvents(wxDC& DC) {
         }
     }
 
-    // Only draw check boxes if there are less than 1000 events (takes too long
-    // to draw them and it's impossible to check them anyway)
-    wxRect WindowRect=GetRect();
-    if (isPrinted) WindowRect=wxRect(printRect);
-    int right=WindowRect.width;
-    int nevents_plot = 0;
-    for (event_it it2 = sec_attr.eventList.begin(); it2 != sec_attr.eventList.end(); ++it2) {
-        nevents_plot += (xFormat(it2->GetEventStartIndex()) < right &&
-                         xFormat(it2->GetEventStartIndex()) > 0);
+    // Only draw check boxes if there are less than MAX_EVENTS_PLOT events
+    // in the window (it's impossible to check them anyway)
+    std::size_t nevents_plot = endEvent - firstEvent;
+    if (nevents_plot >= (std::size_t)MAX_EVENTS_PLOT) {
+        nevents_plot = 0;
     }
-
-    if (nevents_plot < MAX_EVENTS_PLOT) {
-        for (event_it it2 = sec_attr.eventList.begin(); it2 != sec_attr.eventList.end(); ++it2) {
-            if (xFormat(it2->GetEventStartIndex()) < right &&
-                xFormat(it2->GetEventStartIndex()) > 0)
-            {
-                it2->GetCheckBox()->Move(wxPoint(xFormat(it2->GetEventStartIndex()), 0));
-                it2->GetCheckBox()->Show(true);
-            } else {
-                it2->GetCheckBox()->Show(false);
-            }
-        }
-    } else {
-        for (event_it it2 = sec_attr.eventList.begin(); it2 != sec_attr.eventList.end(); ++it2) {
-            it2->GetCheckBox()->Show(false);
+    while (eventCheckBoxes.size() < nevents_plot) {
+        eventCheckBoxes.push_back(new wxCheckBox(this, wxID_ANY, wxEmptyString));
+        eventCheckBoxEvents.push_back(0);
+    }
+    for (std::size_t n_cb = 0; n_cb < eventCheckBoxes.size(); ++n_cb) {
+        if (n_cb < nevents_plot) {
+            std::size_t n_event = firstEvent + n_cb;
+            eventCheckBoxEvents[n_cb] = n_event;
+            eventCheckBoxes[n_cb]->SetValue(!eventList.GetDiscard(n_event));
+            eventCheckBoxes[n_cb]->Move(wxPoint(xFormat(eventList.GetEventStartIndex(n_event)), 0));
+            eventCheckBoxes[n_cb]->Show(true);
+        } else {
+            eventCheckBoxes[n_cb]->Show(false);
         }
     }
 
@@ -574,16 +589,28 @@ void wxStfGraph::PlotEvents(wxDC& DC) {
     SetFocus();
 }
 
-void wxStfGraph::ClearEvents() {
-    stf::SectionAttributes sec_attr;
+void wxStfGraph::OnEventCheckBox(wxCommandEvent& event) {
+    std::vector<wxCheckBox*>::const_iterator it =
+        std::find(eventCheckBoxes.begin(), eventCheckBoxes.end(), event.GetEventObject());
+    if (it == eventCheckBoxes.end()) {
+        event.Skip();
+        return;
+    }
     try {
-        sec_attr = Doc()->GetCurrentSectionAttributes();
+        stf::EventList& eventList = Doc()->GetCurrentSectionAttributesW().eventList;
+        std::size_t n_event = eventCheckBoxEvents[it - eventCheckBoxes.begin()];
+        if (n_event < eventList.size()) {
+            eventList.SetDiscard(n_event, !event.IsChecked());
+        }
     }
     catch (const std::out_of_range& e) {
         return;
     }
-    for (event_it it2 = sec_attr.eventList.begin(); it2 != sec_attr.eventList.end(); ++it2) {
-        it2->GetCheckBox()->Destroy();
+}
+
+void wxStfGraph::ClearEvents() {
+    for (std::size_t n_cb = 0; n_cb < eventCheckBoxes.size(); ++n_cb) {
+        eventCheckBoxes[n_cb]->Show(false);
     }
 }
 
@@ -2092,11 +2119,8 @@ void wxStfGraph::FitToWindowSecCh(bool refresh)
 }	//End FitToWindowSecCh()
 
 void wxStfGraph::ChangeTrace(int trace) {
-    stf::SectionAttributes sec_attr = Doc()->GetCurrentSectionAttributes();
-    if (!sec_attr.eventList.empty() && trace != Doc()->GetCurSecIndex()) {
-        for (event_it it2 = sec_attr.eventList.begin(); it2 != sec_attr.eventList.end(); ++it2) {
-            it2->GetCheckBox()->Show(false);
-        }
+    if (trace != Doc()->GetCurSecIndex()) {
+        ClearEvents();
     }
 
     Doc()->SetSection(trace);
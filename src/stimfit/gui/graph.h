@@ -210,7 +210,7 @@ public:
      */
     void Fittowindow(bool refresh);
 
-    //! Destroys all event check boxes
+    //! Hides all event check boxes
     void ClearEvents();
 
     //! Set to true if the graph is drawn on a printer.
@@ -328,6 +328,12 @@ public:
     // ll... means lower limit, ul... means upper limit
     double llz_x, ulz_x, llz_y, ulz_y, llz_y2,ulz_y2;
 
+    // Check boxes are only created for the events that are shown and
+    // reused when the graph is scrolled; eventCheckBoxEvents holds the
+    // index of the event that each check box currently stands for.
+    std::vector<wxCheckBox*> eventCheckBoxes;
+    std::vector<std::size_t> eventCheckBoxEvents;
+
     //Three lines of text containing the results
     wxString results1, results2, results3,results4, results5, results6; 
 
@@ -428,6 +434,7 @@ public:
     void OnZoomHV(wxCommandEvent& event);
     void OnZoomH(wxCommandEvent& event);
     void OnZoomV(wxCommandEvent& event);
+    void OnEventCheckBox(wxCommandEvent& event);
 #if defined __WXMAC__ && !(wxCHECK_VERSION(2, 9, 0))
     void OnPaint(wxPaintEvent &event);
 #endif
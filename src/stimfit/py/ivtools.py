@@ -30,17 +30,12 @@ def analyze_iv( pulses, trace_start = 0, factor = 1.0 ):
         print("Number of pulses has to be greater or equal 1.")
         return False
     
-    # create an empty array (will contain random numbers)
+    # fetch all traces of the active channel at once:
+    traces = stf.get_channel()
     channel = list()
     for m in range(pulses):
-        # A temporary array to calculate the average:
-        set = np.empty( (int((stf.get_size_channel()-m-1-trace_start)/pulses)+1,
-                        stf.get_size_trace( trace_start+m )) )
-        n_set = 0
-        for n in range( trace_start+m, stf.get_size_channel(), pulses ):
-            # Add this trace to set:
-            set[n_set,:] = stf.get_trace( n )
-            n_set = n_set+1
+        # The traces belonging to this pulse:
+        set = traces[trace_start+m::pulses]
 
         # calculate average and create a new section from it, multiply:
         channel.append( np.average(set, 0) * factor )
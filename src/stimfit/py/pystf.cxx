@@ -75,6 +75,7 @@
 #include "./../gui/childframe.h"
 #include "./../gui/dlgs/cursorsdlg.h"
 #include "./../../libstfnum/fit.h"
+#include "./../../libstfnum/measure.h"
 
 #ifdef WITH_PYTHON
 #define array_data(a)          (((PyArrayObject *)a)->data)
@@ -224,6 +225,135 @@ PyObject* get_trace(int trace, int channel) {
     
     return np_array;
 }
+
+PyObject* get_channel(int channel) {
+    wrap_array();
+
+    if ( !check_doc() ) return NULL;
+
+    if ( channel == -1 ) {
+        channel = actDoc()->GetCurChIndex();
+    }
+
+    const Channel* pCh = NULL;
+    try {
+        pCh = &actDoc()->at(channel);
+    }
+    catch ( const std::out_of_range& e) {
+        ShowExcept( e );
+        return NULL;
+    }
+
+    std::size_t n_points = 0;
+    for (std::size_t n_s = 0; n_s < pCh->size(); ++n_s) {
+        n_points = std::max(n_points, (*pCh)[n_s].size());
+    }
+
+    npy_intp dims[2] = {(npy_intp)pCh->size(), (npy_intp)n_points};
+    PyObject* np_array = PyArray_SimpleNew(2, dims, NPY_DOUBLE);
+    double* gDataP = (double*)array_data(np_array);
+
+    /* fill; pad shorter traces with NaN */
+    for (std::size_t n_s = 0; n_s < pCh->size(); ++n_s) {
+        const Vector_double& sec = (*pCh)[n_s].get();
+        double* row = &gDataP[n_s*n_points];
+        std::copy( sec.begin(), sec.end(), row );
+        std::fill( row+sec.size(), row+n_points, NAN );
+    }
+
+    return np_array;
+}
+
+PyObject* _measure_batch( int* sections, int n_sections, int channel,
+                          int base_start, int base_end, int peak_start, int peak_end ) {
+    wrap_array();
+
+    if ( !check_doc() ) return NULL;
+
+    wxStfDoc* pDoc = actDoc();
+    if ( channel == -1 ) {
+        channel = pDoc->GetCurChIndex();
+    }
+
+    stfnum::MeasureSettings settings;
+    settings.baseBeg = base_start < 0 ? pDoc->GetBaseBeg() : base_start;
+    settings.baseEnd = base_end < 0 ? pDoc->GetBaseEnd() : base_end;
+    settings.peakBeg = peak_start < 0 ? pDoc->GetPeakBeg() : peak_start;
+    settings.peakEnd = peak_end < 0 ? pDoc->GetPeakEnd() : peak_end;
+    settings.pM = pDoc->GetPM();
+    settings.dir = pDoc->GetDirection();
+    settings.baselineMethod = pDoc->GetBaselineMethod();
+    settings.rtFactor = pDoc->GetRTFactor();
+    settings.slopeForThreshold = pDoc->GetSlopeForThreshold();
+    settings.fromBase = pDoc->GetFromBase();
+
+    if ( settings.peakBeg > settings.peakEnd ) {
+        ShowError( wxT("Peak window cursors are reversed; will abort now.") );
+        return NULL;
+    }
+    if ( settings.baseBeg > settings.baseEnd ) {
+        ShowError( wxT("Base window cursors are reversed; will abort now.") );
+        return NULL;
+    }
+
+    std::vector<std::size_t> section_index(n_sections);
+    for (int n = 0; n < n_sections; ++n) {
+        if (sections[n] < 0) {
+            ShowError( wxT("Negative trace index in measure_batch()") );
+            return NULL;
+        }
+        section_index[n] = sections[n];
+    }
+
+    std::vector<stfnum::MeasureResult> results;
+    try {
+        results = stfnum::measureBatch( pDoc->at(channel), section_index, settings,
+                                        pDoc->GetXScale() );
+    }
+    catch (const std::out_of_range& e) {
+        ShowExcept( e );
+        return NULL;
+    }
+
+    // One column per measured value; the Python wrapper turns this into a record array.
+    struct column {
+        const char* name;
+        double stfnum::MeasureResult::* value;
+    };
+    const column columns[] = {
+        {"base", &stfnum::MeasureResult::base},
+        {"base_SD", &stfnum::MeasureResult::baseSD},
+        {"peak", &stfnum::MeasureResult::peak},
+        {"peak_index", &stfnum::MeasureResult::peakT},
+        {"amplitude", &stfnum::MeasureResult::amplitude},
+        {"threshold", &stfnum::MeasureResult::threshold},
+        {"threshold_index", &stfnum::MeasureResult::thresholdT},
+        {"risetime", &stfnum::MeasureResult::risetime},
+        {"rtlow_index", &stfnum::MeasureResult::tLoReal},
+        {"halfwidth", &stfnum::MeasureResult::halfwidth},
+        {"t50left_index", &stfnum::MeasureResult::t50LeftReal},
+        {"maxrise", &stfnum::MeasureResult::maxRise},
+        {"maxrise_index", &stfnum::MeasureResult::maxRiseT},
+        {"maxdecay", &stfnum::MeasureResult::maxDecay},
+        {"maxdecay_index", &stfnum::MeasureResult::maxDecayT},
+        {"slope_ratio", &stfnum::MeasureResult::slopeRatio}
+    };
+    const std::size_t n_cols = sizeof(columns)/sizeof(columns[0]);
+
+    npy_intp dims[1] = {(npy_intp)results.size()};
+    PyObject* retDict = PyDict_New( );
+    for (std::size_t n_c = 0; n_c < n_cols; ++n_c) {
+        PyObject* np_array = PyArray_SimpleNew(1, dims, NPY_DOUBLE);
+        double* gDataP = (double*)array_data(np_array);
+        for (std::size_t n_r = 0; n_r < results.size(); ++n_r) {
+            gDataP[n_r] = results[n_r].*(columns[n_c].value);
+        }
+        PyDict_SetItemString( retDict, columns[n_c].name, np_array );
+        Py_DECREF( np_array );
+    }
+
+    return retDict;
+}
 #endif
 
 bool new_window( double* invec, int size ) {
@@ -11,6 +11,9 @@ std::string get_versionstring( );
 
 #ifdef WITH_PYTHON
 PyObject* get_trace(int trace=-1, int channel=-1);
+PyObject* get_channel(int channel=-1);
+PyObject* _measure_batch( int* sections, int n_sections, int channel=-1,
+                          int base_start=-1, int base_end=-1, int peak_start=-1, int peak_end=-1 );
 #endif
 
 bool new_window( double* invec, int size );
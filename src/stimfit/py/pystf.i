@@ -34,6 +34,8 @@ namespace std {
 
 %apply_numpy_typemaps(double)
 
+%apply (int* IN_ARRAY1, int DIM1) {(int* sections, int n_sections)};
+
 //--------------------------------------------------------------------
 %feature("autodoc", 0) get_versionstring;
 %feature("docstring",
@@ -61,6 +63,33 @@ The trace as a 1D NumPy array.""") get_trace;
 PyObject* get_trace(int trace=-1, int channel=-1);
 //--------------------------------------------------------------------
 
+//--------------------------------------------------------------------
+%feature("autodoc", 0) get_channel;
+%feature("kwargs") get_channel;
+%feature("docstring", """Returns all traces of a channel as a 2-dimensional
+NumPy array in a single call.
+
+Arguments:
+channel -- ZERO-BASED index of the channel. This is independent
+           of whether a channel is active or not.
+           The default value of -1 returns the currently
+           active channel.
+Returns:
+A 2D NumPy array of shape (number of traces, number of sampling
+points). Traces that are shorter than the longest trace are
+padded with NaN.""") get_channel;
+PyObject* get_channel(int channel=-1);
+//--------------------------------------------------------------------
+
+//--------------------------------------------------------------------
+%feature("autodoc", 0) _measure_batch;
+%feature("docstring", "Measures several traces with the current
+measurement settings. Do not use directly; use measure_batch()
+instead.") _measure_batch;
+PyObject* _measure_batch( int* sections, int n_sections, int channel=-1,
+                          int base_start=-1, int base_end=-1, int peak_start=-1, int peak_end=-1 );
+//--------------------------------------------------------------------
+
 //--------------------------------------------------------------------
 %feature("autodoc", 0) new_window;
 %feature("docstring", "Creates a new window showing a
@@ -1607,6 +1636,46 @@ def stfio_open(stfio_rec):
 
     return True
 
+def measure_batch(sections=None, channel=-1, cursors=None):
+    """Measures several traces in a single call, without changing
+    the displayed trace or updating the results table.
+
+    Arguments:
+    sections -- Sequence of ZERO-BASED trace indices. The default
+                value of None measures all traces of the channel.
+    channel  -- ZERO-BASED index of the channel. The default value
+                of -1 uses the currently active channel.
+    cursors  -- Optional dictionary overriding the current cursor
+                positions (in sampling points), e.g.
+                {"base": (0, 100), "peak": (150, 900)}. Cursors
+                that are not given are taken from the current file.
+                All other settings (peak direction, baseline method,
+                rise time factor...) are taken from the current file.
+
+    Returns:
+    A NumPy record array with one entry per trace, or None upon
+    failure. Fields are base, base_SD, peak, peak_index, amplitude,
+    threshold, threshold_index, risetime, rtlow_index, halfwidth,
+    t50left_index, maxrise, maxrise_index, maxdecay, maxdecay_index
+    and slope_ratio. Indices are given in sampling points, durations
+    and slopes in x units.
+    """
+    import numpy as np
+    if not check_doc():
+        return None
+    if sections is None:
+        sections = np.arange(get_size_channel(channel))
+    base_start, base_end, peak_start, peak_end = -1, -1, -1, -1
+    if cursors is not None:
+        base_start, base_end = cursors.get("base", (-1, -1))
+        peak_start, peak_end = cursors.get("peak", (-1, -1))
+    res = _measure_batch(np.asarray(sections, dtype=np.intc), channel,
+                         base_start, base_end, peak_start, peak_end)
+    if res is None:
+        return None
+    names = list(res.keys())
+    return np.rec.fromarrays([res[name] for name in names], names=names)
+
 def cut_traces( pt ):
     """Cuts the selected traces at the sampling point pt,
     and shows the cut traces in a new window.
@@ -21,6 +21,9 @@
  *  Implements some general functions within the stf namespace
  */
 
+#include <algorithm>
+#include <limits>
+
 #include "stf.h"
 
 #if 0
@@ -89,13 +92,77 @@ stf::SectionPointer::SectionPointer(Section* pSec, const stf::SectionAttributes&
     pSection(pSec), sec_attr(sa)
 {}
 
-stf::Event::Event(std::size_t start, std::size_t peak, std::size_t size, wxCheckBox* cb) :
-    eventStartIndex(start), eventPeakIndex(peak), eventSize(size), checkBox(cb)
-{
-    checkBox->Show(true);
-    checkBox->SetValue(true);
+stf::EventList::EventList() :
+    eventStartIndex(), eventPeakIndex(), eventSize(), eventFlags(),
+    measurementLabels(), measurements()
+{}
+
+void stf::EventList::clear() {
+    eventStartIndex.clear();
+    eventPeakIndex.clear();
+    eventSize.clear();
+    eventFlags.clear();
+    measurementLabels.clear();
+    measurements.clear();
 }
 
-stf::Event::~Event()
-{
+void stf::EventList::reserve(std::size_t n) {
+    eventStartIndex.reserve(n);
+    eventPeakIndex.reserve(n);
+    eventSize.reserve(n);
+    eventFlags.reserve(n);
+}
+
+void stf::EventList::push_back(std::size_t start, std::size_t peak, std::size_t size) {
+    insert(start, peak, size);
+}
+
+std::size_t stf::EventList::insert(std::size_t start, std::size_t peak, std::size_t size) {
+    // appending is the common case during event detection
+    std::size_t n = eventStartIndex.size();
+    if (n > 0 && eventStartIndex[n-1] > start) {
+        n = std::upper_bound(eventStartIndex.begin(), eventStartIndex.end(), start)
+            - eventStartIndex.begin();
+    }
+    eventStartIndex.insert(eventStartIndex.begin()+n, start);
+    eventPeakIndex.insert(eventPeakIndex.begin()+n, peak);
+    eventSize.insert(eventSize.begin()+n, size);
+    eventFlags.insert(eventFlags.begin()+n, (unsigned char)0);
+    for (std::size_t col = 0; col < measurements.size(); ++col) {
+        measurements[col].insert(measurements[col].begin()+n,
+                                 std::numeric_limits<double>::quiet_NaN());
+    }
+    return n;
+}
+
+std::size_t stf::EventList::LowerBound(std::size_t start) const {
+    return std::lower_bound(eventStartIndex.begin(), eventStartIndex.end(), start)
+        - eventStartIndex.begin();
+}
+
+void stf::EventList::SetDiscard(std::size_t n, bool value) {
+    if (value) {
+        eventFlags[n] |= discarded;
+    } else {
+        eventFlags[n] &= ~discarded;
+    }
+}
+
+std::size_t stf::EventList::CountKept() const {
+    std::size_t n_kept = 0;
+    for (std::size_t n = 0; n < eventFlags.size(); ++n) {
+        n_kept += ((eventFlags[n] & discarded) == 0);
+    }
+    return n_kept;
+}
+
+std::size_t stf::EventList::AddMeasurement(const std::string& label) {
+    std::vector<std::string>::const_iterator it =
+        std::find(measurementLabels.begin(), measurementLabels.end(), label);
+    if (it != measurementLabels.end()) {
+        return it - measurementLabels.begin();
+    }
+    measurementLabels.push_back(label);
+    measurements.push_back(Vector_double(size(), std::numeric_limits<double>::quiet_NaN()));
+    return measurements.size()-1;
 }
@@ -243,60 +243,120 @@ struct ofstreamMan {
     wxFFile myStream;
 };
  
-//! Describes the attributes of an event.
-class Event {
+//! The events detected in a section, stored column by column.
+/*! Events are kept sorted by their start index. Whether an event is
+ *  discarded is stored as a flag rather than in a check box, so that
+ *  the graph only has to create check boxes for the events it shows.
+ */
+class EventList {
 public:
+    //! Flags of an event
+    enum flags {
+        discarded = 1  /*!< The event will be skipped during extraction. */
+    };
+
     //! Constructor
-    explicit Event(std::size_t start, std::size_t peak, std::size_t size, wxCheckBox* cb);
-    
-    //! Destructor
-    ~Event();
+    EventList();
+
+    //! Number of events.
+    std::size_t size() const { return eventStartIndex.size(); }
+
+    //! true if there are no events.
+    bool empty() const { return eventStartIndex.empty(); }
+
+    //! Removes all events and measurements.
+    void clear();
+
+    //! Reserves memory for a number of events.
+    /*! \param n The number of events. */
+    void reserve(std::size_t n);
+
+    //! Appends an event; events have to be appended in order of their start index.
+    /*! \param start The start index of the event within the section.
+     *  \param peak The index of the event's peak within the section.
+     *  \param size The size of the event in units of data points.
+     */
+    void push_back(std::size_t start, std::size_t peak, std::size_t size);
+
+    //! Inserts an event before the first event that starts later.
+    /*! \param start The start index of the event within the section.
+     *  \param peak The index of the event's peak within the section.
+     *  \param size The size of the event in units of data points.
+     *  \return The index of the new event.
+     */
+    std::size_t insert(std::size_t start, std::size_t peak, std::size_t size);
+
+    //! Returns the index of the first event that starts at or after a given point.
+    /*! \param start A data point index within the section.
+     *  \return The index of the event, or size() if there is none.
+     */
+    std::size_t LowerBound(std::size_t start) const;
 
     //! Retrieves the start index of an event.
-    /*! \return The start index of an event within a section. */
-    std::size_t GetEventStartIndex() const { return eventStartIndex; }
+    /*! \param n The index of the event.
+     *  \return The start index of an event within a section. */
+    std::size_t GetEventStartIndex(std::size_t n) const { return eventStartIndex[n]; }
 
     //! Retrieves the index of an event's peak.
-    /*! \return The index of an event's peak within a section. */
-    std::size_t GetEventPeakIndex() const { return eventPeakIndex; }
+    /*! \param n The index of the event.
+     *  \return The index of an event's peak within a section. */
+    std::size_t GetEventPeakIndex(std::size_t n) const { return eventPeakIndex[n]; }
 
     //! Retrieves the size of an event.
-    /*! \return The size of an event in units of data points. */
-    std::size_t GetEventSize() const { return eventSize; }
+    /*! \param n The index of the event.
+     *  \return The size of an event in units of data points. */
+    std::size_t GetEventSize(std::size_t n) const { return eventSize[n]; }
 
     //! Indicates whether an event should be discarded.
-    /*! \return true if it should be discarded, false otherwise. */
-    bool GetDiscard() const { return !checkBox->GetValue(); }
+    /*! \param n The index of the event.
+     *  \return true if it should be discarded, false otherwise. */
+    bool GetDiscard(std::size_t n) const { return (eventFlags[n] & discarded) != 0; }
 
-    //! Get the check box associated with this event
-    /*! \return The wxCheckBox associated with this event  */
-    wxCheckBox* GetCheckBox() {return checkBox;}
+    //! Sets the index of an event's peak.
+    /*! \param n The index of the event.
+     *  \param value The index of an event's peak within a section. */
+    void SetEventPeakIndex(std::size_t n, std::size_t value) { eventPeakIndex[n] = value; }
 
-    //! Sets the start index of an event.
-    /*! \param value The start index of an event within a section. */
-    void SetEventStartIndex( std::size_t value ) { eventStartIndex = value; }
+    //! Determines whether an event should be discarded.
+    /*! \param n The index of the event.
+     *  \param value true if it should be discarded, false otherwise. */
+    void SetDiscard(std::size_t n, bool value);
 
-    //! Sets the index of an event's peak.
-    /*! \param value The index of an event's peak within a section. */
-    void SetEventPeakIndex( std::size_t value ) { eventPeakIndex = value; }
+    //! Number of events that aren't discarded.
+    std::size_t CountKept() const;
 
-    //! Sets the size of an event.
-    /*! \param value The size of an event in units of data points. */
-    void SetEventSize( std::size_t value ) { eventSize = value; }
+    //! Returns the column of a per-event measurement, adding it if necessary.
+    /*! New columns are filled with NaN.
+     *  \param label The name of the measurement, e.g. "Amplitude".
+     *  \return The index of the column.
+     */
+    std::size_t AddMeasurement(const std::string& label);
 
-    //! Determines whether an event should be discarded.
-    /*! \param true if it should be discarded, false otherwise. */
-    /*void SetDiscard( bool value ) { discard = value; }*/
+    //! Number of per-event measurements.
+    std::size_t GetMeasurementCount() const { return measurementLabels.size(); }
 
-    //! Sets discard to true if it was false and vice versa.
-    /*void ToggleStatus() { discard = !discard; }*/
+    //! Name of a per-event measurement.
+    /*! \param col The index of the column. */
+    const std::string& GetMeasurementLabel(std::size_t col) const { return measurementLabels[col]; }
 
-private:
-    std::size_t eventStartIndex;
-    std::size_t eventPeakIndex;
-    std::size_t eventSize;
-    wxCheckBox* checkBox;
+    //! Retrieves a measurement of an event.
+    /*! \param col The index of the column.
+     *  \param n The index of the event. */
+    double GetMeasurement(std::size_t col, std::size_t n) const { return measurements[col][n]; }
 
+    //! Sets a measurement of an event.
+    /*! \param col The index of the column.
+     *  \param n The index of the event.
+     *  \param value The measured value. */
+    void SetMeasurement(std::size_t col, std::size_t n, double value) { measurements[col][n] = value; }
+
+private:
+    std::vector<std::size_t> eventStartIndex;
+    std::vector<std::size_t> eventPeakIndex;
+    std::vector<std::size_t> eventSize;
+    std::vector<unsigned char> eventFlags;
+    std::vector<std::string> measurementLabels;
+    std::vector<Vector_double> measurements;
 };
 
 //! A marker that can be set from Python
@@ -314,7 +374,7 @@ struct PyMarker {
 
 struct StfDll SectionAttributes {
     SectionAttributes();
-    std::vector<stf::Event> eventList;
+    stf::EventList eventList;
     std::vector<stf::PyMarker> pyMarkers;
     bool isFitted,isIntegrated;
     stfnum::storedFunc *fitFunc;
@@ -418,8 +478,6 @@ inline int stf::round(double toRound) {
 
 typedef std::vector< wxString >::iterator       wxs_it;      /*!< std::string iterator */
 typedef std::vector< wxString >::const_iterator c_wxs_it;    /*!< constant std::string iterator */
-typedef std::vector< stf::Event      >::iterator       event_it;    /*!< stf::Event iterator */
-typedef std::vector< stf::Event      >::const_iterator c_event_it;  /*!< constant stf::Event iterator */
 typedef std::vector< stf::PyMarker   >::iterator       marker_it;   /*!< stf::PyMarker iterator */
 typedef std::vector< stf::PyMarker   >::const_iterator c_marker_it; /*!< constant stf::PyMarker iterator */
 
@@ -922,3 +922,283 @@ TEST(fitlib_test, id_12_fgaussian){
     //data.clear();
 
 }
+
+//=========================================================================
+// Tests that a fit context can be reused for fits of different data
+// and gives the same results as separate fits
+//=========================================================================
+TEST(fitlib_test, fit_context_reuse){
+
+    stfnum::FitContext context;
+    std::string info;
+    int warning;
+
+    for (int n=0; n < 3; ++n) {
+        /* choose function parameters */
+        Vector_double mypars(3);
+        mypars[0] = 50.0+10*n;  /* Amp_0 */
+        mypars[1] = 17.0-n;     /* Tau_0 */
+        mypars[2] = -n;         /* Offset */
+        Vector_double data = fexp_simple(mypars);
+
+        Vector_double pars(3);
+        pars[0] = 35.5232;     /* Amp_0 */
+        pars[1] = 14.6059;     /* Tau_0 */
+        pars[2] = mypars[2];   /* Offset fixed to baseline */
+        Vector_double pars_single(pars);
+
+        double chisqr = stfnum::lmFit(data, dt, funcLib[1], opts,
+            true, /* use_scaling */
+            pars, info, warning, context );
+        EXPECT_EQ(warning, 0);
+        par_test(pars[0], mypars[0], tol);  /* Amp_0  */
+        par_test(pars[1], mypars[1], tol);  /* Tau_0  */
+
+        double chisqr_single = stfnum::lmFit(data, dt, funcLib[1], opts,
+            true, /* use_scaling */
+            pars_single, info, warning );
+        EXPECT_DOUBLE_EQ(chisqr, chisqr_single);
+        EXPECT_DOUBLE_EQ(pars[1], pars_single[1]);
+    }
+
+    /* a shorter trace with the same context */
+    Vector_double mypars(3);
+    mypars[0] = 50.0; mypars[1] = 5.0; mypars[2] = 0.0;
+    Vector_double data = fexp_simple(mypars);
+    data.resize(data.size()/2);
+    Vector_double pars(3);
+    pars[0] = 35.5232; pars[1] = 14.6059; pars[2] = 0.0;
+    stfnum::lmFit(data, dt, funcLib[1], opts, true, pars, info, warning, context);
+    par_test(pars[1], mypars[1], tol);  /* Tau_0  */
+}
+
+//=========================================================================
+// Tests the analytic Jacobians of all library functions against
+// central differences
+//=========================================================================
+TEST(fitlib_test, jacobians){
+
+    /* parameters for each function of the library, in library order */
+    const double pars[][7] = {
+        {50.0, 17.0, -5.0},                  /* monoexponential */
+        {50.0, 17.0, -5.0},                  /* offset fixed */
+        {10.0, 15.0, 17.0, 90.0},            /* with delay */
+        {50.0, 17.0, 20.0, 4.0, -5.0},       /* biexponential */
+        {50.0, 17.0, 20.0, 4.0, -5.0},       /* offset fixed */
+        {-5.0, 10.0, 30.0, 50.0, 2.0},       /* with delay */
+        {50.0, 17.0, 20.0, 4.0, 5.0, 40.0, -5.0},  /* triexponential */
+        {50.0, 17.0, 20.0, 4.0, 5.0, 40.0, -5.0},  /* PSC initialization */
+        {50.0, 17.0, 20.0, 4.0, 5.0, 40.0, -5.0},  /* offset fixed */
+        {50.0, 7.0, -5.0},                   /* alpha */
+        {80.0, 3.0, 12.0, -5.0},             /* HH */
+        {80.0, 3.0, 12.0, -5.0},             /* power of 1 */
+        {1.5, 25.0, 4.5},                    /* Gaussian */
+        {-5.0, 10.0, 30.0, 50.0, 2.0, 60.0, 0.3}   /* triexponential with delay */
+    };
+    ASSERT_EQ(funcLib.size(), sizeof(pars)/sizeof(pars[0]));
+
+    for (std::size_t n_f=0; n_f < funcLib.size(); ++n_f) {
+        EXPECT_TRUE(funcLib[n_f].hasJac) << funcLib[n_f].name;
+        std::size_t n_p = funcLib[n_f].pInfo.size();
+        Vector_double p(pars[n_f], pars[n_f]+n_p);
+        /* avoid the discontinuity at the delay */
+        for (double x=1.3; x < tmax; x += 7.1) {
+            Vector_double jac = funcLib[n_f].jac(x, p);
+            ASSERT_EQ(jac.size(), n_p);
+            for (std::size_t n=0; n < n_p; ++n) {
+                Vector_double p_hi(p), p_lo(p);
+                double h = 1e-6*std::max(1.0, fabs(p[n]));
+                p_hi[n] += h;
+                p_lo[n] -= h;
+                double diff = (funcLib[n_f].func(x, p_hi)-funcLib[n_f].func(x, p_lo)) / (2*h);
+                EXPECT_NEAR(jac[n], diff, 1e-5*std::max(1.0, fabs(diff)))
+                    << funcLib[n_f].name << ", p[" << n << "], x=" << x;
+            }
+        }
+    }
+}
+
+//=========================================================================
+// Tests the evaluation of sums of exponentials on a whole grid
+//=========================================================================
+TEST(fitlib_test, exponential_grid){
+
+    /* triexponential, with a negative amplitude */
+    Vector_double p(7);
+    p[0] = 50.0; p[1] = 17.0; p[2] = -20.0; p[3] = 0.5; p[4] = 5.0; p[5] = 400.0; p[6] = -5.0;
+    std::size_t n = int(tmax/dt);
+    Vector_double y(n), jac(n*p.size());
+    stfnum::fexp_grid(dt, n, p, &y[0]);
+    stfnum::fexp_grid_jac(dt, n, p, &jac[0]);
+    for (std::size_t i=0; i < n; ++i) {
+        double x = i*(double)dt;
+        EXPECT_NEAR(y[i], stfnum::fexp(x, p), 1e-10);
+        Vector_double jac_i = stfnum::fexp_jac(x, p);
+        for (std::size_t k=0; k < p.size(); ++k) {
+            EXPECT_NEAR(jac[i*p.size()+k], jac_i[k], 1e-10);
+        }
+    }
+
+    /* all sums of exponentials in the library use the grid */
+    EXPECT_FALSE(funcLib[0].gridFunc.empty());
+    EXPECT_FALSE(funcLib[3].gridJac.empty());
+    EXPECT_TRUE(funcLib[2].gridFunc.empty());
+}
+
+//=========================================================================
+// Tests a biexponential fit from a symmetric initial guess, where both
+// time constants are equal, with several starts
+//=========================================================================
+TEST(fitlib_test, multi_start){
+
+    /* choose function parameters */
+    Vector_double mypars(5);
+    mypars[0] = 9.0;    /* first amplitude      */
+    mypars[1] = 2.0;    /* first time constant  */
+    mypars[2] = 1.0;    /* second amplitude     */
+    mypars[3] = 15.0;   /* second time constant */
+    mypars[4] = 4.0;    /* baseline             */
+    Vector_double data = fexp(mypars);
+
+    /* Initial parameter guesses */
+    Vector_double pars(5);
+    pars[0] = 5.0;     /* Amp_0   */
+    pars[1] = 8.0;     /* Tau_0   */
+    pars[2] = 5.0;     /* Amp_1   */
+    pars[3] = 8.0;     /* Tau_1   */
+    pars[4] = 4.0;     /* Offset  */
+    Vector_double pars_single(pars);
+
+    std::string info;
+    int warning;
+
+    double chisqr = stfnum::lmFitMultiStart(data, dt, funcLib[3], opts,
+        true, /* use_scaling */
+        pars, info, warning, 16 );
+    double chisqr_single = stfnum::lmFit(data, dt, funcLib[3], opts,
+        true, /* use_scaling */
+        pars_single, info, warning );
+
+    EXPECT_LE(chisqr, chisqr_single);
+    /* time constants may be swapped */
+    if (pars[1] > pars[3]) {
+        std::swap(pars[0], pars[2]);
+        std::swap(pars[1], pars[3]);
+    }
+    par_test(pars[0], mypars[0], tol);  /* Amp_0  */
+    par_test(pars[1], mypars[1], tol);  /* Tau_0  */
+    par_test(pars[2], mypars[2], tol);  /* Amp_1  */
+    par_test(pars[3], mypars[3], tol);  /* Tau_1  */
+    par_test(pars[4], mypars[4], tol);  /* Offset */
+
+    EXPECT_THROW(stfnum::lmFitMultiStart(data, dt, funcLib[3], opts, true,
+                                         pars, info, warning, 0),
+                 std::runtime_error);
+}
+
+//=========================================================================
+// Tests a monoexponential fit to several traces with a shared
+// time constant
+//=========================================================================
+TEST(fitlib_test, global_shared_tau){
+
+    const double tau = 17.0;
+    std::vector<Vector_double> data;
+    std::vector<Vector_double> pars;
+    for (int n=0; n < 4; ++n) {
+        Vector_double mypars(3);
+        mypars[0] = 20.0*(n+1);  /* Amp_0 */
+        mypars[1] = tau;         /* Tau_0 */
+        mypars[2] = -n;          /* Offset */
+        data.push_back(fexp_simple(mypars));
+
+        /* Initial parameter guesses */
+        Vector_double p(3);
+        p[0] = 10.0*(n+1);
+        p[1] = 8.0+4*n;
+        p[2] = -n;
+        pars.push_back(p);
+    }
+    std::deque<bool> shared(3, false);
+    shared[1] = true;
+
+    std::string info;
+    int warning;
+
+    /* offset fixed to baseline */
+    double chisqr = stfnum::lmFitGlobal(data, dt, funcLib[1], opts, shared,
+                                        pars, info, warning);
+
+    EXPECT_LT(chisqr, 1e-6);
+    for (int n=0; n < 4; ++n) {
+        par_test(pars[n][0], 20.0*(n+1), tol);  /* Amp_0 */
+        EXPECT_EQ(pars[n][1], pars[0][1]);      /* shared Tau_0 */
+        EXPECT_EQ(pars[n][2], -n);              /* constant offset */
+    }
+    par_test(pars[0][1], tau, tol);
+
+    /* all parameters shared, free offset */
+    shared.assign(3, true);
+    for (int n=0; n < 4; ++n) {
+        data[n] = data[0];
+    }
+    pars.assign(4, pars[0]);
+    stfnum::lmFitGlobal(data, dt, funcLib[0], opts, shared, pars, info, warning);
+    par_test(pars[3][0], 20.0, tol);
+    par_test(pars[3][1], tau, tol);
+
+    shared.resize(2);
+    EXPECT_THROW(stfnum::lmFitGlobal(data, dt, funcLib[0], opts, shared,
+                                     pars, info, warning),
+                 std::runtime_error);
+}
+
+//=========================================================================
+// Tests a global fit to many traces with a shared amplitude and
+// without a Jacobian, and a global fit without shared parameters
+//=========================================================================
+TEST(fitlib_test, global_many_sets){
+
+    const int n_sets = 40;
+    std::vector<Vector_double> data;
+    std::vector<Vector_double> pars;
+    for (int n=0; n < n_sets; ++n) {
+        Vector_double mypars(3);
+        mypars[0] = 25.0;          /* shared Amp_0 */
+        mypars[1] = 5.0 + 0.5*n;   /* Tau_0 */
+        mypars[2] = 0.1*(n+1);     /* Offset */
+        data.push_back(fexp_simple(mypars));
+
+        Vector_double p(3);
+        p[0] = 15.0;
+        p[1] = 0.8*mypars[1];
+        p[2] = 0.0;
+        pars.push_back(p);
+    }
+    std::deque<bool> shared(3, false);
+    shared[0] = true;
+
+    stfnum::storedFunc noJac(funcLib[0]);
+    noJac.hasJac = false;
+    std::string info;
+    int warning;
+    double chisqr = stfnum::lmFitGlobal(data, dt, noJac, opts, shared,
+                                        pars, info, warning);
+    EXPECT_LT(chisqr, 1e-6);
+    for (int n=0; n < n_sets; ++n) {
+        par_test(pars[n][0], 25.0, tol);
+        par_test(pars[n][1], 5.0 + 0.5*n, tol);
+        par_test(pars[n][2], 0.1*(n+1), tol);
+    }
+
+    /* every data set on its own */
+    shared.assign(3, false);
+    for (int n=0; n < n_sets; ++n) {
+        pars[n][0] = 15.0;
+        pars[n][1] *= 0.8;
+    }
+    chisqr = stfnum::lmFitGlobal(data, dt, funcLib[0], opts, shared,
+                                 pars, info, warning);
+    EXPECT_LT(chisqr, 1e-6);
+    par_test(pars[n_sets-1][1], 5.0 + 0.5*(n_sets-1), tol);
+}
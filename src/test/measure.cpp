@@ -631,6 +631,112 @@ TEST(measlib_test, maxdecay_values){
 
 }
 
+//=========================================================================
+// test batch measurement of several sine waves with different amplitudes
+//=========================================================================
+TEST(measlib_test, measure_batch){
+
+    const int n_sections = 4;
+    long length = long(PI/dt)+10;
+    Channel mychannel(n_sections);
+    for (int i=0; i<n_sections; i++){
+        mychannel.InsertSection(Section(sinwave(i+1., 2*PI, length)), i);
+    }
+
+    stfnum::MeasureSettings settings;
+    settings.baseBeg = 0;
+    settings.baseEnd = 0;
+    settings.peakBeg = 1;
+    settings.peakEnd = length-1;
+    settings.dir = stfnum::up;
+
+    /* measure in reverse order */
+    std::vector<std::size_t> sections;
+    for (int i=n_sections-1; i>=0; i--){
+        sections.push_back(i);
+    }
+    std::vector<stfnum::MeasureResult> results =
+        stfnum::measureBatch(mychannel, sections, settings, dt);
+    EXPECT_EQ(results.size(), sections.size());
+
+    for (std::size_t n=0; n<results.size(); n++){
+        double amp = sections[n]+1.;
+        EXPECT_NEAR(results[n].base, 0, tol);
+        EXPECT_NEAR(results[n].peak, amp, amp*tol);
+        EXPECT_NEAR(results[n].peakT*dt, PI/2, tol);
+        /* same rise time and half duration as in risetime_values
+           and half_duration, independent of the amplitude */
+        double risetime_xpted = std::asin(0.8) - std::asin(0.2);
+        EXPECT_NEAR(results[n].risetime, risetime_xpted, fabs(risetime_xpted*tol));
+        double half_dur_xpted = std::asin(0.5)+std::asin(1.0);
+        EXPECT_NEAR(results[n].halfwidth, half_dur_xpted, fabs(half_dur_xpted*tol));
+    }
+
+    /* Out of range section index */
+    sections.push_back(n_sections);
+    EXPECT_THROW(stfnum::measureBatch(mychannel, sections, settings, dt),
+                 std::out_of_range);
+}
+
+//=========================================================================
+// test extraction of events with a linear rise and an exponential decay
+//=========================================================================
+TEST(measlib_test, extract_events){
+
+    const std::size_t rise = 20;
+    const double tau = 1.0;
+    Vector_double data(3000, 0.0);
+    std::vector<std::size_t> onsets;
+    onsets.push_back(500);
+    onsets.push_back(1500);
+    onsets.push_back(10);   /* window starts before the data */
+    onsets.push_back(2900); /* window ends after the data */
+    for (std::size_t n=0; n<onsets.size(); n++){
+        double amp = n+1.;
+        for (std::size_t i=onsets[n]; i<data.size(); i++){
+            std::size_t t = i-onsets[n];
+            if (t < rise) {
+                data[i] += amp*t/rise;
+            } else if (t < 400) {
+                data[i] += amp*exp(-double(t-rise)*dt/tau);
+            }
+        }
+    }
+
+    stfnum::EventSettings settings;
+    settings.before = 50;
+    settings.after = 400;
+    settings.dir = stfnum::up;
+    std::vector<stfnum::EventResult> results;
+    Vector_double block = stfnum::extractEvents(data, onsets, settings, dt, results);
+    const std::size_t width = settings.before+settings.after;
+    ASSERT_EQ(block.size(), onsets.size()*width);
+    ASSERT_EQ(results.size(), onsets.size());
+
+    for (std::size_t n=0; n<2; n++){
+        double amp = n+1.;
+        EXPECT_DOUBLE_EQ(block[n*width+settings.before+rise], data[onsets[n]+rise]);
+        EXPECT_NEAR(results[n].base, 0, tol);
+        EXPECT_NEAR(results[n].amplitude, amp, amp*tol);
+        EXPECT_NEAR(results[n].peakT, settings.before+rise, 1);
+        /* 20-80% of a linear rise */
+        EXPECT_NEAR(results[n].risetime, 0.6*rise*dt, dt);
+        EXPECT_NEAR(results[n].tau, tau, tau*tol);
+        double tDecay = (settings.after-1-rise)*dt;
+        double charge_xpted = amp*rise*dt/2 + amp*tau*(1-exp(-tDecay/tau));
+        EXPECT_NEAR(results[n].charge, charge_xpted, fabs(charge_xpted*tol));
+    }
+
+    /* points outside of the data are replaced by the first or last point */
+    EXPECT_DOUBLE_EQ(block[2*width], data[0]);
+    EXPECT_DOUBLE_EQ(block[2*width+settings.before], data[10]);
+    EXPECT_DOUBLE_EQ(block[4*width-1], data[data.size()-1]);
+
+    settings.after = 0;
+    EXPECT_THROW(stfnum::extractEvents(data, onsets, settings, dt, results),
+                 std::out_of_range);
+}
+
 
 
 //=========================================================================
@@ -0,0 +1,653 @@
+#include "../libstfio/stfio.h"
+#include "../libstfio/cache/cachelib.h"
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+static Recording test_recording() {
+    Recording rec(2, 3, 128);
+    for (std::size_t n_c=0; n_c < rec.size(); ++n_c) {
+        for (std::size_t n_s=0; n_s < rec[n_c].size(); ++n_s) {
+            for (std::size_t n_p=0; n_p < rec[n_c][n_s].size(); ++n_p) {
+                rec[n_c][n_s][n_p] = 1000.0*n_c + 100.0*n_s + n_p;
+            }
+        }
+    }
+    rec[0].SetChannelName("Vm");
+    rec[0].SetYUnits("mV");
+    rec[1].SetChannelName("Im");
+    rec[1].SetYUnits("pA");
+    rec.SetXScale(0.05);
+    return rec;
+}
+
+// Writes the channels of each Recording as traces of one series of a
+// bundled HEKA file, in the byte order of the host. Channel 0 is stored
+// as int16 with a scaler of 0.5, other channels as float32.
+static void write_heka_bundle(const std::string& fName, const std::vector<Recording>& series) {
+    const int sizes[] = {544, 128, 1120, 160, 296};
+    const int one = 1;
+    const bool littleEndian = (*(const char*)&one == 1);
+    std::vector<char> dat, pul;
+
+    pul.insert(pul.end(), "eerT", "eerT"+4);
+    int levels = 5;
+    pul.insert(pul.end(), (char*)&levels, (char*)&levels+sizeof(int));
+    pul.insert(pul.end(), (char*)sizes, (char*)sizes+sizeof(sizes));
+    // records are followed by the number of their children
+    int nchildren[] = {1, (int)series.size()};
+    for (int level=0; level < 2; ++level) {
+        pul.resize(pul.size()+sizes[level]);
+        pul.insert(pul.end(), (char*)&nchildren[level], (char*)&nchildren[level]+sizeof(int));
+    }
+    for (std::size_t n_r=0; n_r < series.size(); ++n_r) {
+        const Recording& rec = series[n_r];
+        int nsweeps = (int)rec[0].size(), nchannels = (int)rec.size();
+        pul.resize(pul.size()+sizes[2]);
+        pul.insert(pul.end(), (char*)&nsweeps, (char*)&nsweeps+sizeof(int));
+        for (int n_s=0; n_s < nsweeps; ++n_s) {
+            pul.resize(pul.size()+sizes[3]);
+            pul.insert(pul.end(), (char*)&nchannels, (char*)&nchannels+sizeof(int));
+            for (int n_c=0; n_c < nchannels; ++n_c) {
+                const Section& sec = rec[n_c][n_s];
+                char trace[296+sizeof(int)] = {0};
+                int offset = 256 + (int)dat.size(), npoints = (int)sec.size();
+                double scaler = (n_c == 0) ? 0.5 : 1.0, dt = rec.GetXScale()*1.0e-3;
+                for (int n_p=0; n_p < npoints; ++n_p) {
+                    if (n_c == 0) {
+                        short value = (short)(sec[n_p]/scaler);
+                        dat.insert(dat.end(), (char*)&value, (char*)&value+sizeof(short));
+                    } else {
+                        float value = (float)sec[n_p];
+                        dat.insert(dat.end(), (char*)&value, (char*)&value+sizeof(float));
+                    }
+                }
+                strncpy(trace+4, rec[n_c].GetChannelName().c_str(), 31);
+                memcpy(trace+40, &offset, sizeof(int));
+                memcpy(trace+44, &npoints, sizeof(int));
+                trace[70] = (n_c == 0) ? 0 : 2;
+                memcpy(trace+72, &scaler, sizeof(double));
+                strncpy(trace+96, rec[n_c].GetYUnits().c_str(), 7);
+                memcpy(trace+104, &dt, sizeof(double));
+                trace[120] = 's';
+                pul.insert(pul.end(), trace, trace+sizeof(trace));
+            }
+        }
+    }
+
+    char header[256] = {0};
+    int items[] = {256, (int)dat.size(), 256 + (int)dat.size(), (int)pul.size()};
+    strcpy(header, "DAT2");
+    header[52] = littleEndian ? 1 : 0;
+    memcpy(header+64, &items[0], 2*sizeof(int));
+    strcpy(header+72, ".dat");
+    memcpy(header+80, &items[2], 2*sizeof(int));
+    strcpy(header+88, ".pul");
+
+    FILE* fh = fopen(fName.c_str(), "wb");
+    fwrite(header, 1, sizeof(header), fh);
+    fwrite(&dat[0], 1, dat.size(), fh);
+    fwrite(&pul[0], 1, pul.size(), fh);
+    fclose(fh);
+}
+
+TEST(stfio_test, lazy_hdf5)
+{
+    const std::string fName("stfio_test_lazy.h5");
+    Recording rec = test_recording();
+    stfio::StdoutProgressInfo progDlg("", "", 100, false);
+    ASSERT_TRUE( stfio::exportFile(fName, stfio::hdf5, rec, progDlg) );
+
+    stfio::LazyFile* lazy = stfio::openLazyFile(fName, stfio::hdf5);
+    ASSERT_TRUE( lazy != NULL );
+
+    const Recording& header = lazy->GetHeader();
+    EXPECT_EQ( header.size(), rec.size() );
+    EXPECT_DOUBLE_EQ( header.GetXScale(), rec.GetXScale() );
+    for (std::size_t n_c=0; n_c < rec.size(); ++n_c) {
+        EXPECT_EQ( header[n_c].size(), rec[n_c].size() );
+        EXPECT_EQ( header[n_c].GetChannelName(), rec[n_c].GetChannelName() );
+        EXPECT_EQ( header[n_c].GetYUnits(), rec[n_c].GetYUnits() );
+        EXPECT_EQ( header[n_c][0].size(), 0 );
+    }
+
+    // read sections in arbitrary order
+    Section sec;
+    lazy->ReadSection(1, 2, sec);
+    ASSERT_EQ( sec.size(), rec[1][2].size() );
+    for (std::size_t n_p=0; n_p < sec.size(); ++n_p) {
+        EXPECT_DOUBLE_EQ( sec[n_p], rec[1][2][n_p] );
+    }
+    lazy->ReadSection(0, 0, sec);
+    ASSERT_EQ( sec.size(), rec[0][0].size() );
+    EXPECT_DOUBLE_EQ( sec[sec.size()-1], rec[0][0][sec.size()-1] );
+
+    EXPECT_THROW( lazy->ReadSection(2, 0, sec), std::out_of_range );
+    EXPECT_THROW( lazy->ReadSection(0, 3, sec), std::out_of_range );
+
+    delete lazy;
+    std::remove(fName.c_str());
+}
+
+TEST(stfio_test, probe_hdf5)
+{
+    const std::string fName("stfio_test_probe.h5");
+    Recording rec = test_recording();
+    stfio::StdoutProgressInfo progDlg("", "", 100, false);
+    ASSERT_TRUE( stfio::exportFile(fName, stfio::hdf5, rec, progDlg) );
+
+    stfio::FileInfo info = stfio::probeFile(fName, stfio::hdf5);
+    EXPECT_DOUBLE_EQ( info.dt, rec.GetXScale() );
+    ASSERT_EQ( info.channels.size(), rec.size() );
+    for (std::size_t n_c=0; n_c < rec.size(); ++n_c) {
+        EXPECT_EQ( info.channels[n_c].name, rec[n_c].GetChannelName() );
+        EXPECT_EQ( info.channels[n_c].yunits, rec[n_c].GetYUnits() );
+        EXPECT_EQ( info.channels[n_c].sections, rec[n_c].size() );
+    }
+
+    std::remove(fName.c_str());
+    EXPECT_THROW( stfio::probeFile(fName, stfio::hdf5), std::runtime_error );
+}
+
+TEST(stfio_test, cache_hdf5)
+{
+    const std::string fName("stfio_test_cache.h5");
+    Recording rec = test_recording();
+    stfio::StdoutProgressInfo progDlg("", "", 100, false);
+    ASSERT_TRUE( stfio::exportFile(fName, stfio::hdf5, rec, progDlg) );
+
+    stfio::SetCacheDirectory(".");
+    EXPECT_EQ( stfio::GetCacheDirectory(), "." );
+    const std::string cacheName = stfio::cacheFileName(".", fName);
+    ASSERT_FALSE( cacheName.empty() );
+
+    // first import writes the cache, second import reads it
+    stfio::txtImportSettings txtImport;
+    Recording rec1, rec2;
+    ASSERT_TRUE( stfio::importFile(fName, stfio::hdf5, rec1, txtImport, progDlg) );
+    FILE* fp = fopen(cacheName.c_str(), "rb");
+    EXPECT_TRUE( fp != NULL );
+    if (fp != NULL) {
+        fclose(fp);
+    }
+    ASSERT_TRUE( stfio::importFile(fName, stfio::hdf5, rec2, txtImport, progDlg) );
+    stfio::SetCacheDirectory("");
+
+    ASSERT_EQ( rec2.size(), rec.size() );
+    EXPECT_DOUBLE_EQ( rec2.GetXScale(), rec1.GetXScale() );
+    EXPECT_EQ( rec2.GetComment(), rec1.GetComment() );
+    for (std::size_t n_c=0; n_c < rec.size(); ++n_c) {
+        EXPECT_EQ( rec2[n_c].GetChannelName(), rec[n_c].GetChannelName() );
+        EXPECT_EQ( rec2[n_c].GetYUnits(), rec[n_c].GetYUnits() );
+        ASSERT_EQ( rec2[n_c].size(), rec[n_c].size() );
+        for (std::size_t n_s=0; n_s < rec[n_c].size(); ++n_s) {
+            ASSERT_EQ( rec2[n_c][n_s].size(), rec[n_c][n_s].size() );
+            for (std::size_t n_p=0; n_p < rec[n_c][n_s].size(); ++n_p) {
+                EXPECT_DOUBLE_EQ( rec2[n_c][n_s][n_p], rec[n_c][n_s][n_p] );
+            }
+        }
+    }
+
+    std::remove(cacheName.c_str());
+    std::remove(fName.c_str());
+}
+
+TEST(stfio_test, cache_markers)
+{
+    const std::string fName("stfio_test_cache_markers.h5");
+    Recording rec = test_recording();
+    stfio::StdoutProgressInfo progDlg("", "", 100, false);
+    ASSERT_TRUE( stfio::exportFile(fName, stfio::hdf5, rec, progDlg) );
+    EXPECT_EQ( rec.GetSectionType(0), 0 );
+
+    rec.InitSectionMarkerList(rec[0].size());
+    rec.SetSectionType(1, 2);
+    rec.SetSectionType(2, 7);
+    rec.SetEventDescription(2, "stimulus");
+    const std::string cacheName = stfio::cacheFileName(".", fName);
+    ASSERT_TRUE( stfio::exportCacheFile(cacheName, fName, rec) );
+
+    Recording rec2;
+    ASSERT_TRUE( stfio::importCacheFile(cacheName, fName, rec2) );
+    ASSERT_EQ( rec2.GetSectionMarkerCount(), rec[0].size() );
+    EXPECT_EQ( rec2.GetSectionType(0), 0 );
+    EXPECT_EQ( rec2.GetSectionType(1), 2 );
+    EXPECT_EQ( rec2.GetSectionType(2), 7 );
+    EXPECT_EQ( rec2.GetEventDescription(2), "stimulus" );
+    EXPECT_EQ( rec2.GetEventDescription(7), "" );
+
+    std::remove(cacheName.c_str());
+    std::remove(fName.c_str());
+}
+
+TEST(stfio_test, import_heka)
+{
+    const std::string fName("stfio_test_heka.dat");
+    Recording rec = test_recording();
+    std::vector<Recording> series(2, rec);
+    series[1][0].resize(1);
+    series[1][1].resize(1);
+    write_heka_bundle(fName, series);
+
+    Recording rec2;
+    stfio::StdoutProgressInfo progDlg("", "", 100, false);
+    stfio::txtImportSettings txtImport;
+    ASSERT_TRUE( stfio::importFile(fName, stfio::heka, rec2, txtImport, progDlg) );
+    EXPECT_DOUBLE_EQ( rec2.GetXScale(), rec.GetXScale() );
+    ASSERT_EQ( rec2.size(), rec.size() );
+    for (std::size_t n_c=0; n_c < rec.size(); ++n_c) {
+        EXPECT_EQ( rec2[n_c].GetChannelName(), rec[n_c].GetChannelName() );
+        EXPECT_EQ( rec2[n_c].GetYUnits(), rec[n_c].GetYUnits() );
+        // the sweeps of both series
+        ASSERT_EQ( rec2[n_c].size(), rec[n_c].size()+1 );
+        for (std::size_t n_s=0; n_s < rec2[n_c].size(); ++n_s) {
+            const Section& sec = rec[n_c][n_s % rec[n_c].size()];
+            ASSERT_EQ( rec2[n_c][n_s].size(), sec.size() );
+            for (std::size_t n_p=0; n_p < sec.size(); ++n_p) {
+                EXPECT_DOUBLE_EQ( rec2[n_c][n_s][n_p], sec[n_p] );
+            }
+        }
+    }
+
+    std::remove(fName.c_str());
+}
+
+TEST(stfio_test, import_heka_mixed_rates)
+{
+    const std::string fName("stfio_test_rates.dat");
+    Recording rec = test_recording();
+    std::vector<Recording> series(2, rec);
+    series[1].SetXScale(2*rec.GetXScale());
+    write_heka_bundle(fName, series);
+    stfio::StdoutProgressInfo progDlg("", "", 100, false);
+    stfio::txtImportSettings txtImport;
+
+    // a single series has a single sampling interval
+    stfio::ImportFilter filter;
+    filter.series = 1;
+    Recording rec2;
+    ASSERT_TRUE( stfio::importFile(fName, stfio::heka, rec2, txtImport, filter, progDlg) );
+    EXPECT_DOUBLE_EQ( rec2.GetXScale(), series[1].GetXScale() );
+    ASSERT_EQ( rec2[0].size(), rec[0].size() );
+
+    // the native reader refuses to concatenate both series, which
+    // leaves them to libbiosig
+#if (!defined(WITH_BIOSIG) && !defined(WITH_BIOSIG2))
+    Recording rec3;
+    EXPECT_THROW( stfio::importFile(fName, stfio::heka, rec3, txtImport, progDlg),
+                  std::runtime_error );
+#endif
+
+    std::remove(fName.c_str());
+}
+
+TEST(stfio_test, import_filter_heka)
+{
+    const std::string fName("stfio_test_filter.dat");
+    Recording rec = test_recording();
+    std::vector<Recording> series(2, rec);
+    for (std::size_t n_c=0; n_c < rec.size(); ++n_c) {
+        series[1][n_c].resize(1);
+        for (std::size_t n_p=0; n_p < rec[n_c][0].size(); ++n_p) {
+            series[1][n_c][0][n_p] = 50.0 + n_c;
+        }
+    }
+    write_heka_bundle(fName, series);
+    stfio::StdoutProgressInfo progDlg("", "", 100, false);
+    stfio::txtImportSettings txtImport;
+
+    // second series only
+    stfio::ImportFilter filter;
+    filter.group = 0;
+    filter.series = 1;
+    Recording rec2;
+    ASSERT_TRUE( stfio::importFile(fName, stfio::heka, rec2, txtImport, filter, progDlg) );
+    ASSERT_EQ( rec2.size(), rec.size() );
+    ASSERT_EQ( rec2[1].size(), 1 );
+    ASSERT_EQ( rec2[1][0].size(), rec[1][0].size() );
+    EXPECT_DOUBLE_EQ( rec2[1][0][0], 51.0 );
+
+    // second channel, sweeps 1 and 2 of the first series, samples 10 to 19
+    filter = stfio::ImportFilter();
+    filter.series = 0;
+    filter.channels.push_back(1);
+    filter.firstSweep = 1;
+    filter.lastSweep = 2;
+    filter.tStart = 10*rec.GetXScale();
+    filter.tEnd = 20*rec.GetXScale();
+    Recording rec3;
+    ASSERT_TRUE( stfio::importFile(fName, stfio::heka, rec3, txtImport, filter, progDlg) );
+    ASSERT_EQ( rec3.size(), 1 );
+    EXPECT_EQ( rec3[0].GetChannelName(), rec[1].GetChannelName() );
+    ASSERT_EQ( rec3[0].size(), 2 );
+    for (std::size_t n_s=0; n_s < 2; ++n_s) {
+        ASSERT_EQ( rec3[0][n_s].size(), 10 );
+        for (std::size_t n_p=0; n_p < 10; ++n_p) {
+            EXPECT_DOUBLE_EQ( rec3[0][n_s][n_p], rec[1][n_s+1][n_p+10] );
+        }
+    }
+
+    filter.channels[0] = 2;
+    EXPECT_THROW( stfio::importFile(fName, stfio::heka, rec3, txtImport, filter, progDlg),
+                  std::out_of_range );
+
+    std::remove(fName.c_str());
+}
+
+TEST(stfio_test, lazy_heka)
+{
+    const std::string fName("stfio_test_lazy.dat");
+    Recording rec = test_recording();
+    write_heka_bundle(fName, std::vector<Recording>(1, rec));
+
+    stfio::LazyFile* lazy = stfio::openLazyFile(fName, stfio::heka);
+    ASSERT_TRUE( lazy != NULL );
+    const Recording& header = lazy->GetHeader();
+    ASSERT_EQ( header.size(), rec.size() );
+    EXPECT_DOUBLE_EQ( header.GetXScale(), rec.GetXScale() );
+    EXPECT_EQ( header[1].size(), rec[1].size() );
+    EXPECT_EQ( header[1][0].size(), 0 );
+
+    Section sec;
+    lazy->ReadSection(1, 2, sec);
+    ASSERT_EQ( sec.size(), rec[1][2].size() );
+    for (std::size_t n_p=0; n_p < sec.size(); ++n_p) {
+        EXPECT_DOUBLE_EQ( sec[n_p], rec[1][2][n_p] );
+    }
+    lazy->ReadSection(0, 1, sec);
+    ASSERT_EQ( sec.size(), rec[0][1].size() );
+    EXPECT_DOUBLE_EQ( sec[5], rec[0][1][5] );
+    EXPECT_THROW( lazy->ReadSection(0, 3, sec), std::out_of_range );
+
+    delete lazy;
+    std::remove(fName.c_str());
+
+#if (!defined(WITH_BIOSIG) && !defined(WITH_BIOSIG2))
+    // without libbiosig, series with different sampling rates can't be read
+    std::vector<Recording> series(2, rec);
+    series[1].SetXScale(2*rec.GetXScale());
+    write_heka_bundle(fName, series);
+    EXPECT_THROW( stfio::openLazyFile(fName, stfio::heka), std::runtime_error );
+    std::remove(fName.c_str());
+#endif
+}
+
+TEST(stfio_test, probe_heka)
+{
+    const std::string fName("stfio_test_probe.dat");
+    Recording rec = test_recording();
+    write_heka_bundle(fName, std::vector<Recording>(2, rec));
+
+    stfio::FileInfo info = stfio::probeFile(fName, stfio::heka);
+    EXPECT_DOUBLE_EQ( info.dt, rec.GetXScale() );
+    ASSERT_EQ( info.channels.size(), rec.size() );
+    for (std::size_t n_c=0; n_c < rec.size(); ++n_c) {
+        EXPECT_EQ( info.channels[n_c].name, rec[n_c].GetChannelName() );
+        EXPECT_EQ( info.channels[n_c].yunits, rec[n_c].GetYUnits() );
+        EXPECT_EQ( info.channels[n_c].sections, 2*rec[n_c].size() );
+    }
+
+    // a single sampling interval can't describe both series
+    std::vector<Recording> series(2, rec);
+    series[1].SetXScale(2*rec.GetXScale());
+    write_heka_bundle(fName, series);
+    EXPECT_THROW( stfio::probeFile(fName, stfio::heka), std::runtime_error );
+    std::remove(fName.c_str());
+
+    // text files can't be probed without reading them
+    const std::string atfName("stfio_test_probe.atf");
+    stfio::StdoutProgressInfo progDlg("", "", 100, false);
+    ASSERT_TRUE( stfio::exportFile(atfName, stfio::atf, rec, progDlg) );
+    EXPECT_THROW( stfio::probeFile(atfName, stfio::atf), std::runtime_error );
+    std::remove(atfName.c_str());
+}
+
+TEST(stfio_test, atf_roundtrip)
+{
+    const std::string fName("stfio_test_atf.atf");
+    Recording rec = test_recording();
+    rec.resize(1);
+    stfio::StdoutProgressInfo progDlg("", "", 100, false);
+    ASSERT_TRUE( stfio::exportFile(fName, stfio::atf, rec, progDlg) );
+
+    stfio::txtImportSettings txtImport;
+    Recording rec2;
+    ASSERT_TRUE( stfio::importFile(fName, stfio::atf, rec2, txtImport, progDlg) );
+    ASSERT_EQ( rec2.size(), 1 );
+    ASSERT_EQ( rec2[0].size(), rec[0].size() );
+    EXPECT_NEAR( rec2.GetXScale(), rec.GetXScale(), 1e-9 );
+    EXPECT_EQ( rec2[0].GetYUnits(), rec[0].GetYUnits() );
+    for (std::size_t n_s=0; n_s < rec[0].size(); ++n_s) {
+        ASSERT_EQ( rec2[0][n_s].size(), rec[0][n_s].size() );
+        for (std::size_t n_p=0; n_p < rec[0][n_s].size(); ++n_p) {
+            EXPECT_DOUBLE_EQ( rec2[0][n_s][n_p], rec[0][n_s][n_p] );
+        }
+    }
+
+    std::remove(fName.c_str());
+}
+
+TEST(stfio_test, import_ascii)
+{
+    const std::string fName("stfio_test_ascii.txt");
+    FILE* fp = fopen(fName.c_str(), "w");
+    ASSERT_TRUE( fp != NULL );
+    fprintf(fp, "time\tVm\tIm\r\n");
+    for (int n_l=0; n_l < 100; ++n_l) {
+        fprintf(fp, "%g\t%.17g %.17g\r\n", 0.05*n_l, -65.0+n_l/3.0, 1e-3*n_l);
+    }
+    fprintf(fp, "\r\n");
+    fclose(fp);
+
+    stfio::txtImportSettings txtImport;
+    txtImport.ncolumns = 3;
+    stfio::StdoutProgressInfo progDlg("", "", 100, false);
+    Recording rec;
+    ASSERT_TRUE( stfio::importFile(fName, stfio::ascii, rec, txtImport, progDlg) );
+    ASSERT_EQ( rec.size(), 1 );
+    ASSERT_EQ( rec[0].size(), 2 );
+    EXPECT_NEAR( rec.GetXScale(), 0.05, 1e-12 );
+    EXPECT_EQ( rec.GetFileDescription(), "time\tVm\tIm\n" );
+    EXPECT_EQ( rec[0].GetYUnits(), txtImport.yUnits );
+    for (int n_l=0; n_l < 100; ++n_l) {
+        ASSERT_EQ( rec[0][0].size(), 100 );
+        EXPECT_DOUBLE_EQ( rec[0][0][n_l], -65.0+n_l/3.0 );
+        EXPECT_DOUBLE_EQ( rec[0][1][n_l], 1e-3*n_l );
+    }
+
+    // columns to channels
+    txtImport.toSection = false;
+    Recording rec2;
+    ASSERT_TRUE( stfio::importFile(fName, stfio::ascii, rec2, txtImport, progDlg) );
+    ASSERT_EQ( rec2.size(), 2 );
+    ASSERT_EQ( rec2[1].size(), 1 );
+    EXPECT_EQ( rec2[1].GetYUnits(), txtImport.yUnitsCh2 );
+    EXPECT_DOUBLE_EQ( rec2[1][0][99], rec[0][1][99] );
+
+    std::remove(fName.c_str());
+}
+
+TEST(stfio_test, import_filter_hdf5)
+{
+    const std::string fName("stfio_test_filter.h5");
+    Recording rec = test_recording();
+    stfio::StdoutProgressInfo progDlg("", "", 100, false);
+    ASSERT_TRUE( stfio::exportFile(fName, stfio::hdf5, rec, progDlg) );
+
+    stfio::txtImportSettings txtImport;
+    stfio::ImportFilter filter;
+    EXPECT_TRUE( filter.empty() );
+    filter.channels.push_back(1);
+    filter.firstSweep = 1;
+    filter.lastSweep = 5;
+    EXPECT_FALSE( filter.empty() );
+
+    Recording rec2;
+    ASSERT_TRUE( stfio::importFile(fName, stfio::hdf5, rec2, txtImport, filter, progDlg) );
+    ASSERT_EQ( rec2.size(), 1 );
+    ASSERT_EQ( rec2[0].size(), 2 );
+    EXPECT_EQ( rec2[0].GetChannelName(), rec[1].GetChannelName() );
+    EXPECT_EQ( rec2[0].GetYUnits(), rec[1].GetYUnits() );
+    EXPECT_DOUBLE_EQ( rec2.GetXScale(), rec.GetXScale() );
+    for (std::size_t n_s=0; n_s < rec2[0].size(); ++n_s) {
+        ASSERT_EQ( rec2[0][n_s].size(), rec[1][n_s+1].size() );
+        for (std::size_t n_p=0; n_p < rec2[0][n_s].size(); ++n_p) {
+            EXPECT_DOUBLE_EQ( rec2[0][n_s][n_p], rec[1][n_s+1][n_p] );
+        }
+    }
+
+    // samples 20 to 59 of each sweep
+    stfio::ImportFilter window;
+    window.tStart = 1.0;
+    window.tEnd = 3.0;
+    EXPECT_FALSE( window.empty() );
+    Recording rec4;
+    ASSERT_TRUE( stfio::importFile(fName, stfio::hdf5, rec4, txtImport, window, progDlg) );
+    ASSERT_EQ( rec4.size(), rec.size() );
+    ASSERT_EQ( rec4[1].size(), rec[1].size() );
+    ASSERT_EQ( rec4[1][2].size(), 40 );
+    EXPECT_DOUBLE_EQ( rec4[1][2][0], rec[1][2][20] );
+    EXPECT_DOUBLE_EQ( rec4[1][2][39], rec[1][2][59] );
+
+    filter.channels[0] = 2;
+    Recording rec3;
+    EXPECT_THROW( stfio::importFile(fName, stfio::hdf5, rec3, txtImport, filter, progDlg),
+                  std::out_of_range );
+
+    std::remove(fName.c_str());
+}
+
+TEST(stfio_test, cfs_roundtrip)
+{
+    const std::string fName("stfio_test_cfs.dat");
+    Recording rec = test_recording();
+    stfio::StdoutProgressInfo progDlg("", "", 100, false);
+    ASSERT_TRUE( stfio::exportFile(fName, stfio::cfs, rec, progDlg) );
+
+    stfio::txtImportSettings txtImport;
+    Recording rec2;
+    ASSERT_TRUE( stfio::importFile(fName, stfio::cfs, rec2, txtImport, progDlg) );
+    ASSERT_EQ( rec2.size(), rec.size() );
+    EXPECT_NEAR( rec2.GetXScale(), rec.GetXScale(), 1e-6 );
+    for (std::size_t n_c=0; n_c < rec.size(); ++n_c) {
+        EXPECT_EQ( rec2[n_c].GetChannelName(), rec[n_c].GetChannelName() );
+        EXPECT_EQ( rec2[n_c].GetYUnits(), rec[n_c].GetYUnits() );
+        ASSERT_EQ( rec2[n_c].size(), rec[n_c].size() );
+        for (std::size_t n_s=0; n_s < rec[n_c].size(); ++n_s) {
+            ASSERT_EQ( rec2[n_c][n_s].size(), rec[n_c][n_s].size() );
+            for (std::size_t n_p=0; n_p < rec[n_c][n_s].size(); ++n_p) {
+                EXPECT_FLOAT_EQ( rec2[n_c][n_s][n_p], rec[n_c][n_s][n_p] );
+            }
+        }
+    }
+
+    std::remove(fName.c_str());
+}
+
+TEST(stfio_test, export_lazy)
+{
+    const std::string fName("stfio_test_export_lazy.h5");
+    Recording rec = test_recording();
+    stfio::StdoutProgressInfo progDlg("", "", 100, false);
+    ASSERT_TRUE( stfio::exportFile(fName, stfio::hdf5, rec, progDlg) );
+
+    stfio::LazyFile* lazy = stfio::openLazyFile(fName, stfio::hdf5);
+    ASSERT_TRUE( lazy != NULL );
+
+    // sweep by sweep with prefetching, and into a file of the same library
+    const std::string cfsName("stfio_test_export_lazy.dat");
+    const std::string hdf5Name("stfio_test_export_lazy2.h5");
+    ASSERT_TRUE( stfio::exportFile(cfsName, stfio::cfs, *lazy, progDlg, true) );
+    ASSERT_TRUE( stfio::exportFile(hdf5Name, stfio::hdf5, *lazy, progDlg, true) );
+    delete lazy;
+
+    stfio::txtImportSettings txtImport;
+    Recording cfsRec, hdf5Rec;
+    ASSERT_TRUE( stfio::importFile(cfsName, stfio::cfs, cfsRec, txtImport, progDlg) );
+    ASSERT_TRUE( stfio::importFile(hdf5Name, stfio::hdf5, hdf5Rec, txtImport, progDlg) );
+    ASSERT_EQ( cfsRec.size(), rec.size() );
+    ASSERT_EQ( hdf5Rec.size(), rec.size() );
+    for (std::size_t n_c=0; n_c < rec.size(); ++n_c) {
+        EXPECT_EQ( hdf5Rec[n_c].GetChannelName(), rec[n_c].GetChannelName() );
+        EXPECT_EQ( cfsRec[n_c].GetYUnits(), rec[n_c].GetYUnits() );
+        ASSERT_EQ( cfsRec[n_c].size(), rec[n_c].size() );
+        ASSERT_EQ( hdf5Rec[n_c].size(), rec[n_c].size() );
+        for (std::size_t n_s=0; n_s < rec[n_c].size(); ++n_s) {
+            ASSERT_EQ( cfsRec[n_c][n_s].size(), rec[n_c][n_s].size() );
+            ASSERT_EQ( hdf5Rec[n_c][n_s].size(), rec[n_c][n_s].size() );
+            for (std::size_t n_p=0; n_p < rec[n_c][n_s].size(); ++n_p) {
+                EXPECT_FLOAT_EQ( cfsRec[n_c][n_s][n_p], rec[n_c][n_s][n_p] );
+                EXPECT_FLOAT_EQ( hdf5Rec[n_c][n_s][n_p], rec[n_c][n_s][n_p] );
+            }
+        }
+    }
+
+    std::remove(fName.c_str());
+    std::remove(cfsName.c_str());
+    std::remove(hdf5Name.c_str());
+}
+
+#if defined(WITH_BIOSIG2)
+TEST(stfio_test, gdf_roundtrip)
+{
+    const std::string fName("stfio_test_gdf.gdf");
+    Recording rec = test_recording();
+    stfio::StdoutProgressInfo progDlg("", "", 100, false);
+    ASSERT_TRUE( stfio::exportFile(fName, stfio::biosig, rec, progDlg) );
+
+    stfio::txtImportSettings txtImport;
+    Recording rec2;
+    ASSERT_TRUE( stfio::importFile(fName, stfio::biosig, rec2, txtImport, progDlg) );
+    ASSERT_EQ( rec2.size(), rec.size() );
+    for (std::size_t n_c=0; n_c < rec.size(); ++n_c) {
+        EXPECT_EQ( rec2[n_c].GetYUnits(), rec[n_c].GetYUnits() );
+        ASSERT_EQ( rec2[n_c].size(), rec[n_c].size() );
+        for (std::size_t n_s=0; n_s < rec[n_c].size(); ++n_s) {
+            ASSERT_EQ( rec2[n_c][n_s].size(), rec[n_c][n_s].size() );
+            for (std::size_t n_p=0; n_p < rec[n_c][n_s].size(); ++n_p) {
+                EXPECT_DOUBLE_EQ( rec2[n_c][n_s][n_p], rec[n_c][n_s][n_p] );
+            }
+        }
+    }
+
+    // data records that don't start at the beginning of the file
+    stfio::ImportFilter filter;
+    filter.channels.push_back(1);
+    filter.firstSweep = 1;
+    Recording rec3;
+    ASSERT_TRUE( stfio::importFile(fName, stfio::biosig, rec3, txtImport, filter, progDlg) );
+    ASSERT_EQ( rec3.size(), 1 );
+    ASSERT_EQ( rec3[0].size(), rec[1].size()-1 );
+    for (std::size_t n_s=0; n_s < rec3[0].size(); ++n_s) {
+        ASSERT_EQ( rec3[0][n_s].size(), rec[1][n_s+1].size() );
+        for (std::size_t n_p=0; n_p < rec3[0][n_s].size(); ++n_p) {
+            EXPECT_DOUBLE_EQ( rec3[0][n_s][n_p], rec[1][n_s+1][n_p] );
+        }
+    }
+
+    // reordered channels within a time window
+    stfio::ImportFilter window;
+    window.channels.push_back(1);
+    window.channels.push_back(0);
+    window.tStart = 1.0;
+    window.tEnd = 3.0;
+    Recording rec4;
+    ASSERT_TRUE( stfio::importFile(fName, stfio::biosig, rec4, txtImport, window, progDlg) );
+    ASSERT_EQ( rec4.size(), 2 );
+    EXPECT_EQ( rec4[0].GetYUnits(), rec[1].GetYUnits() );
+    EXPECT_EQ( rec4[1].GetYUnits(), rec[0].GetYUnits() );
+    for (std::size_t n_c=0; n_c < rec4.size(); ++n_c) {
+        ASSERT_EQ( rec4[n_c].size(), rec[1-n_c].size() );
+        for (std::size_t n_s=0; n_s < rec4[n_c].size(); ++n_s) {
+            ASSERT_EQ( rec4[n_c][n_s].size(), 40 );
+            for (std::size_t n_p=0; n_p < rec4[n_c][n_s].size(); ++n_p) {
+                EXPECT_DOUBLE_EQ( rec4[n_c][n_s][n_p], rec[1-n_c][n_s][n_p+20] );
+            }
+        }
+    }
+
+    std::remove(fName.c_str());
+}
+#endif